@@ -614,6 +614,26 @@ public:
     return canInstructionRangeModRef(I1, I2, MemoryLocation(Ptr, Size), Mode);
   }
 
+  /// @}
+  //===--------------------------------------------------------------------===//
+  /// \name Batch Queries
+  /// @{
+
+  /// Start a batch of queries. Until the matching \c endBatch the caller
+  /// guarantees that the IR is not modified, which allows the analyses to
+  /// cache information that only depends on the IR across queries. Batches
+  /// nest, and the caches are dropped when the outermost batch ends. See
+  /// \c BatchAAScope for a convenient way to bracket a batch.
+  void beginBatch();
+
+  /// End the batch started by the matching \c beginBatch.
+  void endBatch();
+
+  /// Returns true if a batch of queries is active.
+  bool isInBatch() const { return BatchDepth != 0; }
+
+  /// @}
+
 private:
   class Concept;
 
@@ -626,12 +646,26 @@ private:
   std::vector<std::unique_ptr<Concept>> AAs;
 
   std::vector<AnalysisKey *> AADeps;
+
+  unsigned BatchDepth = 0;
 };
 
 /// Temporary typedef for legacy code that uses a generic \c AliasAnalysis
 /// pointer or reference.
 using AliasAnalysis = AAResults;
 
+/// Runs the queries issued to an \c AAResults object during the lifetime of
+/// the scope as a batch. The IR must not be modified while the scope is alive.
+class BatchAAScope {
+  AAResults &AA;
+
+public:
+  explicit BatchAAScope(AAResults &AA) : AA(AA) { AA.beginBatch(); }
+  BatchAAScope(const BatchAAScope &) = delete;
+  BatchAAScope &operator=(const BatchAAScope &) = delete;
+  ~BatchAAScope() { AA.endBatch(); }
+};
+
 /// A private abstract base class describing the concept of an individual alias
 /// analysis implementation.
 ///
@@ -695,6 +729,15 @@ public:
   virtual ModRefInfo getModRefInfo(ImmutableCallSite CS1,
                                    ImmutableCallSite CS2) = 0;
 
+  /// @}
+  //===--------------------------------------------------------------------===//
+  /// \name Batch Queries
+  /// @{
+
+  /// Called when the outermost batch of queries starts (\p Enabled is true)
+  /// and ends (\p Enabled is false).
+  virtual void setBatchMode(bool Enabled) = 0;
+
   /// @}
 };
 
@@ -746,6 +789,8 @@ public:
                            ImmutableCallSite CS2) override {
     return Result.getModRefInfo(CS1, CS2);
   }
+
+  void setBatchMode(bool Enabled) override { Result.setBatchMode(Enabled); }
 };
 
 /// A CRTP-driven "mixin" base class to help implement the function alias
@@ -868,6 +913,8 @@ public:
   ModRefInfo getModRefInfo(ImmutableCallSite CS1, ImmutableCallSite CS2) {
     return MRI_ModRef;
   }
+
+  void setBatchMode(bool Enabled) {}
 };
 
 /// Return true if this pointer is returned by a noalias function.
@@ -49,7 +49,9 @@ class Value;
 /// analysis. It implements the AA query interface in an entirely stateless
 /// manner. As one consequence, it is never invalidated due to IR changes.
 /// While it does retain some storage, that is used as an optimization and not
-/// to preserve information from query to query. However it does retain handles
+/// to preserve information from query to query, except during a batch of
+/// queries (see \c AAResults::beginBatch), where decomposed GEPs, underlying
+/// objects and capture information are reused. However it does retain handles
 /// to various other analyses and must be recomputed when those analyses are.
 class BasicAAResult : public AAResultBase<BasicAAResult> {
   friend AAResultBase<BasicAAResult>;
@@ -96,6 +98,9 @@ public:
   /// call site is not known.
   FunctionModRefBehavior getModRefBehavior(const Function *F);
 
+  /// Start or stop caching information across queries.
+  void setBatchMode(bool Enabled);
+
 private:
   // A linear transformation of a Value; this class represents ZExt(SExt(V,
   // SExtBits), ZExtBits) * Scale + Offset.
@@ -136,6 +141,18 @@ private:
     SmallVector<VariableGEPIndex, 4> VarIndices;
   };
 
+  /// Caches used during a batch of queries. Everything in here only depends
+  /// on the IR, which does not change during a batch.
+  struct BatchCaches {
+    /// Decomposed GEPs and whether the search limit was reached for them.
+    DenseMap<const Value *, std::pair<DecomposedGEP, bool>> DecomposedGEPs;
+    /// Underlying objects, as found by GetUnderlyingObject.
+    DenseMap<const Value *, const Value *> UnderlyingObjects;
+    /// Whether a local object may be captured.
+    DenseMap<const Value *, bool> IsCaptured;
+  };
+  Optional<BatchCaches> Batch;
+
   /// Track alias queries to guard against recursion.
   using LocPair = std::pair<MemoryLocation, MemoryLocation>;
   using AliasCacheTy = SmallDenseMap<LocPair, AliasResult, 8>;
@@ -169,6 +186,14 @@ private:
   static bool DecomposeGEPExpression(const Value *V, DecomposedGEP &Decomposed,
       const DataLayout &DL, AssumptionCache *AC, DominatorTree *DT);
 
+  /// Like \c DecomposeGEPExpression, but reuses earlier results during a
+  /// batch of queries.
+  bool decomposeGEP(const Value *V, DecomposedGEP &Decomposed);
+
+  /// Returns the underlying object of \p V, reusing earlier results during a
+  /// batch of queries.
+  const Value *getUnderlyingObject(const Value *V);
+
   static bool isGEPBaseAtNegativeOffset(const GEPOperator *GEPOp,
       const DecomposedGEP &DecompGEP, const DecomposedGEP &DecompObject,
       uint64_t ObjectAccessSize);
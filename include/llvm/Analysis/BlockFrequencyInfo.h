@@ -88,6 +88,17 @@ public:
   void setBlockFreqAndScale(const BasicBlock *ReferenceBB, uint64_t Freq,
                             SmallPtrSetImpl<BasicBlock *> &BlocksToScale);
 
+  /// Set the frequency of \p NewBB, which was inserted on an edge leaving
+  /// \p Pred that is taken with probability \p Prob, e.g. by splitting it.
+  /// The frequencies of the other blocks do not change.
+  void setBlockFreqForSplitEdge(const BasicBlock *NewBB,
+                                const BasicBlock *Pred, BranchProbability Prob);
+
+  /// Forget the frequency of \p BB, which is about to be deleted.  When two
+  /// blocks are merged, erasing the one that goes away is all that is needed,
+  /// as the merged block executes as often as both did.
+  void eraseBlock(const BasicBlock *BB);
+
   /// calculate - compute block frequency info for the given function.
   void calculate(const Function &F, const BranchProbabilityInfo &BPI,
                  const LoopInfo &LI);
@@ -594,6 +594,10 @@ template <> inline std::string getBlockName(const BasicBlock *BB) {
 /// \a GraphTraits (so that \a analyzeIrreducible() can use \a scc_iterator),
 /// and it explicitly lists predecessors and successors.  The initialization
 /// that relies on \c MachineBasicBlock is defined in the header.
+///
+/// The edges of all the nodes are kept in a single array, each node owning a
+/// contiguous range of it with its predecessors followed by its successors.
+/// Edges are collected first and laid out once all of them are known.
 struct IrreducibleGraph {
   using BFIBase = BlockFrequencyInfoImplBase;
 
@@ -603,22 +607,29 @@ struct IrreducibleGraph {
   struct IrrNode {
     BlockNode Node;
     unsigned NumIn = 0;
-    std::deque<const IrrNode *> Edges;
+    unsigned NumOut = 0;
+    const IrrNode *const *Edges = nullptr;
 
     IrrNode(const BlockNode &Node) : Node(Node) {}
 
-    using iterator = std::deque<const IrrNode *>::const_iterator;
+    using iterator = const IrrNode *const *;
 
-    iterator pred_begin() const { return Edges.begin(); }
-    iterator succ_begin() const { return Edges.begin() + NumIn; }
+    iterator pred_begin() const { return Edges; }
+    iterator succ_begin() const { return Edges + NumIn; }
     iterator pred_end() const { return succ_begin(); }
-    iterator succ_end() const { return Edges.end(); }
+    iterator succ_end() const { return Edges + NumIn + NumOut; }
   };
   BlockNode Start;
   const IrrNode *StartIrr = nullptr;
   std::vector<IrrNode> Nodes;
   SmallDenseMap<uint32_t, IrrNode *, 4> Lookup;
 
+  /// The (source, destination) pairs added by \a addEdge(), in order.
+  std::vector<std::pair<IrrNode *, IrrNode *>> PendingEdges;
+
+  /// The edges of all the nodes, see \a IrrNode::Edges.
+  std::vector<const IrrNode *> EdgeStorage;
+
   /// \brief Construct an explicit graph containing irreducible control flow.
   ///
   /// Construct an explicit graph of the control flow in \c OuterLoop (or the
@@ -651,6 +662,9 @@ struct IrreducibleGraph {
                 BlockEdgesAdder addBlockEdges);
   void addEdge(IrrNode &Irr, const BlockNode &Succ,
                const BFIBase::LoopData *OuterLoop);
+
+  /// Lay the pending edges out in \a EdgeStorage.
+  void finalizeEdges();
 };
 
 template <class BlockEdgesAdder>
@@ -665,6 +679,7 @@ void IrreducibleGraph::initialize(const BFIBase::LoopData *OuterLoop,
     for (uint32_t Index = 0; Index < BFI.Working.size(); ++Index)
       addEdges(Index, OuterLoop, addBlockEdges);
   }
+  finalizeEdges();
   StartIrr = Lookup[Start.Index];
 }
 
@@ -988,6 +1003,10 @@ public:
 
   void setBlockFreq(const BlockT *BB, uint64_t Freq);
 
+  /// Forget the frequency of \p BB, which is about to be deleted.  Its index
+  /// is not reused.
+  void eraseBlock(const BlockT *BB) { Nodes.erase(BB); }
+
   Scaled64 getFloatingBlockFreq(const BlockT *BB) const {
     return BlockFrequencyInfoImplBase::getFloatingBlockFreq(getNode(BB));
   }
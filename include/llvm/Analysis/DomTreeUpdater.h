@@ -0,0 +1,130 @@
+//===- DomTreeUpdater.h - DomTree/Post DomTree Updater ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the DomTreeUpdater class, which provides a uniform way to
+// update dominator tree related data structures.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_DOMTREEUPDATER_H
+#define LLVM_ANALYSIS_DOMTREEUPDATER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Dominators.h"
+#include <cstddef>
+
+namespace llvm {
+
+class BasicBlock;
+class Function;
+struct PostDominatorTree;
+
+/// \brief Keeps a DominatorTree and a PostDominatorTree in sync with the CFG
+/// edits of a pass.
+///
+/// With the Eager strategy, every update is applied to both trees right away.
+/// With the Lazy strategy, updates are queued and only applied to a tree when
+/// it is asked for through getDomTree() or getPostDomTree(), or when flush()
+/// is called. A pass can then make many CFG edits and pay for one batch
+/// update. If a batch is large compared to the function, the tree is
+/// recalculated instead.
+///
+/// Blocks passed to deleteBB() are emptied right away but only erased once
+/// all the pending updates have been applied, because the trees may still
+/// refer to them until then.
+class DomTreeUpdater {
+public:
+  enum class UpdateStrategy : unsigned char { Eager = 0, Lazy = 1 };
+
+  DomTreeUpdater(DominatorTree *DT, PostDominatorTree *PDT,
+                 UpdateStrategy Strategy)
+      : DT(DT), PDT(PDT), Strategy(Strategy) {}
+  DomTreeUpdater(const DomTreeUpdater &) = delete;
+  DomTreeUpdater &operator=(const DomTreeUpdater &) = delete;
+
+  /// Applies all the pending updates.
+  ~DomTreeUpdater() { flush(); }
+
+  bool isLazy() const { return Strategy == UpdateStrategy::Lazy; }
+  bool isEager() const { return Strategy == UpdateStrategy::Eager; }
+
+  bool hasDomTree() const { return DT != nullptr; }
+  bool hasPostDomTree() const { return PDT != nullptr; }
+
+  /// Returns true if some updates have not been applied to one of the trees
+  /// yet.
+  bool hasPendingUpdates() const {
+    return hasPendingDomTreeUpdates() || hasPendingPostDomTreeUpdates();
+  }
+  bool hasPendingDomTreeUpdates() const;
+  bool hasPendingPostDomTreeUpdates() const;
+
+  /// Returns true if some blocks are waiting to be erased.
+  bool hasPendingDeletedBB() const { return !DeletedBBs.empty(); }
+
+  /// Returns true if \p BB has been passed to deleteBB() but not erased yet.
+  bool isBBPendingDeletion(BasicBlock *BB) const {
+    return DeletedBBs.count(BB);
+  }
+
+  /// Inform the trees about CFG edge insertions and deletions that have
+  /// already been made. As with DominatorTree::applyUpdates(), the updates
+  /// may come in any order, and updates that cancel each other out are
+  /// dropped.
+  void applyUpdates(ArrayRef<DominatorTree::UpdateType> Updates);
+
+  /// Inform the trees about a single edge insertion or deletion that has
+  /// already been made.
+  void insertEdge(BasicBlock *From, BasicBlock *To);
+  void deleteEdge(BasicBlock *From, BasicBlock *To);
+
+  /// Delete \p DelBB, which must no longer have predecessors. The edges out
+  /// of it must have been reported as deleted. Its instructions are removed
+  /// right away and it is erased when the updates are flushed.
+  void deleteBB(BasicBlock *DelBB);
+
+  /// Apply the pending updates to the DominatorTree and return it.
+  DominatorTree &getDomTree();
+
+  /// Apply the pending updates to the PostDominatorTree and return it.
+  PostDominatorTree &getPostDomTree();
+
+  /// Drop the pending updates and recalculate both trees for \p F.
+  void recalculate(Function &F);
+
+  /// Apply all the pending updates and erase the deleted blocks.
+  void flush();
+
+private:
+  /// Bring \p Tree up to date with the updates from \p PendingIndex on, and
+  /// advance \p PendingIndex past them.
+  template <typename DomTreeT>
+  void applyPendingUpdates(DomTreeT &Tree, size_t &PendingIndex);
+
+  /// Erase the blocks passed to deleteBB() once no tree has pending updates.
+  void tryFlushDeletedBB();
+
+  /// Drop the updates that all the trees have seen.
+  void dropOutOfDateUpdates();
+
+  SmallVector<DominatorTree::UpdateType, 16> PendingUpdates;
+  size_t PendingDTUpdateIndex = 0;
+  size_t PendingPDTUpdateIndex = 0;
+  SmallSetVector<BasicBlock *, 8> DeletedBBs;
+
+  DominatorTree *DT;
+  PostDominatorTree *PDT;
+  const UpdateStrategy Strategy;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_ANALYSIS_DOMTREEUPDATER_H
@@ -14,11 +14,15 @@
 #ifndef LLVM_ANALYSIS_INLINECOST_H
 #define LLVM_ANALYSIS_INLINECOST_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/IR/ValueHandle.h"
 #include <cassert>
 #include <climits>
+#include <cstdint>
+#include <memory>
 
 namespace llvm {
 class AssumptionCacheTracker;
@@ -178,6 +182,64 @@ InlineParams getInlineParams(unsigned OptLevel, unsigned SizeOptLevel);
 /// and the call/return instruction.
 int getCallsiteCost(CallSite CS, const DataLayout &DL);
 
+/// \brief Cache of the cost of callee bodies shared between inline cost
+/// queries.
+///
+/// Call sites which pass nothing that simplifies the callee body, i.e. no
+/// constants, no allocas and no two pointers into the same object, all see
+/// the same cost for the body of the callee. That cost is summarized once per
+/// callee and reused for such call sites, so that only the call site specific
+/// part of the cost is computed for them.
+///
+/// The owner of the cache must invalidate the summary of a function whenever
+/// it changes the function. Deleted functions are removed automatically.
+class InlineCostCache {
+public:
+  /// The cost of the body of a callee, independent of the call site.
+  struct CalleeSummary {
+    /// False if the cost of the body cannot be reused, e.g. because it is
+    /// not inlinable or because its cost depends on the threshold.
+    bool Valid = false;
+    int Cost = 0;
+    unsigned NumInstructions = 0;
+    unsigned NumVectorInstructions = 0;
+    unsigned NumInstructionsSimplified = 0;
+    uint64_t AllocatedSize = 0;
+    bool SingleBB = true;
+    bool ContainsNoDuplicateCall = false;
+  };
+
+  /// Return the summary of \p F, or null if it has not been computed.
+  const CalleeSummary *lookup(const Function &F) const;
+
+  /// Record the summary of \p F.
+  const CalleeSummary &insert(Function &F, const CalleeSummary &Summary);
+
+  /// Forget the summary of \p F because its body changed.
+  void invalidate(const Function &F) { Summaries.erase(&F); }
+
+  void clear() { Summaries.clear(); }
+
+private:
+  struct SummaryHandle final : public CallbackVH {
+    InlineCostCache *Cache;
+
+    SummaryHandle(Function *F, InlineCostCache *Cache)
+        : CallbackVH(F), Cache(Cache) {}
+
+    void deleted() override;
+    void allUsesReplacedWith(Value *V) override { deleted(); }
+  };
+
+  struct Entry {
+    Entry(Function *F, InlineCostCache *Cache) : Handle(F, Cache) {}
+    SummaryHandle Handle;
+    CalleeSummary Summary;
+  };
+
+  DenseMap<const Function *, std::unique_ptr<Entry>> Summaries;
+};
+
 /// \brief Get an InlineCost object representing the cost of inlining this
 /// callsite.
 ///
@@ -188,12 +250,15 @@ int getCallsiteCost(CallSite CS, const DataLayout &DL);
 /// sufficiently low to warrant inlining.
 ///
 /// Also note that calling this function *dynamically* computes the cost of
-/// inlining the callsite. It is an expensive, heavyweight call.
+/// inlining the callsite. It is an expensive, heavyweight call. If \p Cache is
+/// provided, the cost of the callee body is reused across call sites where
+/// possible.
 InlineCost getInlineCost(
     CallSite CS, const InlineParams &Params, TargetTransformInfo &CalleeTTI,
     std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
     Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE = nullptr);
+    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE = nullptr,
+    InlineCostCache *Cache = nullptr);
 
 /// \brief Get an InlineCost with the callee explicitly specified.
 /// This allows you to calculate the cost of inlining a function via a
@@ -205,7 +270,8 @@ getInlineCost(CallSite CS, Function *Callee, const InlineParams &Params,
               TargetTransformInfo &CalleeTTI,
               std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
               Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-              ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE);
+              ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE,
+              InlineCostCache *Cache = nullptr);
 
 /// \brief Minimal filter to detect invalid constructs for inlining.
 bool isInlineViable(Function &Callee);
@@ -0,0 +1,117 @@
+//===- llvm/Analysis/LoopCacheAnalysis.h - Loop Cache Analysis --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines an estimate of the number of cache lines a loop nest
+// touches for each choice of its innermost loop. Loop transformations that
+// reorder loops, such as loop interchange, use it to find the order with the
+// best locality.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_LOOPCACHEANALYSIS_H
+#define LLVM_ANALYSIS_LOOPCACHEANALYSIS_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace llvm {
+
+class Instruction;
+class Loop;
+class raw_ostream;
+class ScalarEvolution;
+class SCEV;
+class SCEVUnknown;
+class TargetTransformInfo;
+
+/// Estimates the cache cost of a perfect loop nest.
+///
+/// The memory references of the nest are split into reference groups, which
+/// are references to the same array whose addresses differ by less than a
+/// cache line, so that they share the lines they touch. For each loop \c L of
+/// the nest, the cost of a group is the number of lines it touches while \c L
+/// runs as the innermost loop:
+///   - 1 if its address does not vary in \c L,
+///   - TripCount(L) * Stride / CacheLineSize if it moves by a constant stride
+///     smaller than a cache line each iteration of \c L,
+///   - TripCount(L) otherwise.
+/// The cost of \c L is the sum over the groups, scaled by the trip counts of
+/// the other loops of the nest. The cheapest loop is the best innermost loop,
+/// and sorting the loops by decreasing cost gives the preferred loop order.
+class CacheCost {
+public:
+  using LoopCostTy = std::pair<const Loop *, uint64_t>;
+
+  /// Compute the cache cost of the nest rooted at \p Root. Returns null if
+  /// \p Root is not the root of a perfect nest, i.e. one where every loop has
+  /// at most one subloop, if one of its loops has a very small constant trip
+  /// count, or if the nest does not access memory.
+  static std::unique_ptr<CacheCost>
+  getCacheCost(Loop &Root, ScalarEvolution &SE, TargetTransformInfo &TTI);
+
+  /// Return the estimated cost of \p L as the innermost loop of the nest.
+  uint64_t getLoopCost(const Loop &L) const {
+    auto It = LoopCostIndex.find(&L);
+    assert(It != LoopCostIndex.end() && "Loop is not part of the nest");
+    return LoopCosts[It->second].second;
+  }
+
+  /// Return the loops of the nest with their costs, most expensive first.
+  ArrayRef<LoopCostTy> getLoopCosts() const { return LoopCosts; }
+
+  void print(raw_ostream &OS) const;
+
+private:
+  /// A memory reference of the nest: the accessing instruction, the
+  /// address it accesses and the array it is based on.
+  struct Reference {
+    Instruction *I;
+    const SCEV *Addr;
+    const SCEVUnknown *Base;
+  };
+
+  CacheCost(SmallVectorImpl<Loop *> &&Loops, ScalarEvolution &SE,
+            unsigned CacheLineSize);
+
+  /// Split the memory references of the nest into groups of references that
+  /// share cache lines.
+  void collectReferenceGroups();
+
+  /// Return the number of cache lines \p Ref touches while \p L runs as the
+  /// innermost loop.
+  uint64_t computeRefCost(const Reference &Ref, const Loop &L) const;
+
+  /// Return the trip count of \p L, or an estimate if it is not known.
+  uint64_t getTripCount(const Loop &L) const;
+
+  /// Compute and sort the costs of all the loops of the nest.
+  void calculateCosts();
+
+  SmallVector<Loop *, 8> Loops;
+  ScalarEvolution &SE;
+  unsigned CacheLineSize;
+
+  /// The leader of each reference group. The cost of a group is computed for
+  /// its leader only.
+  SmallVector<Reference, 16> Groups;
+
+  SmallVector<LoopCostTy, 8> LoopCosts;
+  DenseMap<const Loop *, unsigned> LoopCostIndex;
+};
+
+raw_ostream &operator<<(raw_ostream &OS, const CacheCost &CC);
+
+} // end namespace llvm
+
+#endif // LLVM_ANALYSIS_LOOPCACHEANALYSIS_H
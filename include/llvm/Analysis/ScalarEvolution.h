@@ -1049,6 +1049,11 @@ private:
   /// The loop information for the function we are currently analyzing.
   LoopInfo &LI;
 
+  /// The work left in the budget for this function, shared by SCEV
+  /// construction, range computation and trip count analysis. Once it is used
+  /// up these return conservative results.
+  unsigned RemainingWork;
+
   /// This SCEV is used to represent unknown trip counts and things.
   std::unique_ptr<SCEVCouldNotCompute> CouldNotCompute;
 
@@ -1357,6 +1362,12 @@ private:
   /// copied if its needed for longer.
   const ConstantRange &getRangeRef(const SCEV *S, RangeSignHint Hint);
 
+  /// Charge one unit of work to the budget of this function. Returns false if
+  /// the budget is used up, in which case the caller must fall back to a
+  /// conservative result. \p L is the loop being analyzed, if known; it is
+  /// named in the remark emitted when the budget runs out.
+  bool consumeWork(const Loop *L);
+
   /// Determines the range for the affine SCEVAddRecExpr {\p Start,+,\p Stop}.
   /// Helper for \c getRange.
   ConstantRange getRangeForAffineAR(const SCEV *Start, const SCEV *Stop,
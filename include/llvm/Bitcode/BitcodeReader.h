@@ -15,6 +15,7 @@
 #define LLVM_BITCODE_BITCODEREADER_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Bitcode/BitCodes.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
@@ -29,6 +30,7 @@
 #include <vector>
 namespace llvm {
 
+class GlobalValue;
 class LLVMContext;
 class Module;
 
@@ -99,6 +101,13 @@ class Module;
                                                     bool ShouldLazyLoadMetadata,
                                                     bool IsImporting);
 
+    /// Read the bitcode module lazily, like getLazyModule(), and materialize
+    /// only the global values named in \p Names and the global values that
+    /// they depend on, see materializeWithDependencies().
+    Expected<std::unique_ptr<Module>>
+    getLazyModuleForGlobals(LLVMContext &Context, ArrayRef<StringRef> Names,
+                            bool CallsOnly = false);
+
     /// Read the entire bitcode module and return it.
     Expected<std::unique_ptr<Module>> parseModule(LLVMContext &Context);
 
@@ -148,6 +157,17 @@ class Module;
       std::unique_ptr<MemoryBuffer> &&Buffer, LLVMContext &Context,
       bool ShouldLazyLoadMetadata = false, bool IsImporting = false);
 
+  /// Materialize the global values in \p GVs, which belong to a lazily loaded
+  /// module, and the defined functions that they call, transitively. Unless
+  /// \p CallsOnly is true, the defined global values that they otherwise
+  /// reference are followed as well. The global values that are reached are
+  /// added to \p GVs. If the bitcode was written with a function dependency
+  /// index (-bitcode-function-deps), the whole set is found from the index
+  /// before any function body is read, and the bodies are then read in
+  /// bitcode order.
+  Error materializeWithDependencies(SetVector<GlobalValue *> &GVs,
+                                    bool CallsOnly = false);
+
   /// Read the header of the specified bitcode buffer and extract just the
   /// triple information. If successful, this returns a string. On error, this
   /// returns "".
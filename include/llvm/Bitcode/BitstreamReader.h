@@ -126,6 +126,11 @@ public:
   // Return the byte # of the current bit.
   uint64_t getCurrentByteNo() const { return GetCurrentBitNo() / 8; }
 
+  /// Return the number of bits left to read in the stream.
+  uint64_t getBitsLeft() const {
+    return BitcodeBytes.size() * CHAR_BIT - GetCurrentBitNo();
+  }
+
   ArrayRef<uint8_t> getBitcodeBytes() const { return BitcodeBytes; }
 
   /// Reset the stream to the specified bit number.
@@ -219,11 +224,51 @@ public:
     return R;
   }
 
+  /// Read \p NumElts fixed-width fields of \p NumBits bits each and append
+  /// them to \p Vals. As many fields as fit in CurWord are extracted in a
+  /// tight loop before it is refilled, rather than going through Read() for
+  /// every field.
+  void ReadFixedArray(unsigned NumBits, unsigned NumElts,
+                      SmallVectorImpl<uint64_t> &Vals) {
+    assert(NumBits && NumBits <= MaxChunkSize && "Invalid field width!");
+    // Don't trust a corrupt element count further than the stream goes.
+    Vals.reserve(Vals.size() +
+                 std::min<uint64_t>(NumElts, getBitsLeft() / NumBits));
+
+    // Shifting a word by its full width is undefined; let Read() handle that.
+    if (NumBits == MaxChunkSize) {
+      for (; NumElts; --NumElts)
+        Vals.push_back(Read(NumBits));
+      return;
+    }
+
+    const word_t Mask = ~word_t(0) >> (MaxChunkSize - NumBits);
+    while (NumElts) {
+      unsigned InWord = std::min(BitsInCurWord / NumBits, NumElts);
+      for (unsigned I = 0; I != InWord; ++I) {
+        Vals.push_back(CurWord & Mask);
+        CurWord >>= NumBits;
+      }
+      BitsInCurWord -= InWord * NumBits;
+      NumElts -= InWord;
+
+      // The next field straddles the end of CurWord.
+      if (NumElts) {
+        Vals.push_back(Read(NumBits));
+        --NumElts;
+      }
+    }
+  }
+
   uint32_t ReadVBR(unsigned NumBits) {
     uint32_t Piece = Read(NumBits);
     if ((Piece & (1U << (NumBits-1))) == 0)
       return Piece;
 
+    uint64_t InWord;
+    if (ReadVBRTailFromCurWord(NumBits, Piece, InWord))
+      return uint32_t(InWord);
+
     uint32_t Result = 0;
     unsigned NextBit = 0;
     while (true) {
@@ -244,6 +289,10 @@ public:
     if ((Piece & (1U << (NumBits-1))) == 0)
       return uint64_t(Piece);
 
+    uint64_t InWord;
+    if (ReadVBRTailFromCurWord(NumBits, Piece, InWord))
+      return InWord;
+
     uint64_t Result = 0;
     unsigned NextBit = 0;
     while (true) {
@@ -257,6 +306,32 @@ public:
     }
   }
 
+  /// Finish decoding a multi-chunk VBR field whose first chunk \p Piece has
+  /// been read, if the remaining chunks all lie in the bits left in CurWord.
+  /// Returns false without consuming anything otherwise, in which case the
+  /// caller falls back to reading chunk by chunk.
+  bool ReadVBRTailFromCurWord(unsigned NumBits, uint32_t Piece,
+                              uint64_t &Result) {
+    const word_t ContinueBit = word_t(1) << (NumBits - 1);
+    const word_t ChunkMask = ContinueBit - 1;
+    word_t Word = CurWord;
+    uint64_t Value = Piece & ChunkMask;
+    for (unsigned Used = NumBits, Shift = NumBits - 1; Used <= BitsInCurWord;
+         Used += NumBits, Shift += NumBits - 1) {
+      Value |= uint64_t(Word & ChunkMask) << Shift;
+      if (!(Word & ContinueBit)) {
+        // Use a conditional to avoid undefined behavior when every bit of
+        // CurWord was used.
+        CurWord = Used == MaxChunkSize ? 0 : CurWord >> Used;
+        BitsInCurWord -= Used;
+        Result = Value;
+        return true;
+      }
+      Word >>= NumBits;
+    }
+    return false;
+  }
+
   void SkipToFourByteBoundary() {
     // If word_t is 64-bits and if we've read less than 32 bits, just dump
     // the bits we have up to the next 32-bit boundary.
@@ -345,12 +420,14 @@ public:
   using SimpleBitstreamCursor::getBitcodeBytes;
   using SimpleBitstreamCursor::GetCurrentBitNo;
   using SimpleBitstreamCursor::getCurrentByteNo;
+  using SimpleBitstreamCursor::getBitsLeft;
   using SimpleBitstreamCursor::getPointerToByte;
   using SimpleBitstreamCursor::JumpToBit;
   using SimpleBitstreamCursor::fillCurWord;
   using SimpleBitstreamCursor::Read;
   using SimpleBitstreamCursor::ReadVBR;
   using SimpleBitstreamCursor::ReadVBR64;
+  using SimpleBitstreamCursor::ReadFixedArray;
 
   /// Return the number of bits used to encode an abbrev #.
   unsigned getAbbrevIDWidth() const { return CurCodeSize; }
@@ -248,6 +248,16 @@ public:
     BlockScope.pop_back();
   }
 
+  /// Append blocks that were written by another BitstreamWriter, e.g. on
+  /// another thread. Both streams must be 32-bit aligned, and the blocks must
+  /// have been written with the abbrev ID width and the BLOCKINFO abbrevs in
+  /// effect here.
+  void EmitAlignedBlocks(ArrayRef<char> Blocks) {
+    assert(CurBit == 0 && "Not 32-bit aligned");
+    assert((Blocks.size() & 3) == 0 && "Blocks not 32-bit aligned");
+    Out.append(Blocks.begin(), Blocks.end());
+  }
+
   //===--------------------------------------------------------------------===//
   // Record Emission
   //===--------------------------------------------------------------------===//
@@ -184,7 +184,9 @@ enum ValueSymtabCodes {
   VST_CODE_BBENTRY = 2, // VST_BBENTRY: [bbid, namechar x N]
   VST_CODE_FNENTRY = 3, // VST_FNENTRY: [valueid, offset, namechar x N]
   // VST_COMBINED_ENTRY: [valueid, refguid]
-  VST_CODE_COMBINED_ENTRY = 5
+  VST_CODE_COMBINED_ENTRY = 5,
+  // VST_FNDEPS: [valueid, numcallees, calleeid x numcallees, refid x N]
+  VST_CODE_FNDEPS = 6
 };
 
 // The module path symbol table only has one code (MST_CODE_ENTRY).
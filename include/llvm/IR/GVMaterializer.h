@@ -23,6 +23,7 @@
 namespace llvm {
 
 class Error;
+class Function;
 class GlobalValue;
 class StructType;
 
@@ -45,6 +46,17 @@ public:
   virtual void setStripDebugInfo() = 0;
 
   virtual std::vector<StructType *> getIdentifiedStructTypes() const = 0;
+
+  /// Append to \p Callees the functions that the body of \p F calls
+  /// directly, and to \p Refs the other global values that it references,
+  /// if they are known without materializing \p F. Only global values that
+  /// are defined are reported. Returns false if the dependencies of \p F are
+  /// not known, in which case \p F has to be materialized to find them.
+  virtual bool getDependencies(const Function *F,
+                               std::vector<GlobalValue *> &Callees,
+                               std::vector<GlobalValue *> &Refs) {
+    return false;
+  }
 };
 
 } // end namespace llvm
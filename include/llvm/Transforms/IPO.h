@@ -206,6 +206,25 @@ ModulePass *createMergeFunctionsPass();
 ///
 ModulePass *createPartialInliningPass();
 
+//===----------------------------------------------------------------------===//
+/// createHotColdSplittingPass - This pass outlines cold regions of functions
+/// into separate cold functions.
+///
+ModulePass *createHotColdSplittingPass();
+
+//===----------------------------------------------------------------------===//
+/// createFunctionSpecializationPass - This pass clones functions for call
+/// sites passing them constant or function pointer arguments.
+///
+ModulePass *createFunctionSpecializationPass();
+
+//===----------------------------------------------------------------------===//
+/// createModuleInlinerPass - This pass inlines the call sites of the module
+/// in a global priority order, within a growth budget for the module.
+///
+ModulePass *createModuleInlinerPass();
+ModulePass *createModuleInlinerPass(InlineParams &Params);
+
 //===----------------------------------------------------------------------===//
 // createMetaRenamerPass - Rename everything with metasyntatic names.
 //
@@ -17,6 +17,7 @@
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Transforms/Utils/ImportedFunctionsInliningStatistics.h"
+#include <memory>
 #include <utility>
 
 namespace llvm {
@@ -76,6 +77,10 @@ protected:
   AssumptionCacheTracker *ACT;
   ProfileSummaryInfo *PSI;
   ImportedFunctionsInliningStatistics ImportedFunctionsStats;
+
+  /// The costs of the callee bodies analyzed so far. Summaries of the
+  /// functions in the current SCC are dropped as their bodies change.
+  InlineCostCache CostCache;
 };
 
 /// The inliner pass for the new pass manager.
@@ -102,6 +107,10 @@ public:
 
 private:
   InlineParams Params;
+
+  /// The costs of the callee bodies analyzed so far, created on the first run
+  /// so that the pass stays movable.
+  std::unique_ptr<InlineCostCache> CostCache;
 };
 
 } // end namespace llvm
@@ -0,0 +1,46 @@
+//===- ModuleInliner.h - Module level inliner pass --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass inlines the call sites of a whole module in a global priority
+// order instead of one SCC at a time bottom-up.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_MODULEINLINER_H
+#define LLVM_TRANSFORMS_IPO_MODULEINLINER_H
+
+#include "llvm/Analysis/InlineCost.h"
+#include "llvm/IR/PassManager.h"
+
+namespace llvm {
+
+class Module;
+
+/// The module inliner pass for the new pass manager.
+///
+/// Every call site of the module is kept in a single priority queue, ordered
+/// by its profile count and then by how far its cost is below the threshold.
+/// The call sites exposed by inlining are added to the queue, and the
+/// priority of a call site is recomputed when it reaches the top since its
+/// caller or callee may have changed in the meantime. The overall growth of
+/// the module is bounded by a budget.
+class ModuleInlinerPass : public PassInfoMixin<ModuleInlinerPass> {
+public:
+  ModuleInlinerPass(InlineParams Params = getInlineParams())
+      : Params(std::move(Params)) {}
+
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+
+private:
+  InlineParams Params;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_TRANSFORMS_IPO_MODULEINLINER_H
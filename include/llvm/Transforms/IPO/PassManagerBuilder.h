@@ -164,6 +164,12 @@ public:
   std::string PGOInstrGen;
   /// Path of the profile data file.
   std::string PGOInstrUse;
+  /// Enable the context sensitive profile instrumentation pass, which runs
+  /// after inlining.
+  bool EnablePGOCSInstrGen;
+  /// Annotate the IR with the context sensitive records of \c PGOInstrUse
+  /// after inlining, if the profile has any.
+  bool EnablePGOCSInstrUse;
   /// Path of the sample Profile data file.
   std::string PGOSampleUse;
 
@@ -186,7 +192,7 @@ private:
   void addInitialAliasAnalysisPasses(legacy::PassManagerBase &PM) const;
   void addLTOOptimizationPasses(legacy::PassManagerBase &PM);
   void addLateLTOOptimizationPasses(legacy::PassManagerBase &PM);
-  void addPGOInstrPasses(legacy::PassManagerBase &MPM);
+  void addPGOInstrPasses(legacy::PassManagerBase &MPM, bool IsCS);
   void addFunctionSimplificationPasses(legacy::PassManagerBase &MPM);
   void addInstructionCombiningPass(legacy::PassManagerBase &MPM) const;
 
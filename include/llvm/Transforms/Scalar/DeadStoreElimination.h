@@ -25,10 +25,16 @@ namespace llvm {
 class Function;
 
 /// This class implements a trivial dead store elimination. We consider
-/// only the redundant stores that are local to a single Basic Block.
+/// only the redundant stores that are local to a single Basic Block, unless
+/// MemorySSA is used, in which case dead stores are also found across blocks.
 class DSEPass : public PassInfoMixin<DSEPass> {
 public:
+  DSEPass(bool UseMemorySSA = false) : UseMemorySSA(UseMemorySSA) {}
+
   PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM);
+
+private:
+  bool UseMemorySSA;
 };
 
 } // end namespace llvm
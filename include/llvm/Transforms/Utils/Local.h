@@ -39,6 +39,7 @@ namespace llvm {
 class AllocaInst;
 class AssumptionCache;
 class BasicBlock;
+class BlockFrequencyInfo;
 class BranchInst;
 class CallInst;
 class DbgInfoIntrinsic;
@@ -174,7 +175,9 @@ void MergeBasicBlockIntoOnlyPred(BasicBlock *BB, DominatorTree *DT = nullptr);
 /// other than PHI nodes, potential debug intrinsics and the branch. If
 /// possible, eliminate BB by rewriting all the predecessors to branch to the
 /// successor block and return true. If we can't transform, return false.
-bool TryToSimplifyUncondBranchFromEmptyBlock(BasicBlock *BB);
+/// If \p BFI is given, BB is removed from it before it is deleted.
+bool TryToSimplifyUncondBranchFromEmptyBlock(BasicBlock *BB,
+                                             BlockFrequencyInfo *BFI = nullptr);
 
 /// Check for and eliminate duplicate PHI nodes in this block. This doesn't try
 /// to be clever about PHI nodes which differ only in the order of the incoming
@@ -100,6 +100,10 @@ struct LoopVectorizePass : public PassInfoMixin<LoopVectorizePass> {
                OptimizationRemarkEmitter &ORE);
 
   bool processLoop(Loop *L);
+
+  /// Vectorize the scalar remainder \p L of a vectorized loop with a
+  /// vectorization factor of at most \p MaxVF.
+  bool vectorizeEpilogueLoop(Loop *L, unsigned MaxVF);
 };
 
 } // end namespace llvm
@@ -63,7 +63,8 @@ static cl::opt<bool> DisableBasicAA("disable-basicaa", cl::Hidden,
                                     cl::init(false));
 
 AAResults::AAResults(AAResults &&Arg)
-    : TLI(Arg.TLI), AAs(std::move(Arg.AAs)), AADeps(std::move(Arg.AADeps)) {
+    : TLI(Arg.TLI), AAs(std::move(Arg.AAs)), AADeps(std::move(Arg.AADeps)),
+      BatchDepth(Arg.BatchDepth) {
   for (auto &AA : AAs)
     AA->setAAResults(this);
 }
@@ -543,6 +544,19 @@ bool AAResults::canInstructionRangeModRef(const Instruction &I1,
   return false;
 }
 
+void AAResults::beginBatch() {
+  if (BatchDepth++ == 0)
+    for (const auto &AA : AAs)
+      AA->setBatchMode(true);
+}
+
+void AAResults::endBatch() {
+  assert(BatchDepth && "Ending a batch of queries that was never started!");
+  if (--BatchDepth == 0)
+    for (const auto &AA : AAs)
+      AA->setBatchMode(false);
+}
+
 // Provide a definition for the root virtual destructor.
 AAResults::Concept::~Concept() = default;
 
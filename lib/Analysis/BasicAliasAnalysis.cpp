@@ -74,6 +74,16 @@ STATISTIC(SearchLimitReached, "Number of times the limit to "
                               "decompose GEPs is reached");
 STATISTIC(SearchTimes, "Number of times a GEP is decomposed");
 
+/// Hits and misses of the caches used during a batch of queries. Every hit
+/// saves a GEP decomposition, an underlying object lookup or a capture
+/// analysis respectively.
+STATISTIC(NumGEPCacheHits, "Number of decomposed GEPs reused in a batch");
+STATISTIC(NumGEPCacheMisses, "Number of GEPs decomposed in a batch");
+STATISTIC(NumObjectCacheHits, "Number of underlying objects reused in a batch");
+STATISTIC(NumObjectCacheMisses, "Number of underlying objects found in a batch");
+STATISTIC(NumCaptureCacheHits, "Number of capture results reused in a batch");
+STATISTIC(NumCaptureCacheMisses, "Number of capture results computed in a batch");
+
 /// Cutoff after which to stop analysing a set of phi nodes potentially involved
 /// in a cycle. Because we are analysing 'through' phi nodes, we need to be
 /// careful with value equivalence. We use reachability to make sure a value
@@ -105,8 +115,25 @@ bool BasicAAResult::invalidate(Function &F, const PreservedAnalyses &PA,
 //===----------------------------------------------------------------------===//
 
 /// Returns true if the pointer is to a function-local object that never
-/// escapes from the function.
-static bool isNonEscapingLocalObject(const Value *V) {
+/// escapes from the function. If \p IsCapturedCache is given, the result of
+/// the capture analysis is looked up in and added to it.
+static bool
+isNonEscapingLocalObject(const Value *V,
+                         DenseMap<const Value *, bool> *IsCapturedCache) {
+  auto IsCaptured = [&]() {
+    if (!IsCapturedCache)
+      return PointerMayBeCaptured(V, false, /*StoreCaptures=*/true);
+    auto Pair = IsCapturedCache->insert(std::make_pair(V, false));
+    if (!Pair.second) {
+      ++NumCaptureCacheHits;
+      return Pair.first->second;
+    }
+    ++NumCaptureCacheMisses;
+    bool Captured = PointerMayBeCaptured(V, false, /*StoreCaptures=*/true);
+    (*IsCapturedCache)[V] = Captured;
+    return Captured;
+  };
+
   // If this is a local allocation, check to see if it escapes.
   if (isa<AllocaInst>(V) || isNoAliasCall(V))
     // Set StoreCaptures to True so that we can assume in our callers that the
@@ -114,7 +141,7 @@ static bool isNonEscapingLocalObject(const Value *V) {
     // PointerMayBeCaptured doesn't have any special analysis for the
     // StoreCaptures=false case; if it did, our callers could be refined to be
     // more precise.
-    return !PointerMayBeCaptured(V, false, /*StoreCaptures=*/true);
+    return !IsCaptured();
 
   // If this is an argument that corresponds to a byval or noalias argument,
   // then it has not escaped before entering the function.  Check if it escapes
@@ -124,7 +151,7 @@ static bool isNonEscapingLocalObject(const Value *V) {
       // Note even if the argument is marked nocapture, we still need to check
       // for copies made inside the function. The nocapture attribute only
       // specifies that there are no copies made that outlive the function.
-      return !PointerMayBeCaptured(V, false, /*StoreCaptures=*/true);
+      return !IsCaptured();
 
   return false;
 }
@@ -538,6 +565,44 @@ bool BasicAAResult::DecomposeGEPExpression(const Value *V,
   return true;
 }
 
+bool BasicAAResult::decomposeGEP(const Value *V, DecomposedGEP &Decomposed) {
+  if (!Batch)
+    return DecomposeGEPExpression(V, Decomposed, DL, &AC, DT);
+
+  auto It = Batch->DecomposedGEPs.find(V);
+  if (It != Batch->DecomposedGEPs.end()) {
+    ++NumGEPCacheHits;
+    Decomposed = It->second.first;
+    return It->second.second;
+  }
+  ++NumGEPCacheMisses;
+  bool MaxLookupReached = DecomposeGEPExpression(V, Decomposed, DL, &AC, DT);
+  Batch->DecomposedGEPs[V] = std::make_pair(Decomposed, MaxLookupReached);
+  return MaxLookupReached;
+}
+
+const Value *BasicAAResult::getUnderlyingObject(const Value *V) {
+  if (!Batch)
+    return GetUnderlyingObject(V, DL, MaxLookupSearchDepth);
+
+  auto Pair = Batch->UnderlyingObjects.insert(std::make_pair(V, nullptr));
+  if (!Pair.second) {
+    ++NumObjectCacheHits;
+    return Pair.first->second;
+  }
+  ++NumObjectCacheMisses;
+  const Value *Object = GetUnderlyingObject(V, DL, MaxLookupSearchDepth);
+  Pair.first->second = Object;
+  return Object;
+}
+
+void BasicAAResult::setBatchMode(bool Enabled) {
+  if (Enabled)
+    Batch.emplace();
+  else
+    Batch.reset();
+}
+
 /// Returns whether the given pointer value points to memory that is local to
 /// the function, with global constants being considered local to all
 /// functions.
@@ -760,7 +825,7 @@ ModRefInfo BasicAAResult::getModRefInfo(ImmutableCallSite CS,
   assert(notDifferentParent(CS.getInstruction(), Loc.Ptr) &&
          "AliasAnalysis query involving multiple functions!");
 
-  const Value *Object = GetUnderlyingObject(Loc.Ptr, DL);
+  const Value *Object = getUnderlyingObject(Loc.Ptr);
 
   // If this is a tail call and Loc.Ptr points to a stack location, we know that
   // the tail call cannot access or modify the local stack.
@@ -776,7 +841,8 @@ ModRefInfo BasicAAResult::getModRefInfo(ImmutableCallSite CS,
   // then the call can not mod/ref the pointer unless the call takes the pointer
   // as an argument, and itself doesn't capture it.
   if (!isa<Constant>(Object) && CS.getInstruction() != Object &&
-      isNonEscapingLocalObject(Object)) {
+      isNonEscapingLocalObject(Object,
+                               Batch ? &Batch->IsCaptured : nullptr)) {
 
     // Optimistically assume that call doesn't touch Object and check this
     // assumption in the following loop.
@@ -1163,10 +1229,8 @@ AliasResult BasicAAResult::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
                                     const Value *UnderlyingV1,
                                     const Value *UnderlyingV2) {
   DecomposedGEP DecompGEP1, DecompGEP2;
-  bool GEP1MaxLookupReached =
-    DecomposeGEPExpression(GEP1, DecompGEP1, DL, &AC, DT);
-  bool GEP2MaxLookupReached =
-    DecomposeGEPExpression(V2, DecompGEP2, DL, &AC, DT);
+  bool GEP1MaxLookupReached = decomposeGEP(GEP1, DecompGEP1);
+  bool GEP2MaxLookupReached = decomposeGEP(V2, DecompGEP2);
 
   int64_t GEP1BaseOffset = DecompGEP1.StructOffset + DecompGEP1.OtherOffset;
   int64_t GEP2BaseOffset = DecompGEP2.StructOffset + DecompGEP2.OtherOffset;
@@ -1564,10 +1628,10 @@ AliasResult BasicAAResult::aliasCheck(const Value *V1, uint64_t V1Size,
 
   // Figure out what objects these things are pointing to if we can.
   if (O1 == nullptr)
-    O1 = GetUnderlyingObject(V1, DL, MaxLookupSearchDepth);
+    O1 = getUnderlyingObject(V1);
 
   if (O2 == nullptr)
-    O2 = GetUnderlyingObject(V2, DL, MaxLookupSearchDepth);
+    O2 = getUnderlyingObject(V2);
 
   // Null values in the default address space don't point to any object, so they
   // don't alias any other pointer.
@@ -1603,9 +1667,11 @@ AliasResult BasicAAResult::aliasCheck(const Value *V1, uint64_t V1Size,
     // temporary store the nocapture argument's value in a temporary memory
     // location if that memory location doesn't escape. Or it may pass a
     // nocapture value to other functions as long as they don't capture it.
-    if (isEscapeSource(O1) && isNonEscapingLocalObject(O2))
+    DenseMap<const Value *, bool> *IsCapturedCache =
+        Batch ? &Batch->IsCaptured : nullptr;
+    if (isEscapeSource(O1) && isNonEscapingLocalObject(O2, IsCapturedCache))
       return NoAlias;
-    if (isEscapeSource(O2) && isNonEscapingLocalObject(O1))
+    if (isEscapeSource(O2) && isNonEscapingLocalObject(O1, IsCapturedCache))
       return NoAlias;
   }
 
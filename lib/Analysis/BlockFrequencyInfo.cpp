@@ -250,6 +250,18 @@ void BlockFrequencyInfo::setBlockFreqAndScale(
   BFI->setBlockFreq(ReferenceBB, Freq);
 }
 
+void BlockFrequencyInfo::setBlockFreqForSplitEdge(const BasicBlock *NewBB,
+                                                  const BasicBlock *Pred,
+                                                  BranchProbability Prob) {
+  assert(BFI && "Expected analysis to be available");
+  BFI->setBlockFreq(NewBB, (BFI->getBlockFreq(Pred) * Prob).getFrequency());
+}
+
+void BlockFrequencyInfo::eraseBlock(const BasicBlock *BB) {
+  assert(BFI && "Expected analysis to be available");
+  BFI->eraseBlock(BB);
+}
+
 /// Pop up a ghostview window with the current block frequency propagation
 /// rendered using dot.
 void BlockFrequencyInfo::view() const {
@@ -650,11 +650,34 @@ void IrreducibleGraph::addEdge(IrrNode &Irr, const BlockNode &Succ,
   if (L == Lookup.end())
     return;
   IrrNode &SuccIrr = *L->second;
-  Irr.Edges.push_back(&SuccIrr);
-  SuccIrr.Edges.push_front(&Irr);
+  PendingEdges.emplace_back(&Irr, &SuccIrr);
+  ++Irr.NumOut;
   ++SuccIrr.NumIn;
 }
 
+void IrreducibleGraph::finalizeEdges() {
+  EdgeStorage.resize(2 * PendingEdges.size());
+
+  // Point every node at its range and remember where its next predecessor and
+  // successor go.  Predecessors are filled from the back so that the most
+  // recently added one comes first.
+  SmallVector<std::pair<unsigned, unsigned>, 16> Next;
+  Next.reserve(Nodes.size());
+  unsigned Offset = 0;
+  for (IrrNode &Irr : Nodes) {
+    Irr.Edges = EdgeStorage.data() + Offset;
+    Next.emplace_back(Offset + Irr.NumIn, Offset + Irr.NumIn);
+    Offset += Irr.NumIn + Irr.NumOut;
+  }
+  assert(Offset == EdgeStorage.size() && "Edge count mismatch");
+
+  for (const auto &E : PendingEdges) {
+    EdgeStorage[Next[E.first - Nodes.data()].second++] = E.second;
+    EdgeStorage[--Next[E.second - Nodes.data()].first] = E.first;
+  }
+  PendingEdges.clear();
+}
+
 namespace llvm {
 
 template <> struct GraphTraits<IrreducibleGraph> {
@@ -0,0 +1,175 @@
+//===- DomTreeUpdater.cpp - DomTree/Post DomTree Updater --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the DomTreeUpdater class, which provides a uniform way
+// to update dominator tree related data structures.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/DomTreeUpdater.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cassert>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "dom-tree-updater"
+
+STATISTIC(NumBatchUpdates, "Number of update batches applied incrementally");
+STATISTIC(NumRecalculations,
+          "Number of update batches replaced by a full recalculation");
+
+static cl::opt<unsigned> RecalculateRatio(
+    "dom-tree-updater-recalculate-ratio", cl::Hidden, cl::init(10),
+    cl::desc("Recalculate a dominator tree instead of updating it when the "
+             "number of pending updates times this ratio exceeds the number "
+             "of blocks in the function (0 = always update)"));
+
+bool DomTreeUpdater::hasPendingDomTreeUpdates() const {
+  return DT && PendingDTUpdateIndex != PendingUpdates.size();
+}
+
+bool DomTreeUpdater::hasPendingPostDomTreeUpdates() const {
+  return PDT && PendingPDTUpdateIndex != PendingUpdates.size();
+}
+
+template <typename DomTreeT>
+void DomTreeUpdater::applyPendingUpdates(DomTreeT &Tree, size_t &PendingIndex) {
+  size_t NumUpdates = PendingUpdates.size() - PendingIndex;
+  if (NumUpdates == 0)
+    return;
+
+  // Each incremental update costs about as much as walking the affected
+  // subtree, so past some fraction of the function it is cheaper to start
+  // over.
+  Function &F = *PendingUpdates[PendingIndex].getFrom()->getParent();
+  if (NumUpdates > 1 && RecalculateRatio &&
+      NumUpdates * RecalculateRatio > F.size()) {
+    DEBUG(dbgs() << "DomTreeUpdater: recalculating instead of applying "
+                 << NumUpdates << " updates\n");
+    ++NumRecalculations;
+    Tree.recalculate(F);
+  } else {
+    ++NumBatchUpdates;
+    Tree.applyUpdates(makeArrayRef(PendingUpdates).slice(PendingIndex));
+  }
+  PendingIndex = PendingUpdates.size();
+}
+
+void DomTreeUpdater::dropOutOfDateUpdates() {
+  if (hasPendingUpdates())
+    return;
+  PendingUpdates.clear();
+  PendingDTUpdateIndex = 0;
+  PendingPDTUpdateIndex = 0;
+}
+
+void DomTreeUpdater::tryFlushDeletedBB() {
+  if (hasPendingUpdates())
+    return;
+  for (BasicBlock *BB : DeletedBBs) {
+    if (DT && DT->getNode(BB))
+      DT->eraseNode(BB);
+    if (PDT && PDT->getNode(BB))
+      PDT->eraseNode(BB);
+    BB->eraseFromParent();
+  }
+  DeletedBBs.clear();
+}
+
+void DomTreeUpdater::applyUpdates(ArrayRef<DominatorTree::UpdateType> Updates) {
+  PendingUpdates.append(Updates.begin(), Updates.end());
+  if (isEager())
+    flush();
+}
+
+void DomTreeUpdater::insertEdge(BasicBlock *From, BasicBlock *To) {
+  applyUpdates({{DominatorTree::Insert, From, To}});
+}
+
+void DomTreeUpdater::deleteEdge(BasicBlock *From, BasicBlock *To) {
+  applyUpdates({{DominatorTree::Delete, From, To}});
+}
+
+void DomTreeUpdater::deleteBB(BasicBlock *DelBB) {
+  assert(pred_empty(DelBB) && "Block to delete still has predecessors");
+  assert(!DeletedBBs.count(DelBB) && "Block deleted twice");
+
+  SmallVector<DominatorTree::UpdateType, 4> Updates;
+  SmallPtrSet<BasicBlock *, 4> Seen;
+  for (BasicBlock *Succ : successors(DelBB))
+    if (Seen.insert(Succ).second) {
+      Succ->removePredecessor(DelBB);
+      Updates.push_back({DominatorTree::Delete, DelBB, Succ});
+    }
+
+  // Empty the block but keep it around with a terminator, so that it is still
+  // a valid block while the trees refer to it.
+  while (!DelBB->empty()) {
+    Instruction &I = DelBB->back();
+    if (!I.use_empty())
+      I.replaceAllUsesWith(UndefValue::get(I.getType()));
+    I.eraseFromParent();
+  }
+  new UnreachableInst(DelBB->getContext(), DelBB);
+
+  DeletedBBs.insert(DelBB);
+  applyUpdates(Updates);
+}
+
+DominatorTree &DomTreeUpdater::getDomTree() {
+  assert(DT && "Invalid acquisition of a null DomTree");
+  applyPendingUpdates(*DT, PendingDTUpdateIndex);
+  dropOutOfDateUpdates();
+  tryFlushDeletedBB();
+  return *DT;
+}
+
+PostDominatorTree &DomTreeUpdater::getPostDomTree() {
+  assert(PDT && "Invalid acquisition of a null PostDomTree");
+  applyPendingUpdates(*PDT, PendingPDTUpdateIndex);
+  dropOutOfDateUpdates();
+  tryFlushDeletedBB();
+  return *PDT;
+}
+
+void DomTreeUpdater::recalculate(Function &F) {
+  PendingUpdates.clear();
+  PendingDTUpdateIndex = 0;
+  PendingPDTUpdateIndex = 0;
+
+  // The recalculated trees do not refer to the deleted blocks, so they can go
+  // first.
+  for (BasicBlock *BB : DeletedBBs)
+    BB->eraseFromParent();
+  DeletedBBs.clear();
+
+  if (DT)
+    DT->recalculate(F);
+  if (PDT)
+    PDT->recalculate(F);
+}
+
+void DomTreeUpdater::flush() {
+  if (DT)
+    applyPendingUpdates(*DT, PendingDTUpdateIndex);
+  if (PDT)
+    applyPendingUpdates(*PDT, PendingPDTUpdateIndex);
+  dropOutOfDateUpdates();
+  tryFlushDeletedBB();
+}
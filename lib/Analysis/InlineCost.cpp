@@ -40,6 +40,12 @@ using namespace llvm;
 #define DEBUG_TYPE "inline-cost"
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumCalleeSummariesComputed, "Number of callee summaries computed");
+STATISTIC(NumCalleeSummaryHits,
+          "Number of call sites analyzed with a cached callee summary");
+STATISTIC(NumInstructionsNotReanalyzed,
+          "Number of callee instructions not analyzed again thanks to cached "
+          "callee summaries");
 
 static cl::opt<int> InlineThreshold(
     "inline-threshold", cl::Hidden, cl::init(225), cl::ZeroOrMore,
@@ -87,6 +93,11 @@ static cl::opt<bool> OptComputeFullInlineCost(
     cl::desc("Compute the full inline cost of a call site even when the cost "
              "exceeds the threshold."));
 
+static cl::opt<bool> EnableCalleeSummaries(
+    "inline-cost-callee-summaries", cl::Hidden, cl::init(true),
+    cl::desc("Reuse the cost of a callee body across call sites that do not "
+             "simplify it."));
+
 namespace {
 
 class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
@@ -114,6 +125,9 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   /// The OptimizationRemarkEmitter available for this compilation.
   OptimizationRemarkEmitter *ORE;
 
+  /// The cache of callee summaries, if any.
+  InlineCostCache *Cache;
+
   /// The candidate callsite being analyzed. Please do not use this to do
   /// analysis in the caller function; we want the inline cost query to be
   /// easily cacheable. Instead, use the cover function paramHasAttr.
@@ -134,6 +148,11 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   bool HasReturn;
   bool HasIndirectBr;
   bool HasFrameEscape;
+  bool SingleBB;
+
+  /// Whether the cost went down while analyzing the body, which makes it
+  /// depend on when the threshold is checked.
+  bool CostDecreased;
 
   /// Number of bytes allocated statically by the callee.
   uint64_t AllocatedSize;
@@ -208,6 +227,17 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
 
   // Custom analysis routines.
   bool analyzeBlock(BasicBlock *BB, SmallPtrSetImpl<const Value *> &EphValues);
+  bool analyzeCalleeBody(CallSite CS);
+  bool finishAnalysis(CallSite CS);
+
+  /// Return true if \p CS passes nothing to the callee that could simplify
+  /// its body, so that the cost of the body is the same as for any other such
+  /// call site.
+  bool isGenericCallSite(CallSite CS);
+
+  /// Return the cached summary of the callee body, computing it first if
+  /// needed, or null if it cannot be reused.
+  const InlineCostCache::CalleeSummary *getCalleeSummary(CallSite CS);
 
   // Disable several entry points to the visitor so we don't accidentally use
   // them by declaring but not defining them here.
@@ -255,16 +285,19 @@ public:
                std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
                Optional<function_ref<BlockFrequencyInfo &(Function &)>> &GetBFI,
                ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE,
-               Function &Callee, CallSite CSArg, const InlineParams &Params)
+               Function &Callee, CallSite CSArg, const InlineParams &Params,
+               InlineCostCache *Cache = nullptr)
       : TTI(TTI), GetAssumptionCache(GetAssumptionCache), GetBFI(GetBFI),
         PSI(PSI), F(Callee), DL(F.getParent()->getDataLayout()), ORE(ORE),
-        CandidateCS(CSArg), Params(Params), Threshold(Params.DefaultThreshold),
+        Cache(Cache), CandidateCS(CSArg), Params(Params),
+        Threshold(Params.DefaultThreshold),
         Cost(0), ComputeFullInlineCost(OptComputeFullInlineCost ||
                                        Params.ComputeFullInlineCost || ORE),
         IsCallerRecursive(false), IsRecursiveCall(false),
         ExposesReturnsTwice(false), HasDynamicAlloca(false),
         ContainsNoDuplicateCall(false), HasReturn(false), HasIndirectBr(false),
-        HasFrameEscape(false), AllocatedSize(0), NumInstructions(0),
+        HasFrameEscape(false), SingleBB(true), CostDecreased(false),
+        AllocatedSize(0), NumInstructions(0),
         NumVectorInstructions(0), VectorBonus(0), SingleBBBonus(0),
         NumConstantArgs(0), NumConstantOffsetPtrArgs(0), NumAllocaArgs(0),
         NumConstantPtrCmps(0), NumConstantPtrDiffs(0),
@@ -1150,7 +1183,9 @@ bool CallAnalyzer::visitCallSite(CallSite CS) {
   if (CA.analyzeCall(CS)) {
     // We were able to inline the indirect call! Subtract the cost from the
     // threshold to get the bonus we want to apply, but don't go below zero.
-    Cost -= std::max(0, CA.getThreshold() - CA.getCost());
+    int Bonus = std::max(0, CA.getThreshold() - CA.getCost());
+    Cost -= Bonus;
+    CostDecreased |= Bonus > 0;
   }
 
   return Base::visitCallSite(CS);
@@ -1572,6 +1607,44 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
     }
   }
 
+  // The cost of the callee body is the same for all call sites that pass
+  // nothing simplifying it, so reuse it if it is known.
+  if (Cache && EnableCalleeSummaries && isGenericCallSite(CS))
+    if (const auto *Summary = getCalleeSummary(CS)) {
+      Cost += Summary->Cost;
+      NumInstructions = Summary->NumInstructions;
+      NumVectorInstructions = Summary->NumVectorInstructions;
+      NumInstructionsSimplified = Summary->NumInstructionsSimplified;
+      AllocatedSize = Summary->AllocatedSize;
+      ContainsNoDuplicateCall = Summary->ContainsNoDuplicateCall;
+      if (!Summary->SingleBB)
+        Threshold -= SingleBBBonus;
+
+      // This is checked while analyzing the body otherwise.
+      if (IsCallerRecursive &&
+          AllocatedSize > InlineConstants::TotalAllocaSizeRecursiveCaller) {
+        if (ORE)
+          ORE->emit([&]() {
+            return OptimizationRemarkMissed(DEBUG_TYPE, "NeverInline",
+                                            CandidateCS.getInstruction())
+                   << ore::NV("Callee", &F)
+                   << " is recursive and allocates too much stack space. "
+                      "Cost is not fully computed";
+          });
+        return false;
+      }
+      return finishAnalysis(CS);
+    }
+
+  if (!analyzeCalleeBody(CS))
+    return false;
+  return finishAnalysis(CS);
+}
+
+/// \brief Analyze the body of the callee for a call site.
+///
+/// Returns false if inlining the callee is not viable.
+bool CallAnalyzer::analyzeCalleeBody(CallSite CS) {
   // Populate our simplified values by mapping from function arguments to call
   // arguments with known important simplifications.
   CallSite::arg_iterator CAI = CS.arg_begin();
@@ -1614,7 +1687,6 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
       BBSetVector;
   BBSetVector BBWorklist;
   BBWorklist.insert(&F.getEntryBlock());
-  bool SingleBB = true;
   // Note that we *must not* cache the size, this loop grows the worklist.
   for (unsigned Idx = 0; Idx != BBWorklist.size(); ++Idx) {
     // Bail out the moment we cross the threshold. This means we'll under-count
@@ -1679,6 +1751,11 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
     }
   }
 
+  return true;
+}
+
+/// \brief Apply the checks that need the whole callee body to be analyzed.
+bool CallAnalyzer::finishAnalysis(CallSite CS) {
   bool OnlyOneCallAndLocalLinkage =
       F.hasLocalLinkage() && F.hasOneUse() && &F == CS.getCalledFunction();
   // If this is a noduplicate call, we can still inline as long as
@@ -1698,6 +1775,63 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   return Cost < std::max(1, Threshold);
 }
 
+bool CallAnalyzer::isGenericCallSite(CallSite CS) {
+  if (CS.getCalledFunction() != &F)
+    return false;
+
+  SmallPtrSet<Value *, 8> PtrBases;
+  for (unsigned I = 0, E = CS.arg_size(); I != E; ++I) {
+    Value *Arg = CS.getArgument(I);
+    if (isa<Constant>(Arg))
+      return false;
+    // Attributes on the call site may enable simplifications in the callee.
+    if (CS.getAttributes().getParamAttributes(I).hasAttributes())
+      return false;
+    if (!Arg->getType()->isPointerTy())
+      continue;
+    // Pointers into allocas may be SROA'd, and pointers sharing a base may
+    // have their comparisons and differences folded.
+    Value *Base = Arg;
+    stripAndComputeInBoundsConstantOffsets(Base);
+    if (isa<AllocaInst>(Base) || isa<Constant>(Base) ||
+        !PtrBases.insert(Base).second)
+      return false;
+  }
+  return true;
+}
+
+const InlineCostCache::CalleeSummary *
+CallAnalyzer::getCalleeSummary(CallSite CS) {
+  if (const auto *Summary = Cache->lookup(F)) {
+    if (!Summary->Valid)
+      return nullptr;
+    ++NumCalleeSummaryHits;
+    NumInstructionsNotReanalyzed += Summary->NumInstructions;
+    return Summary;
+  }
+
+  // Analyze the whole body without any threshold. Its cost can only be reused
+  // if it never decreases, so that it is still over the threshold whenever
+  // the analysis would have stopped early.
+  CallAnalyzer CA(TTI, GetAssumptionCache, GetBFI, PSI, nullptr, F, CS,
+                  Params);
+  CA.ComputeFullInlineCost = true;
+  InlineCostCache::CalleeSummary Summary;
+  Summary.Valid = CA.analyzeCalleeBody(CS) && !CA.CostDecreased &&
+                  CA.Cost < INT_MAX / 2;
+  Summary.Cost = CA.Cost;
+  Summary.NumInstructions = CA.NumInstructions;
+  Summary.NumVectorInstructions = CA.NumVectorInstructions;
+  Summary.NumInstructionsSimplified = CA.NumInstructionsSimplified;
+  Summary.AllocatedSize = CA.AllocatedSize;
+  Summary.SingleBB = CA.SingleBB;
+  Summary.ContainsNoDuplicateCall = CA.ContainsNoDuplicateCall;
+  ++NumCalleeSummariesComputed;
+
+  const auto &Cached = Cache->insert(F, Summary);
+  return Cached.Valid ? &Cached : nullptr;
+}
+
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_DUMP)
 /// \brief Dump stats about this call's analysis.
 LLVM_DUMP_METHOD void CallAnalyzer::dump() {
@@ -1763,9 +1897,10 @@ InlineCost llvm::getInlineCost(
     CallSite CS, const InlineParams &Params, TargetTransformInfo &CalleeTTI,
     std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
     Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE) {
+    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE,
+    InlineCostCache *Cache) {
   return getInlineCost(CS, CS.getCalledFunction(), Params, CalleeTTI,
-                       GetAssumptionCache, GetBFI, PSI, ORE);
+                       GetAssumptionCache, GetBFI, PSI, ORE, Cache);
 }
 
 InlineCost llvm::getInlineCost(
@@ -1773,7 +1908,8 @@ InlineCost llvm::getInlineCost(
     TargetTransformInfo &CalleeTTI,
     std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
     Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE) {
+    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE,
+    InlineCostCache *Cache) {
 
   // Cannot inline indirect calls.
   if (!Callee)
@@ -1809,7 +1945,7 @@ InlineCost llvm::getInlineCost(
                      << "... (caller:" << Caller->getName() << ")\n");
 
   CallAnalyzer CA(CalleeTTI, GetAssumptionCache, GetBFI, PSI, ORE, *Callee, CS,
-                  Params);
+                  Params, Cache);
   bool ShouldInline = CA.analyzeCall(CS);
 
   DEBUG(CA.dump());
@@ -1823,6 +1959,26 @@ InlineCost llvm::getInlineCost(
   return llvm::InlineCost::get(CA.getCost(), CA.getThreshold());
 }
 
+const InlineCostCache::CalleeSummary *
+InlineCostCache::lookup(const Function &F) const {
+  auto It = Summaries.find(&F);
+  return It == Summaries.end() ? nullptr : &It->second->Summary;
+}
+
+const InlineCostCache::CalleeSummary &
+InlineCostCache::insert(Function &F, const CalleeSummary &Summary) {
+  auto &E = Summaries[&F];
+  if (!E)
+    E = llvm::make_unique<Entry>(&F, this);
+  E->Summary = Summary;
+  return E->Summary;
+}
+
+void InlineCostCache::SummaryHandle::deleted() {
+  // This destroys the handle.
+  Cache->Summaries.erase(cast<Function>(getValPtr()));
+}
+
 bool llvm::isInlineViable(Function &F) {
   bool ReturnsTwice = F.hasFnAttribute(Attribute::ReturnsTwice);
   for (Function::iterator BI = F.begin(), BE = F.end(); BI != BE; ++BI) {
@@ -15,9 +15,11 @@
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Analysis/ValueLattice.h"
@@ -33,6 +35,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/PatternMatch.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/raw_ostream.h"
@@ -43,9 +46,25 @@ using namespace PatternMatch;
 
 #define DEBUG_TYPE "lazy-value-info"
 
+STATISTIC(NumQueriesAborted, "Number of queries that hit the work limit");
+STATISTIC(NumBlocksEvicted, "Number of blocks evicted from the cache");
+
 // This is the number of worklist items we will process to try to discover an
 // answer for a given value.
-static const unsigned MaxProcessedPerValue = 500;
+static cl::opt<unsigned> MaxProcessedPerValue(
+    "lvi-max-processed-per-value", cl::Hidden, cl::init(500),
+    cl::desc("Maximum number of worklist items processed for one query"));
+
+// This is the deepest the chain of values and blocks a single query depends on
+// may grow before we give up on it.
+static cl::opt<unsigned> MaxStackDepth(
+    "lvi-max-stack-depth", cl::Hidden, cl::init(1000),
+    cl::desc("Maximum depth of the dependency stack of one query"));
+
+static cl::opt<unsigned> MaxCachedBlocks(
+    "lvi-max-cached-blocks", cl::Hidden, cl::init(8192),
+    cl::desc("Maximum number of blocks to keep cached results for; the least "
+             "recently used blocks are evicted beyond this (0 = unlimited)"));
 
 char LazyValueInfoWrapperPass::ID = 0;
 INITIALIZE_PASS_BEGIN(LazyValueInfoWrapperPass, "lazy-value-info",
@@ -168,8 +187,11 @@ namespace {
     typedef DenseMap<PoisoningVH<BasicBlock>, SmallPtrSet<Value *, 4>>
         OverDefinedCacheTy;
     /// Keep track of all blocks that we have ever seen, so we
-    /// don't spend time removing unused blocks from our caches.
-    DenseSet<PoisoningVH<BasicBlock> > SeenBlocks;
+    /// don't spend time removing unused blocks from our caches. Each block
+    /// maps to the time it was last used, which orders the blocks for
+    /// eviction.
+    DenseMap<PoisoningVH<BasicBlock>, unsigned> SeenBlocks;
+    unsigned CurrentTime = 0;
 
     /// This is all of the cached information for all values,
     /// mapped from Value* to key information.
@@ -180,7 +202,7 @@ namespace {
   public:
     void insertResult(Value *Val, BasicBlock *BB,
                       const ValueLatticeElement &Result) {
-      SeenBlocks.insert(BB);
+      SeenBlocks[BB] = ++CurrentTime;
 
       // Insert over-defined values into their own cache to reduce memory
       // overhead.
@@ -217,7 +239,11 @@ namespace {
       return I->second->BlockVals.count(BB);
     }
 
-    ValueLatticeElement getCachedValueInfo(Value *V, BasicBlock *BB) const {
+    ValueLatticeElement getCachedValueInfo(Value *V, BasicBlock *BB) {
+      auto SBI = SeenBlocks.find(BB);
+      if (SBI != SeenBlocks.end())
+        SBI->second = ++CurrentTime;
+
       if (isOverdefined(V, BB))
         return ValueLatticeElement::getOverdefined();
 
@@ -237,6 +263,10 @@ namespace {
       OverDefinedCache.clear();
     }
 
+    /// Evict the least recently used blocks if results are cached for more
+    /// than \p MaxBlocks blocks. Returns the number of blocks evicted.
+    unsigned evictBlocks(unsigned MaxBlocks);
+
     /// Inform the cache that a given value has been deleted.
     void eraseValue(Value *V);
 
@@ -275,7 +305,7 @@ void LVIValueHandle::deleted() {
 
 void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
   // Shortcut if we have never seen this block.
-  DenseSet<PoisoningVH<BasicBlock> >::iterator I = SeenBlocks.find(BB);
+  auto I = SeenBlocks.find(BB);
   if (I == SeenBlocks.end())
     return;
   SeenBlocks.erase(I);
@@ -288,6 +318,46 @@ void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
     I.second->BlockVals.erase(BB);
 }
 
+unsigned LazyValueInfoCache::evictBlocks(unsigned MaxBlocks) {
+  if (MaxBlocks == 0 || SeenBlocks.size() <= MaxBlocks)
+    return 0;
+
+  // Evict down to three quarters of the limit, so that the walk over all
+  // cached values below is amortized over many insertions.
+  SmallVector<std::pair<unsigned, BasicBlock *>, 64> ByTime;
+  ByTime.reserve(SeenBlocks.size());
+  for (auto &KV : SeenBlocks)
+    ByTime.push_back({KV.second, KV.first});
+  unsigned NumToEvict = ByTime.size() - MaxBlocks * 3 / 4;
+  std::nth_element(ByTime.begin(), ByTime.begin() + NumToEvict, ByTime.end(),
+                   llvm::less_first());
+
+  SmallPtrSet<BasicBlock *, 32> Evicted;
+  for (unsigned I = 0; I != NumToEvict; ++I) {
+    BasicBlock *BB = ByTime[I].second;
+    Evicted.insert(BB);
+    SeenBlocks.erase(BB);
+    OverDefinedCache.erase(BB);
+  }
+
+  for (auto I = ValueCache.begin(), E = ValueCache.end(); I != E;) {
+    // Copy and increment the iterator immediately so we can erase behind
+    // ourselves.
+    auto Iter = I++;
+    auto &BlockVals = Iter->second->BlockVals;
+    for (auto BVI = BlockVals.begin(), BVE = BlockVals.end(); BVI != BVE;) {
+      auto BVIter = BVI++;
+      if (Evicted.count(BVIter->first))
+        BlockVals.erase(BVIter);
+    }
+    // Values without any cached blocks are dropped entirely, which also
+    // releases their value handles.
+    if (BlockVals.empty())
+      ValueCache.erase(Iter);
+  }
+  return NumToEvict;
+}
+
 void LazyValueInfoCache::threadEdgeImpl(BasicBlock *OldSucc,
                                         BasicBlock *NewSucc) {
   // When an edge in the graph has been threaded, values that we could not
@@ -430,6 +500,15 @@ namespace {
 
   void solve();
 
+  /// Give up on the current query, marking the values it was started for as
+  /// overdefined. \p Reason names the limit that was hit in the remark.
+  void abortQuery(ArrayRef<std::pair<BasicBlock *, Value *>> StartingStack,
+                  StringRef Reason);
+
+  /// Keep the cache within its size limit. This is only done between queries,
+  /// since the solver relies on the results it computes staying cached.
+  void evictBlocks(BasicBlock *BB);
+
   public:
     /// This is the query interface to determine the lattice
     /// value for the specified Value* at the end of the specified block.
@@ -492,15 +571,14 @@ void LazyValueInfoImpl::solve() {
     // overdefined cache global, and remove this throttle.
     if (processedCount > MaxProcessedPerValue) {
       DEBUG(dbgs() << "Giving up on stack because we are getting too deep\n");
-      // Fill in the original values
-      while (!StartingStack.empty()) {
-        std::pair<BasicBlock *, Value *> &e = StartingStack.back();
-        TheCache.insertResult(e.second, e.first,
-                              ValueLatticeElement::getOverdefined());
-        StartingStack.pop_back();
-      }
-      BlockValueSet.clear();
-      BlockValueStack.clear();
+      abortQuery(StartingStack, "work");
+      return;
+    }
+    // Long chains of dependent values are given up on as well, as they keep
+    // every value on the chain alive on the stack.
+    if (BlockValueStack.size() > MaxStackDepth) {
+      DEBUG(dbgs() << "Giving up on stack because it is too deep\n");
+      abortQuery(StartingStack, "depth");
       return;
     }
     std::pair<BasicBlock *, Value *> e = BlockValueStack.back();
@@ -524,6 +602,47 @@ void LazyValueInfoImpl::solve() {
   }
 }
 
+void LazyValueInfoImpl::abortQuery(
+    ArrayRef<std::pair<BasicBlock *, Value *>> StartingStack,
+    StringRef Reason) {
+  ++NumQueriesAborted;
+
+  // Fill in the original values
+  for (auto &e : StartingStack)
+    TheCache.insertResult(e.second, e.first,
+                          ValueLatticeElement::getOverdefined());
+  BlockValueSet.clear();
+  BlockValueStack.clear();
+
+  BasicBlock *BB = StartingStack.front().first;
+  Value *V = StartingStack.front().second;
+  OptimizationRemarkEmitter ORE(BB->getParent());
+  ORE.emit([&]() {
+    DiagnosticLocation Loc;
+    if (auto *I = dyn_cast<Instruction>(V))
+      Loc = I->getDebugLoc();
+    return OptimizationRemarkAnalysis(DEBUG_TYPE, "QueryLimitReached", Loc, BB)
+           << "gave up on the value of " << ore::NV("Value", V) << " in "
+           << ore::NV("Block", BB->getName()) << " after reaching the " << Reason
+           << " limit";
+  });
+}
+
+void LazyValueInfoImpl::evictBlocks(BasicBlock *BB) {
+  unsigned NumEvicted = TheCache.evictBlocks(MaxCachedBlocks);
+  if (!NumEvicted)
+    return;
+  NumBlocksEvicted += NumEvicted;
+
+  OptimizationRemarkEmitter ORE(BB->getParent());
+  ORE.emit([&]() {
+    return OptimizationRemarkAnalysis(DEBUG_TYPE, "CacheLimitReached",
+                                      DiagnosticLocation(), BB)
+           << "evicted " << ore::NV("NumBlocks", NumEvicted)
+           << " blocks from the cache";
+  });
+}
+
 bool LazyValueInfoImpl::hasBlockValue(Value *Val, BasicBlock *BB) {
   // If already a constant, there is nothing to compute.
   if (isa<Constant>(Val))
@@ -1378,6 +1497,7 @@ ValueLatticeElement LazyValueInfoImpl::getValueInBlock(Value *V, BasicBlock *BB,
 
   assert(BlockValueStack.empty() && BlockValueSet.empty());
   if (!hasBlockValue(V, BB)) {
+    evictBlocks(BB);
     pushBlockValue(std::make_pair(BB, V));
     solve();
   }
@@ -1410,6 +1530,8 @@ getValueOnEdge(Value *V, BasicBlock *FromBB, BasicBlock *ToBB,
   DEBUG(dbgs() << "LVI Getting edge value " << *V << " from '"
         << FromBB->getName() << "' to '" << ToBB->getName() << "'\n");
 
+  evictBlocks(FromBB);
+
   ValueLatticeElement Result;
   if (!getEdgeValue(V, FromBB, ToBB, Result, CxtI)) {
     solve();
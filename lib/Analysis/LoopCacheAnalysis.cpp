@@ -0,0 +1,190 @@
+//===- LoopCacheAnalysis.cpp - Loop Cache Analysis ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the cache cost estimate of a loop nest. See
+// LoopCacheAnalysis.h for the cost model.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/LoopCacheAnalysis.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-cache-cost"
+
+static cl::opt<unsigned> DefaultTripCount(
+    "cache-cost-default-trip-count", cl::init(100), cl::Hidden,
+    cl::desc("Trip count assumed for loops whose trip count is unknown"));
+
+static cl::opt<unsigned> MinTripCount(
+    "cache-cost-min-trip-count", cl::init(8), cl::Hidden,
+    cl::desc("Do not estimate the cache cost of loop nests containing a loop "
+             "with a smaller constant trip count"));
+
+static cl::opt<unsigned> DefaultCacheLineSize(
+    "cache-cost-cache-line-size", cl::init(64), cl::Hidden,
+    cl::desc("Cache line size in bytes used if the target does not provide "
+             "one"));
+
+CacheCost::CacheCost(SmallVectorImpl<Loop *> &&Loops, ScalarEvolution &SE,
+                     unsigned CacheLineSize)
+    : Loops(std::move(Loops)), SE(SE), CacheLineSize(CacheLineSize) {}
+
+std::unique_ptr<CacheCost>
+CacheCost::getCacheCost(Loop &Root, ScalarEvolution &SE,
+                        TargetTransformInfo &TTI) {
+  SmallVector<Loop *, 8> Loops;
+  for (Loop *L = &Root;; L = L->getSubLoops().front()) {
+    // The lines touched by the innermost loop are assumed not to be reused by
+    // the next iterations of the outer loops, which is far off for loops of a
+    // handful of iterations.
+    unsigned TripCount = SE.getSmallConstantTripCount(L);
+    if (TripCount && TripCount < MinTripCount) {
+      DEBUG(dbgs() << "Loop " << L->getHeader()->getName()
+                   << " has a trip count of " << TripCount << "\n");
+      return nullptr;
+    }
+    Loops.push_back(L);
+    if (L->getSubLoops().empty())
+      break;
+    if (L->getSubLoops().size() != 1) {
+      DEBUG(dbgs() << "Loop " << L->getHeader()->getName()
+                   << " has more than one subloop\n");
+      return nullptr;
+    }
+  }
+
+  unsigned CacheLineSize = TTI.getCacheLineSize();
+  if (!CacheLineSize)
+    CacheLineSize = DefaultCacheLineSize;
+
+  std::unique_ptr<CacheCost> CC(
+      new CacheCost(std::move(Loops), SE, CacheLineSize));
+  CC->collectReferenceGroups();
+  if (CC->Groups.empty())
+    return nullptr;
+  CC->calculateCosts();
+  return CC;
+}
+
+void CacheCost::collectReferenceGroups() {
+  for (BasicBlock *BB : Loops.front()->blocks()) {
+    for (Instruction &I : *BB) {
+      Value *Ptr;
+      if (auto *LI = dyn_cast<LoadInst>(&I))
+        Ptr = LI->getPointerOperand();
+      else if (auto *SI = dyn_cast<StoreInst>(&I))
+        Ptr = SI->getPointerOperand();
+      else
+        continue;
+
+      const SCEV *Addr = SE.getSCEV(Ptr);
+      Reference Ref = {&I, Addr,
+                       dyn_cast<SCEVUnknown>(SE.getPointerBase(Addr))};
+
+      // References to the same array that are less than a cache line apart
+      // touch the same lines, so only the first one of them is counted.
+      bool Grouped = Ref.Base && any_of(Groups, [&](const Reference &Leader) {
+        if (Leader.Base != Ref.Base)
+          return false;
+        auto *Diff =
+            dyn_cast<SCEVConstant>(SE.getMinusSCEV(Ref.Addr, Leader.Addr));
+        return Diff && Diff->getAPInt().abs().ult(CacheLineSize);
+      });
+      if (!Grouped)
+        Groups.push_back(Ref);
+    }
+  }
+  DEBUG(dbgs() << "Found " << Groups.size() << " reference groups\n");
+}
+
+uint64_t CacheCost::getTripCount(const Loop &L) const {
+  if (unsigned TripCount = SE.getSmallConstantTripCount(&L))
+    return TripCount;
+  return DefaultTripCount;
+}
+
+uint64_t CacheCost::computeRefCost(const Reference &Ref, const Loop &L) const {
+  uint64_t TripCount = getTripCount(L);
+
+  // Peel the add recurrences of the loops of the nest off the address,
+  // remembering the step of L.
+  const SCEV *Step = nullptr;
+  const SCEV *S = Ref.Addr;
+  while (auto *AR = dyn_cast<SCEVAddRecExpr>(S)) {
+    if (!AR->isAffine())
+      return TripCount;
+    if (AR->getLoop() == &L)
+      Step = AR->getStepRecurrence(SE);
+    S = AR->getStart();
+  }
+
+  // An address that varies in the nest other than by an add recurrence is
+  // assumed to touch a new line on every iteration.
+  if (!SE.isLoopInvariant(S, Loops.front()))
+    return TripCount;
+
+  if (!Step || Step->isZero())
+    return 1;
+
+  auto *C = dyn_cast<SCEVConstant>(Step);
+  if (!C)
+    return TripCount;
+  uint64_t Stride = C->getAPInt().abs().getLimitedValue();
+  if (Stride >= CacheLineSize)
+    return TripCount;
+  uint64_t Bytes = SaturatingMultiply(TripCount, Stride);
+  return std::max<uint64_t>(1, Bytes / CacheLineSize);
+}
+
+void CacheCost::calculateCosts() {
+  for (const Loop *L : Loops) {
+    uint64_t Cost = 0;
+    for (const Reference &Ref : Groups)
+      Cost = SaturatingAdd(Cost, computeRefCost(Ref, *L));
+
+    // The innermost loop runs once for each iteration of the other loops.
+    for (const Loop *Other : Loops)
+      if (Other != L)
+        Cost = SaturatingMultiply(Cost, getTripCount(*Other));
+
+    DEBUG(dbgs() << "Loop " << L->getHeader()->getName() << " has cost "
+                 << Cost << "\n");
+    LoopCosts.push_back({L, Cost});
+  }
+
+  std::stable_sort(LoopCosts.begin(), LoopCosts.end(),
+                   [](const LoopCostTy &A, const LoopCostTy &B) {
+                     return A.second > B.second;
+                   });
+  for (unsigned I = 0, E = LoopCosts.size(); I != E; ++I)
+    LoopCostIndex[LoopCosts[I].first] = I;
+}
+
+void CacheCost::print(raw_ostream &OS) const {
+  for (const LoopCostTy &LC : LoopCosts)
+    OS << "Loop '" << LC.first->getHeader()->getName() << "' has cost = "
+       << LC.second << "\n";
+}
+
+raw_ostream &llvm::operator<<(raw_ostream &OS, const CacheCost &CC) {
+  CC.print(OS);
+  return OS;
+}
@@ -22,6 +22,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/iterator.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Analysis/AliasAnalysis.h"
@@ -39,6 +40,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Use.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/AtomicOrdering.h"
 #include "llvm/Support/Casting.h"
@@ -58,6 +60,11 @@ using namespace llvm;
 
 #define DEBUG_TYPE "memoryssa"
 
+STATISTIC(NumLocationCacheHits,
+          "Number of clobber queries with a location answered from the cache");
+STATISTIC(NumWalkerBudgetExhausted,
+          "Number of clobber walkers that ran out of their step budget");
+
 INITIALIZE_PASS_BEGIN(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
                       true)
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
@@ -76,6 +83,12 @@ static cl::opt<unsigned> MaxCheckLimit(
     cl::desc("The maximum number of stores/phis MemorySSA"
              "will consider trying to walk past (default = 100)"));
 
+static cl::opt<unsigned> MaxWalkerSteps(
+    "memssa-walker-budget", cl::Hidden, cl::init(1000000),
+    cl::desc("The maximum number of defs the clobber walker of a function "
+             "will check before it conservatively treats every def it reaches "
+             "as a clobber (default = 1000000)"));
+
 static cl::opt<bool>
     VerifyMemorySSA("verify-memoryssa", cl::init(false), cl::Hidden,
                     cl::desc("Verify MemorySSA in legacy printer pass."));
@@ -454,6 +467,10 @@ class ClobberWalker {
   DominatorTree &DT;
   UpwardsMemoryQuery *Query;
 
+  /// The number of defs we may still check against a query, over all the
+  /// queries of this walker.
+  unsigned StepsLeft;
+
   // Phi optimization bookkeeping
   SmallVector<DefPath, 32> Paths;
   DenseSet<ConstMemoryAccessPair> VisitedPhis;
@@ -488,7 +505,7 @@ class ClobberWalker {
   /// This does not test for whether StopAt is a clobber
   UpwardsWalkResult
   walkToPhiOrClobber(DefPath &Desc,
-                     const MemoryAccess *StopAt = nullptr) const {
+                     const MemoryAccess *StopAt = nullptr) {
     assert(!isa<MemoryUse>(Desc.Last) && "Uses don't exist in my world");
 
     for (MemoryAccess *Current : def_chain(Desc.Last)) {
@@ -496,10 +513,19 @@ class ClobberWalker {
       if (Current == StopAt)
         return {Current, false};
 
-      if (auto *MD = dyn_cast<MemoryDef>(Current))
-        if (MSSA.isLiveOnEntryDef(MD) ||
-            instructionClobbersQuery(MD, Desc.Loc, Query->Inst, AA))
+      if (auto *MD = dyn_cast<MemoryDef>(Current)) {
+        if (MSSA.isLiveOnEntryDef(MD))
+          return {MD, true};
+        // Once the budget is used up, any def may clobber the query.
+        if (!StepsLeft)
+          return {MD, true};
+        if (--StepsLeft == 0) {
+          ++NumWalkerBudgetExhausted;
+          DEBUG(dbgs() << "MemorySSA walker budget exhausted\n");
+        }
+        if (instructionClobbersQuery(MD, Desc.Loc, Query->Inst, AA))
           return {MD, true};
+      }
     }
 
     assert(isa<MemoryPhi>(Desc.Last) &&
@@ -825,10 +851,14 @@ class ClobberWalker {
 
 public:
   ClobberWalker(const MemorySSA &MSSA, AliasAnalysis &AA, DominatorTree &DT)
-      : MSSA(MSSA), AA(AA), DT(DT) {}
+      : MSSA(MSSA), AA(AA), DT(DT), StepsLeft(MaxWalkerSteps) {}
 
   void reset() {}
 
+  /// Whether the walker has run out of budget, so that its results are only
+  /// conservative.
+  bool isOutOfBudget() const { return !StepsLeft; }
+
   /// Finds the nearest clobber for the given query, optimizing phis if
   /// possible.
   MemoryAccess *findClobber(MemoryAccess *Start, UpwardsMemoryQuery &Q) {
@@ -856,7 +886,8 @@ public:
     }
 
 #ifdef EXPENSIVE_CHECKS
-    checkClobberSanity(Current, Result, Q.StartingLoc, MSSA, Q, AA);
+    if (!isOutOfBudget())
+      checkClobberSanity(Current, Result, Q.StartingLoc, MSSA, Q, AA);
 #endif
     return Result;
   }
@@ -884,13 +915,37 @@ struct RenamePassData {
 
 namespace llvm {
 
-/// \brief A MemorySSAWalker that does AA walks to disambiguate accesses. It no
-/// longer does caching on its own,
-/// but the name has been retained for the moment.
+/// \brief A MemorySSAWalker that does AA walks to disambiguate accesses. The
+/// results of queries without an explicit location are kept in the accesses
+/// themselves, see MemoryUseOrDef::setOptimized(). The results of queries with
+/// an explicit location are cached here until MemorySSA changes.
 class MemorySSA::CachingWalker final : public MemorySSAWalker {
   ClobberWalker Walker;
   bool AutoResetWalker = true;
 
+  using LocationQuery = std::pair<const MemoryAccess *, MemoryLocation>;
+  DenseMap<LocationQuery, MemoryAccess *> LocationCache;
+
+  /// Drops the cached results when a pointer they are keyed on is deleted.
+  /// Deleting a value that is not a memory access does not change MemorySSA,
+  /// and another value may later be created at the same address.
+  class LocationPtrHandle final : public CallbackVH {
+    CachingWalker *Walker = nullptr;
+
+    void deleted() override {
+      Walker->LocationCache.clear();
+      setValPtr(nullptr);
+    }
+
+  public:
+    LocationPtrHandle() = default;
+    LocationPtrHandle(const Value *Ptr, CachingWalker *Walker)
+        : CallbackVH(const_cast<Value *>(Ptr)), Walker(Walker) {}
+  };
+
+  /// The handles on the pointers of the locations in LocationCache.
+  DenseMap<const Value *, LocationPtrHandle> LocationPtrs;
+
   MemoryAccess *getClobberingMemoryAccess(MemoryAccess *, UpwardsMemoryQuery &);
 
 public:
@@ -911,6 +966,13 @@ public:
   /// Drop the walker's persistent data structures.
   void resetClobberWalker() { Walker.reset(); }
 
+  /// Drop the cached results of queries with an explicit location. Any
+  /// change to MemorySSA may change them.
+  void clearLocationCache() {
+    LocationCache.clear();
+    LocationPtrs.clear();
+  }
+
   void verify(const MemorySSA *MSSA) override {
     MemorySSAWalker::verify(MSSA);
     Walker.verify(MSSA);
@@ -1369,7 +1431,10 @@ void MemorySSA::buildMemorySSA() {
 
   // We're doing a batch of updates; don't drop useful caches between them.
   Walker->setAutoResetWalker(false);
-  OptimizeUses(this, Walker, AA, DT).optimizeUses();
+  {
+    BatchAAScope BatchAA(*AA);
+    OptimizeUses(this, Walker, AA, DT).optimizeUses();
+  }
   Walker->setAutoResetWalker(true);
   Walker->resetClobberWalker();
 
@@ -1423,6 +1488,8 @@ void MemorySSA::insertIntoListsForBlock(MemoryAccess *NewAccess,
     }
   }
   BlockNumberingValid.erase(BB);
+  if (Walker)
+    Walker->clearLocationCache();
 }
 
 void MemorySSA::insertIntoListsBefore(MemoryAccess *What, const BasicBlock *BB,
@@ -1451,6 +1518,8 @@ void MemorySSA::insertIntoListsBefore(MemoryAccess *What, const BasicBlock *BB,
     }
   }
   BlockNumberingValid.erase(BB);
+  if (Walker)
+    Walker->clearLocationCache();
 }
 
 // Move What before Where in the IR.  The end result is taht What will belong to
@@ -1573,6 +1642,8 @@ void MemorySSA::removeFromLookups(MemoryAccess *MA) {
   // Invalidate our walker's cache if necessary
   if (!isa<MemoryUse>(MA))
     Walker->invalidateInfo(MA);
+  else
+    Walker->clearLocationCache();
   // The call below to erase will destroy MA, so we can't change the order we
   // are doing things here
   Value *MemoryInst;
@@ -1983,6 +2054,7 @@ MemorySSA::CachingWalker::CachingWalker(MemorySSA *M, AliasAnalysis *A,
 void MemorySSA::CachingWalker::invalidateInfo(MemoryAccess *MA) {
   if (auto *MUD = dyn_cast<MemoryUseOrDef>(MA))
     MUD->resetOptimized();
+  clearLocationCache();
 }
 
 /// \brief Walk the use-def chains starting at \p MA and find
@@ -1994,7 +2066,8 @@ MemoryAccess *MemorySSA::CachingWalker::getClobberingMemoryAccess(
   MemoryAccess *New = Walker.findClobber(StartingAccess, Q);
 #ifdef EXPENSIVE_CHECKS
   MemoryAccess *NewNoCache = Walker.findClobber(StartingAccess, Q);
-  assert(NewNoCache == New && "Cache made us hand back a different result?");
+  assert((NewNoCache == New || Walker.isOutOfBudget()) &&
+         "Cache made us hand back a different result?");
   (void)NewNoCache;
 #endif
   if (AutoResetWalker)
@@ -2030,7 +2103,21 @@ MemoryAccess *MemorySSA::CachingWalker::getClobberingMemoryAccess(
                                      ? StartingUseOrDef->getDefiningAccess()
                                      : StartingUseOrDef;
 
+  // The query only depends on the starting access, which determines I, and on
+  // the location.
+  auto CacheIt = LocationCache.find({StartingUseOrDef, Loc});
+  if (CacheIt != LocationCache.end()) {
+    ++NumLocationCacheHits;
+    return CacheIt->second;
+  }
+
   MemoryAccess *Clobber = getClobberingMemoryAccess(DefiningAccess, Q);
+  LocationCache[{StartingUseOrDef, Loc}] = Clobber;
+  if (Loc.Ptr) {
+    LocationPtrHandle &PtrHandle = LocationPtrs[Loc.Ptr];
+    if (!PtrHandle)
+      PtrHandle = LocationPtrHandle(Loc.Ptr, this);
+  }
   DEBUG(dbgs() << "Starting Memory SSA clobber for " << *I << " is ");
   DEBUG(dbgs() << *StartingUseOrDef << "\n");
   DEBUG(dbgs() << "Final Memory SSA clobber for " << *I << " is ");
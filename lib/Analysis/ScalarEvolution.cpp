@@ -79,6 +79,7 @@
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
@@ -143,6 +144,8 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumWorkBudgetsExhausted,
+          "Number of functions in which the work budget was exhausted");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -204,6 +207,12 @@ static cl::opt<unsigned>
                   cl::desc("Max coefficients in AddRec during evolving"),
                   cl::init(16));
 
+static cl::opt<unsigned> MaxWorkPerFunction(
+    "scalar-evolution-max-work", cl::Hidden,
+    cl::desc("Maximum number of expressions, ranges and trip counts computed "
+             "per function before falling back to conservative results"),
+    cl::init(1000000));
+
 //===----------------------------------------------------------------------===//
 //                           SCEV class definitions
 //===----------------------------------------------------------------------===//
@@ -5295,6 +5304,30 @@ static Optional<ConstantRange> GetRangeFromMetadata(Value *V) {
   return None;
 }
 
+bool ScalarEvolution::consumeWork(const Loop *L) {
+  if (RemainingWork == 0)
+    return false;
+  if (--RemainingWork != 0)
+    return true;
+
+  ++NumWorkBudgetsExhausted;
+  OptimizationRemarkEmitter ORE(&F);
+  ORE.emit([&]() {
+    if (L)
+      return OptimizationRemarkAnalysis(DEBUG_TYPE, "WorkBudgetExhausted",
+                                        L->getStartLoc(), L->getHeader())
+             << "work budget exhausted while analyzing loop "
+             << ore::NV("Loop", L->getHeader()->getName())
+             << "; later queries return conservative results";
+    return OptimizationRemarkAnalysis(DEBUG_TYPE, "WorkBudgetExhausted",
+                                      DiagnosticLocation(F.getSubprogram()),
+                                      &F.getEntryBlock())
+           << "work budget exhausted; later queries return conservative "
+              "results";
+  });
+  return true;
+}
+
 /// Determine the range for a particular SCEV.  If SignHint is
 /// HINT_RANGE_UNSIGNED (resp. HINT_RANGE_SIGNED) then getRange prefers ranges
 /// with a "cleaner" unsigned (resp. signed) representation.
@@ -5316,6 +5349,12 @@ ScalarEvolution::getRangeRef(const SCEV *S,
   unsigned BitWidth = getTypeSizeInBits(S->getType());
   ConstantRange ConservativeResult(BitWidth, /*isFullSet=*/true);
 
+  // Only the ranges of add recurrences are charged: they are the ones that
+  // query trip counts and recurse into the start and step.
+  const SCEVAddRecExpr *AddRecS = dyn_cast<SCEVAddRecExpr>(S);
+  if (AddRecS && !consumeWork(AddRecS->getLoop()))
+    return setRange(S, SignHint, std::move(ConservativeResult));
+
   // If the value has known zeros, the maximum value will have those known zeros
   // as well.
   uint32_t TZ = GetMinTrailingZeros(S);
@@ -5863,6 +5902,8 @@ const SCEV *ScalarEvolution::createSCEV(Value *V) {
     // analysis depends on.
     if (!DT.isReachableFromEntry(I->getParent()))
       return getUnknown(V);
+    if (!consumeWork(LI.getLoopFor(I->getParent())))
+      return getUnknown(V);
   } else if (ConstantInt *CI = dyn_cast<ConstantInt>(V))
     return getConstant(CI);
   else if (isa<ConstantPointerNull>(V))
@@ -6707,12 +6748,16 @@ void ScalarEvolution::BackedgeTakenInfo::clear() {
 ScalarEvolution::BackedgeTakenInfo
 ScalarEvolution::computeBackedgeTakenCount(const Loop *L,
                                            bool AllowPredicates) {
-  SmallVector<BasicBlock *, 8> ExitingBlocks;
-  L->getExitingBlocks(ExitingBlocks);
-
   using EdgeExitInfo = ScalarEvolution::BackedgeTakenInfo::EdgeExitInfo;
 
   SmallVector<EdgeExitInfo, 4> ExitCounts;
+  if (!consumeWork(L))
+    return BackedgeTakenInfo(std::move(ExitCounts), /*Complete=*/false,
+                             getCouldNotCompute(), /*MaxOrZero=*/false);
+
+  SmallVector<BasicBlock *, 8> ExitingBlocks;
+  L->getExitingBlocks(ExitingBlocks);
+
   bool CouldComputeBECount = true;
   BasicBlock *Latch = L->getLoopLatch(); // may be NULL.
   const SCEV *MustExitMaxBECount = nullptr;
@@ -9816,6 +9861,9 @@ ScalarEvolution::ExitLimit
 ScalarEvolution::howManyLessThans(const SCEV *LHS, const SCEV *RHS,
                                   const Loop *L, bool IsSigned,
                                   bool ControlsExit, bool AllowPredicates) {
+  if (!consumeWork(L))
+    return getCouldNotCompute();
+
   SmallPtrSet<const SCEVPredicate *, 4> Predicates;
 
   const SCEVAddRecExpr *IV = dyn_cast<SCEVAddRecExpr>(LHS);
@@ -10656,6 +10704,7 @@ ScalarEvolution::ScalarEvolution(Function &F, TargetLibraryInfo &TLI,
                                  AssumptionCache &AC, DominatorTree &DT,
                                  LoopInfo &LI)
     : F(F), TLI(TLI), AC(AC), DT(DT), LI(LI),
+      RemainingWork(MaxWorkPerFunction),
       CouldNotCompute(new SCEVCouldNotCompute()), ValuesAtScopes(64),
       LoopDispositions(64), BlockDispositions(64) {
   // To use guards for proving predicates, we need to scan every instruction in
@@ -10675,7 +10724,8 @@ ScalarEvolution::ScalarEvolution(Function &F, TargetLibraryInfo &TLI,
 
 ScalarEvolution::ScalarEvolution(ScalarEvolution &&Arg)
     : F(Arg.F), HasGuards(Arg.HasGuards), TLI(Arg.TLI), AC(Arg.AC), DT(Arg.DT),
-      LI(Arg.LI), CouldNotCompute(std::move(Arg.CouldNotCompute)),
+      LI(Arg.LI), RemainingWork(Arg.RemainingWork),
+      CouldNotCompute(std::move(Arg.CouldNotCompute)),
       ValueExprMap(std::move(Arg.ValueExprMap)),
       PendingLoopPredicates(std::move(Arg.PendingLoopPredicates)),
       MinTrailingZerosCache(std::move(Arg.MinTrailingZerosCache)),
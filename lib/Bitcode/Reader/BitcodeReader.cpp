@@ -16,6 +16,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -70,12 +71,14 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <deque>
+#include <future>
 #include <map>
 #include <memory>
 #include <set>
@@ -92,6 +95,16 @@ static cl::opt<bool> PrintSummaryGUIDs(
     cl::desc(
         "Print the global id for each value when reading the module summary"));
 
+static cl::opt<unsigned> MaterializeThreads(
+    "bitcode-materialize-threads", cl::init(0), cl::Hidden,
+    cl::desc("Number of threads used to decode function blocks ahead of "
+             "lazy materialization (0 = decode on the materializing thread)"));
+
+static cl::opt<unsigned> MaterializeReadahead(
+    "bitcode-materialize-readahead", cl::init(64), cl::Hidden,
+    cl::desc("Maximum number of function blocks decoded ahead of the function "
+             "being materialized"));
+
 namespace {
 
 enum {
@@ -437,6 +450,115 @@ BitcodeReaderBase::readNameFromStrtab(ArrayRef<uint64_t> Record) {
 
 namespace {
 
+/// The records of a single FUNCTION_BLOCK, decoded ahead of time.
+///
+/// Decoding the records of a function block only needs the bitstream and the
+/// module-level BLOCKINFO abbreviations, so it can happen on a worker thread
+/// while the reader is busy constructing IR for another function. Everything
+/// that touches the LLVMContext stays on the materializing thread: the nested
+/// constants, metadata, value symbol table and use-list blocks are not decoded
+/// here, only their positions are remembered so that the reader can parse them
+/// from its own cursor when the records are replayed.
+class DecodedFunctionBlock {
+  struct Entry {
+    bool IsSubBlock;
+    /// The record code, or the block ID of a nested block.
+    unsigned ID;
+    /// For records, the range of operands in Ops. For nested blocks, Begin is
+    /// the bit just after the block ID.
+    uint64_t Begin;
+    uint64_t End;
+  };
+
+  std::vector<Entry> Entries;
+  std::vector<uint64_t> Ops;
+  /// The bit following the END_BLOCK of the function block.
+  uint64_t EndBit = 0;
+  bool Valid = false;
+  size_t NextEntry = 0;
+
+public:
+  /// Decode the function block starting at \p BitNo. May be called on any
+  /// thread; \p BlockInfo must not change while this runs.
+  void decode(ArrayRef<uint8_t> Bytes, BitstreamBlockInfo *BlockInfo,
+              uint64_t BitNo);
+
+  /// Whether the block was decoded completely. Malformed blocks are left to
+  /// the regular parser so that it can diagnose them.
+  bool isValid() const { return Valid; }
+
+  /// Return the next entry of the block. Nested blocks and the end of the
+  /// block are returned with \p Stream positioned as if it had read them
+  /// itself.
+  BitstreamEntry advance(BitstreamCursor &Stream);
+
+  /// Read the record returned by the last call to advance().
+  unsigned readRecord(SmallVectorImpl<uint64_t> &Vals);
+};
+
+} // end anonymous namespace
+
+void DecodedFunctionBlock::decode(ArrayRef<uint8_t> Bytes,
+                                  BitstreamBlockInfo *BlockInfo,
+                                  uint64_t BitNo) {
+  BitstreamCursor Cursor(Bytes);
+  Cursor.setBlockInfo(BlockInfo);
+  Cursor.JumpToBit(BitNo);
+  if (Cursor.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
+    return;
+
+  SmallVector<uint64_t, 64> Record;
+  while (true) {
+    BitstreamEntry Entry = Cursor.advance();
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return;
+    case BitstreamEntry::EndBlock:
+      EndBit = Cursor.GetCurrentBitNo();
+      Valid = true;
+      return;
+    case BitstreamEntry::SubBlock:
+      Entries.push_back({true, Entry.ID, Cursor.GetCurrentBitNo(), 0});
+      if (Cursor.SkipBlock())
+        return;
+      continue;
+    case BitstreamEntry::Record:
+      break;
+    }
+
+    Record.clear();
+    unsigned Code = Cursor.readRecord(Entry.ID, Record);
+    Entries.push_back({false, Code, Ops.size(), Ops.size() + Record.size()});
+    Ops.insert(Ops.end(), Record.begin(), Record.end());
+  }
+}
+
+BitstreamEntry DecodedFunctionBlock::advance(BitstreamCursor &Stream) {
+  if (NextEntry == Entries.size()) {
+    Stream.JumpToBit(EndBit);
+    if (Stream.ReadBlockEnd())
+      return BitstreamEntry::getError();
+    return BitstreamEntry::getEndBlock();
+  }
+
+  const Entry &E = Entries[NextEntry];
+  if (!E.IsSubBlock)
+    return BitstreamEntry::getRecord(bitc::UNABBREV_RECORD);
+
+  ++NextEntry;
+  Stream.JumpToBit(E.Begin);
+  return BitstreamEntry::getSubBlock(E.ID);
+}
+
+unsigned DecodedFunctionBlock::readRecord(SmallVectorImpl<uint64_t> &Vals) {
+  const Entry &E = Entries[NextEntry++];
+  assert(!E.IsSubBlock && "Expected a record");
+  Vals.append(Ops.begin() + E.Begin, Ops.begin() + E.End);
+  return E.ID;
+}
+
+namespace {
+
 class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   LLVMContext &Context;
   Module *TheModule = nullptr;
@@ -493,6 +615,14 @@ class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   /// where to find deferred function body in the stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// The defined global values that each function calls and references, read
+  /// from the VST_CODE_FNDEPS records of the module-level VST.
+  struct FunctionDependencies {
+    std::vector<GlobalValue *> Callees;
+    std::vector<GlobalValue *> Refs;
+  };
+  DenseMap<const Function *, FunctionDependencies> FunctionDeps;
+
   /// When Metadata block is initially scanned when parsing the module, we may
   /// choose to defer parsing of the metadata. This vector contains info about
   /// which Metadata blocks are deferred.
@@ -522,6 +652,18 @@ class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   std::vector<std::string> BundleTags;
   SmallVector<SyncScope::ID, 8> SSIDs;
 
+  /// Function blocks that are being decoded on DecodeThreads ahead of their
+  /// materialization. See -bitcode-materialize-threads.
+  struct PendingFunctionBlock {
+    std::shared_future<void> Done;
+    std::unique_ptr<DecodedFunctionBlock> Block;
+  };
+  DenseMap<Function *, PendingFunctionBlock> PendingFunctionBlocks;
+
+  /// Declared after PendingFunctionBlocks so that the pool, which waits for
+  /// its tasks on destruction, goes away first.
+  std::unique_ptr<ThreadPool> DecodeThreads;
+
 public:
   BitcodeReader(BitstreamCursor Stream, StringRef Strtab,
                 StringRef ProducerIdentification, LLVMContext &Context);
@@ -531,6 +673,8 @@ public:
   Error materialize(GlobalValue *GV) override;
   Error materializeModule() override;
   std::vector<StructType *> getIdentifiedStructTypes() const override;
+  bool getDependencies(const Function *F, std::vector<GlobalValue *> &Callees,
+                       std::vector<GlobalValue *> &Refs) override;
 
   /// \brief Main interface to parsing a bitcode buffer.
   /// \returns true if an error occurred.
@@ -670,7 +814,9 @@ private:
   /// Save the positions of the Metadata blocks and skip parsing the blocks.
   Error rememberAndSkipMetadata();
   Error typeCheckLoadStoreInst(Type *ValType, Type *PtrType);
-  Error parseFunctionBody(Function *F);
+  Error parseFunctionBody(Function *F, DecodedFunctionBlock *Decoded);
+  void decodeFunctionBlocksAhead(Function *F);
+  std::unique_ptr<DecodedFunctionBlock> takeDecodedFunctionBlock(Function *F);
   Error globalCleanup();
   Error resolveGlobalAndIndirectSymbolInits();
   Error parseUseLists();
@@ -1899,6 +2045,33 @@ Error BitcodeReader::parseGlobalValueSymbolTable() {
       setDeferredFunctionInfo(FuncBitcodeOffsetDelta,
                               cast<Function>(ValueList[Record[0]]), Record);
       break;
+    case bitc::VST_CODE_FNDEPS: {
+      // VST_CODE_FNDEPS: [valueid, numcallees, calleeid x numcallees,
+      //                   refid x N]
+      if (Record.size() < 2 || Record[1] > Record.size() - 2 ||
+          Record[0] >= ValueList.size())
+        return error("Invalid record");
+      auto *F = dyn_cast_or_null<Function>(ValueList[Record[0]]);
+      if (!F)
+        return error("Invalid record");
+      FunctionDependencies &Deps = FunctionDeps[F];
+      for (unsigned I = 2, E = Record.size(); I != E; ++I) {
+        auto *GV = Record[I] < ValueList.size()
+                       ? dyn_cast_or_null<GlobalValue>(ValueList[Record[I]])
+                       : nullptr;
+        if (!GV)
+          return error("Invalid record");
+        // Only definitions are worth following, and declarations of upgraded
+        // intrinsics go away before the module is complete.
+        if (GV->isDeclaration())
+          continue;
+        if (I < Record[1] + 2)
+          Deps.Callees.push_back(GV);
+        else
+          Deps.Refs.push_back(GV);
+      }
+      break;
+    }
     }
   }
 }
@@ -3334,7 +3507,10 @@ Error BitcodeReader::typeCheckLoadStoreInst(Type *ValType, Type *PtrType) {
 }
 
 /// Lazily parse the specified function body block.
-Error BitcodeReader::parseFunctionBody(Function *F) {
+/// Parse the body of \p F. If \p Decoded is not null its records are used
+/// instead of decoding them from the stream.
+Error BitcodeReader::parseFunctionBody(Function *F,
+                                       DecodedFunctionBlock *Decoded) {
   if (Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
     return error("Invalid record");
 
@@ -3370,7 +3546,7 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
   SmallVector<uint64_t, 64> Record;
 
   while (true) {
-    BitstreamEntry Entry = Stream.advance();
+    BitstreamEntry Entry = Decoded ? Decoded->advance(Stream) : Stream.advance();
 
     switch (Entry.Kind) {
     case BitstreamEntry::Error:
@@ -3418,7 +3594,8 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
     // Read a record.
     Record.clear();
     Instruction *I = nullptr;
-    unsigned BitCode = Stream.readRecord(Entry.ID, Record);
+    unsigned BitCode = Decoded ? Decoded->readRecord(Record)
+                               : Stream.readRecord(Entry.ID, Record);
     switch (BitCode) {
     default: // Default behavior: reject
       return error("Invalid value");
@@ -4641,6 +4818,59 @@ Error BitcodeReader::findFunctionInStream(
   return Error::success();
 }
 
+/// Start decoding the function blocks that follow \p F in the module on the
+/// worker threads, up to -bitcode-materialize-readahead of them. Clients that
+/// materialize a module lazily (the IRMover, materializeAll) tend to do so in
+/// module order, so those blocks are usually needed next. The IR itself is
+/// still built on the materializing thread, in the order the client asks for.
+void BitcodeReader::decodeFunctionBlocksAhead(Function *F) {
+  if (!MaterializeThreads)
+    return;
+  if (!DecodeThreads)
+    DecodeThreads = llvm::make_unique<ThreadPool>(MaterializeThreads);
+
+  ArrayRef<uint8_t> Bytes = Stream.getBitcodeBytes();
+  BitstreamBlockInfo *BI = &BlockInfo;
+  unsigned Window = 0;
+  for (auto I = std::next(F->getIterator()), E = TheModule->end();
+       I != E && Window < MaterializeReadahead; ++I) {
+    Function *Next = &*I;
+    if (!Next->isMaterializable())
+      continue;
+    // Bodies whose position is not known yet are found by scanning the stream
+    // on this thread, see findFunctionInStream().
+    auto DFII = DeferredFunctionInfo.find(Next);
+    if (DFII == DeferredFunctionInfo.end() || DFII->second == 0)
+      continue;
+    ++Window;
+    if (PendingFunctionBlocks.count(Next))
+      continue;
+
+    auto Block = llvm::make_unique<DecodedFunctionBlock>();
+    DecodedFunctionBlock *B = Block.get();
+    uint64_t BitNo = DFII->second;
+    PendingFunctionBlock &P = PendingFunctionBlocks[Next];
+    P.Done = DecodeThreads->async([=] { B->decode(Bytes, BI, BitNo); });
+    P.Block = std::move(Block);
+  }
+}
+
+/// Return the records of \p F if they were decoded ahead of time, waiting for
+/// the worker thread if needed, or null if \p F has to be parsed directly
+/// from the stream.
+std::unique_ptr<DecodedFunctionBlock>
+BitcodeReader::takeDecodedFunctionBlock(Function *F) {
+  auto PFBI = PendingFunctionBlocks.find(F);
+  if (PFBI == PendingFunctionBlocks.end())
+    return nullptr;
+  PFBI->second.Done.wait();
+  std::unique_ptr<DecodedFunctionBlock> Block = std::move(PFBI->second.Block);
+  PendingFunctionBlocks.erase(PFBI);
+  if (!Block->isValid())
+    return nullptr;
+  return Block;
+}
+
 SyncScope::ID BitcodeReader::getDecodedSyncScopeID(unsigned Val) {
   if (Val == SyncScope::SingleThread || Val == SyncScope::System)
     return SyncScope::ID(Val);
@@ -4674,7 +4904,9 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
   // Move the bit stream to the saved position of the deferred function body.
   Stream.JumpToBit(DFII->second);
 
-  if (Error Err = parseFunctionBody(F))
+  std::unique_ptr<DecodedFunctionBlock> Decoded = takeDecodedFunctionBlock(F);
+  decodeFunctionBlocksAhead(F);
+  if (Error Err = parseFunctionBody(F, Decoded.get()))
     return Err;
   F->setIsMaterializable(false);
 
@@ -4773,6 +5005,18 @@ Error BitcodeReader::materializeModule() {
   return Error::success();
 }
 
+bool BitcodeReader::getDependencies(const Function *F,
+                                    std::vector<GlobalValue *> &Callees,
+                                    std::vector<GlobalValue *> &Refs) {
+  auto I = FunctionDeps.find(F);
+  if (I == FunctionDeps.end())
+    return false;
+  Callees.insert(Callees.end(), I->second.Callees.begin(),
+                 I->second.Callees.end());
+  Refs.insert(Refs.end(), I->second.Refs.begin(), I->second.Refs.end());
+  return true;
+}
+
 std::vector<StructType *> BitcodeReader::getIdentifiedStructTypes() const {
   return IdentifiedStructTypes;
 }
@@ -5654,6 +5898,101 @@ BitcodeModule::getLazyModule(LLVMContext &Context, bool ShouldLazyLoadMetadata,
   return getModuleImpl(Context, false, ShouldLazyLoadMetadata, IsImporting);
 }
 
+Expected<std::unique_ptr<Module>>
+BitcodeModule::getLazyModuleForGlobals(LLVMContext &Context,
+                                       ArrayRef<StringRef> Names,
+                                       bool CallsOnly) {
+  Expected<std::unique_ptr<Module>> MOrErr =
+      getModuleImpl(Context, false, false, false);
+  if (!MOrErr)
+    return MOrErr.takeError();
+
+  SetVector<GlobalValue *> GVs;
+  for (StringRef Name : Names) {
+    GlobalValue *GV = (*MOrErr)->getNamedValue(Name);
+    if (!GV)
+      return error("Unknown global value '" + Twine(Name) + "'");
+    GVs.insert(GV);
+  }
+  if (Error Err = materializeWithDependencies(GVs, CallsOnly))
+    return std::move(Err);
+  return MOrErr;
+}
+
+/// Collect the defined functions that \p GV calls directly, and the other
+/// defined global values that it references, including through constants.
+static void collectDependencies(GlobalValue &GV,
+                                std::vector<GlobalValue *> &Callees,
+                                std::vector<GlobalValue *> &Refs) {
+  SmallPtrSet<Constant *, 16> Visited;
+  SmallVector<Constant *, 16> Worklist;
+  auto AddOperand = [&](Value *V) {
+    if (auto *C = dyn_cast<Constant>(V))
+      if (Visited.insert(C).second)
+        Worklist.push_back(C);
+  };
+
+  // Initializers, aliasees, and personality, prefix and prologue data.
+  for (Use &U : GV.operands())
+    AddOperand(U.get());
+  if (auto *F = dyn_cast<Function>(&GV))
+    for (BasicBlock &BB : *F)
+      for (Instruction &I : BB) {
+        CallSite CS(&I);
+        Function *Callee = CS ? CS.getCalledFunction() : nullptr;
+        if (Callee && !Callee->isDeclaration())
+          Callees.push_back(Callee);
+        for (Use &U : I.operands())
+          if (!Callee || !CS.isCallee(&U))
+            AddOperand(U.get());
+      }
+
+  while (!Worklist.empty()) {
+    Constant *C = Worklist.pop_back_val();
+    if (auto *Ref = dyn_cast<GlobalValue>(C)) {
+      if (!Ref->isDeclaration())
+        Refs.push_back(Ref);
+      continue;
+    }
+    for (Use &Op : C->operands())
+      AddOperand(Op.get());
+  }
+}
+
+Error llvm::materializeWithDependencies(SetVector<GlobalValue *> &GVs,
+                                        bool CallsOnly) {
+  if (GVs.empty())
+    return Error::success();
+  Module &M = *GVs.front()->getParent();
+  GVMaterializer *Materializer = M.getMaterializer();
+
+  // GVs grows while we walk it.
+  std::vector<GlobalValue *> Callees, Refs;
+  for (unsigned I = 0; I != GVs.size(); ++I) {
+    GlobalValue *GV = GVs[I];
+    Callees.clear();
+    Refs.clear();
+    auto *F = dyn_cast<Function>(GV);
+    if (!F || !F->isMaterializable() || !Materializer ||
+        !Materializer->getDependencies(F, Callees, Refs)) {
+      if (Error Err = GV->materialize())
+        return Err;
+      collectDependencies(*GV, Callees, Refs);
+    }
+    GVs.insert(Callees.begin(), Callees.end());
+    if (!CallsOnly)
+      GVs.insert(Refs.begin(), Refs.end());
+  }
+
+  // Read the remaining bodies in module order, which is the order of the
+  // function blocks in the bitcode.
+  for (Function &F : M)
+    if (F.isMaterializable() && GVs.count(&F))
+      if (Error Err = F.materialize())
+        return Err;
+  return Error::success();
+}
+
 // Parse the specified bitcode buffer and merge the index into CombinedIndex.
 // We don't use ModuleIdentifier here because the client may need to control the
 // module path used in the combined summary (e.g. when reading summaries for
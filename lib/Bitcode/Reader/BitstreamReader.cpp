@@ -9,6 +9,7 @@
 
 #include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/ADT/StringRef.h"
+#include <algorithm>
 #include <cassert>
 #include <string>
 
@@ -48,6 +49,39 @@ bool BitstreamCursor::EnterSubBlock(unsigned BlockID, unsigned *NumWordsP) {
   return CurCodeSize == 0 || AtEndOfStream();
 }
 
+/// Read a VBR field. The chunk widths that dominate LLVM IR bitcode (6 for
+/// operands, 8 for ids and offsets, 4 for small enumerations) are dispatched to
+/// calls with a constant width, so that the masks and shifts in the inlined
+/// decoder fold away.
+static uint64_t readVBR64(BitstreamCursor &Cursor, unsigned NumBits) {
+  switch (NumBits) {
+  case 6:
+    return Cursor.ReadVBR64(6);
+  case 8:
+    return Cursor.ReadVBR64(8);
+  case 4:
+    return Cursor.ReadVBR64(4);
+  default:
+    return Cursor.ReadVBR64(NumBits);
+  }
+}
+
+/// Read a fixed-width field, specializing the common widths like readVBR64.
+static uint64_t readFixed(BitstreamCursor &Cursor, unsigned NumBits) {
+  switch (NumBits) {
+  case 1:
+    return Cursor.Read(1);
+  case 3:
+    return Cursor.Read(3);
+  case 4:
+    return Cursor.Read(4);
+  case 8:
+    return Cursor.Read(8);
+  default:
+    return Cursor.Read(NumBits);
+  }
+}
+
 static uint64_t readAbbreviatedField(BitstreamCursor &Cursor,
                                      const BitCodeAbbrevOp &Op) {
   assert(!Op.isLiteral() && "Not to be used with literals!");
@@ -59,10 +93,10 @@ static uint64_t readAbbreviatedField(BitstreamCursor &Cursor,
     llvm_unreachable("Should not reach here");
   case BitCodeAbbrevOp::Fixed:
     assert((unsigned)Op.getEncodingData() <= Cursor.MaxChunkSize);
-    return Cursor.Read((unsigned)Op.getEncodingData());
+    return readFixed(Cursor, (unsigned)Op.getEncodingData());
   case BitCodeAbbrevOp::VBR:
     assert((unsigned)Op.getEncodingData() <= Cursor.MaxChunkSize);
-    return Cursor.ReadVBR64((unsigned)Op.getEncodingData());
+    return readVBR64(Cursor, (unsigned)Op.getEncodingData());
   case BitCodeAbbrevOp::Char6:
     return BitCodeAbbrevOp::DecodeChar6(Cursor.Read(6));
   }
@@ -92,6 +126,29 @@ static void skipAbbreviatedField(BitstreamCursor &Cursor,
   }
 }
 
+/// Read \p NumElts VBR fields of array operands into \p Vals, with the loop
+/// specialized on the common chunk widths.
+static void readVBRArray(BitstreamCursor &Cursor, unsigned NumBits,
+                         unsigned NumElts, SmallVectorImpl<uint64_t> &Vals) {
+  // Don't trust a corrupt element count further than the stream goes.
+  Vals.reserve(Vals.size() +
+               std::min<uint64_t>(NumElts, Cursor.getBitsLeft() / NumBits));
+  switch (NumBits) {
+  case 6:
+    for (; NumElts; --NumElts)
+      Vals.push_back(Cursor.ReadVBR64(6));
+    break;
+  case 8:
+    for (; NumElts; --NumElts)
+      Vals.push_back(Cursor.ReadVBR64(8));
+    break;
+  default:
+    for (; NumElts; --NumElts)
+      Vals.push_back(Cursor.ReadVBR64(NumBits));
+    break;
+  }
+}
+
 /// skipRecord - Read the current record and discard it.
 unsigned BitstreamCursor::skipRecord(unsigned AbbrevID) {
   // Skip unabbreviated records by reading past their entries.
@@ -182,8 +239,7 @@ unsigned BitstreamCursor::readRecord(unsigned AbbrevID,
   if (AbbrevID == bitc::UNABBREV_RECORD) {
     unsigned Code = ReadVBR(6);
     unsigned NumElts = ReadVBR(6);
-    for (unsigned i = 0; i != NumElts; ++i)
-      Vals.push_back(ReadVBR64(6));
+    readVBRArray(*this, 6, NumElts, Vals);
     return Code;
   }
 
@@ -232,16 +288,18 @@ unsigned BitstreamCursor::readRecord(unsigned AbbrevID,
       default:
         report_fatal_error("Array element type can't be an Array or a Blob");
       case BitCodeAbbrevOp::Fixed:
-        for (; NumElts; --NumElts)
-          Vals.push_back(Read((unsigned)EltEnc.getEncodingData()));
+        ReadFixedArray((unsigned)EltEnc.getEncodingData(), NumElts, Vals);
         break;
       case BitCodeAbbrevOp::VBR:
-        for (; NumElts; --NumElts)
-          Vals.push_back(ReadVBR64((unsigned)EltEnc.getEncodingData()));
+        readVBRArray(*this, (unsigned)EltEnc.getEncodingData(), NumElts, Vals);
         break;
-      case BitCodeAbbrevOp::Char6:
-        for (; NumElts; --NumElts)
-          Vals.push_back(BitCodeAbbrevOp::DecodeChar6(Read(6)));
+      case BitCodeAbbrevOp::Char6: {
+        size_t Start = Vals.size();
+        ReadFixedArray(6, NumElts, Vals);
+        for (size_t I = Start, E = Vals.size(); I != E; ++I)
+          Vals[I] = BitCodeAbbrevOp::DecodeChar6(Vals[I]);
+        break;
+      }
       }
       continue;
     }
@@ -20,6 +20,8 @@
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
@@ -67,8 +69,10 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -86,6 +90,17 @@ static cl::opt<unsigned>
                    cl::desc("Number of metadatas above which we emit an index "
                             "to enable lazy-loading"));
 
+static cl::opt<unsigned> WriterThreads(
+    "bitcode-writer-threads", cl::Hidden, cl::init(0),
+    cl::desc("Number of threads used to write function blocks (0 = write "
+             "them on the calling thread)"));
+
+static cl::opt<bool> WriteFunctionDeps(
+    "bitcode-function-deps", cl::Hidden, cl::init(false),
+    cl::desc("Write the global values that each function calls and references "
+             "to the module-level VST, for extracting functions without "
+             "reading the others"));
+
 namespace {
 
 /// These are manifest constants used by the bitcode writer. They do not need to
@@ -194,6 +209,16 @@ public:
               assignValueId(CallEdge.first.getGUID());
   }
 
+  /// Constructs a ModuleBitcodeWriterBase object that writes parts of the
+  /// module of \p Parent to \p Stream, with its own copy of the module-level
+  /// value enumeration.
+  ModuleBitcodeWriterBase(const ModuleBitcodeWriterBase &Parent,
+                          BitstreamWriter &Stream)
+      : BitcodeWriterBase(Stream, Parent.StrtabBuilder), M(Parent.M),
+        VE(Parent.VE), Index(Parent.Index),
+        GUIDToValueIdMap(Parent.GUIDToValueIdMap),
+        GlobalValueId(Parent.GlobalValueId) {}
+
 protected:
   void writePerModuleGlobalValueSummary();
 
@@ -261,6 +286,14 @@ public:
         Buffer(Buffer), GenerateHash(GenerateHash), ModHash(ModHash),
         BitcodeStartBit(Stream.GetCurrentBitNo()) {}
 
+  /// Constructs a ModuleBitcodeWriter object that writes function blocks of
+  /// the module of \p Parent to its own \p Buffer, see writeFunctionBlocks().
+  ModuleBitcodeWriter(const ModuleBitcodeWriter &Parent,
+                      SmallVectorImpl<char> &Buffer, BitstreamWriter &Stream)
+      : ModuleBitcodeWriterBase(Parent, Stream), Buffer(Buffer),
+        GenerateHash(false), ModHash(nullptr),
+        BitcodeStartBit(Stream.GetCurrentBitNo()) {}
+
   /// Emit the current module to the bitstream.
   void write();
 
@@ -375,6 +408,8 @@ private:
   void
   writeFunction(const Function &F,
                 DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
+  void writeFunctionBlocks(
+      DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
   void writeBlockInfo();
   void writeModuleHash(size_t BlockStartPos);
 
@@ -2856,6 +2891,45 @@ void ModuleBitcodeWriter::writeInstruction(const Instruction &I,
   Vals.clear();
 }
 
+/// Collect the functions that \p F calls directly, and the other global values
+/// that it references, including through constants.
+static void
+collectFunctionDependencies(const Function &F,
+                            SetVector<const GlobalValue *> &Callees,
+                            SetVector<const GlobalValue *> &Refs) {
+  SmallPtrSet<const Constant *, 16> Visited;
+  SmallVector<const Constant *, 16> Worklist;
+  auto AddOperand = [&](const Value *V) {
+    if (auto *C = dyn_cast<Constant>(V))
+      if (Visited.insert(C).second)
+        Worklist.push_back(C);
+  };
+
+  // Personality, prefix and prologue data.
+  for (const Use &U : F.operands())
+    AddOperand(U.get());
+  for (const BasicBlock &BB : F)
+    for (const Instruction &I : BB) {
+      ImmutableCallSite CS(&I);
+      const Function *Callee = CS ? CS.getCalledFunction() : nullptr;
+      if (Callee)
+        Callees.insert(Callee);
+      for (const Use &U : I.operands())
+        if (!Callee || !CS.isCallee(&U))
+          AddOperand(U.get());
+    }
+
+  while (!Worklist.empty()) {
+    const Constant *C = Worklist.pop_back_val();
+    if (auto *GV = dyn_cast<GlobalValue>(C)) {
+      Refs.insert(GV);
+      continue;
+    }
+    for (const Use &Op : C->operands())
+      AddOperand(Op.get());
+  }
+}
+
 /// Write a GlobalValue VST to the module. The purpose of this data structure is
 /// to allow clients to efficiently find the function body.
 void ModuleBitcodeWriter::writeGlobalValueSymbolTable(
@@ -2899,6 +2973,36 @@ void ModuleBitcodeWriter::writeGlobalValueSymbolTable(
     Stream.EmitRecord(bitc::VST_CODE_FNENTRY, Record, FnEntryAbbrev);
   }
 
+  if (WriteFunctionDeps) {
+    // VST_CODE_FNDEPS: [valueid, numcallees, calleeid x numcallees,
+    //                   refid x N]
+    Abbv = std::make_shared<BitCodeAbbrev>();
+    Abbv->Add(BitCodeAbbrevOp(bitc::VST_CODE_FNDEPS));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+    unsigned FnDepsAbbrev = Stream.EmitAbbrev(std::move(Abbv));
+
+    SetVector<const GlobalValue *> Callees, Refs;
+    SmallVector<uint64_t, 64> Vals;
+    for (const Function &F : M) {
+      if (F.isDeclaration())
+        continue;
+
+      Callees.clear();
+      Refs.clear();
+      collectFunctionDependencies(F, Callees, Refs);
+
+      Vals.push_back(VE.getValueID(&F));
+      Vals.push_back(Callees.size());
+      for (const GlobalValue *GV : Callees)
+        Vals.push_back(VE.getValueID(GV));
+      for (const GlobalValue *GV : Refs)
+        Vals.push_back(VE.getValueID(GV));
+      Stream.EmitRecord(bitc::VST_CODE_FNDEPS, Vals, FnDepsAbbrev);
+      Vals.clear();
+    }
+  }
+
   Stream.ExitBlock();
 }
 
@@ -3057,6 +3161,94 @@ void ModuleBitcodeWriter::writeFunction(
   Stream.ExitBlock();
 }
 
+/// Emit the bodies of all functions defined in the module.
+///
+/// With -bitcode-writer-threads, consecutive runs of function blocks are
+/// written into separate buffers on worker threads and then spliced into the
+/// stream in module order. A function block is 32-bit aligned and only refers
+/// to module-level value IDs and to abbrevs from the BLOCKINFO block, so each
+/// worker writes them inside a module block of its own, with its own copy of
+/// the value enumeration, and the result is identical to writing them here.
+void ModuleBitcodeWriter::writeFunctionBlocks(
+    DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex) {
+  std::vector<const Function *> Functions;
+  for (const Function &F : M)
+    if (!F.isDeclaration())
+      Functions.push_back(&F);
+
+  // Use-list orders are popped off a single stack one function at a time, so
+  // they are only written serially.
+  unsigned NumThreads = std::min<size_t>(WriterThreads, Functions.size());
+  if (NumThreads < 2 || VE.shouldPreserveUseListOrder()) {
+    for (const Function *F : Functions)
+      writeFunction(*F, FunctionToBitcodeIndex);
+    return;
+  }
+
+  // Hand out several chunks per thread so that uneven functions balance out.
+  size_t NumChunks = std::min<size_t>(Functions.size(), NumThreads * 4);
+  auto ChunkBegin = [&](size_t Chunk) {
+    return Chunk * Functions.size() / NumChunks;
+  };
+
+  struct FunctionBlockWriter {
+    SmallVector<char, 0> Buffer;
+    DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
+  };
+  std::vector<FunctionBlockWriter> Writers(NumThreads);
+
+  /// For each chunk, the writer that wrote it and its byte range in the
+  /// writer's buffer.
+  struct ChunkInfo {
+    unsigned Writer;
+    size_t Begin;
+    size_t End;
+  };
+  std::vector<ChunkInfo> Chunks(NumChunks);
+  std::atomic<size_t> NextChunk(0);
+
+  // Arguments are created lazily on first access. Make sure that this does
+  // not happen concurrently on the workers.
+  for (const Function *F : Functions)
+    (void)F->arg_begin();
+
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned W = 0; W != NumThreads; ++W)
+      Pool.async([&, W] {
+        FunctionBlockWriter &FBW = Writers[W];
+        BitstreamWriter WorkerStream(FBW.Buffer);
+        ModuleBitcodeWriter Writer(*this, FBW.Buffer, WorkerStream);
+
+        // Enter the state in which function blocks are written: inside the
+        // module block, with the BLOCKINFO abbrevs registered.
+        WorkerStream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
+        Writer.writeBlockInfo();
+
+        for (size_t C; (C = NextChunk++) < NumChunks;) {
+          Chunks[C].Writer = W;
+          Chunks[C].Begin = FBW.Buffer.size();
+          for (size_t I = ChunkBegin(C), E = ChunkBegin(C + 1); I != E; ++I)
+            Writer.writeFunction(*Functions[I], FBW.FunctionToBitcodeIndex);
+          Chunks[C].End = FBW.Buffer.size();
+        }
+        WorkerStream.ExitBlock();
+      });
+  }
+
+  for (size_t C = 0; C != NumChunks; ++C) {
+    const ChunkInfo &CI = Chunks[C];
+    FunctionBlockWriter &FBW = Writers[CI.Writer];
+    uint64_t ChunkStartBit = Stream.GetCurrentBitNo();
+    for (size_t I = ChunkBegin(C), E = ChunkBegin(C + 1); I != E; ++I)
+      FunctionToBitcodeIndex[Functions[I]] =
+          ChunkStartBit + FBW.FunctionToBitcodeIndex[Functions[I]] -
+          uint64_t(CI.Begin) * 8;
+    Stream.EmitAlignedBlocks(
+        makeArrayRef(FBW.Buffer).slice(CI.Begin, CI.End - CI.Begin));
+  }
+}
+
 // Emit blockinfo, which defines the standard abbreviations etc.
 void ModuleBitcodeWriter::writeBlockInfo() {
   // We only want to emit block info records for blocks that have multiple
@@ -3835,9 +4027,7 @@ void ModuleBitcodeWriter::write() {
 
   // Emit function bodies.
   DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
-  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
-    if (!F->isDeclaration())
-      writeFunction(*F, FunctionToBitcodeIndex);
+  writeFunctionBlocks(FunctionToBitcodeIndex);
 
   // Need to write after the above call to WriteFunction which populates
   // the summary information in the index.
@@ -141,7 +141,9 @@ private:
 
 public:
   ValueEnumerator(const Module &M, bool ShouldPreserveUseListOrder);
-  ValueEnumerator(const ValueEnumerator &) = delete;
+  /// Copy the module-level enumeration, so that function blocks can be
+  /// written with independent enumerators on several threads.
+  explicit ValueEnumerator(const ValueEnumerator &) = default;
   ValueEnumerator &operator=(const ValueEnumerator &) = delete;
 
   void dump() const;
@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "LLVMContextImpl.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/OptBisect.h"
 #include "llvm/IR/Type.h"
@@ -135,18 +136,23 @@ LLVMContextImpl::~LLVMContextImpl() {
 }
 
 void LLVMContextImpl::dropTriviallyDeadConstantArrays() {
-  bool Changed;
-  do {
-    Changed = false;
-
-    for (auto I = ArrayConstants.begin(), E = ArrayConstants.end(); I != E;) {
-      auto *C = *I++;
-      if (C->use_empty()) {
-        Changed = true;
-        C->destroyConstant();
-      }
-    }
-  } while (Changed);
+  SmallSetVector<ConstantArray *, 4> WorkList;
+  for (ConstantArray *C : ArrayConstants)
+    if (C->use_empty())
+      WorkList.insert(C);
+
+  // Destroying an array can only make the arrays among its operands dead, so
+  // follow those rather than rescanning all arrays in the context until
+  // nothing changes.
+  while (!WorkList.empty()) {
+    ConstantArray *C = WorkList.pop_back_val();
+    if (!C->use_empty())
+      continue;
+    for (const Use &Op : C->operands())
+      if (auto *OpArray = dyn_cast<ConstantArray>(Op))
+        WorkList.insert(OpArray);
+    C->destroyConstant();
+  }
 }
 
 void Module::dropTriviallyDeadConstantArrays() {
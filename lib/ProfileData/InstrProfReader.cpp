@@ -133,11 +133,13 @@ bool TextInstrProfReader::hasFormat(const MemoryBuffer &Buffer) {
 }
 
 // Read the profile variant flag from the header: ":FE" means this is a FE
-// generated profile. ":IR" means this is an IR level profile. Other strings
+// generated profile. ":IR" means this is an IR level profile. ":CSIR" means
+// this is an IR level profile with context sensitive records. Other strings
 // with a leading ':' will be reported an error format.
 Error TextInstrProfReader::readHeader() {
   Symtab.reset(new InstrProfSymtab());
   bool IsIRInstr = false;
+  bool HasCSIRInstr = false;
   if (!Line->startswith(":")) {
     IsIRLevelProfile = false;
     return success();
@@ -147,11 +149,15 @@ Error TextInstrProfReader::readHeader() {
     IsIRInstr = true;
   else if (Str.equals_lower("fe"))
     IsIRInstr = false;
-  else
+  else if (Str.equals_lower("csir")) {
+    IsIRInstr = true;
+    HasCSIRInstr = true;
+  } else
     return error(instrprof_error::bad_header);
 
   ++Line;
   IsIRLevelProfile = IsIRInstr;
+  HasCSIRLevelProfile = HasCSIRInstr;
   return success();
 }
 
@@ -601,7 +607,7 @@ bool IndexedInstrProfReader::hasFormat(const MemoryBuffer &DataBuffer) {
 
 const unsigned char *
 IndexedInstrProfReader::readSummary(IndexedInstrProf::ProfVersion Version,
-                                    const unsigned char *Cur) {
+                                    const unsigned char *Cur, bool UseCS) {
   using namespace IndexedInstrProf;
   using namespace support;
 
@@ -629,7 +635,9 @@ IndexedInstrProfReader::readSummary(IndexedInstrProf::ProfVersion Version,
                                    Ent.NumBlocks);
     }
     // initialize InstrProfSummary using the SummaryData from disk.
-    this->Summary = llvm::make_unique<ProfileSummary>(
+    std::unique_ptr<ProfileSummary> &Summary =
+        UseCS ? this->CS_Summary : this->Summary;
+    Summary = llvm::make_unique<ProfileSummary>(
         ProfileSummary::PSK_Instr, DetailedSummary,
         SummaryData->get(Summary::TotalBlockCount),
         SummaryData->get(Summary::MaxBlockCount),
@@ -645,7 +653,10 @@ IndexedInstrProfReader::readSummary(IndexedInstrProf::ProfVersion Version,
     InstrProfSummaryBuilder Builder(ProfileSummaryBuilder::DefaultCutoffs);
     // FIXME: This only computes an empty summary. Need to call addRecord for
     // all NamedInstrProfRecords to get the correct summary.
-    this->Summary = Builder.getSummary();
+    if (UseCS)
+      this->CS_Summary = Builder.getSummary();
+    else
+      this->Summary = Builder.getSummary();
     return Cur;
   }
 }
@@ -673,7 +684,12 @@ Error IndexedInstrProfReader::readHeader() {
       IndexedInstrProf::ProfVersion::CurrentVersion)
     return error(instrprof_error::unsupported_version);
 
-  Cur = readSummary((IndexedInstrProf::ProfVersion)FormatVersion, Cur);
+  Cur = readSummary((IndexedInstrProf::ProfVersion)FormatVersion, Cur,
+                    /* UseCS */ false);
+  // The context sensitive summary, if any, follows the regular one.
+  if (FormatVersion & VARIANT_MASK_CSIR_PROF)
+    Cur = readSummary((IndexedInstrProf::ProfVersion)FormatVersion, Cur,
+                      /* UseCS */ true);
 
   // Read the hash type and start offset.
   IndexedInstrProf::HashT HashType = static_cast<IndexedInstrProf::HashT>(
@@ -14,15 +14,26 @@
 // GEP + load from the coroutine frame. At the point of the definition we spill
 // the value into the coroutine frame.
 //
+// The fields of the spilled values are ordered by decreasing alignment to
+// reduce the padding, and allocas whose lifetimes do not overlap share a field.
+// Values that are cheap to compute from the other values of the frame are
+// recreated on resume rather than spilled.
+//
 // TODO: pack values tightly using liveness info.
 //===----------------------------------------------------------------------===//
 
 #include "CoroInternal.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/circular_raw_ostream.h"
@@ -258,6 +269,16 @@ SuspendCrossingInfo::SuspendCrossingInfo(Function &F, coro::Shape &Shape)
 #undef DEBUG_TYPE // "coro-suspend-crossing"
 #define DEBUG_TYPE "coro-frame"
 
+static cl::opt<bool> ReuseFrameSlots(
+    "coro-reuse-frame-slots", cl::init(true), cl::Hidden,
+    cl::desc("Let the allocas whose lifetimes do not overlap share a field of "
+             "the coroutine frame"));
+
+static cl::opt<bool> MaterializeBySize(
+    "coro-materialize-by-size", cl::init(true), cl::Hidden,
+    cl::desc("Recreate a value on resume only if its operands take no more "
+             "room in the coroutine frame than the value itself"));
+
 // We build up the list of spills for every case where a use is separated
 // from the definition by a suspend point.
 
@@ -294,6 +315,131 @@ static void dump(StringRef Title, SpillInfo const &Spills) {
 }
 #endif
 
+// Maps every spilled value to the index of its field in the coroutine frame.
+using FieldIndexMap = DenseMap<Value *, unsigned>;
+
+// The lifetime of an alloca bounded by lifetime markers, at the granularity of
+// the blocks and then of the markers within a block.
+namespace {
+struct AllocaLifetime {
+  AllocaInst *Alloca;
+  SmallPtrSet<Instruction *, 4> Starts;
+  SmallPtrSet<Instruction *, 4> Ends;
+  // The blocks the alloca may be live on entry to.
+  BitVector LiveIn;
+  // The blocks the alloca may be live in at some point.
+  BitVector Live;
+
+  AllocaLifetime(AllocaInst *AI) : Alloca(AI) {}
+};
+} // end anonymous namespace
+
+static bool isLifetimeMarker(User *U, Intrinsic::ID ID) {
+  if (auto *II = dyn_cast<IntrinsicInst>(U))
+    return II->getIntrinsicID() == ID;
+  return false;
+}
+
+// Collect the lifetime markers of the alloca and compute the blocks in which
+// it may be live, i.e. which are reached from a lifetime.start without passing
+// a lifetime.end. Return false if its lifetime is not bounded by markers, or if
+// a marker covers only a part of it or a pointer that may be another object,
+// i.e. a marker on a pointer derived from it other than through casts.
+//
+// The liveness is not propagated along the edges taken when the coroutine
+// suspends: they lead back to the caller, and the frame is used again only
+// once the coroutine resumes at the suspend point.
+static bool computeLifetime(AllocaLifetime &L, Function &F,
+                            BlockToIndexMapping const &Mapping,
+                            SmallPtrSetImpl<SwitchInst *> const &Suspends) {
+  SmallVector<Instruction *, 8> Worklist{L.Alloca};
+  SmallPtrSet<Instruction *, 8> Visited{L.Alloca};
+  while (!Worklist.empty()) {
+    Instruction *Ptr = Worklist.pop_back_val();
+    for (User *U : Ptr->users()) {
+      auto *I = cast<Instruction>(U);
+      bool IsStart = isLifetimeMarker(I, Intrinsic::lifetime_start);
+      if (IsStart || isLifetimeMarker(I, Intrinsic::lifetime_end)) {
+        if (Ptr->stripPointerCasts() != L.Alloca)
+          return false;
+        (IsStart ? L.Starts : L.Ends).insert(I);
+      } else if (isa<CastInst>(I) || isa<GetElementPtrInst>(I) ||
+                 isa<PHINode>(I) || isa<SelectInst>(I)) {
+        if (I->getType()->isPointerTy() && Visited.insert(I).second)
+          Worklist.push_back(I);
+      }
+    }
+  }
+  if (L.Starts.empty())
+    return false;
+
+  const size_t N = Mapping.size();
+  L.LiveIn.resize(N);
+  L.Live.resize(N);
+
+  // Whether the alloca is live at the end of the block given that it is live
+  // on entry to it.
+  auto IsLiveOut = [&](BasicBlock &BB, bool LiveIn) {
+    for (Instruction &I : BB) {
+      if (L.Starts.count(&I))
+        LiveIn = true;
+      else if (L.Ends.count(&I))
+        LiveIn = false;
+    }
+    return LiveIn;
+  };
+
+  bool Changed;
+  do {
+    Changed = false;
+    for (BasicBlock &BB : F) {
+      if (!IsLiveOut(BB, L.LiveIn[Mapping.blockToIndex(&BB)]))
+        continue;
+      auto *SI = dyn_cast<SwitchInst>(BB.getTerminator());
+      BasicBlock *SuspendDest =
+          SI && Suspends.count(SI) ? SI->getDefaultDest() : nullptr;
+      for (BasicBlock *Succ : successors(&BB)) {
+        size_t SuccNo = Mapping.blockToIndex(Succ);
+        if (!L.LiveIn[SuccNo] && Succ != SuspendDest) {
+          L.LiveIn.set(SuccNo);
+          Changed = true;
+        }
+      }
+    }
+  } while (Changed);
+
+  L.Live = L.LiveIn;
+  for (Instruction *I : L.Starts)
+    L.Live.set(Mapping.blockToIndex(I->getParent()));
+  return true;
+}
+
+// Check whether two allocas may be live at the same point.
+static bool lifetimesOverlap(AllocaLifetime const &A, AllocaLifetime const &B,
+                             BlockToIndexMapping const &Mapping) {
+  BitVector Common = A.Live;
+  Common &= B.Live;
+  for (unsigned I : Common.set_bits()) {
+    bool LiveA = A.LiveIn[I];
+    bool LiveB = B.LiveIn[I];
+    if (LiveA && LiveB)
+      return true;
+    for (Instruction &Inst : *Mapping.indexToBlock(I)) {
+      if (A.Starts.count(&Inst))
+        LiveA = true;
+      else if (A.Ends.count(&Inst))
+        LiveA = false;
+      if (B.Starts.count(&Inst))
+        LiveB = true;
+      else if (B.Ends.count(&Inst))
+        LiveB = false;
+      if (LiveA && LiveB)
+        return true;
+    }
+  }
+  return false;
+}
+
 // Build a struct that will keep state for an active coroutine.
 //   struct f.frame {
 //     ResumeFnTy ResumeFnAddr;
@@ -302,9 +448,14 @@ static void dump(StringRef Title, SpillInfo const &Spills) {
 //     ... promise (if present) ...
 //     ... spills ...
 //   };
+//
+// The spills are ordered by decreasing alignment, and the allocas whose
+// lifetimes do not overlap are given the same field, whose type is the one of
+// the largest of them.
 static StructType *buildFrameType(Function &F, coro::Shape &Shape,
-                                  SpillInfo &Spills) {
+                                  SpillInfo &Spills, FieldIndexMap &Fields) {
   LLVMContext &C = F.getContext();
+  const DataLayout &DL = F.getParent()->getDataLayout();
   SmallString<32> Name(F.getName());
   Name.append(".Frame");
   StructType *FrameTy = StructType::create(C, Name);
@@ -320,9 +471,25 @@ static StructType *buildFrameType(Function &F, coro::Shape &Shape,
                           : Type::getInt1Ty(C);
   SmallVector<Type *, 8> Types{FnPtrTy, FnPtrTy, PromiseType,
                                Type::getIntNTy(C, IndexBits)};
+
+  // A field of the frame past the known ones, and the values stored in it.
+  struct FieldInfo {
+    Type *Ty;
+    SmallVector<Value *, 1> Defs;
+    SmallVector<AllocaLifetime *, 1> Lifetimes;
+  };
+  SmallVector<FieldInfo, 8> FieldInfos;
+  SmallVector<std::unique_ptr<AllocaLifetime>, 4> SharedAllocas;
+  BlockToIndexMapping Mapping(F);
+  SmallPtrSet<SwitchInst *, 4> Suspends;
+  for (CoroSuspendInst *CSI : Shape.CoroSuspends)
+    for (User *U : CSI->users())
+      if (auto *SI = dyn_cast<SwitchInst>(U))
+        Suspends.insert(SI);
   Value *CurrentDef = nullptr;
 
-  // Create an entry for every spilled value.
+  // Create an entry for every spilled value, except for the allocas bounded by
+  // lifetime markers which may share one.
   for (auto const &S : Spills) {
     if (CurrentDef == S.def())
       continue;
@@ -333,12 +500,69 @@ static StructType *buildFrameType(Function &F, coro::Shape &Shape,
       continue;
 
     Type *Ty = nullptr;
-    if (auto *AI = dyn_cast<AllocaInst>(CurrentDef))
+    if (auto *AI = dyn_cast<AllocaInst>(CurrentDef)) {
       Ty = AI->getAllocatedType();
-    else
+      if (ReuseFrameSlots && !AI->isArrayAllocation()) {
+        auto L = llvm::make_unique<AllocaLifetime>(AI);
+        if (computeLifetime(*L, F, Mapping, Suspends)) {
+          SharedAllocas.push_back(std::move(L));
+          continue;
+        }
+      }
+    } else
       Ty = CurrentDef->getType();
 
-    Types.push_back(Ty);
+    FieldInfos.push_back({Ty, {CurrentDef}, {}});
+  }
+
+  // Place the allocas from the largest to the smallest in the first field
+  // large and aligned enough for them whose allocas are all dead while they
+  // are live.
+  auto GetSize = [&](AllocaLifetime const *L) {
+    return DL.getTypeAllocSize(L->Alloca->getAllocatedType());
+  };
+  auto GetAlign = [&](AllocaLifetime const *L) {
+    return std::max(L->Alloca->getAlignment(),
+                    DL.getABITypeAlignment(L->Alloca->getAllocatedType()));
+  };
+  std::stable_sort(SharedAllocas.begin(), SharedAllocas.end(),
+                   [&](std::unique_ptr<AllocaLifetime> const &A,
+                       std::unique_ptr<AllocaLifetime> const &B) {
+                     return GetSize(A.get()) > GetSize(B.get());
+                   });
+  size_t FirstShared = FieldInfos.size();
+  for (auto const &L : SharedAllocas) {
+    auto Field = std::find_if(
+        FieldInfos.begin() + FirstShared, FieldInfos.end(),
+        [&](FieldInfo const &FI) {
+          if (DL.getABITypeAlignment(FI.Ty) < GetAlign(L.get()))
+            return false;
+          return llvm::none_of(FI.Lifetimes, [&](AllocaLifetime const *Other) {
+            return lifetimesOverlap(*L, *Other, Mapping);
+          });
+        });
+    if (Field == FieldInfos.end()) {
+      FieldInfos.push_back({L->Alloca->getAllocatedType(), {}, {}});
+      Field = FieldInfos.end() - 1;
+    } else {
+      DEBUG(dbgs() << "sharing a frame field with " << *Field->Defs.front()
+                   << ": " << *L->Alloca << "\n");
+    }
+    Field->Defs.push_back(L->Alloca);
+    Field->Lifetimes.push_back(L.get());
+  }
+
+  // Order the fields by decreasing alignment to reduce the padding.
+  std::stable_sort(FieldInfos.begin(), FieldInfos.end(),
+                   [&](FieldInfo const &A, FieldInfo const &B) {
+                     return DL.getABITypeAlignment(A.Ty) >
+                            DL.getABITypeAlignment(B.Ty);
+                   });
+
+  for (FieldInfo const &FI : FieldInfos) {
+    for (Value *Def : FI.Defs)
+      Fields[Def] = Types.size();
+    Types.push_back(FI.Ty);
   }
   FrameTy->setBody(Types);
 
@@ -388,7 +612,8 @@ static Instruction *splitBeforeCatchSwitch(CatchSwitchInst *CatchSwitch) {
 //    whatever
 //
 //
-static Instruction *insertSpills(SpillInfo &Spills, coro::Shape &Shape) {
+static Instruction *insertSpills(SpillInfo &Spills, coro::Shape &Shape,
+                                 FieldIndexMap const &Fields) {
   auto *CB = Shape.CoroBegin;
   IRBuilder<> Builder(CB->getNextNode());
   PointerType *FramePtrTy = Shape.FrameTy->getPointerTo();
@@ -399,7 +624,7 @@ static Instruction *insertSpills(SpillInfo &Spills, coro::Shape &Shape) {
   Value *CurrentValue = nullptr;
   BasicBlock *CurrentBlock = nullptr;
   Value *CurrentReload = nullptr;
-  unsigned Index = coro::Shape::LastKnownField;
+  unsigned Index = 0;
 
   // We need to keep track of any allocas that need "spilling"
   // since they will live in the coroutine frame now, all access to them
@@ -418,8 +643,10 @@ static Instruction *insertSpills(SpillInfo &Spills, coro::Shape &Shape) {
     auto *G = Builder.CreateConstInBoundsGEP2_32(FrameTy, FramePtr, 0, Index,
                                                  CurrentValue->getName() +
                                                      Twine(".reload.addr"));
+    // An alloca sharing its field with a larger one is accessed through a
+    // cast of the field address.
     return isa<AllocaInst>(CurrentValue)
-               ? G
+               ? Builder.CreateBitCast(G, CurrentValue->getType())
                : Builder.CreateLoad(G,
                                     CurrentValue->getName() + Twine(".reload"));
   };
@@ -431,7 +658,8 @@ static Instruction *insertSpills(SpillInfo &Spills, coro::Shape &Shape) {
       CurrentBlock = nullptr;
       CurrentReload = nullptr;
 
-      ++Index;
+      assert(Fields.count(CurrentValue) && "spilled value without a field");
+      Index = Fields.lookup(CurrentValue);
 
       if (auto *AI = dyn_cast<AllocaInst>(CurrentValue)) {
         // Spilled AllocaInst will be replaced with GEP from the coroutine frame
@@ -506,8 +734,9 @@ static Instruction *insertSpills(SpillInfo &Spills, coro::Shape &Shape) {
   Builder.SetInsertPoint(&Shape.AllocaSpillBlock->front());
   // If we found any allocas, replace all of their remaining uses with Geps.
   for (auto &P : Allocas) {
-    auto *G =
+    Value *G =
         Builder.CreateConstInBoundsGEP2_32(FrameTy, FramePtr, 0, P.second);
+    G = Builder.CreateBitCast(G, P.first->getType());
     // We are not using ReplaceInstWithInst(P.first, cast<Instruction>(G)) here,
     // as we are changing location of the instruction.
     G->takeName(P.first);
@@ -664,8 +893,50 @@ static void rewritePHIs(Function &F) {
 // Check for instructions that we can recreate on resume as opposed to spill
 // the result into a coroutine frame.
 static bool materializable(Instruction &V) {
-  return isa<CastInst>(&V) || isa<GetElementPtrInst>(&V) ||
-         isa<BinaryOperator>(&V) || isa<CmpInst>(&V) || isa<SelectInst>(&V);
+  if (isa<CastInst>(&V) || isa<GetElementPtrInst>(&V) ||
+      isa<BinaryOperator>(&V) || isa<CmpInst>(&V) || isa<SelectInst>(&V))
+    return true;
+  // The vector and aggregate element instructions may take more room in the
+  // frame than their operands, so they are only recreated when the size of
+  // the operands is checked.
+  return MaterializeBySize &&
+         (isa<ExtractElementInst>(&V) || isa<InsertElementInst>(&V) ||
+          isa<ShuffleVectorInst>(&V) || isa<ExtractValueInst>(&V) ||
+          isa<InsertValueInst>(&V));
+}
+
+// Check whether recreating a materializable instruction on resume takes no
+// more room in the frame than spilling it. Its operands are spilled instead,
+// unless they are constants, allocas, materializable themselves, or already
+// used across a suspend point by another user.
+static bool cheaperToMaterialize(Instruction &I, Function &F,
+                                 SuspendCrossingInfo const &Checker) {
+  if (!MaterializeBySize)
+    return true;
+
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  uint64_t OperandSize = 0;
+  SmallPtrSet<Value *, 4> Visited;
+  for (Value *Op : I.operands()) {
+    if (isa<Constant>(Op) || isa<AllocaInst>(Op) || !Visited.insert(Op).second)
+      continue;
+    BasicBlock *DefBB;
+    if (auto *OpI = dyn_cast<Instruction>(Op)) {
+      if (materializable(*OpI))
+        continue;
+      DefBB = OpI->getParent();
+    } else if (isa<Argument>(Op)) {
+      DefBB = &F.getEntryBlock();
+    } else {
+      continue;
+    }
+    if (llvm::any_of(Op->users(), [&](User *U) {
+          return U != &I && Checker.isDefinitionAcrossSuspend(DefBB, U);
+        }))
+      continue;
+    OperandSize += DL.getTypeAllocSize(Op->getType());
+  }
+  return OperandSize <= DL.getTypeAllocSize(I.getType());
 }
 
 // Check for structural coroutine intrinsics that should not be spilled into
@@ -814,7 +1085,7 @@ void coro::buildCoroutineFrame(Function &F, Shape &Shape) {
   for (int Repeat = 0; Repeat < 4; ++Repeat) {
     // See if there are materializable instructions across suspend points.
     for (Instruction &I : instructions(F))
-      if (materializable(I))
+      if (materializable(I) && cheaperToMaterialize(I, F, Checker))
         for (User *U : I.users())
           if (Checker.isDefinitionAcrossSuspend(I, U))
             Spills.emplace_back(&I, U);
@@ -855,6 +1126,7 @@ void coro::buildCoroutineFrame(Function &F, Shape &Shape) {
   }
   DEBUG(dump("Spills", Spills));
   moveSpillUsesAfterCoroBegin(F, Spills, Shape.CoroBegin);
-  Shape.FrameTy = buildFrameType(F, Shape, Spills);
-  Shape.FramePtr = insertSpills(Spills, Shape);
+  FieldIndexMap Fields;
+  Shape.FrameTy = buildFrameType(F, Shape, Spills, Fields);
+  Shape.FramePtr = insertSpills(Spills, Shape, Fields);
 }
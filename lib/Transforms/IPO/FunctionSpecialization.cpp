@@ -0,0 +1,435 @@
+//===- FunctionSpecialization.cpp - Function Specialization ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass clones functions for the call sites that pass them constant
+// integer or function pointer arguments. In the clone, the argument is
+// replaced by the constant: an indirect call through a function pointer
+// argument becomes a direct call that can be inlined, and compares and
+// switches on an integer argument can be folded. IPSCCP, which runs right
+// after this pass in the pipeline, propagates the constants further through
+// the clones.
+//
+// The call sites of a function are grouped by the constants they pass, and a
+// group is specialized when the expected gain outweighs the size of the
+// clone. The gain of a constant argument is the number of its uses that
+// simplify, weighted by loop depth, and a bonus for each indirect call it
+// turns into a direct one. The gain is scaled by the share of the calls to
+// the function made by the group, which comes from the profile when there is
+// one; cold call sites are never specialized. The number of clones per
+// function and the total size of the clones are bounded.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/FunctionSpecialization.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/CodeMetrics.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "function-specialization"
+
+STATISTIC(NumSpecializations, "Number of function specializations created");
+STATISTIC(NumCallSitesSpecialized,
+          "Number of call sites redirected to a specialization");
+
+static cl::opt<unsigned> MaxClonesPerFunction(
+    "func-specialization-max-clones", cl::init(3), cl::Hidden,
+    cl::desc("Maximum number of specializations of a function"));
+
+static cl::opt<unsigned> MaxFunctionSize(
+    "func-specialization-max-size", cl::init(500), cl::Hidden,
+    cl::desc("Do not specialize functions with more instructions"));
+
+static cl::opt<unsigned> SizeGrowthPercent(
+    "func-specialization-size-growth", cl::init(10), cl::Hidden,
+    cl::desc("Maximum growth of the module by specialization, as a "
+             "percentage of its size (at least one function of the maximum "
+             "size is always allowed)"));
+
+static cl::opt<unsigned> IndirectCallBonus(
+    "func-specialization-indirect-call-bonus", cl::init(25), cl::Hidden,
+    cl::desc("Gain of turning an indirect call into a direct one"));
+
+/// The gain of an argument use is multiplied by this for each loop it is in,
+/// up to a depth of 3.
+static const unsigned LoopWeight = 10;
+
+namespace {
+
+/// The call sites of a function that pass it the same constants.
+struct SpecializationCandidate {
+  /// The specialized arguments and their constant values.
+  SmallVector<std::pair<unsigned, Constant *>, 4> Args;
+  SmallVector<CallSite, 4> CallSites;
+  /// The number of times the call sites are executed, or their number if
+  /// there is no profile.
+  uint64_t Weight = 0;
+  uint64_t Gain = 0;
+};
+
+class FunctionSpecializer {
+public:
+  FunctionSpecializer(ProfileSummaryInfo *PSI,
+                      function_ref<BlockFrequencyInfo *(Function &)> GetBFI,
+                      function_ref<TargetTransformInfo &(Function &)> GetTTI,
+                      function_ref<void(Function &)> DeleteFunction)
+      : PSI(PSI), GetBFI(GetBFI), GetTTI(GetTTI),
+        DeleteFunction(DeleteFunction) {}
+
+  bool run(Module &M);
+
+private:
+  /// Returns the number of instructions of \p F, or 0 if it cannot be
+  /// cloned.
+  unsigned getFunctionSize(Function &F);
+
+  /// Returns the gain of replacing \p A by \p C in its function.
+  uint64_t getArgumentGain(Argument &A, Constant *C, LoopInfo &LI);
+
+  /// Group the call sites of \p F by the constants they pass.
+  void collectCandidates(Function &F,
+                         SmallVectorImpl<SpecializationCandidate> &Candidates,
+                         uint64_t &TotalWeight);
+
+  /// Clone \p F for \p Candidate and redirect its call sites to the clone,
+  /// the \p Index'th specialization of \p F.
+  void specialize(Function &F, SpecializationCandidate &Candidate,
+                  unsigned Index);
+
+  bool specializeFunction(Function &F);
+
+  ProfileSummaryInfo *PSI;
+  function_ref<BlockFrequencyInfo *(Function &)> GetBFI;
+  function_ref<TargetTransformInfo &(Function &)> GetTTI;
+  /// Drops the analyses of a function and erases it from the module.
+  function_ref<void(Function &)> DeleteFunction;
+
+  /// Functions that lost all their callers to their specializations. They
+  /// are deleted once all functions have been visited.
+  SmallVector<Function *, 8> DeadFunctions;
+
+  /// The number of instructions the clones may still add to the module.
+  uint64_t Budget = 0;
+};
+
+class FunctionSpecializationLegacyPass : public ModulePass {
+public:
+  static char ID;
+
+  FunctionSpecializationLegacyPass() : ModulePass(ID) {
+    initializeFunctionSpecializationLegacyPassPass(
+        *PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfoWrapperPass>();
+    AU.addRequired<ProfileSummaryInfoWrapperPass>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+  }
+
+  bool runOnModule(Module &M) override;
+};
+
+} // end anonymous namespace
+
+/// Returns true if passing \p V to a function is worth specializing it for.
+static bool isSpecializableConstant(Value *V) {
+  if (isa<ConstantInt>(V))
+    return true;
+  auto *C = dyn_cast<Constant>(V);
+  return C && isa<Function>(C->stripPointerCasts());
+}
+
+unsigned FunctionSpecializer::getFunctionSize(Function &F) {
+  TargetTransformInfo &TTI = GetTTI(F);
+  SmallPtrSet<const Value *, 4> EphValues;
+  CodeMetrics Metrics;
+  for (BasicBlock &BB : F)
+    Metrics.analyzeBasicBlock(&BB, TTI, EphValues);
+  if (Metrics.notDuplicatable)
+    return 0;
+  return Metrics.NumInsts;
+}
+
+uint64_t FunctionSpecializer::getArgumentGain(Argument &A, Constant *C,
+                                              LoopInfo &LI) {
+  bool IsFunction = isa<Function>(C->stripPointerCasts());
+  uint64_t Gain = 0;
+  for (User *U : A.users()) {
+    auto *I = dyn_cast<Instruction>(U);
+    if (!I)
+      continue;
+
+    uint64_t UseGain = 0;
+    CallSite CS(I);
+    if (CS && IsFunction && CS.getCalledValue()->stripPointerCasts() == &A)
+      UseGain = IndirectCallBonus;
+    else if (!IsFunction && (isa<CmpInst>(I) || isa<SwitchInst>(I) ||
+                             isa<BinaryOperator>(I) || isa<SelectInst>(I)))
+      UseGain = 1;
+
+    for (unsigned Depth = std::min(LI.getLoopDepth(I->getParent()), 3u);
+         Depth; --Depth)
+      UseGain *= LoopWeight;
+    Gain += UseGain;
+  }
+  return Gain;
+}
+
+void FunctionSpecializer::collectCandidates(
+    Function &F, SmallVectorImpl<SpecializationCandidate> &Candidates,
+    uint64_t &TotalWeight) {
+  bool HasProfile = PSI->hasProfileSummary();
+  DominatorTree DT(F);
+  LoopInfo LI(DT);
+  DenseMap<std::pair<unsigned, Constant *>, uint64_t> ArgGains;
+  TotalWeight = 0;
+
+  for (User *U : F.users()) {
+    CallSite CS(U);
+    if (!CS || CS.getCalledValue() != &F || CS.arg_size() != F.arg_size())
+      continue;
+    // Calls from a function that is about to be deleted do not count.
+    if (is_contained(DeadFunctions, CS.getCaller()))
+      continue;
+
+    uint64_t Weight = 1;
+    if (HasProfile) {
+      BlockFrequencyInfo *CallerBFI = GetBFI(*CS.getCaller());
+      Optional<uint64_t> Count =
+          PSI->getProfileCount(CS.getInstruction(), CallerBFI);
+      Weight = Count ? *Count : 0;
+      TotalWeight += Weight;
+      if (PSI->isColdCallSite(CS, CallerBFI))
+        continue;
+    } else {
+      ++TotalWeight;
+    }
+
+    SpecializationCandidate Candidate;
+    for (Argument &A : F.args()) {
+      Value *V = CS.getArgument(A.getArgNo());
+      if (!isSpecializableConstant(V))
+        continue;
+      auto Key = std::make_pair(A.getArgNo(), cast<Constant>(V));
+      auto It = ArgGains.find(Key);
+      if (It == ArgGains.end())
+        It = ArgGains.insert({Key, getArgumentGain(A, Key.second, LI)}).first;
+      if (It->second == 0)
+        continue;
+      Candidate.Args.push_back(Key);
+      Candidate.Gain += It->second;
+    }
+    if (Candidate.Args.empty())
+      continue;
+
+    auto Existing = find_if(Candidates, [&](SpecializationCandidate &Other) {
+      return Other.Args == Candidate.Args;
+    });
+    if (Existing == Candidates.end()) {
+      Candidates.push_back(std::move(Candidate));
+      Existing = std::prev(Candidates.end());
+    }
+    Existing->CallSites.push_back(CS);
+    Existing->Weight += Weight;
+  }
+
+  // The entry count also covers the calls this pass cannot see.
+  if (HasProfile)
+    if (Optional<uint64_t> EntryCount = F.getEntryCount())
+      TotalWeight = std::max(TotalWeight, *EntryCount);
+}
+
+void FunctionSpecializer::specialize(Function &F,
+                                     SpecializationCandidate &Candidate,
+                                     unsigned Index) {
+  ValueToValueMapTy VMap;
+  Function *Clone = CloneFunction(&F, VMap);
+  Clone->setName(F.getName() + ".specialized." + Twine(Index));
+  Clone->setLinkage(GlobalValue::InternalLinkage);
+  Clone->setVisibility(GlobalValue::DefaultVisibility);
+  Clone->setComdat(nullptr);
+
+  // The arguments are kept so that the call sites only need a new callee;
+  // dead argument elimination removes them later.
+  for (auto &Arg : Candidate.Args) {
+    Argument *A = &*std::next(Clone->arg_begin(), Arg.first);
+    A->replaceAllUsesWith(Arg.second);
+  }
+  for (CallSite CS : Candidate.CallSites)
+    CS.setCalledFunction(Clone);
+
+  // Move the calls made by the call sites over to the clone.
+  if (PSI->hasProfileSummary())
+    if (Optional<uint64_t> EntryCount = F.getEntryCount()) {
+      uint64_t Moved = std::min(*EntryCount, Candidate.Weight);
+      Clone->setEntryCount(Moved);
+      F.setEntryCount(*EntryCount - Moved);
+    }
+
+  DEBUG(dbgs() << "FnSpecialization: created " << Clone->getName() << " for "
+               << Candidate.CallSites.size() << " call sites\n");
+  ++NumSpecializations;
+  NumCallSitesSpecialized += Candidate.CallSites.size();
+}
+
+bool FunctionSpecializer::specializeFunction(Function &F) {
+  // The linker may pick another definition of an interposable function, so
+  // its body says nothing about what the call sites run.
+  if (F.isDeclaration() || !F.hasExactDefinition() || F.isVarArg() ||
+      F.arg_empty() || F.hasFnAttribute(Attribute::OptimizeNone) ||
+      F.hasFnAttribute(Attribute::NoDuplicate))
+    return false;
+  if (PSI->hasProfileSummary() && PSI->isFunctionEntryCold(&F))
+    return false;
+
+  SmallVector<SpecializationCandidate, 4> Candidates;
+  uint64_t TotalWeight;
+  collectCandidates(F, Candidates, TotalWeight);
+  if (Candidates.empty() || TotalWeight == 0)
+    return false;
+
+  unsigned Size = getFunctionSize(F);
+  if (Size == 0 || Size > MaxFunctionSize)
+    return false;
+
+  // Scale the gain of each group by its share of the calls, and keep the
+  // groups for which it outweighs the size of the clone.
+  for (SpecializationCandidate &Candidate : Candidates)
+    Candidate.Gain =
+        SaturatingMultiply(Candidate.Gain, Candidate.Weight) / TotalWeight;
+  std::stable_sort(Candidates.begin(), Candidates.end(),
+                   [](const SpecializationCandidate &A,
+                      const SpecializationCandidate &B) {
+                     return A.Gain > B.Gain;
+                   });
+
+  bool Changed = false;
+  unsigned NumClones = 0;
+  for (SpecializationCandidate &Candidate : Candidates) {
+    DEBUG(dbgs() << "FnSpecialization: " << F.getName() << " with "
+                 << Candidate.Args.size() << " constant arguments has gain "
+                 << Candidate.Gain << ", size " << Size << "\n");
+    if (NumClones == MaxClonesPerFunction || Candidate.Gain < Size ||
+        Size > Budget)
+      break;
+    specialize(F, Candidate, ++NumClones);
+    Budget -= Size;
+    Changed = true;
+  }
+
+  // The original function may have lost all its callers.
+  if (Changed && F.hasLocalLinkage() && F.use_empty()) {
+    Budget += Size;
+    DeadFunctions.push_back(&F);
+  }
+  return Changed;
+}
+
+bool FunctionSpecializer::run(Module &M) {
+  uint64_t ModuleSize = 0;
+  for (Function &F : M)
+    for (BasicBlock &BB : F)
+      ModuleSize += BB.size();
+  Budget = std::max<uint64_t>(ModuleSize * SizeGrowthPercent / 100,
+                              MaxFunctionSize);
+
+  // Collect the functions first, as specialization adds new ones to the
+  // module.
+  SmallVector<Function *, 16> Worklist;
+  for (Function &F : M)
+    Worklist.push_back(&F);
+
+  bool Changed = false;
+  for (Function *F : Worklist)
+    Changed |= specializeFunction(*F);
+
+  for (Function *F : DeadFunctions)
+    DeleteFunction(*F);
+  DeadFunctions.clear();
+  return Changed;
+}
+
+bool FunctionSpecializationLegacyPass::runOnModule(Module &M) {
+  if (skipModule(M))
+    return false;
+
+  ProfileSummaryInfo *PSI =
+      getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI();
+  auto GetBFI = [this](Function &F) {
+    return &this->getAnalysis<BlockFrequencyInfoWrapperPass>(F).getBFI();
+  };
+  auto GetTTI = [this](Function &F) -> TargetTransformInfo & {
+    return this->getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+  };
+  auto DeleteFunction = [](Function &F) { F.eraseFromParent(); };
+  return FunctionSpecializer(PSI, GetBFI, GetTTI, DeleteFunction).run(M);
+}
+
+char FunctionSpecializationLegacyPass::ID = 0;
+
+INITIALIZE_PASS_BEGIN(FunctionSpecializationLegacyPass,
+                      "function-specialization", "Function Specialization",
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_END(FunctionSpecializationLegacyPass,
+                    "function-specialization", "Function Specialization",
+                    false, false)
+
+ModulePass *llvm::createFunctionSpecializationPass() {
+  return new FunctionSpecializationLegacyPass();
+}
+
+PreservedAnalyses FunctionSpecializationPass::run(Module &M,
+                                                  ModuleAnalysisManager &AM) {
+  auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  ProfileSummaryInfo *PSI = &AM.getResult<ProfileSummaryAnalysis>(M);
+  auto GetBFI = [&FAM](Function &F) {
+    return &FAM.getResult<BlockFrequencyAnalysis>(F);
+  };
+  auto GetTTI = [&FAM](Function &F) -> TargetTransformInfo & {
+    return FAM.getResult<TargetIRAnalysis>(F);
+  };
+  // The analyses cached for a dead function must not outlive it, or a clone
+  // allocated at the same address could pick them up.
+  auto DeleteFunction = [&FAM](Function &F) {
+    FAM.clear(F, F.getName());
+    F.eraseFromParent();
+  };
+
+  if (FunctionSpecializer(PSI, GetBFI, GetTTI, DeleteFunction).run(M))
+    return PreservedAnalyses::none();
+  return PreservedAnalyses::all();
+}
@@ -0,0 +1,397 @@
+//===- HotColdSplitting.cpp - Outline cold regions ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass outlines the cold regions of functions into separate functions.
+// A block is cold if the profile says so, if it contains a call to a cold or
+// noreturn function, if it ends in unreachable, or if all its successors are
+// cold. Each single-entry region of cold blocks is extracted into a function
+// marked cold and minsize and placed in the .unlikely text section, provided
+// the code it removes from the hot function outweighs the call replacing it.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/HotColdSplitting.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <cassert>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "hotcoldsplit"
+
+STATISTIC(NumColdRegionsFound, "Number of cold regions found");
+STATISTIC(NumColdRegionsOutlined, "Number of cold regions outlined");
+
+static cl::opt<int> SplittingThreshold(
+    "hotcoldsplit-threshold", cl::init(2), cl::Hidden,
+    cl::desc("Base penalty of outlining a cold region, i.e. the cost of the "
+             "call and branch replacing it (as a multiple of TCC_Basic)"));
+
+static cl::opt<bool> UseColdSection(
+    "hotcoldsplit-cold-section", cl::init(true), cl::Hidden,
+    cl::desc("Place the outlined functions in the .unlikely text section"));
+
+namespace {
+
+class HotColdSplitting {
+public:
+  HotColdSplitting(ProfileSummaryInfo *PSI,
+                   function_ref<BlockFrequencyInfo *(Function &)> GetBFI,
+                   function_ref<TargetTransformInfo &(Function &)> GetTTI)
+      : PSI(PSI), GetBFI(GetBFI), GetTTI(GetTTI) {}
+
+  bool run(Module &M);
+
+private:
+  bool shouldSplit(Function &F);
+
+  /// Find the blocks of \p F that are unlikely to be executed.
+  void findColdBlocks(Function &F, BlockFrequencyInfo *BFI,
+                      SmallPtrSetImpl<BasicBlock *> &ColdBlocks);
+
+  /// Partition \p ColdBlocks into single-entry regions. The first block of
+  /// each region dominates the others.
+  void findColdRegions(Function &F,
+                       const SmallPtrSetImpl<BasicBlock *> &ColdBlocks,
+                       SmallVectorImpl<SmallVector<BasicBlock *, 8>> &Regions);
+
+  /// Outline \p Region if it is worth it. Returns the outlined function.
+  Function *outlineRegion(ArrayRef<BasicBlock *> Region,
+                          TargetTransformInfo &TTI);
+
+  bool splitFunction(Function &F);
+
+  ProfileSummaryInfo *PSI;
+  function_ref<BlockFrequencyInfo *(Function &)> GetBFI;
+  function_ref<TargetTransformInfo &(Function &)> GetTTI;
+};
+
+class HotColdSplittingLegacyPass : public ModulePass {
+public:
+  static char ID;
+
+  HotColdSplittingLegacyPass() : ModulePass(ID) {
+    initializeHotColdSplittingLegacyPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfoWrapperPass>();
+    AU.addRequired<ProfileSummaryInfoWrapperPass>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+  }
+
+  bool runOnModule(Module &M) override;
+};
+
+} // end anonymous namespace
+
+/// Returns true if the code in \p BB says it is unlikely to be executed.
+static bool isStaticallyCold(const BasicBlock &BB) {
+  if (isa<UnreachableInst>(BB.getTerminator()))
+    return true;
+  for (const Instruction &I : BB)
+    if (ImmutableCallSite CS = ImmutableCallSite(&I))
+      if (CS.hasFnAttr(Attribute::Cold) || CS.doesNotReturn())
+        return true;
+  return false;
+}
+
+/// Returns true if \p BB may be moved into an outlined function.
+static bool mayBeOutlined(const BasicBlock &BB) {
+  // Returns, resumes and the other function exits would leave the outlined
+  // function rather than the original one.
+  const TerminatorInst *Term = BB.getTerminator();
+  if (!isa<BranchInst>(Term) && !isa<SwitchInst>(Term) &&
+      !isa<UnreachableInst>(Term))
+    return false;
+  return CodeExtractor::isBlockValidForExtraction(BB, /*AllowVarArgs=*/false);
+}
+
+bool HotColdSplitting::shouldSplit(Function &F) {
+  if (F.isDeclaration() || F.hasFnAttribute(Attribute::OptimizeNone) ||
+      F.hasFnAttribute(Attribute::Naked))
+    return false;
+  // A cold function, such as one outlined by this pass, has no hot part to
+  // protect.
+  if (F.hasFnAttribute(Attribute::Cold))
+    return false;
+  if (PSI->hasProfileSummary() && PSI->isFunctionEntryCold(&F))
+    return false;
+  return true;
+}
+
+void HotColdSplitting::findColdBlocks(
+    Function &F, BlockFrequencyInfo *BFI,
+    SmallPtrSetImpl<BasicBlock *> &ColdBlocks) {
+  // Visit the successors of a block before the block itself, so that the
+  // coldness of the unlikely exits flows back to the branches leading there.
+  // Loops are handled conservatively: a back edge never makes a block cold.
+  for (BasicBlock *BB : post_order(&F)) {
+    if (BB == &F.getEntryBlock() || !mayBeOutlined(*BB))
+      continue;
+    bool Cold = isStaticallyCold(*BB) || (BFI && PSI->isColdBB(BB, BFI));
+    if (!Cold && succ_begin(BB) != succ_end(BB))
+      Cold = all_of(successors(BB), [&](BasicBlock *Succ) {
+        return ColdBlocks.count(Succ);
+      });
+    if (Cold)
+      ColdBlocks.insert(BB);
+  }
+}
+
+void HotColdSplitting::findColdRegions(
+    Function &F, const SmallPtrSetImpl<BasicBlock *> &ColdBlocks,
+    SmallVectorImpl<SmallVector<BasicBlock *, 8>> &Regions) {
+  DominatorTree DT(F);
+  SmallPtrSet<BasicBlock *, 16> Claimed;
+
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  for (BasicBlock *Header : RPOT) {
+    if (!ColdBlocks.count(Header) || Claimed.count(Header))
+      continue;
+
+    // Start with the cold blocks dominated by the header through cold blocks,
+    // then drop the ones that can be entered from outside the region until
+    // the header is its only entry.
+    SetVector<BasicBlock *> Region;
+    SmallVector<DomTreeNode *, 8> Worklist;
+    Worklist.push_back(DT.getNode(Header));
+    while (!Worklist.empty()) {
+      DomTreeNode *N = Worklist.pop_back_val();
+      Region.insert(N->getBlock());
+      for (DomTreeNode *Child : *N)
+        if (ColdBlocks.count(Child->getBlock()) &&
+            !Claimed.count(Child->getBlock()))
+          Worklist.push_back(Child);
+    }
+
+    bool Changed;
+    do {
+      Changed = false;
+      for (BasicBlock *BB : Region) {
+        if (BB == Header)
+          continue;
+        if (any_of(predecessors(BB),
+                   [&](BasicBlock *Pred) { return !Region.count(Pred); })) {
+          Region.remove(BB);
+          Changed = true;
+          break;
+        }
+      }
+    } while (Changed);
+
+    Claimed.insert(Region.begin(), Region.end());
+    Regions.emplace_back(Region.begin(), Region.end());
+    ++NumColdRegionsFound;
+  }
+}
+
+/// Returns the code size removed from the hot function by outlining
+/// \p Region.
+static int getOutliningBenefit(ArrayRef<BasicBlock *> Region,
+                               TargetTransformInfo &TTI) {
+  int Benefit = 0;
+  for (BasicBlock *BB : Region)
+    for (Instruction &I : *BB)
+      if (!isa<DbgInfoIntrinsic>(I))
+        Benefit += TTI.getUserCost(&I);
+  return Benefit;
+}
+
+/// Returns the code size added to the hot function by the call replacing
+/// \p Region, which takes \p NumInputs arguments and returns \p NumOutputs
+/// values.
+static int getOutliningPenalty(ArrayRef<BasicBlock *> Region,
+                               unsigned NumInputs, unsigned NumOutputs) {
+  int Penalty = SplittingThreshold;
+  // Each input is an argument to set up, and each output goes through memory:
+  // a store in the outlined function and a load after the call.
+  Penalty += NumInputs;
+  Penalty += 2 * NumOutputs;
+
+  // With more than one exit, the call returns which one was taken and the
+  // caller switches on it.
+  SmallPtrSet<BasicBlock *, 4> Exits;
+  for (BasicBlock *BB : Region)
+    for (BasicBlock *Succ : successors(BB))
+      if (!is_contained(Region, Succ))
+        Exits.insert(Succ);
+  if (Exits.size() > 1)
+    Penalty += Exits.size();
+  return Penalty * TargetTransformInfo::TCC_Basic;
+}
+
+/// Returns true if a PHI in an exit of \p Region has several incoming values
+/// from it, which the code extractor cannot merge into one.
+static bool hasMultiEntryExitPHI(ArrayRef<BasicBlock *> Region) {
+  for (BasicBlock *BB : Region)
+    for (BasicBlock *Succ : successors(BB)) {
+      if (is_contained(Region, Succ) || !isa<PHINode>(Succ->begin()))
+        continue;
+      if (count_if(predecessors(Succ), [&](BasicBlock *Pred) {
+            return is_contained(Region, Pred);
+          }) > 1)
+        return true;
+    }
+  return false;
+}
+
+Function *HotColdSplitting::outlineRegion(ArrayRef<BasicBlock *> Region,
+                                          TargetTransformInfo &TTI) {
+  if (hasMultiEntryExitPHI(Region))
+    return nullptr;
+
+  // The dominator tree is not updated as regions are outlined, so do not
+  // give it to the extractor.
+  CodeExtractor CE(Region, /*DT=*/nullptr);
+  if (!CE.isEligible())
+    return nullptr;
+
+  SetVector<Value *> Inputs, Outputs, Sinks;
+  CE.findInputsOutputs(Inputs, Outputs, Sinks);
+  int Benefit = getOutliningBenefit(Region, TTI);
+  int Penalty = getOutliningPenalty(Region, Inputs.size(), Outputs.size());
+  DEBUG(dbgs() << "HotColdSplit: region at " << Region.front()->getName()
+               << " with " << Region.size() << " blocks, benefit " << Benefit
+               << ", penalty " << Penalty << "\n");
+  if (Benefit <= Penalty)
+    return nullptr;
+
+  Function *OutF = CE.extractCodeRegion();
+  if (!OutF)
+    return nullptr;
+
+  OutF->addFnAttr(Attribute::Cold);
+  OutF->addFnAttr(Attribute::MinSize);
+  if (UseColdSection)
+    OutF->setSectionPrefix(".unlikely");
+
+  // A region without exits, such as one ending in a call to abort, never
+  // returns. Say so, so that the code after the call goes away.
+  bool Returns = any_of(*OutF, [](BasicBlock &BB) {
+    return isa<ReturnInst>(BB.getTerminator());
+  });
+  if (!Returns)
+    OutF->setDoesNotReturn();
+
+  // Keep the inliner from undoing the split.
+  for (User *U : OutF->users())
+    if (auto *CI = dyn_cast<CallInst>(U)) {
+      CI->setIsNoInline();
+      if (!Returns) {
+        CI->setDoesNotReturn();
+        changeToUnreachable(CI->getNextNode(), /*UseLLVMTrap=*/false);
+      }
+    }
+  ++NumColdRegionsOutlined;
+  return OutF;
+}
+
+bool HotColdSplitting::splitFunction(Function &F) {
+  BlockFrequencyInfo *BFI = nullptr;
+  if (PSI->hasProfileSummary() && F.getEntryCount())
+    BFI = GetBFI(F);
+
+  SmallPtrSet<BasicBlock *, 16> ColdBlocks;
+  findColdBlocks(F, BFI, ColdBlocks);
+  if (ColdBlocks.empty())
+    return false;
+
+  SmallVector<SmallVector<BasicBlock *, 8>, 4> Regions;
+  findColdRegions(F, ColdBlocks, Regions);
+
+  TargetTransformInfo &TTI = GetTTI(F);
+  bool Changed = false;
+  for (SmallVectorImpl<BasicBlock *> &Region : Regions)
+    if (Function *OutF = outlineRegion(Region, TTI)) {
+      DEBUG(dbgs() << "HotColdSplit: outlined " << OutF->getName() << "\n");
+      Changed = true;
+    }
+  return Changed;
+}
+
+bool HotColdSplitting::run(Module &M) {
+  // Collect the functions first, as outlining adds new ones to the module.
+  SmallVector<Function *, 16> Worklist;
+  for (Function &F : M)
+    if (shouldSplit(F))
+      Worklist.push_back(&F);
+
+  bool Changed = false;
+  for (Function *F : Worklist)
+    Changed |= splitFunction(*F);
+  return Changed;
+}
+
+bool HotColdSplittingLegacyPass::runOnModule(Module &M) {
+  if (skipModule(M))
+    return false;
+
+  ProfileSummaryInfo *PSI =
+      getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI();
+  auto GetBFI = [this](Function &F) {
+    return &this->getAnalysis<BlockFrequencyInfoWrapperPass>(F).getBFI();
+  };
+  auto GetTTI = [this](Function &F) -> TargetTransformInfo & {
+    return this->getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+  };
+  return HotColdSplitting(PSI, GetBFI, GetTTI).run(M);
+}
+
+char HotColdSplittingLegacyPass::ID = 0;
+
+INITIALIZE_PASS_BEGIN(HotColdSplittingLegacyPass, "hotcoldsplit",
+                      "Hot Cold Splitting", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_END(HotColdSplittingLegacyPass, "hotcoldsplit",
+                    "Hot Cold Splitting", false, false)
+
+ModulePass *llvm::createHotColdSplittingPass() {
+  return new HotColdSplittingLegacyPass();
+}
+
+PreservedAnalyses HotColdSplittingPass::run(Module &M,
+                                            ModuleAnalysisManager &AM) {
+  auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  ProfileSummaryInfo *PSI = &AM.getResult<ProfileSummaryAnalysis>(M);
+  auto GetBFI = [&FAM](Function &F) {
+    return &FAM.getResult<BlockFrequencyAnalysis>(F);
+  };
+  auto GetTTI = [&FAM](Function &F) -> TargetTransformInfo & {
+    return FAM.getResult<TargetIRAnalysis>(F);
+  };
+
+  if (HotColdSplitting(PSI, GetBFI, GetTTI).run(M))
+    return PreservedAnalyses::none();
+  return PreservedAnalyses::all();
+}
@@ -73,7 +73,7 @@ public:
     };
     return llvm::getInlineCost(CS, Params, TTI, GetAssumptionCache,
                                /*GetBFI=*/None, PSI,
-                               RemarksEnabled ? &ORE : nullptr);
+                               RemarksEnabled ? &ORE : nullptr, &CostCache);
   }
 
   bool runOnSCC(CallGraphSCC &SCC) override;
@@ -468,13 +468,17 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
                 bool InsertLifetime,
                 function_ref<InlineCost(CallSite CS)> GetInlineCost,
                 function_ref<AAResults &(Function &)> AARGetter,
-                ImportedFunctionsInliningStatistics &ImportedFunctionsStats) {
+                ImportedFunctionsInliningStatistics &ImportedFunctionsStats,
+                InlineCostCache &CostCache) {
   SmallPtrSet<Function *, 8> SCCFunctions;
   DEBUG(dbgs() << "Inliner visiting SCC:");
   for (CallGraphNode *Node : SCC) {
     Function *F = Node->getFunction();
-    if (F)
+    if (F) {
       SCCFunctions.insert(F);
+      // The function may have changed since it was summarized as a callee.
+      CostCache.invalidate(*F);
+    }
     DEBUG(dbgs() << " " << (F ? F->getName() : "INDIRECTNODE"));
   }
 
@@ -597,6 +601,7 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
         // Update the call graph by deleting the edge from Callee to Caller.
         CG[Caller]->removeCallEdgeFor(CS);
         Instr->eraseFromParent();
+        CostCache.invalidate(*Caller);
         ++NumCallsDeleted;
       } else {
         // Get DebugLoc to report. CS will be invalid after Inliner.
@@ -617,6 +622,7 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
           });
           continue;
         }
+        CostCache.invalidate(*Caller);
         ++NumInlined;
 
         ORE.emit([&]() {
@@ -686,6 +692,11 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
     }
   } while (LocalChange);
 
+  // The passes run after the inliner on this SCC may change its functions
+  // further, so they are summarized again when their callers are visited.
+  for (Function *F : SCCFunctions)
+    CostCache.invalidate(*F);
+
   return Changed;
 }
 
@@ -699,12 +710,14 @@ bool LegacyInlinerBase::inlineCalls(CallGraphSCC &SCC) {
   };
   return inlineCallsImpl(SCC, CG, GetAssumptionCache, PSI, TLI, InsertLifetime,
                          [this](CallSite CS) { return getInlineCost(CS); },
-                         LegacyAARGetter(*this), ImportedFunctionsStats);
+                         LegacyAARGetter(*this), ImportedFunctionsStats,
+                         CostCache);
 }
 
 /// Remove now-dead linkonce functions at the end of
 /// processing to avoid breaking the SCC traversal.
 bool LegacyInlinerBase::doFinalization(CallGraph &CG) {
+  CostCache.clear();
   if (InlinerFunctionImportStats != InlinerFunctionImportStatsOpts::No)
     ImportedFunctionsStats.dump(InlinerFunctionImportStats ==
                                 InlinerFunctionImportStatsOpts::Verbose);
@@ -804,6 +817,16 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
   Module &M = *InitialC.begin()->getFunction().getParent();
   ProfileSummaryInfo *PSI = MAM.getCachedResult<ProfileSummaryAnalysis>(M);
 
+  if (!CostCache)
+    CostCache = llvm::make_unique<InlineCostCache>();
+  // The functions of the SCC may have changed since they were summarized as
+  // callees, and they may change again after this pass.
+  SmallVector<Function *, 4> SCCFunctions;
+  for (LazyCallGraph::Node &N : InitialC) {
+    SCCFunctions.push_back(&N.getFunction());
+    CostCache->invalidate(N.getFunction());
+  }
+
   // We use a single common worklist for calls across the entire SCC. We
   // process these in-order and append new calls introduced during inlining to
   // the end.
@@ -907,7 +930,7 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
       Function &Callee = *CS.getCalledFunction();
       auto &CalleeTTI = FAM.getResult<TargetIRAnalysis>(Callee);
       return getInlineCost(CS, Params, CalleeTTI, GetAssumptionCache, {GetBFI},
-                           PSI, &ORE);
+                           PSI, &ORE, CostCache.get());
     };
 
     // Now process as many calls as we have within this caller in the sequnece.
@@ -965,6 +988,7 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
       }
       DidInline = true;
       InlinedCallees.insert(&Callee);
+      CostCache->invalidate(F);
 
       ORE.emit([&]() {
         bool AlwaysInline = OIC->isAlways();
@@ -1015,6 +1039,7 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
           // Note that after this point, it is an error to do anything other
           // than use the callee's address or delete it.
           Callee.dropAllReferences();
+          CostCache->invalidate(Callee);
           assert(find(DeadFunctions, &Callee) == DeadFunctions.end() &&
                  "Cannot put cause a function to become dead twice!");
           DeadFunctions.push_back(&Callee);
@@ -1077,6 +1102,9 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
     InlinedCallees.clear();
   }
 
+  for (Function *F : SCCFunctions)
+    CostCache->invalidate(*F);
+
   // Now that we've finished inlining all of the calls across this SCC, delete
   // all of the trivially dead functions, updating the call graph and the CGSCC
   // pass manager in the process.
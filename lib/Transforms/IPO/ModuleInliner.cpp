@@ -0,0 +1,488 @@
+//===- ModuleInliner.cpp - Module level inliner ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements an inliner that visits the call sites of a whole
+// module in a global priority order. The CGSCC inliner walks the call graph
+// bottom-up with a threshold per call site, so a hot call chain that crosses
+// SCC boundaries is inlined wherever the walk reaches it first, and may run
+// out of budget in the wrong place. Here the hottest call sites according to
+// the profile are inlined first, and then the ones whose cost is the furthest
+// below their threshold, until the growth budget of the module is spent.
+//
+// The priority of a call site depends on its caller and callee, which change
+// as other call sites are inlined. Rather than updating the queue on every
+// change, the priority of a call site is recomputed when it reaches the top of
+// the queue, and the call site is queued again if it dropped below the next
+// one. The call sites exposed by inlining are added to the queue.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/ModuleInliner.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "module-inline"
+
+STATISTIC(NumInlined, "Number of call sites inlined");
+STATISTIC(NumDeleted, "Number of functions deleted because all callers found");
+STATISTIC(NumRequeued, "Number of call sites queued again with a lower "
+                       "priority");
+STATISTIC(NumOverBudget, "Number of call sites not inlined because the growth "
+                         "budget was spent");
+
+static cl::opt<unsigned> ModuleInlinerGrowthPercent(
+    "module-inliner-growth-percent", cl::init(50), cl::Hidden,
+    cl::desc("The growth of the module, in percent of its size, allowed to "
+             "the module inliner"));
+
+namespace {
+
+/// The priority of a call site in the queue. Call sites are ordered by their
+/// profile count, and then by how far their cost is below the threshold.
+struct InlinePriority {
+  uint64_t Count = 0;
+  int Benefit = 0;
+
+  bool operator<(const InlinePriority &RHS) const {
+    return std::tie(Count, Benefit) < std::tie(RHS.Count, RHS.Benefit);
+  }
+};
+
+struct InlineCandidate {
+  /// The call instruction, or null if it was deleted since it was queued.
+  WeakVH Call;
+  /// The entry of the inline history for the callee whose inlining exposed
+  /// this call site, or -1.
+  int InlineHistoryID;
+  InlinePriority Priority;
+};
+
+static bool compareCandidates(const InlineCandidate &LHS,
+                              const InlineCandidate &RHS) {
+  return LHS.Priority < RHS.Priority;
+}
+
+class ModuleInliner {
+public:
+  ModuleInliner(
+      const InlineParams &Params, ProfileSummaryInfo *PSI,
+      std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
+      function_ref<BlockFrequencyInfo &(Function &)> GetBFI,
+      function_ref<TargetTransformInfo &(Function &)> GetTTI,
+      function_ref<OptimizationRemarkEmitter &(Function &)> GetORE,
+      function_ref<void(Function &)> InvalidateAnalyses)
+      : Params(Params), PSI(PSI), GetAssumptionCache(GetAssumptionCache),
+        GetBFI(GetBFI), GetTTI(GetTTI), GetORE(GetORE),
+        InvalidateAnalyses(InvalidateAnalyses) {}
+
+  bool run(Module &M);
+
+private:
+  /// Queue \p CS if it calls a function that may be inlined.
+  void enqueue(CallSite CS, int InlineHistoryID);
+
+  InlineCost getInlineCostFor(CallSite CS);
+  InlinePriority getPriority(CallSite CS, const InlineCost &IC);
+
+  /// Return true if the inline history \p InlineHistoryID includes \p F.
+  bool inlineHistoryIncludes(Function *F, int InlineHistoryID) const;
+
+  void emitNotInlined(CallSite CS, const InlineCost &IC);
+
+  const InlineParams &Params;
+  ProfileSummaryInfo *PSI;
+  std::function<AssumptionCache &(Function &)> &GetAssumptionCache;
+  function_ref<BlockFrequencyInfo &(Function &)> GetBFI;
+  function_ref<TargetTransformInfo &(Function &)> GetTTI;
+  function_ref<OptimizationRemarkEmitter &(Function &)> GetORE;
+  function_ref<void(Function &)> InvalidateAnalyses;
+
+  /// The costs of the callee bodies analyzed so far.
+  InlineCostCache CostCache;
+
+  /// The call sites to visit, as a max-heap on their priority.
+  std::vector<InlineCandidate> Queue;
+
+  /// The callees whose inlining exposed new call sites, each with the entry
+  /// of its own call site. This prevents the infinite inlining of recursive
+  /// calls.
+  SmallVector<std::pair<Function *, int>, 16> InlineHistory;
+
+  /// The functions left without uses by inlining, whose body is dropped.
+  SmallSetVector<Function *, 8> DeadFunctions;
+};
+
+/// The function analyses used by the legacy pass, which cannot hold the
+/// results of several functions at once when queried from a module pass.
+struct FunctionAnalyses {
+  DominatorTree DT;
+  LoopInfo LI;
+  BranchProbabilityInfo BPI;
+  BlockFrequencyInfo BFI;
+  OptimizationRemarkEmitter ORE;
+
+  FunctionAnalyses(Function &F)
+      : DT(F), LI(DT), BPI(F, LI), BFI(F, BPI, LI), ORE(&F, &BFI) {}
+};
+
+class ModuleInlinerLegacyPass : public ModulePass {
+public:
+  static char ID;
+
+  ModuleInlinerLegacyPass(InlineParams Params = getInlineParams())
+      : ModulePass(ID), Params(std::move(Params)) {
+    initializeModuleInlinerLegacyPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<AssumptionCacheTracker>();
+    AU.addRequired<ProfileSummaryInfoWrapperPass>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  InlineParams Params;
+};
+
+} // end anonymous namespace
+
+/// Return the number of instructions of \p F.
+static uint64_t getFunctionSize(const Function &F) {
+  uint64_t Size = 0;
+  for (const BasicBlock &BB : F)
+    Size += BB.size();
+  return Size;
+}
+
+InlineCost ModuleInliner::getInlineCostFor(CallSite CS) {
+  Function &Callee = *CS.getCalledFunction();
+  return getInlineCost(CS, Params, GetTTI(Callee), GetAssumptionCache,
+                       {GetBFI}, PSI, &GetORE(*CS.getCaller()), &CostCache);
+}
+
+InlinePriority ModuleInliner::getPriority(CallSite CS, const InlineCost &IC) {
+  InlinePriority Priority;
+  if (PSI && PSI->hasProfileSummary())
+    if (Optional<uint64_t> Count = PSI->getProfileCount(
+            CS.getInstruction(), &GetBFI(*CS.getCaller())))
+      Priority.Count = *Count;
+  if (IC.isAlways())
+    Priority.Benefit = std::numeric_limits<int>::max();
+  else if (IC.isNever())
+    Priority.Benefit = std::numeric_limits<int>::min();
+  else
+    Priority.Benefit = IC.getCostDelta();
+  return Priority;
+}
+
+bool ModuleInliner::inlineHistoryIncludes(Function *F,
+                                          int InlineHistoryID) const {
+  while (InlineHistoryID != -1) {
+    assert(unsigned(InlineHistoryID) < InlineHistory.size() &&
+           "Invalid inline history ID");
+    if (InlineHistory[InlineHistoryID].first == F)
+      return true;
+    InlineHistoryID = InlineHistory[InlineHistoryID].second;
+  }
+  return false;
+}
+
+void ModuleInliner::emitNotInlined(CallSite CS, const InlineCost &IC) {
+  using namespace ore;
+
+  Instruction *Call = CS.getInstruction();
+  Function *Callee = CS.getCalledFunction();
+  Function *Caller = CS.getCaller();
+  OptimizationRemarkEmitter &ORE = GetORE(*Caller);
+  if (IC.isNever()) {
+    DEBUG(dbgs() << "    NOT Inlining: cost=never, Call: " << *Call << "\n");
+    ORE.emit([&]() {
+      return OptimizationRemarkMissed(DEBUG_TYPE, "NeverInline", Call)
+             << NV("Callee", Callee) << " not inlined into "
+             << NV("Caller", Caller)
+             << " because it should never be inlined (cost=never)";
+    });
+    return;
+  }
+  DEBUG(dbgs() << "    NOT Inlining: cost=" << IC.getCost()
+               << ", thres=" << IC.getThreshold() << ", Call: " << *Call
+               << "\n");
+  ORE.emit([&]() {
+    return OptimizationRemarkMissed(DEBUG_TYPE, "TooCostly", Call)
+           << NV("Callee", Callee) << " not inlined into "
+           << NV("Caller", Caller) << " because too costly to inline (cost="
+           << NV("Cost", IC.getCost())
+           << ", threshold=" << NV("Threshold", IC.getThreshold()) << ")";
+  });
+}
+
+void ModuleInliner::enqueue(CallSite CS, int InlineHistoryID) {
+  Function *Callee = CS.getCalledFunction();
+  if (!Callee || Callee->isDeclaration())
+    return;
+  InlineCost IC = getInlineCostFor(CS);
+  if (IC.isNever()) {
+    emitNotInlined(CS, IC);
+    return;
+  }
+  Queue.push_back(
+      {WeakVH(CS.getInstruction()), InlineHistoryID, getPriority(CS, IC)});
+  std::push_heap(Queue.begin(), Queue.end(), compareCandidates);
+}
+
+bool ModuleInliner::run(Module &M) {
+  uint64_t ModuleSize = 0;
+  for (Function &F : M)
+    ModuleSize += getFunctionSize(F);
+  const uint64_t MaxModuleSize =
+      ModuleSize + ModuleSize * ModuleInlinerGrowthPercent / 100;
+
+  for (Function &F : M) {
+    if (F.isDeclaration() || F.hasFnAttribute(Attribute::OptimizeNone))
+      continue;
+    for (Instruction &I : instructions(F))
+      if (auto CS = CallSite(&I))
+        enqueue(CS, -1);
+  }
+
+  bool Changed = false;
+  while (!Queue.empty()) {
+    std::pop_heap(Queue.begin(), Queue.end(), compareCandidates);
+    InlineCandidate Candidate = Queue.back();
+    Queue.pop_back();
+
+    auto *Call = cast_or_null<Instruction>(Candidate.Call);
+    if (!Call || DeadFunctions.count(Call->getFunction()))
+      continue;
+    CallSite CS(Call);
+    Function &Caller = *CS.getCaller();
+    Function *Callee = CS.getCalledFunction();
+    if (!Callee || Callee->isDeclaration())
+      continue;
+    if (Candidate.InlineHistoryID != -1 &&
+        inlineHistoryIncludes(Callee, Candidate.InlineHistoryID))
+      continue;
+
+    InlineCost IC = getInlineCostFor(CS);
+    if (!IC) {
+      emitNotInlined(CS, IC);
+      continue;
+    }
+
+    // The caller or the callee may have changed since the call site was
+    // queued. Queue it again if it is no longer at the top.
+    InlinePriority Priority = getPriority(CS, IC);
+    if (Priority < Candidate.Priority && !Queue.empty() &&
+        Priority < Queue.front().Priority) {
+      Candidate.Priority = Priority;
+      Queue.push_back(Candidate);
+      std::push_heap(Queue.begin(), Queue.end(), compareCandidates);
+      ++NumRequeued;
+      continue;
+    }
+
+    using namespace ore;
+
+    // A local callee without other uses is deleted after inlining, so its
+    // inlining does not grow the module.
+    OptimizationRemarkEmitter &ORE = GetORE(Caller);
+    bool CalleeDies = Callee->hasLocalLinkage() && Callee->hasOneUse();
+    uint64_t Growth = CalleeDies ? 0 : getFunctionSize(*Callee);
+    if (!IC.isAlways() && ModuleSize + Growth > MaxModuleSize) {
+      DEBUG(dbgs() << "    NOT Inlining: growth=" << Growth
+                   << " over budget, Call: " << *Call << "\n");
+      ++NumOverBudget;
+      ORE.emit([&]() {
+        return OptimizationRemarkMissed(DEBUG_TYPE, "GrowthBudget", Call)
+               << NV("Callee", Callee) << " not inlined into "
+               << NV("Caller", &Caller)
+               << " because the growth budget of the module is spent";
+      });
+      continue;
+    }
+
+    DEBUG(dbgs() << "    Inlining: cost=" << IC.getCost()
+                 << ", thres=" << IC.getThreshold()
+                 << ", count=" << Priority.Count << ", Call: " << *Call
+                 << "\n");
+    InlineFunctionInfo IFI(/*cg=*/nullptr, &GetAssumptionCache, PSI,
+                           &GetBFI(Caller), &GetBFI(*Callee));
+    // The call site is invalid after inlining.
+    DebugLoc DLoc = Call->getDebugLoc();
+    BasicBlock *Block = Call->getParent();
+    uint64_t CallerSize = getFunctionSize(Caller);
+    if (!InlineFunction(CS, IFI)) {
+      ORE.emit([&]() {
+        return OptimizationRemarkMissed(DEBUG_TYPE, "NotInlined", DLoc, Block)
+               << NV("Callee", Callee) << " will not be inlined into "
+               << NV("Caller", &Caller);
+      });
+      continue;
+    }
+    ++NumInlined;
+    Changed = true;
+    ModuleSize -= CallerSize;
+    ModuleSize += getFunctionSize(Caller);
+
+    ORE.emit([&]() {
+      bool AlwaysInline = IC.isAlways();
+      StringRef RemarkName = AlwaysInline ? "AlwaysInline" : "Inlined";
+      OptimizationRemark R(DEBUG_TYPE, RemarkName, DLoc, Block);
+      R << NV("Callee", Callee) << " inlined into " << NV("Caller", &Caller);
+      if (AlwaysInline)
+        R << " with cost=always";
+      else
+        R << " with cost=" << NV("Cost", IC.getCost())
+          << " (threshold=" << NV("Threshold", IC.getThreshold()) << ")";
+      return R;
+    });
+
+    AttributeFuncs::mergeAttributesForInlining(Caller, *Callee);
+    InvalidateAnalyses(Caller);
+    CostCache.invalidate(Caller);
+
+    // Queue the call sites exposed by inlining.
+    if (!IFI.InlinedCallSites.empty()) {
+      int NewHistoryID = InlineHistory.size();
+      InlineHistory.push_back({Callee, Candidate.InlineHistoryID});
+      for (CallSite &NewCS : IFI.InlinedCallSites)
+        enqueue(NewCS, NewHistoryID);
+    }
+
+    // Drop the body of a local callee without uses left, and delete it once
+    // the queue is empty.
+    if (Callee->hasLocalLinkage()) {
+      Callee->removeDeadConstantUsers();
+      if (Callee->use_empty()) {
+        ModuleSize -= getFunctionSize(*Callee);
+        InvalidateAnalyses(*Callee);
+        CostCache.invalidate(*Callee);
+        Callee->dropAllReferences();
+        DeadFunctions.insert(Callee);
+      }
+    }
+  }
+
+  for (Function *F : DeadFunctions) {
+    F->eraseFromParent();
+    ++NumDeleted;
+  }
+  return Changed;
+}
+
+bool ModuleInlinerLegacyPass::runOnModule(Module &M) {
+  if (skipModule(M))
+    return false;
+
+  ProfileSummaryInfo *PSI =
+      getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI();
+  AssumptionCacheTracker *ACT = &getAnalysis<AssumptionCacheTracker>();
+  std::function<AssumptionCache &(Function &)> GetAssumptionCache =
+      [ACT](Function &F) -> AssumptionCache & {
+    return ACT->getAssumptionCache(F);
+  };
+  DenseMap<Function *, std::unique_ptr<FunctionAnalyses>> Analyses;
+  auto GetAnalyses = [&Analyses](Function &F) -> FunctionAnalyses & {
+    std::unique_ptr<FunctionAnalyses> &Result = Analyses[&F];
+    if (!Result)
+      Result = llvm::make_unique<FunctionAnalyses>(F);
+    return *Result;
+  };
+  auto GetBFI = [&](Function &F) -> BlockFrequencyInfo & {
+    return GetAnalyses(F).BFI;
+  };
+  auto GetTTI = [this](Function &F) -> TargetTransformInfo & {
+    return this->getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+  };
+  auto GetORE = [&](Function &F) -> OptimizationRemarkEmitter & {
+    return GetAnalyses(F).ORE;
+  };
+  auto InvalidateAnalyses = [&Analyses](Function &F) { Analyses.erase(&F); };
+
+  return ModuleInliner(Params, PSI, GetAssumptionCache, GetBFI, GetTTI, GetORE,
+                       InvalidateAnalyses)
+      .run(M);
+}
+
+char ModuleInlinerLegacyPass::ID = 0;
+
+INITIALIZE_PASS_BEGIN(ModuleInlinerLegacyPass, "module-inline",
+                      "Module Inliner", false, false)
+INITIALIZE_PASS_DEPENDENCY(AssumptionCacheTracker)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_END(ModuleInlinerLegacyPass, "module-inline",
+                    "Module Inliner", false, false)
+
+ModulePass *llvm::createModuleInlinerPass() {
+  return new ModuleInlinerLegacyPass();
+}
+
+ModulePass *llvm::createModuleInlinerPass(InlineParams &Params) {
+  return new ModuleInlinerLegacyPass(Params);
+}
+
+PreservedAnalyses ModuleInlinerPass::run(Module &M,
+                                         ModuleAnalysisManager &AM) {
+  auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  ProfileSummaryInfo *PSI = &AM.getResult<ProfileSummaryAnalysis>(M);
+  std::function<AssumptionCache &(Function &)> GetAssumptionCache =
+      [&FAM](Function &F) -> AssumptionCache & {
+    return FAM.getResult<AssumptionAnalysis>(F);
+  };
+  auto GetBFI = [&FAM](Function &F) -> BlockFrequencyInfo & {
+    return FAM.getResult<BlockFrequencyAnalysis>(F);
+  };
+  auto GetTTI = [&FAM](Function &F) -> TargetTransformInfo & {
+    return FAM.getResult<TargetIRAnalysis>(F);
+  };
+  auto GetORE = [&FAM](Function &F) -> OptimizationRemarkEmitter & {
+    return FAM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+  };
+  auto InvalidateAnalyses = [&FAM](Function &F) {
+    FAM.invalidate(F, PreservedAnalyses::none());
+  };
+
+  if (!ModuleInliner(Params, PSI, GetAssumptionCache, GetBFI, GetTTI, GetORE,
+                     InvalidateAnalyses)
+           .run(M))
+    return PreservedAnalyses::all();
+  return PreservedAnalyses::none();
+}
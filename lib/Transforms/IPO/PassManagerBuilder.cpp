@@ -94,6 +94,14 @@ static cl::opt<bool> EnableLoopInterchange(
     "enable-loopinterchange", cl::init(false), cl::Hidden,
     cl::desc("Enable the new, experimental LoopInterchange Pass"));
 
+static cl::opt<bool> EnableLoopFusion(
+    "enable-loop-fusion", cl::init(false), cl::Hidden,
+    cl::desc("Enable the experimental loop fusion pass"));
+
+static cl::opt<bool>
+    EnableUnrollAndJam("enable-unroll-and-jam", cl::init(false), cl::Hidden,
+                       cl::desc("Enable Unroll And Jam Pass"));
+
 static cl::opt<bool>
     EnablePrepareForThinLTO("prepare-for-thinlto", cl::init(false), cl::Hidden,
                             cl::desc("Enable preparation for ThinLTO."));
@@ -106,6 +114,10 @@ static cl::opt<std::string>
     PGOOutputFile("profile-generate-file", cl::init(""), cl::Hidden,
                       cl::desc("Specify the path of profile data file."));
 
+static cl::opt<bool> RunPGOCSInstrGen(
+    "cs-profile-generate", cl::init(false), cl::Hidden,
+    cl::desc("Enable context sensitive PGO instrumentation after inlining."));
+
 static cl::opt<std::string> RunPGOInstrUse(
     "profile-use", cl::init(""), cl::Hidden, cl::value_desc("filename"),
     cl::desc("Enable use phase of PGO instrumentation and specify the path "
@@ -128,6 +140,10 @@ static cl::opt<bool> EnableEarlyCSEMemSSA(
     "enable-earlycse-memssa", cl::init(true), cl::Hidden,
     cl::desc("Enable the EarlyCSE w/ MemorySSA pass (default = on)"));
 
+static cl::opt<bool> EnableDSEMemSSA(
+    "enable-dse-memssa", cl::init(false), cl::Hidden,
+    cl::desc("Enable the DSE w/ MemorySSA pass (default = off)"));
+
 static cl::opt<bool> EnableGVNHoist(
     "enable-gvn-hoist", cl::init(false), cl::Hidden,
     cl::desc("Enable the GVN hoisting pass (default = off)"));
@@ -146,6 +162,19 @@ static cl::opt<bool> EnableGVNSink(
     "enable-gvn-sink", cl::init(false), cl::Hidden,
     cl::desc("Enable the GVN sinking pass (default = off)"));
 
+static cl::opt<bool> EnableHotColdSplit(
+    "hot-cold-split", cl::init(false), cl::Hidden,
+    cl::desc("Enable the hot/cold splitting pass (default = off)"));
+
+static cl::opt<bool> EnableFunctionSpecialization(
+    "enable-function-specialization", cl::init(false), cl::Hidden,
+    cl::desc("Enable the function specialization pass (default = off)"));
+
+static cl::opt<bool> EnableModuleInliner(
+    "enable-module-inliner", cl::init(false), cl::Hidden,
+    cl::desc("Use the module inliner instead of the CGSCC inliner after the "
+             "link (default = off)"));
+
 PassManagerBuilder::PassManagerBuilder() {
     OptLevel = 2;
     SizeLevel = 0;
@@ -164,6 +193,8 @@ PassManagerBuilder::PassManagerBuilder() {
     EnablePGOInstrGen = RunPGOInstrGen;
     PGOInstrGen = PGOOutputFile;
     PGOInstrUse = RunPGOInstrUse;
+    EnablePGOCSInstrGen = RunPGOCSInstrGen;
+    EnablePGOCSInstrUse = true;
     PrepareForThinLTO = EnablePrepareForThinLTO;
     PerformThinLTO = false;
     DivergentTarget = false;
@@ -258,7 +289,25 @@ void PassManagerBuilder::populateFunctionPassManager(
 }
 
 // Do PGO instrumentation generation or use pass as the option specified.
-void PassManagerBuilder::addPGOInstrPasses(legacy::PassManagerBase &MPM) {
+// With \p IsCS, add the context sensitive passes that run after inlining.
+void PassManagerBuilder::addPGOInstrPasses(legacy::PassManagerBase &MPM,
+                                           bool IsCS) {
+  if (IsCS) {
+    if (EnablePGOCSInstrGen) {
+      MPM.add(createPGOInstrumentationGenLegacyPass(/*IsCS=*/true));
+      InstrProfOptions Options;
+      if (!PGOInstrGen.empty())
+        Options.InstrProfileOutput = PGOInstrGen;
+      Options.DoCounterPromotion = true;
+      MPM.add(createLoopRotatePass());
+      MPM.add(createInstrProfilingLegacyPass(Options));
+    } else if (EnablePGOCSInstrUse && !PGOInstrUse.empty()) {
+      MPM.add(createPGOInstrumentationUseLegacyPass(PGOInstrUse,
+                                                    /*IsCS=*/true));
+    }
+    return;
+  }
+
   if (!EnablePGOInstrGen && PGOInstrUse.empty() && PGOSampleUse.empty())
     return;
   // Perform the preinline and cleanup passes for O1 and above.
@@ -346,6 +395,8 @@ void PassManagerBuilder::addFunctionSimplificationPasses(
   addExtensionsToPM(EP_LateLoopOptimizations, MPM);
   MPM.add(createLoopDeletionPass());          // Delete dead loops
 
+  if (EnableLoopFusion)
+    MPM.add(createLoopFusePass());            // Fuse adjacent loops
   if (EnableLoopInterchange) {
     MPM.add(createLoopInterchangePass()); // Interchange loops
     MPM.add(createCFGSimplificationPass());
@@ -373,7 +424,8 @@ void PassManagerBuilder::addFunctionSimplificationPasses(
   addExtensionsToPM(EP_Peephole, MPM);
   MPM.add(createJumpThreadingPass());         // Thread jumps
   MPM.add(createCorrelatedValuePropagationPass());
-  MPM.add(createDeadStoreEliminationPass());  // Delete dead stores
+  // Delete dead stores
+  MPM.add(createDeadStoreEliminationPass(EnableDSEMemSSA));
   MPM.add(createLICMPass());
 
   addExtensionsToPM(EP_ScalarOptimizerLate, MPM);
@@ -403,7 +455,7 @@ void PassManagerBuilder::populateModulePassManager(
   // If all optimizations are disabled, just run the always-inline pass and,
   // if enabled, the function merging pass.
   if (OptLevel == 0) {
-    addPGOInstrPasses(MPM);
+    addPGOInstrPasses(MPM, /*IsCS=*/false);
     if (Inliner) {
       MPM.add(Inliner);
       Inliner = nullptr;
@@ -471,6 +523,10 @@ void PassManagerBuilder::populateModulePassManager(
   if (OptLevel > 2)
     MPM.add(createCallSiteSplittingPass());
 
+  // Specialize functions for constant arguments right before IPSCCP, which
+  // then propagates the constants through the clones.
+  if (EnableFunctionSpecialization)
+    MPM.add(createFunctionSpecializationPass());
   MPM.add(createIPSCCPPass());          // IP SCCP
   MPM.add(createCalledValuePropagationPass());
   MPM.add(createGlobalOptimizerPass()); // Optimize out global vars
@@ -489,16 +545,26 @@ void PassManagerBuilder::populateModulePassManager(
   // PGO instrumentation is added during the compile phase for ThinLTO, do
   // not run it a second time
   if (!PerformThinLTO && !PrepareForThinLTOUsingPGOSampleProfile)
-    addPGOInstrPasses(MPM);
+    addPGOInstrPasses(MPM, /*IsCS=*/false);
 
   // We add a module alias analysis pass here. In part due to bugs in the
   // analysis infrastructure this "works" in that the analysis stays alive
   // for the entire SCC pass run below.
   MPM.add(createGlobalsAAWrapperPass());
 
+  // In the ThinLTO backend, inline the call sites in a global priority order
+  // before the bottom-up walk simplifies the inlined code.
+  bool RunInliner = false;
+  if (Inliner && PerformThinLTO && EnableModuleInliner) {
+    InlineParams Params = getInlineParams(OptLevel, SizeLevel);
+    MPM.add(createModuleInlinerPass(Params));
+    delete Inliner;
+    Inliner = nullptr;
+    RunInliner = true;
+  }
+
   // Start of CallGraph SCC passes.
   MPM.add(createPruneEHPass()); // Remove dead EH info
-  bool RunInliner = false;
   if (Inliner) {
     MPM.add(Inliner);
     Inliner = nullptr;
@@ -562,6 +628,11 @@ void PassManagerBuilder::populateModulePassManager(
     // optimizations later.
     MPM.add(createGlobalOptimizerPass());
 
+  // Instrument or annotate the IR after inlining with the context sensitive
+  // profile. For LTO this is done after the link time inliner instead.
+  if (!PrepareForLTO)
+    addPGOInstrPasses(MPM, /*IsCS=*/true);
+
   // Scheduling LoopVersioningLICM when inlining is over, because after that
   // we may see more accurate aliasing. Reason to run this late is that too
   // early versioning may prevent further inlining due to increase of code
@@ -646,6 +717,13 @@ void PassManagerBuilder::populateModulePassManager(
   addInstructionCombiningPass(MPM);
 
   if (!DisableUnrollLoops) {
+    if (EnableUnrollAndJam) {
+      // Unroll and Jam. We do this before unroll but need to be in a separate
+      // loop pass manager in order for the outer loop to be processed by
+      // unroll and jam before the inner loop is unrolled.
+      MPM.add(createLoopUnrollAndJamPass(OptLevel));
+    }
+
     MPM.add(createLoopUnrollPass(OptLevel));    // Unroll small loops
 
     // LoopUnroll may generate some redundency to cleanup.
@@ -692,6 +770,11 @@ void PassManagerBuilder::populateModulePassManager(
   // resulted in single-entry-single-exit or empty blocks. Clean up the CFG.
   MPM.add(createCFGSimplificationPass());
 
+  // Split out cold code. This is done late so that the cold regions do not
+  // hide context from the other optimizations.
+  if (EnableHotColdSplit)
+    MPM.add(createHotColdSplittingPass());
+
   addExtensionsToPM(EP_OptimizerLast, MPM);
 }
 
@@ -769,7 +852,13 @@ void PassManagerBuilder::addLTOOptimizationPasses(legacy::PassManagerBase &PM) {
   // Inline small functions
   bool RunInliner = Inliner;
   if (RunInliner) {
-    PM.add(Inliner);
+    if (EnableModuleInliner) {
+      InlineParams Params = getInlineParams(OptLevel, SizeLevel);
+      PM.add(createModuleInlinerPass(Params));
+      delete Inliner;
+    } else {
+      PM.add(Inliner);
+    }
     Inliner = nullptr;
   }
 
@@ -780,6 +869,10 @@ void PassManagerBuilder::addLTOOptimizationPasses(legacy::PassManagerBase &PM) {
     PM.add(createGlobalOptimizerPass());
   PM.add(createGlobalDCEPass()); // Remove dead functions.
 
+  // Context sensitive profile instrumentation or annotation after the link
+  // time inliner.
+  addPGOInstrPasses(PM, /*IsCS=*/true);
+
   // If we didn't decide to inline a function, check to see if we can
   // transform it to pass arguments by value instead of by reference.
   PM.add(createArgumentPromotionPass());
@@ -803,7 +896,7 @@ void PassManagerBuilder::addLTOOptimizationPasses(legacy::PassManagerBase &PM) {
   PM.add(createMemCpyOptPass());            // Remove dead memcpys.
 
   // Nuke dead stores.
-  PM.add(createDeadStoreEliminationPass());
+  PM.add(createDeadStoreEliminationPass(EnableDSEMemSSA));
 
   // More loops are countable; try to optimize them.
   PM.add(createIndVarSimplifyPass());
@@ -23,6 +23,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DomTreeUpdater.h"
 #include "llvm/Analysis/GlobalsModRef.h"
 #include "llvm/Analysis/IteratedDominanceFrontier.h"
 #include "llvm/Analysis/PostDominators.h"
@@ -565,6 +566,10 @@ void AggressiveDeadCodeElimination::updateDeadRegions() {
   // Don't compute the post ordering unless we needed it.
   bool HavePostOrder = false;
 
+  // Nothing looks at the (post)dominator trees while dead branches are being
+  // removed, so update both of them once for all the removed edges.
+  DomTreeUpdater DTU(&DT, &PDT, DomTreeUpdater::UpdateStrategy::Lazy);
+
   for (auto *BB : BlocksWithDeadTerminators) {
     auto &Info = BlockInfo[BB];
     if (Info.UnconditionalBranch) {
@@ -613,8 +618,7 @@ void AggressiveDeadCodeElimination::updateDeadRegions() {
       }
     }
 
-    DT.applyUpdates(DeletedEdges);
-    PDT.applyUpdates(DeletedEdges);
+    DTU.applyUpdates(DeletedEdges);
 
     NumBranchesRemoved += 1;
   }
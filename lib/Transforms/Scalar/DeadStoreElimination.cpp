@@ -8,10 +8,9 @@
 //===----------------------------------------------------------------------===//
 //
 // This file implements a trivial dead store elimination that only considers
-// basic-block local redundant stores.
-//
-// FIXME: This should eventually be extended to be a post-dominator tree
-// traversal.  Doing so would be pretty trivial.
+// basic-block local redundant stores.  When MemorySSA is requested, dead stores
+// are instead found across basic blocks by walking MemorySSA def chains and
+// using the post-dominator tree.
 //
 //===----------------------------------------------------------------------===//
 
@@ -29,6 +28,9 @@
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
 #include "llvm/Analysis/MemoryLocation.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/MemorySSAUpdater.h"
+#include "llvm/Analysis/PostDominators.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Argument.h"
@@ -48,6 +50,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Value.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
@@ -85,6 +88,11 @@ EnablePartialStoreMerging("enable-dse-partial-store-merging",
   cl::init(true), cl::Hidden,
   cl::desc("Enable partial store merging in DSE"));
 
+static cl::opt<unsigned>
+MemorySSAScanLimit("dse-memoryssa-scanlimit", cl::init(150), cl::Hidden,
+  cl::desc("The number of memory accesses to look at for each store when "
+           "using MemorySSA in DSE (default = 150)"));
+
 //===----------------------------------------------------------------------===//
 // Helper functions
 //===----------------------------------------------------------------------===//
@@ -876,6 +884,31 @@ static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
   return MadeChange;
 }
 
+/// Returns the value of the wider constant store \p Earlier after the
+/// narrower constant store \p Later, which writes only within it, has been
+/// applied to it.
+static APInt mergeStoredConstants(StoreInst *Earlier, StoreInst *Later,
+                                  int64_t EarlierOffset, int64_t LaterOffset,
+                                  const DataLayout &DL) {
+  APInt EarlierValue =
+      cast<ConstantInt>(Earlier->getValueOperand())->getValue();
+  APInt LaterValue = cast<ConstantInt>(Later->getValueOperand())->getValue();
+  unsigned LaterBits = LaterValue.getBitWidth();
+  assert(EarlierValue.getBitWidth() > LaterValue.getBitWidth());
+  LaterValue = LaterValue.zext(EarlierValue.getBitWidth());
+
+  // Offset of the smaller store inside the larger store
+  unsigned BitOffsetDiff = (LaterOffset - EarlierOffset) * 8;
+  unsigned LShiftAmount =
+      DL.isBigEndian() ? EarlierValue.getBitWidth() - BitOffsetDiff - LaterBits
+                       : BitOffsetDiff;
+  APInt Mask = APInt::getBitsSet(EarlierValue.getBitWidth(), LShiftAmount,
+                                 LShiftAmount + LaterBits);
+  // Clear the bits we'll be replacing, then OR with the smaller
+  // store, shifted appropriately.
+  return (EarlierValue & ~Mask) | (LaterValue << LShiftAmount);
+}
+
 static bool tryToShorten(Instruction *EarlierWrite, int64_t &EarlierOffset,
                          int64_t &EarlierSize, int64_t LaterOffset,
                          int64_t LaterSize, bool IsOverwriteEnd) {
@@ -1189,28 +1222,8 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
             // merge of both values.
             // TODO: Deal with other constant types (vectors, etc), and probably
             // some mem intrinsics (if needed)
-
-            APInt EarlierValue =
-                cast<ConstantInt>(Earlier->getValueOperand())->getValue();
-            APInt LaterValue =
-                cast<ConstantInt>(Later->getValueOperand())->getValue();
-            unsigned LaterBits = LaterValue.getBitWidth();
-            assert(EarlierValue.getBitWidth() > LaterValue.getBitWidth());
-            LaterValue = LaterValue.zext(EarlierValue.getBitWidth());
-
-            // Offset of the smaller store inside the larger store
-            unsigned BitOffsetDiff = (InstWriteOffset - DepWriteOffset) * 8;
-            unsigned LShiftAmount =
-                DL.isBigEndian()
-                    ? EarlierValue.getBitWidth() - BitOffsetDiff - LaterBits
-                    : BitOffsetDiff;
-            APInt Mask =
-                APInt::getBitsSet(EarlierValue.getBitWidth(), LShiftAmount,
-                                  LShiftAmount + LaterBits);
-            // Clear the bits we'll be replacing, then OR with the smaller
-            // store, shifted appropriately.
-            APInt Merged =
-                (EarlierValue & ~Mask) | (LaterValue << LShiftAmount);
+            APInt Merged = mergeStoredConstants(Earlier, Later, DepWriteOffset,
+                                                InstWriteOffset, DL);
             DEBUG(dbgs() << "DSE: Merge Stores:\n  Earlier: " << *DepWrite
                          << "\n  Later: " << *Inst
                          << "\n  Merged Value: " << Merged << '\n');
@@ -1288,15 +1301,481 @@ static bool eliminateDeadStores(Function &F, AliasAnalysis *AA,
   return MadeChange;
 }
 
+//===----------------------------------------------------------------------===//
+// MemorySSA backed DSE
+//===----------------------------------------------------------------------===//
+namespace {
+
+/// Dead store elimination on top of MemorySSA.
+///
+/// For every store (the killing write) we walk up its chain of MemoryDefs and
+/// look for earlier writes it overwrites. An earlier write is dead if the
+/// killing write post-dominates it, nothing between the two can unwind to a
+/// caller that sees the memory, and no MemorySSA user of the earlier write
+/// reads the location before the killing write. Unlike the MemDep based
+/// implementation above, this works across basic blocks. A write is also dead
+/// if it is overwritten by every incoming write of a MemoryPhi that
+/// post-dominates it, e.g. on both arms of a diamond. All walks are bounded by
+/// -dse-memoryssa-scanlimit.
+class DSEState {
+  Function &F;
+  AliasAnalysis &AA;
+  MemorySSA &MSSA;
+  DominatorTree &DT;
+  PostDominatorTree &PDT;
+  const TargetLibraryInfo &TLI;
+  const DataLayout &DL;
+  MemorySSAUpdater Updater;
+
+  /// All writes that may kill or be killed, in function order.
+  SmallVector<WeakTrackingVH, 64> MemDefs;
+  /// Blocks containing an instruction that may throw.
+  SmallPtrSet<BasicBlock *, 16> ThrowingBlocks;
+  /// Underlying objects known to be (in)visible to the caller on unwind and
+  /// after the function returns.
+  DenseMap<const Value *, bool> InvisibleOnUnwind;
+  DenseMap<const Value *, bool> InvisibleAfterRet;
+  /// A map of interval maps representing partially-overwritten value parts.
+  InstOverlapIntervalsTy IOL;
+
+public:
+  DSEState(Function &F, AliasAnalysis &AA, MemorySSA &MSSA, DominatorTree &DT,
+           PostDominatorTree &PDT, const TargetLibraryInfo &TLI)
+      : F(F), AA(AA), MSSA(MSSA), DT(DT), PDT(PDT), TLI(TLI),
+        DL(F.getParent()->getDataLayout()), Updater(&MSSA) {}
+
+  bool run();
+
+private:
+  bool isInvisibleToCallerOnUnwind(const Value *UO);
+  bool isInvisibleToCallerAfterRet(const Value *UO);
+  bool mayThrowBetween(Instruction *EarlierI, Instruction *LaterI,
+                       const Value *UO);
+  bool isReadBeforeOverwrite(MemoryDef *Earlier, const MemoryLocation &Loc,
+                             ArrayRef<MemoryAccess *> Killers,
+                             unsigned &Budget);
+  bool isDefChainAncestor(MemoryAccess *Ancestor, MemoryDef *Def,
+                          unsigned &Budget);
+  bool eliminateNoopStore(Instruction *I);
+  bool eliminateDeadWritesKilledBy(Instruction *KillingI);
+  bool eliminateDeadWritesKilledByPhi(MemoryPhi *Phi);
+  bool eliminateDeadWritesAtEnd();
+  void deleteDeadInstruction(Instruction *I);
+};
+
+} // end anonymous namespace
+
+/// Returns true if \p I orders memory operations such that earlier writes may
+/// not be eliminated across it.
+static bool isDSEBarrier(Instruction *I) {
+  if (!I->isAtomic())
+    return false;
+  if (auto *LI = dyn_cast<LoadInst>(I))
+    return isStrongerThanMonotonic(LI->getOrdering());
+  if (auto *SI = dyn_cast<StoreInst>(I))
+    return isStrongerThanMonotonic(SI->getOrdering());
+  return true;
+}
+
+bool DSEState::isInvisibleToCallerOnUnwind(const Value *UO) {
+  auto I = InvisibleOnUnwind.insert(std::make_pair(UO, false));
+  if (I.second)
+    I.first->second =
+        isa<AllocaInst>(UO) ||
+        (isAllocLikeFn(UO, &TLI) && !PointerMayBeCaptured(UO, false, true));
+  return I.first->second;
+}
+
+bool DSEState::isInvisibleToCallerAfterRet(const Value *UO) {
+  auto I = InvisibleAfterRet.insert(std::make_pair(UO, false));
+  if (I.second)
+    I.first->second =
+        isa<AllocaInst>(UO) ||
+        (isAllocLikeFn(UO, &TLI) && !PointerMayBeCaptured(UO, true, true));
+  return I.first->second;
+}
+
+/// Returns true if an instruction between \p EarlierI and \p LaterI may throw
+/// while the write of \p EarlierI to \p UO is visible to the caller.
+bool DSEState::mayThrowBetween(Instruction *EarlierI, Instruction *LaterI,
+                               const Value *UO) {
+  if (ThrowingBlocks.empty() || isInvisibleToCallerOnUnwind(UO))
+    return false;
+  BasicBlock *BB = EarlierI->getParent();
+  if (BB != LaterI->getParent())
+    return true;
+  if (!ThrowingBlocks.count(BB))
+    return false;
+  unsigned Limit = MemorySSAScanLimit;
+  for (BasicBlock::iterator BI = std::next(EarlierI->getIterator());
+       &*BI != LaterI; ++BI)
+    if (BI->mayThrow() || --Limit == 0)
+      return true;
+  return false;
+}
+
+/// Returns true if \p Loc, as written by \p Earlier, may be read before it is
+/// overwritten by one of \p Killers or, if there are none, before the function
+/// returns. Conservatively returns true once \p Budget is exhausted.
+bool DSEState::isReadBeforeOverwrite(MemoryDef *Earlier,
+                                     const MemoryLocation &Loc,
+                                     ArrayRef<MemoryAccess *> Killers,
+                                     unsigned &Budget) {
+  SmallVector<MemoryAccess *, 16> WorkList;
+  SmallPtrSet<MemoryAccess *, 16> Visited;
+  auto PushUsers = [&](MemoryAccess *MA) {
+    for (User *U : MA->users()) {
+      auto *UA = cast<MemoryAccess>(U);
+      if (!is_contained(Killers, UA) && Visited.insert(UA).second)
+        WorkList.push_back(UA);
+    }
+  };
+
+  PushUsers(Earlier);
+  while (!WorkList.empty()) {
+    if (Budget == 0)
+      return true;
+    --Budget;
+
+    MemoryAccess *UA = WorkList.pop_back_val();
+    if (isa<MemoryPhi>(UA)) {
+      PushUsers(UA);
+      continue;
+    }
+    Instruction *UI = cast<MemoryUseOrDef>(UA)->getMemoryInst();
+    if (AA.getModRefInfo(UI, Loc) & MRI_Ref)
+      return true;
+    if (isa<MemoryDef>(UA))
+      PushUsers(UA);
+  }
+  return false;
+}
+
+/// Returns true if \p Ancestor is reached from \p Def by following defining
+/// accesses through MemoryDefs only. Returns false once \p Budget is
+/// exhausted.
+bool DSEState::isDefChainAncestor(MemoryAccess *Ancestor, MemoryDef *Def,
+                                  unsigned &Budget) {
+  MemoryAccess *Current = Def->getDefiningAccess();
+  while (Budget && isa<MemoryDef>(Current) && !MSSA.isLiveOnEntryDef(Current)) {
+    if (Current == Ancestor)
+      return true;
+    --Budget;
+    Current = cast<MemoryDef>(Current)->getDefiningAccess();
+  }
+  return false;
+}
+
+void DSEState::deleteDeadInstruction(Instruction *I) {
+  SmallVector<Instruction *, 32> NowDeadInsts;
+
+  NowDeadInsts.push_back(I);
+  --NumFastOther;
+
+  do {
+    Instruction *DeadInst = NowDeadInsts.pop_back_val();
+    ++NumFastOther;
+
+    if (MemoryAccess *MA = MSSA.getMemoryAccess(DeadInst))
+      Updater.removeMemoryAccess(MA);
+
+    for (unsigned op = 0, e = DeadInst->getNumOperands(); op != e; ++op) {
+      Value *Op = DeadInst->getOperand(op);
+      DeadInst->setOperand(op, nullptr);
+
+      // If this operand just became dead, add it to the NowDeadInsts list.
+      if (!Op->use_empty()) continue;
+
+      if (Instruction *OpI = dyn_cast<Instruction>(Op))
+        if (isInstructionTriviallyDead(OpI, &TLI))
+          NowDeadInsts.push_back(OpI);
+    }
+
+    IOL.erase(DeadInst);
+    DeadInst->eraseFromParent();
+  } while (!NowDeadInsts.empty());
+}
+
+/// Remove a store of a value that was just loaded from the same address, if
+/// nothing clobbers the address in between.
+bool DSEState::eliminateNoopStore(Instruction *I) {
+  StoreInst *SI = dyn_cast<StoreInst>(I);
+  if (!SI || !isRemovable(SI))
+    return false;
+  LoadInst *DepLoad = dyn_cast<LoadInst>(SI->getValueOperand());
+  if (!DepLoad || DepLoad->getPointerOperand() != SI->getPointerOperand())
+    return false;
+
+  MemorySSAWalker *Walker = MSSA.getWalker();
+  MemoryAccess *LoadClobber = Walker->getClobberingMemoryAccess(DepLoad);
+  if (Walker->getClobberingMemoryAccess(MSSA.getMemoryAccess(SI)) !=
+      LoadClobber)
+    return false;
+
+  DEBUG(dbgs() << "DSE: Remove Store Of Load from same pointer:\n  LOAD: "
+               << *DepLoad << "\n  STORE: " << *SI << '\n');
+  deleteDeadInstruction(SI);
+  ++NumRedundantStores;
+  return true;
+}
+
+bool DSEState::eliminateDeadWritesKilledBy(Instruction *KillingI) {
+  auto *KillingDef = dyn_cast_or_null<MemoryDef>(MSSA.getMemoryAccess(KillingI));
+  if (!KillingDef)
+    return false;
+  MemoryLocation KillingLoc = getLocForWrite(KillingI, AA);
+  if (!KillingLoc.Ptr)
+    return false;
+  const Value *KillingUO = GetUnderlyingObject(KillingLoc.Ptr, DL);
+  BasicBlock *KillingBB = KillingI->getParent();
+
+  bool MadeChange = false;
+  unsigned Budget = MemorySSAScanLimit;
+  MemoryAccess *Current = KillingDef->getDefiningAccess();
+  while (Budget && isa<MemoryDef>(Current) && !MSSA.isLiveOnEntryDef(Current)) {
+    --Budget;
+    auto *EarlierDef = cast<MemoryDef>(Current);
+    Instruction *EarlierI = EarlierDef->getMemoryInst();
+    Current = EarlierDef->getDefiningAccess();
+
+    if (isDSEBarrier(EarlierI))
+      break;
+    if (!hasMemoryWrite(EarlierI, TLI) || !isRemovable(EarlierI))
+      continue;
+    MemoryLocation EarlierLoc = getLocForWrite(EarlierI, AA);
+    if (!EarlierLoc.Ptr ||
+        GetUnderlyingObject(EarlierLoc.Ptr, DL) != KillingUO)
+      continue;
+
+    // The killing write must execute whenever the earlier one does.
+    if (EarlierI->getParent() != KillingBB &&
+        !PDT.dominates(KillingBB, EarlierI->getParent()))
+      continue;
+    // All remaining candidates write the same object and lie further up.
+    if (mayThrowBetween(EarlierI, KillingI, KillingUO))
+      break;
+    if (isPossibleSelfRead(KillingI, KillingLoc, EarlierI, TLI, AA) ||
+        isReadBeforeOverwrite(EarlierDef, EarlierLoc, {KillingDef}, Budget))
+      continue;
+
+    int64_t KillingOffset, EarlierOffset;
+    OverwriteResult OR = isOverwrite(KillingLoc, EarlierLoc, DL, TLI,
+                                     EarlierOffset, KillingOffset, EarlierI,
+                                     IOL);
+    if (OR == OW_Complete) {
+      DEBUG(dbgs() << "DSE: Remove Dead Store:\n  DEAD: " << *EarlierI
+                   << "\n  KILLER: " << *KillingI << '\n');
+      deleteDeadInstruction(EarlierI);
+      ++NumFastStores;
+      MadeChange = true;
+    } else if ((OR == OW_End && isShortenableAtTheEnd(EarlierI)) ||
+               (OR == OW_Begin && isShortenableAtTheBeginning(EarlierI))) {
+      int64_t EarlierSize = EarlierLoc.Size;
+      MadeChange |= tryToShorten(EarlierI, EarlierOffset, EarlierSize,
+                                 KillingOffset, KillingLoc.Size, OR == OW_End);
+    } else if (OR == OW_PartialEarlierWithFullLater) {
+      // Fold a narrower constant store into the wider one it writes into. The
+      // earlier store keeps its MemoryDef and only gets a new value, so it
+      // must run on every path to the killing store.
+      auto *Earlier = dyn_cast<StoreInst>(EarlierI);
+      auto *Later = dyn_cast<StoreInst>(KillingI);
+      if (Earlier && isa<ConstantInt>(Earlier->getValueOperand()) && Later &&
+          isa<ConstantInt>(Later->getValueOperand()) && isRemovable(Later) &&
+          DT.dominates(Earlier, Later)) {
+        APInt Merged = mergeStoredConstants(Earlier, Later, EarlierOffset,
+                                            KillingOffset, DL);
+        DEBUG(dbgs() << "DSE: Merge Stores:\n  Earlier: " << *Earlier
+                     << "\n  Later: " << *Later
+                     << "\n  Merged Value: " << Merged << '\n');
+        Earlier->setOperand(
+            0, ConstantInt::get(Earlier->getValueOperand()->getType(), Merged));
+        ++NumModifiedStores;
+        // The bytes recorded as overwritten by Later now hold its value.
+        IOL.erase(Earlier);
+        deleteDeadInstruction(Later);
+        return true;
+      }
+    }
+  }
+  return MadeChange;
+}
+
+/// Remove earlier writes that each incoming write of \p Phi completely
+/// overwrites. The incoming writes are the last ones on every path into the
+/// block of \p Phi, so if that block post-dominates the earlier write, each
+/// path from it is overwritten before it reaches the block or the function
+/// returns.
+bool DSEState::eliminateDeadWritesKilledByPhi(MemoryPhi *Phi) {
+  struct Killer {
+    MemoryDef *Def;
+    Instruction *I;
+    MemoryLocation Loc;
+  };
+  SmallVector<Killer, 4> Killers;
+  SmallVector<MemoryAccess *, 4> KillerDefs;
+  for (const Use &Incoming : Phi->incoming_values()) {
+    auto *Def = dyn_cast<MemoryDef>(Incoming.get());
+    if (!Def || MSSA.isLiveOnEntryDef(Def))
+      return false;
+    if (is_contained(KillerDefs, Def))
+      continue;
+    Instruction *I = Def->getMemoryInst();
+    MemoryLocation Loc = getLocForWrite(I, AA);
+    if (!Loc.Ptr)
+      return false;
+    Killers.push_back({Def, I, Loc});
+    KillerDefs.push_back(Def);
+  }
+  // A single incoming write dominates the phi and is handled on its own.
+  if (Killers.size() < 2)
+    return false;
+  const Value *KillingUO = GetUnderlyingObject(Killers[0].Loc.Ptr, DL);
+  for (const Killer &K : Killers)
+    if (GetUnderlyingObject(K.Loc.Ptr, DL) != KillingUO)
+      return false;
+
+  bool MadeChange = false;
+  unsigned Budget = MemorySSAScanLimit;
+  MemoryAccess *Current = Killers[0].Def->getDefiningAccess();
+  while (Budget && isa<MemoryDef>(Current) && !MSSA.isLiveOnEntryDef(Current)) {
+    --Budget;
+    auto *EarlierDef = cast<MemoryDef>(Current);
+    Instruction *EarlierI = EarlierDef->getMemoryInst();
+    Current = EarlierDef->getDefiningAccess();
+
+    if (isDSEBarrier(EarlierI))
+      break;
+    if (!hasMemoryWrite(EarlierI, TLI) || !isRemovable(EarlierI))
+      continue;
+    MemoryLocation EarlierLoc = getLocForWrite(EarlierI, AA);
+    if (!EarlierLoc.Ptr ||
+        GetUnderlyingObject(EarlierLoc.Ptr, DL) != KillingUO)
+      continue;
+    if (!PDT.dominates(Phi->getBlock(), EarlierI->getParent()))
+      continue;
+
+    // Each killer only covers some of the paths, so the partial overwrites
+    // it finds must not be merged into IOL.
+    bool AllKill = all_of(Killers, [&](const Killer &K) {
+      if (K.Def != Killers[0].Def &&
+          !isDefChainAncestor(EarlierDef, K.Def, Budget))
+        return false;
+      if (mayThrowBetween(EarlierI, K.I, KillingUO) ||
+          isPossibleSelfRead(K.I, K.Loc, EarlierI, TLI, AA))
+        return false;
+      InstOverlapIntervalsTy PathIOL;
+      int64_t KillingOffset, EarlierOffset;
+      return isOverwrite(K.Loc, EarlierLoc, DL, TLI, EarlierOffset,
+                         KillingOffset, EarlierI, PathIOL) == OW_Complete;
+    });
+    if (!AllKill ||
+        isReadBeforeOverwrite(EarlierDef, EarlierLoc, KillerDefs, Budget))
+      continue;
+
+    DEBUG(dbgs() << "DSE: Remove Dead Store:\n  DEAD: " << *EarlierI
+                 << "\n  KILLED BY: " << *Phi << '\n');
+    deleteDeadInstruction(EarlierI);
+    ++NumFastStores;
+    MadeChange = true;
+  }
+  return MadeChange;
+}
+
+/// Remove writes to objects that die at the end of the function and which are
+/// not read on any path to a return.
+bool DSEState::eliminateDeadWritesAtEnd() {
+  bool MadeChange = false;
+  for (WeakTrackingVH &V : MemDefs) {
+    Instruction *I = cast_or_null<Instruction>(V);
+    if (!I || !isRemovable(I))
+      continue;
+    auto *Def = dyn_cast_or_null<MemoryDef>(MSSA.getMemoryAccess(I));
+    MemoryLocation Loc = getLocForWrite(I, AA);
+    if (!Def || !Loc.Ptr ||
+        !isInvisibleToCallerAfterRet(GetUnderlyingObject(Loc.Ptr, DL)))
+      continue;
+
+    unsigned Budget = MemorySSAScanLimit;
+    if (isReadBeforeOverwrite(Def, Loc, None, Budget))
+      continue;
+
+    DEBUG(dbgs() << "DSE: Dead Store at End of Function:\n  DEAD: " << *I
+                 << '\n');
+    deleteDeadInstruction(I);
+    ++NumFastStores;
+    MadeChange = true;
+  }
+  return MadeChange;
+}
+
+bool DSEState::run() {
+  for (BasicBlock &BB : F) {
+    // Only check non-dead blocks.  Dead blocks may have strange pointer
+    // cycles that will confuse alias analysis.
+    if (!DT.isReachableFromEntry(&BB))
+      continue;
+    for (Instruction &I : BB) {
+      if (I.mayThrow())
+        ThrowingBlocks.insert(&BB);
+      if (hasMemoryWrite(&I, TLI) &&
+          dyn_cast_or_null<MemoryDef>(MSSA.getMemoryAccess(&I)))
+        MemDefs.push_back(&I);
+    }
+  }
+
+  bool MadeChange = false;
+  for (unsigned Idx = 0; Idx != MemDefs.size(); ++Idx) {
+    Instruction *I = cast_or_null<Instruction>(MemDefs[Idx]);
+    if (!I)
+      continue;
+    if (eliminateNoopStore(I)) {
+      MadeChange = true;
+      continue;
+    }
+    MadeChange |= eliminateDeadWritesKilledBy(I);
+  }
+
+  for (BasicBlock &BB : F)
+    if (DT.isReachableFromEntry(&BB))
+      if (MemoryPhi *Phi = MSSA.getMemoryAccess(&BB))
+        MadeChange |= eliminateDeadWritesKilledByPhi(Phi);
+
+  if (EnablePartialOverwriteTracking)
+    MadeChange |= removePartiallyOverlappedStores(&AA, DL, IOL);
+
+  MadeChange |= eliminateDeadWritesAtEnd();
+  return MadeChange;
+}
+
+static bool eliminateDeadStoresMemorySSA(Function &F, AliasAnalysis &AA,
+                                         MemorySSA &MSSA, DominatorTree &DT,
+                                         PostDominatorTree &PDT,
+                                         const TargetLibraryInfo &TLI) {
+  return DSEState(F, AA, MSSA, DT, PDT, TLI).run();
+}
+
 //===----------------------------------------------------------------------===//
 // DSE Pass
 //===----------------------------------------------------------------------===//
 PreservedAnalyses DSEPass::run(Function &F, FunctionAnalysisManager &AM) {
   AliasAnalysis *AA = &AM.getResult<AAManager>(F);
   DominatorTree *DT = &AM.getResult<DominatorTreeAnalysis>(F);
-  MemoryDependenceResults *MD = &AM.getResult<MemoryDependenceAnalysis>(F);
   const TargetLibraryInfo *TLI = &AM.getResult<TargetLibraryAnalysis>(F);
 
+  if (UseMemorySSA) {
+    MemorySSA &MSSA = AM.getResult<MemorySSAAnalysis>(F).getMSSA();
+    PostDominatorTree &PDT = AM.getResult<PostDominatorTreeAnalysis>(F);
+    if (!eliminateDeadStoresMemorySSA(F, *AA, MSSA, *DT, PDT, *TLI))
+      return PreservedAnalyses::all();
+
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    PA.preserve<GlobalsAA>();
+    PA.preserve<MemorySSAAnalysis>();
+    return PA;
+  }
+
+  MemoryDependenceResults *MD = &AM.getResult<MemoryDependenceAnalysis>(F);
   if (!eliminateDeadStores(F, AA, MD, DT, TLI))
     return PreservedAnalyses::all();
 
@@ -1310,12 +1789,16 @@ PreservedAnalyses DSEPass::run(Function &F, FunctionAnalysisManager &AM) {
 namespace {
 
 /// A legacy pass for the legacy pass manager that wraps \c DSEPass.
-class DSELegacyPass : public FunctionPass {
+template<bool UseMemorySSA>
+class DSELegacyCommonPass : public FunctionPass {
 public:
   static char ID; // Pass identification, replacement for typeid
 
-  DSELegacyPass() : FunctionPass(ID) {
-    initializeDSELegacyPassPass(*PassRegistry::getPassRegistry());
+  DSELegacyCommonPass() : FunctionPass(ID) {
+    if (UseMemorySSA)
+      initializeDSEMemSSALegacyPassPass(*PassRegistry::getPassRegistry());
+    else
+      initializeDSELegacyPassPass(*PassRegistry::getPassRegistry());
   }
 
   bool runOnFunction(Function &F) override {
@@ -1324,11 +1807,18 @@ public:
 
     DominatorTree *DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
     AliasAnalysis *AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
-    MemoryDependenceResults *MD =
-        &getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
     const TargetLibraryInfo *TLI =
         &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
 
+    if (UseMemorySSA) {
+      MemorySSA &MSSA = getAnalysis<MemorySSAWrapperPass>().getMSSA();
+      PostDominatorTree &PDT =
+          getAnalysis<PostDominatorTreeWrapperPass>().getPostDomTree();
+      return eliminateDeadStoresMemorySSA(F, *AA, MSSA, *DT, PDT, *TLI);
+    }
+
+    MemoryDependenceResults *MD =
+        &getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
     return eliminateDeadStores(F, AA, MD, DT, TLI);
   }
 
@@ -1336,16 +1826,26 @@ public:
     AU.setPreservesCFG();
     AU.addRequired<DominatorTreeWrapperPass>();
     AU.addRequired<AAResultsWrapperPass>();
-    AU.addRequired<MemoryDependenceWrapperPass>();
     AU.addRequired<TargetLibraryInfoWrapperPass>();
     AU.addPreserved<DominatorTreeWrapperPass>();
     AU.addPreserved<GlobalsAAWrapperPass>();
-    AU.addPreserved<MemoryDependenceWrapperPass>();
+    if (UseMemorySSA) {
+      AU.addRequired<MemorySSAWrapperPass>();
+      AU.addRequired<PostDominatorTreeWrapperPass>();
+      AU.addPreserved<MemorySSAWrapperPass>();
+      AU.addPreserved<PostDominatorTreeWrapperPass>();
+    } else {
+      AU.addRequired<MemoryDependenceWrapperPass>();
+      AU.addPreserved<MemoryDependenceWrapperPass>();
+    }
   }
 };
 
 } // end anonymous namespace
 
+using DSELegacyPass = DSELegacyCommonPass</*UseMemorySSA=*/false>;
+
+template<>
 char DSELegacyPass::ID = 0;
 
 INITIALIZE_PASS_BEGIN(DSELegacyPass, "dse", "Dead Store Elimination", false,
@@ -1358,6 +1858,24 @@ INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
 INITIALIZE_PASS_END(DSELegacyPass, "dse", "Dead Store Elimination", false,
                     false)
 
-FunctionPass *llvm::createDeadStoreEliminationPass() {
+using DSEMemSSALegacyPass = DSELegacyCommonPass</*UseMemorySSA=*/true>;
+
+template<>
+char DSEMemSSALegacyPass::ID = 0;
+
+INITIALIZE_PASS_BEGIN(DSEMemSSALegacyPass, "dse-memssa",
+                      "Dead Store Elimination w/ MemorySSA", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(PostDominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(GlobalsAAWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(MemorySSAWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
+INITIALIZE_PASS_END(DSEMemSSALegacyPass, "dse-memssa",
+                    "Dead Store Elimination w/ MemorySSA", false, false)
+
+FunctionPass *llvm::createDeadStoreEliminationPass(bool UseMemorySSA) {
+  if (UseMemorySSA)
+    return new DSEMemSSALegacyPass();
   return new DSELegacyPass();
 }
@@ -1302,9 +1302,14 @@ bool GVN::processNonLocalLoad(LoadInst *LI) {
   if (LI->getParent()->getParent()->hasFnAttribute(Attribute::SanitizeAddress))
     return false;
 
-  // Step 1: Find the non-local dependencies of the load.
+  // Step 1: Find the non-local dependencies of the load. This and the
+  // availability analysis in step 2 do not modify the IR, so their alias
+  // queries are issued as batches.
   LoadDepVect Deps;
-  MD->getNonLocalPointerDependency(LI, Deps);
+  {
+    BatchAAScope Batch(*VN.getAliasAnalysis());
+    MD->getNonLocalPointerDependency(LI, Deps);
+  }
 
   // If we had to process more than one hundred blocks to find the
   // dependencies, this load isn't worth worrying about.  Optimizing
@@ -1337,7 +1342,10 @@ bool GVN::processNonLocalLoad(LoadInst *LI) {
   // Step 2: Analyze the availability of the load
   AvailValInBlkVect ValuesPerBlock;
   UnavailBlkVect UnavailableBlocks;
-  AnalyzeLoadAvailability(LI, Deps, ValuesPerBlock, UnavailableBlocks);
+  {
+    BatchAAScope Batch(*VN.getAliasAnalysis());
+    AnalyzeLoadAvailability(LI, Deps, ValuesPerBlock, UnavailableBlocks);
+  }
 
   // If we have no predecessors that produce a known value for this load, exit
   // early.
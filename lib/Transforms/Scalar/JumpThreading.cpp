@@ -377,6 +377,8 @@ bool JumpThreadingPass::runImpl(Function &F, TargetLibraryInfo *TLI_,
               << "' with terminator: " << *BB->getTerminator() << '\n');
         LoopHeaders.erase(BB);
         LVI->eraseBlock(BB);
+        if (HasProfileData)
+          BFI->eraseBlock(BB);
         DeleteDeadBlock(BB);
         Changed = true;
         continue;
@@ -399,9 +401,12 @@ bool JumpThreadingPass::runImpl(Function &F, TargetLibraryInfo *TLI_,
         // FIXME: It is always conservatively correct to drop the info
         // for a block even if it doesn't get erased.  This isn't totally
         // awesome, but it allows us to use AssertingVH to prevent nasty
-        // dangling pointer issues within LazyValueInfo.
+        // dangling pointer issues within LazyValueInfo. This does not hold
+        // for BFI, where a block without info has a frequency of zero, so BB
+        // is only removed from it once it is known to be deleted.
         LVI->eraseBlock(BB);
-        if (TryToSimplifyUncondBranchFromEmptyBlock(BB))
+        if (TryToSimplifyUncondBranchFromEmptyBlock(
+                BB, HasProfileData ? BFI.get() : nullptr))
           Changed = true;
       }
     }
@@ -949,6 +954,8 @@ bool JumpThreadingPass::ProcessBlock(BasicBlock *BB) {
         LoopHeaders.insert(BB);
 
       LVI->eraseBlock(SinglePred);
+      if (HasProfileData)
+        BFI->eraseBlock(SinglePred);
       MergeBasicBlockIntoOnlyPred(BB);
 
       // Now that BB is merged into SinglePred (i.e. SinglePred Code followed by
@@ -1868,11 +1875,9 @@ bool JumpThreadingPass::ThreadEdge(BasicBlock *BB,
   NewBB->moveAfter(PredBB);
 
   // Set the block frequency of NewBB.
-  if (HasProfileData) {
-    auto NewBBFreq =
-        BFI->getBlockFreq(PredBB) * BPI->getEdgeProbability(PredBB, BB);
-    BFI->setBlockFreq(NewBB, NewBBFreq.getFrequency());
-  }
+  if (HasProfileData)
+    BFI->setBlockFreqForSplitEdge(NewBB, PredBB,
+                                  BPI->getEdgeProbability(PredBB, BB));
 
   BasicBlock::iterator BI = BB->begin();
   for (; PHINode *PN = dyn_cast<PHINode>(BI); ++BI)
@@ -2148,7 +2153,13 @@ bool JumpThreadingPass::DuplicateCondBranchOnPHIIntoPred(
   BranchInst *OldPredBranch = dyn_cast<BranchInst>(PredBB->getTerminator());
 
   if (!OldPredBranch || !OldPredBranch->isUnconditional()) {
-    PredBB = SplitEdge(PredBB, BB);
+    BasicBlock *OldPredBB = PredBB;
+    BranchProbability EdgeProb = HasProfileData
+                                     ? BPI->getEdgeProbability(OldPredBB, BB)
+                                     : BranchProbability::getUnknown();
+    PredBB = SplitEdge(OldPredBB, BB);
+    if (HasProfileData)
+      BFI->setBlockFreqForSplitEdge(PredBB, OldPredBB, EdgeProb);
     OldPredBranch = cast<BranchInst>(PredBB->getTerminator());
   }
 
@@ -1416,6 +1416,8 @@ bool llvm::promoteLoopAccessesToScalars(
 AliasSetTracker *
 LoopInvariantCodeMotion::collectAliasInfoForLoop(Loop *L, LoopInfo *LI,
                                                  AliasAnalysis *AA) {
+  // Building the alias sets does not change the IR.
+  BatchAAScope BatchAA(*AA);
   AliasSetTracker *CurAST = nullptr;
   SmallVector<Loop *, 4> RecomputeLoops;
   for (Loop *InnerL : L->getSubLoops()) {
@@ -0,0 +1,35 @@
+//===- LoopCacheAnalysisPrinter.cpp - Loop Cache Analysis Printer ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar/LoopCacheAnalysisPrinter.h"
+#include "llvm/Analysis/LoopCacheAnalysis.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-cache-cost"
+
+PreservedAnalyses LoopCachePrinterPass::run(Loop &L, LoopAnalysisManager &AM,
+                                            LoopStandardAnalysisResults &AR,
+                                            LPMUpdater &) {
+  // The cost is computed for whole nests, so only print it for the root.
+  if (L.getParentLoop())
+    return PreservedAnalyses::all();
+
+  Function &F = *L.getHeader()->getParent();
+  OS << "Loop cache cost in function '" << F.getName() << "':\n";
+  OS.indent(2) << L.getHeader()->getName() << ":\n";
+  auto CC = CacheCost::getCacheCost(L, AR.SE, AR.TTI);
+  if (!CC) {
+    OS.indent(4) << "Not a perfect loop nest with memory references\n";
+    return PreservedAnalyses::all();
+  }
+  for (const CacheCost::LoopCostTy &LC : CC->getLoopCosts())
+    OS.indent(4) << LC.first->getHeader()->getName()
+                 << ": cost = " << LC.second << "\n";
+  return PreservedAnalyses::all();
+}
@@ -0,0 +1,487 @@
+//===- LoopFuse.cpp - Loop Fusion Pass ------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass fuses adjacent innermost loops that run the same number of
+// iterations, so that the data they share is streamed through the cache once.
+// It is the counterpart of loop distribution.
+//
+// Two loops L0 and L1 are fused when:
+//   - they are in simplified form, exit only from their latch, and L1's
+//     preheader is L0's exit block and contains nothing but a branch,
+//   - they are control flow equivalent, i.e. L0 dominates L1 and L1
+//     post-dominates L0,
+//   - ScalarEvolution proves they have the same backedge-taken count,
+//   - L1 does not use the values computed by L0,
+//   - no dependence between them is violated. Running iteration i of L1
+//     right after iteration i of L0 is only wrong if L1 accesses at some
+//     iteration memory that L0 accesses at a later one. DependenceAnalysis
+//     rules out most pairs of accesses, and the others must be affine in
+//     their loops with the same step, L1's accesses not being ahead of L0's,
+//   - the values live in the fused loop fit in the registers of the target.
+//
+// The body of L1 is placed after the body of L0 in the fused loop, whose exit
+// condition is the one of L1. An optimization remark explains each rejected
+// fusion.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar/LoopFuse.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/DomTreeUpdater.h"
+#include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-fusion"
+
+STATISTIC(NumLoopsFused, "Number of loops fused");
+STATISTIC(NumUnsafeDependences,
+          "Number of fusions rejected because of a dependence");
+STATISTIC(NumHighRegisterPressure,
+          "Number of fusions rejected because of register pressure");
+
+namespace {
+
+class LoopFuser {
+public:
+  LoopFuser(LoopInfo &LI, DominatorTree &DT, PostDominatorTree &PDT,
+            ScalarEvolution &SE, DependenceInfo &DI, TargetTransformInfo &TTI,
+            OptimizationRemarkEmitter &ORE)
+      : LI(LI), DT(DT), PDT(PDT), SE(SE), DI(DI), TTI(TTI), ORE(ORE) {}
+
+  bool run();
+
+private:
+  /// Fuse the adjacent loops among the sibling loops \p Loops.
+  bool fuseSiblings(ArrayRef<Loop *> Loops);
+
+  /// Returns true if \p L0 and the loop \p L1 following it may be fused, and
+  /// emits a remark explaining why not otherwise.
+  bool canFuse(Loop *L0, Loop *L1);
+
+  /// Returns true if \p L has the shape fusion needs and no instruction
+  /// preventing it. Fills \p MemAccesses with its loads and stores.
+  bool isSupportedLoop(Loop *L, SmallVectorImpl<Instruction *> &MemAccesses,
+                       StringRef &Reason);
+
+  /// Returns true if executing \p I1 of \p L1 in the same iteration as \p I0
+  /// of \p L0 respects their dependence.
+  bool dependenceAllowsFusion(Instruction *I0, Loop *L0, Instruction *I1,
+                              Loop *L1);
+
+  /// Returns an estimate of the number of registers needed by the values
+  /// live throughout the loop made of \p Loops.
+  unsigned estimateRegisterPressure(ArrayRef<Loop *> Loops);
+
+  /// Fuse \p L1 into \p L0.
+  void fuse(Loop *L0, Loop *L1);
+
+  void reportRejection(Loop *L0, Loop *L1, StringRef Name,
+                       StringRef Message);
+
+  LoopInfo &LI;
+  DominatorTree &DT;
+  PostDominatorTree &PDT;
+  ScalarEvolution &SE;
+  DependenceInfo &DI;
+  TargetTransformInfo &TTI;
+  OptimizationRemarkEmitter &ORE;
+};
+
+} // end anonymous namespace
+
+static Value *getPointerOperand(Instruction *I) {
+  if (auto *LI = dyn_cast<LoadInst>(I))
+    return LI->getPointerOperand();
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+static Type *getAccessType(Instruction *I) {
+  if (auto *SI = dyn_cast<StoreInst>(I))
+    return SI->getValueOperand()->getType();
+  return I->getType();
+}
+
+void LoopFuser::reportRejection(Loop *L0, Loop *L1, StringRef Name,
+                                StringRef Message) {
+  DEBUG(dbgs() << "LoopFuse: cannot fuse " << L0->getHeader()->getName()
+               << " and " << L1->getHeader()->getName() << ": " << Message
+               << "\n");
+  ORE.emit([&]() {
+    return OptimizationRemarkMissed(DEBUG_TYPE, Name, L0->getStartLoc(),
+                                    L0->getHeader())
+           << "loop not fused with the next loop: " << Message;
+  });
+}
+
+bool LoopFuser::isSupportedLoop(Loop *L,
+                                SmallVectorImpl<Instruction *> &MemAccesses,
+                                StringRef &Reason) {
+  if (!L->empty()) {
+    Reason = "not an innermost loop";
+    return false;
+  }
+  if (!L->isLoopSimplifyForm() || !L->getExitBlock() ||
+      L->getExitingBlock() != L->getLoopLatch()) {
+    Reason = "loop is not in simplified form or has several exits";
+    return false;
+  }
+  auto *LatchBr = dyn_cast<BranchInst>(L->getLoopLatch()->getTerminator());
+  if (!LatchBr || LatchBr->isUnconditional()) {
+    Reason = "loop latch does not end in a conditional branch";
+    return false;
+  }
+
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB) {
+      if (isa<LoadInst>(I) || isa<StoreInst>(I)) {
+        bool IsSimple = isa<LoadInst>(I) ? cast<LoadInst>(I).isSimple()
+                                         : cast<StoreInst>(I).isSimple();
+        if (!IsSimple) {
+          Reason = "loop contains volatile or atomic accesses";
+          return false;
+        }
+        MemAccesses.push_back(&I);
+        continue;
+      }
+      if (I.mayHaveSideEffects() || I.mayReadFromMemory()) {
+        Reason = "loop contains calls or instructions with side effects";
+        return false;
+      }
+    }
+  return true;
+}
+
+bool LoopFuser::dependenceAllowsFusion(Instruction *I0, Loop *L0,
+                                       Instruction *I1, Loop *L1) {
+  if (!DI.depends(I0, I1, /*PossiblyLoopIndependent=*/true))
+    return true;
+
+  auto *AR0 = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(getPointerOperand(I0)));
+  auto *AR1 = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(getPointerOperand(I1)));
+  if (!AR0 || !AR1 || AR0->getLoop() != L0 || AR1->getLoop() != L1 ||
+      !AR0->isAffine() || !AR1->isAffine())
+    return false;
+  auto *Step = dyn_cast<SCEVConstant>(AR0->getStepRecurrence(SE));
+  if (!Step || Step != AR1->getStepRecurrence(SE) || Step->isZero())
+    return false;
+
+  // With accesses no wider than the step, iteration j of L1 only overlaps
+  // the iterations i <= j of L0 as long as its accesses start behind L0's in
+  // the direction both loops move.
+  const DataLayout &DL = I0->getModule()->getDataLayout();
+  uint64_t StepSize = Step->getAPInt().abs().getLimitedValue();
+  if (DL.getTypeStoreSize(getAccessType(I0)) > StepSize ||
+      DL.getTypeStoreSize(getAccessType(I1)) > StepSize)
+    return false;
+  const SCEV *Diff = SE.getMinusSCEV(AR1->getStart(), AR0->getStart());
+  if (isa<SCEVCouldNotCompute>(Diff))
+    return false;
+  return Step->getAPInt().isStrictlyPositive() ? SE.isKnownNonPositive(Diff)
+                                               : SE.isKnownNonNegative(Diff);
+}
+
+unsigned LoopFuser::estimateRegisterPressure(ArrayRef<Loop *> Loops) {
+  // Each induction or reduction PHI and each value defined before the loop
+  // and used in it is live throughout the loop.
+  unsigned NumPHIs = 0;
+  SmallPtrSet<const Value *, 16> Invariants;
+  for (Loop *L : Loops) {
+    NumPHIs += std::distance(L->getHeader()->phis().begin(),
+                             L->getHeader()->phis().end());
+    for (BasicBlock *BB : L->blocks())
+      for (Instruction &I : *BB)
+        for (Value *Op : I.operands()) {
+          if (isa<Argument>(Op))
+            Invariants.insert(Op);
+          else if (auto *OpI = dyn_cast<Instruction>(Op))
+            if (none_of(Loops, [&](Loop *Other) {
+                  return Other->contains(OpI);
+                }))
+              Invariants.insert(Op);
+        }
+  }
+  return NumPHIs + Invariants.size();
+}
+
+bool LoopFuser::canFuse(Loop *L0, Loop *L1) {
+  SmallVector<Instruction *, 16> MemAccesses0, MemAccesses1;
+  StringRef Reason;
+  if (!isSupportedLoop(L0, MemAccesses0, Reason) ||
+      !isSupportedLoop(L1, MemAccesses1, Reason)) {
+    reportRejection(L0, L1, "UnsupportedLoop", Reason);
+    return false;
+  }
+
+  BasicBlock *Between = L1->getLoopPreheader();
+  if (Between->size() != 1 || !Between->getSinglePredecessor()) {
+    reportRejection(L0, L1, "NonEmptyPreheader",
+                    "code between the loops");
+    return false;
+  }
+
+  if (!DT.dominates(L0->getHeader(), L1->getHeader()) ||
+      !PDT.dominates(L1->getHeader(), L0->getHeader())) {
+    reportRejection(L0, L1, "NotControlFlowEquivalent",
+                    "loops are not control flow equivalent");
+    return false;
+  }
+
+  const SCEV *TripCount0 = SE.getBackedgeTakenCount(L0);
+  const SCEV *TripCount1 = SE.getBackedgeTakenCount(L1);
+  if (isa<SCEVCouldNotCompute>(TripCount0) ||
+      isa<SCEVCouldNotCompute>(TripCount1)) {
+    reportRejection(L0, L1, "UnknownTripCount", "trip count is not known");
+    return false;
+  }
+  if (TripCount0 != TripCount1) {
+    reportRejection(L0, L1, "DifferentTripCount",
+                    "loops have different trip counts");
+    return false;
+  }
+
+  for (BasicBlock *BB : L1->blocks())
+    for (Instruction &I : *BB)
+      for (Value *Op : I.operands())
+        if (auto *OpI = dyn_cast<Instruction>(Op))
+          if (L0->contains(OpI)) {
+            reportRejection(L0, L1, "UsesFirstLoopValues",
+                            "second loop uses values of the first one");
+            return false;
+          }
+
+  for (Instruction *I0 : MemAccesses0)
+    for (Instruction *I1 : MemAccesses1) {
+      if (!isa<StoreInst>(I0) && !isa<StoreInst>(I1))
+        continue;
+      if (!dependenceAllowsFusion(I0, L0, I1, L1)) {
+        ++NumUnsafeDependences;
+        reportRejection(L0, L1, "UnsafeDependence",
+                        "fusion would violate a dependence");
+        return false;
+      }
+    }
+
+  // Fusing loops that each fit in the registers into one that does not would
+  // add spills to every iteration.
+  unsigned NumRegs = TTI.getNumberOfRegisters(/*Vector=*/false);
+  unsigned Pressure = estimateRegisterPressure({L0, L1});
+  if (Pressure > NumRegs && estimateRegisterPressure(L0) <= NumRegs &&
+      estimateRegisterPressure(L1) <= NumRegs) {
+    ++NumHighRegisterPressure;
+    reportRejection(L0, L1, "RegisterPressure",
+                    "fused loop would need more registers than available");
+    return false;
+  }
+  return true;
+}
+
+void LoopFuser::fuse(Loop *L0, Loop *L1) {
+  BasicBlock *Preheader0 = L0->getLoopPreheader();
+  BasicBlock *Header0 = L0->getHeader();
+  BasicBlock *Latch0 = L0->getLoopLatch();
+  BasicBlock *Between = L1->getLoopPreheader();
+  BasicBlock *Header1 = L1->getHeader();
+  BasicBlock *Latch1 = L1->getLoopLatch();
+
+  DEBUG(dbgs() << "LoopFuse: fusing " << Header0->getName() << " and "
+               << Header1->getName() << "\n");
+  ORE.emit([&]() {
+    return OptimizationRemark(DEBUG_TYPE, "Fused", L0->getStartLoc(), Header0)
+           << "loop fused with the next loop";
+  });
+
+  SE.forgetLoop(L0);
+  SE.forgetLoop(L1);
+
+  // The back edge now comes from the latch of L1, and the header PHIs of L1
+  // move to the fused header.
+  for (PHINode &PN : Header0->phis())
+    PN.setIncomingBlock(PN.getBasicBlockIndex(Latch0), Latch1);
+  while (auto *PN = dyn_cast<PHINode>(&Header1->front())) {
+    PN->moveBefore(Header0->getFirstNonPHI());
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Between), Preheader0);
+  }
+
+  // The body of L0 falls through into the body of L1, whose latch decides
+  // whether to go around again.
+  auto *LatchBr0 = cast<BranchInst>(Latch0->getTerminator());
+  Value *Cond0 = LatchBr0->getCondition();
+  BranchInst::Create(Header1, LatchBr0);
+  LatchBr0->eraseFromParent();
+  RecursivelyDeleteTriviallyDeadInstructions(Cond0);
+  Latch1->getTerminator()->replaceUsesOfWith(Header1, Header0);
+
+  for (BasicBlock *BB : L1->blocks()) {
+    L0->addBlockEntry(BB);
+    LI.changeLoopFor(BB, L0);
+  }
+  if (Loop *Parent = L1->getParentLoop())
+    Parent->removeChildLoop(L1);
+  else
+    LI.removeLoop(find(LI, L1));
+  LI.destroy(L1);
+  LI.removeBlock(Between);
+
+  DomTreeUpdater DTU(&DT, &PDT, DomTreeUpdater::UpdateStrategy::Lazy);
+  DTU.applyUpdates({{DominatorTree::Delete, Latch0, Header0},
+                    {DominatorTree::Delete, Latch0, Between},
+                    {DominatorTree::Insert, Latch0, Header1},
+                    {DominatorTree::Delete, Latch1, Header1},
+                    {DominatorTree::Insert, Latch1, Header0}});
+  DTU.deleteBB(Between);
+  DTU.flush();
+
+  ++NumLoopsFused;
+}
+
+bool LoopFuser::fuseSiblings(ArrayRef<Loop *> Loops) {
+  DenseMap<BasicBlock *, Loop *> LoopForPreheader;
+  for (Loop *L : Loops)
+    if (BasicBlock *Preheader = L->getLoopPreheader())
+      LoopForPreheader[Preheader] = L;
+
+  bool Changed = false;
+  SmallPtrSet<Loop *, 8> Fused;
+  for (Loop *L0 : Loops) {
+    if (Fused.count(L0))
+      continue;
+    // Keep fusing the loop following L0 into it.
+    while (BasicBlock *Exit = L0->getExitBlock()) {
+      Loop *L1 = LoopForPreheader.lookup(Exit);
+      if (!L1 || L1 == L0 || !canFuse(L0, L1))
+        break;
+      LoopForPreheader.erase(Exit);
+      Fused.insert(L1);
+      fuse(L0, L1);
+      Changed = true;
+    }
+  }
+  return Changed;
+}
+
+bool LoopFuser::run() {
+  bool Changed = false;
+  SmallVector<Loop *, 8> Worklist;
+  SmallVector<Loop *, 8> TopLevel(LI.begin(), LI.end());
+  Changed |= fuseSiblings(TopLevel);
+  Worklist.append(LI.begin(), LI.end());
+  while (!Worklist.empty()) {
+    Loop *L = Worklist.pop_back_val();
+    SmallVector<Loop *, 8> SubLoops(L->begin(), L->end());
+    Changed |= fuseSiblings(SubLoops);
+    Worklist.append(L->begin(), L->end());
+  }
+  return Changed;
+}
+
+namespace {
+
+class LoopFuseLegacy : public FunctionPass {
+public:
+  static char ID;
+
+  LoopFuseLegacy() : FunctionPass(ID) {
+    initializeLoopFuseLegacyPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    if (skipFunction(F))
+      return false;
+
+    auto &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    auto &PDT = getAnalysis<PostDominatorTreeWrapperPass>().getPostDomTree();
+    auto &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    auto &DI = getAnalysis<DependenceAnalysisWrapperPass>().getDI();
+    auto &TTI = getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+    auto &ORE = getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
+    return LoopFuser(LI, DT, PDT, SE, DI, TTI, ORE).run();
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<PostDominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<DependenceAnalysisWrapperPass>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+    AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<PostDominatorTreeWrapperPass>();
+    AU.addPreserved<ScalarEvolutionWrapperPass>();
+    AU.addPreserved<GlobalsAAWrapperPass>();
+  }
+};
+
+} // end anonymous namespace
+
+char LoopFuseLegacy::ID = 0;
+
+INITIALIZE_PASS_BEGIN(LoopFuseLegacy, "loop-fusion", "Loop Fusion", false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(PostDominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysisWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(OptimizationRemarkEmitterWrapperPass)
+INITIALIZE_PASS_END(LoopFuseLegacy, "loop-fusion", "Loop Fusion", false,
+                    false)
+
+FunctionPass *llvm::createLoopFusePass() { return new LoopFuseLegacy(); }
+
+PreservedAnalyses LoopFusePass::run(Function &F, FunctionAnalysisManager &AM) {
+  auto &LI = AM.getResult<LoopAnalysis>(F);
+  auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  auto &PDT = AM.getResult<PostDominatorTreeAnalysis>(F);
+  auto &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  auto &DI = AM.getResult<DependenceAnalysis>(F);
+  auto &TTI = AM.getResult<TargetIRAnalysis>(F);
+  auto &ORE = AM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+
+  if (!LoopFuser(LI, DT, PDT, SE, DI, TTI, ORE).run())
+    return PreservedAnalyses::all();
+
+  PreservedAnalyses PA;
+  PA.preserve<LoopAnalysis>();
+  PA.preserve<DominatorTreeAnalysis>();
+  PA.preserve<PostDominatorTreeAnalysis>();
+  PA.preserve<ScalarEvolutionAnalysis>();
+  PA.preserve<GlobalsAA>();
+  return PA;
+}
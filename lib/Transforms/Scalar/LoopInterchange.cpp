@@ -18,10 +18,12 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/LoopCacheAnalysis.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
@@ -54,6 +56,11 @@ static cl::opt<int> LoopInterchangeCostThreshold(
     "loop-interchange-threshold", cl::init(0), cl::Hidden,
     cl::desc("Interchange if you gain more than this number"));
 
+static cl::opt<bool> UseCacheCost(
+    "loop-interchange-use-cache-cost", cl::init(true), cl::Hidden,
+    cl::desc("Decide the profitability of interchanging loops by their "
+             "estimated cache cost"));
+
 namespace {
 
 using LoopVector = SmallVector<Loop *, 8>;
@@ -371,8 +378,9 @@ private:
 class LoopInterchangeProfitability {
 public:
   LoopInterchangeProfitability(Loop *Outer, Loop *Inner, ScalarEvolution *SE,
+                               const CacheCost *CC,
                                OptimizationRemarkEmitter *ORE)
-      : OuterLoop(Outer), InnerLoop(Inner), SE(SE), ORE(ORE) {}
+      : OuterLoop(Outer), InnerLoop(Inner), SE(SE), CC(CC), ORE(ORE) {}
 
   /// Check if the loop interchange is profitable.
   bool isProfitable(unsigned InnerLoopId, unsigned OuterLoopId,
@@ -387,6 +395,9 @@ private:
   /// Scev analysis.
   ScalarEvolution *SE;
 
+  /// The cache cost of the loop nest, if it could be computed.
+  const CacheCost *CC;
+
   /// Interface to emit optimization remarks.
   OptimizationRemarkEmitter *ORE;
 };
@@ -435,6 +446,7 @@ struct LoopInterchange : public FunctionPass {
   LoopInfo *LI = nullptr;
   DependenceInfo *DI = nullptr;
   DominatorTree *DT = nullptr;
+  TargetTransformInfo *TTI = nullptr;
   bool PreserveLCSSA;
 
   /// Interface to emit optimization remarks.
@@ -450,6 +462,7 @@ struct LoopInterchange : public FunctionPass {
     AU.addRequired<DominatorTreeWrapperPass>();
     AU.addRequired<LoopInfoWrapperPass>();
     AU.addRequired<DependenceAnalysisWrapperPass>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
     AU.addRequiredID(LoopSimplifyID);
     AU.addRequiredID(LCSSAID);
     AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
@@ -464,6 +477,7 @@ struct LoopInterchange : public FunctionPass {
     DI = &getAnalysis<DependenceAnalysisWrapperPass>().getDI();
     auto *DTWP = getAnalysisIfAvailable<DominatorTreeWrapperPass>();
     DT = DTWP ? &DTWP->getDomTree() : nullptr;
+    TTI = &getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
     ORE = &getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
     PreserveLCSSA = mustPreserveAnalysisID(LCSSAID);
 
@@ -561,11 +575,17 @@ struct LoopInterchange : public FunctionPass {
       return false;
     }
 
+    // The cost of each loop as the innermost one does not depend on the order
+    // of the other loops, so it stays valid as loops are interchanged.
+    std::unique_ptr<CacheCost> CC;
+    if (UseCacheCost)
+      CC = CacheCost::getCacheCost(*OuterMostLoop, *SE, *TTI);
+
     unsigned SelecLoopId = selectLoopForInterchange(LoopList);
     // Move the selected loop outwards to the best possible position.
     for (unsigned i = SelecLoopId; i > 0; i--) {
-      bool Interchanged =
-          processLoop(LoopList, i, i - 1, LoopNestExit, DependencyMatrix);
+      bool Interchanged = processLoop(LoopList, i, i - 1, LoopNestExit,
+                                      DependencyMatrix, CC.get());
       if (!Interchanged)
         return Changed;
       // Loops interchanged reflect the same in LoopList
@@ -585,7 +605,8 @@ struct LoopInterchange : public FunctionPass {
 
   bool processLoop(LoopVector LoopList, unsigned InnerLoopId,
                    unsigned OuterLoopId, BasicBlock *LoopNestExit,
-                   std::vector<std::vector<char>> &DependencyMatrix) {
+                   std::vector<std::vector<char>> &DependencyMatrix,
+                   const CacheCost *CC) {
     DEBUG(dbgs() << "Processing Inner Loop Id = " << InnerLoopId
                  << " and OuterLoopId = " << OuterLoopId << "\n");
     Loop *InnerLoop = LoopList[InnerLoopId];
@@ -598,7 +619,7 @@ struct LoopInterchange : public FunctionPass {
       return false;
     }
     DEBUG(dbgs() << "Loops are legal to interchange\n");
-    LoopInterchangeProfitability LIP(OuterLoop, InnerLoop, SE, ORE);
+    LoopInterchangeProfitability LIP(OuterLoop, InnerLoop, SE, CC, ORE);
     if (!LIP.isProfitable(InnerLoopId, OuterLoopId, DependencyMatrix)) {
       DEBUG(dbgs() << "Interchanging loops not profitable\n");
       return false;
@@ -1116,6 +1137,33 @@ bool LoopInterchangeProfitability::isProfitable(unsigned InnerLoopId,
   // of bad orders is more than good.
   int Cost = getInstrOrderCost();
   DEBUG(dbgs() << "Cost = " << Cost << "\n");
+
+  // If the cache cost model tells the loops apart, the loop touching fewer
+  // cache lines as the innermost loop should be the inner one.
+  if (CC) {
+    uint64_t InnerCost = CC->getLoopCost(*InnerLoop);
+    uint64_t OuterCost = CC->getLoopCost(*OuterLoop);
+    DEBUG(dbgs() << "Cache cost: inner loop = " << InnerCost
+                 << ", outer loop = " << OuterCost << "\n");
+    if (OuterCost < InnerCost)
+      return true;
+    if (OuterCost > InnerCost && Cost < -LoopInterchangeCostThreshold) {
+      if (isProfitableForVectorization(InnerLoopId, OuterLoopId, DepMatrix))
+        return true;
+
+      ORE->emit([&]() {
+        return OptimizationRemarkMissed(DEBUG_TYPE, "InterchangeNotProfitable",
+                                        InnerLoop->getStartLoc(),
+                                        InnerLoop->getHeader())
+               << "Interchanging loops increases the cache cost (inner="
+               << ore::NV("InnerCost", InnerCost) << ", outer="
+               << ore::NV("OuterCost", OuterCost)
+               << ") and it does not improve parallelism.";
+      });
+      return false;
+    }
+  }
+
   if (Cost < -LoopInterchangeCostThreshold)
     return true;
 
@@ -1416,6 +1464,7 @@ INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(DependenceAnalysisWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
 INITIALIZE_PASS_DEPENDENCY(LCSSAWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
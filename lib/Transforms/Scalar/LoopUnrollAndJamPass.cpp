@@ -0,0 +1,296 @@
+//===- LoopUnrollAndJamPass.cpp - Loop unroll and jam pass ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass implements an unroll and jam pass. Most of the work is done by
+// Utils/LoopUnrollAndJam.cpp, this pass picks the loops and the unroll count.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar/LoopUnrollAndJamPass.h"
+#include "llvm/ADT/None.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/LoopPassManager.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/UnrollLoop.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-unroll-and-jam"
+
+static cl::opt<unsigned> UnrollAndJamCount(
+    "unroll-and-jam-count", cl::Hidden,
+    cl::desc("Use this unroll count for all loops including those with "
+             "unroll_and_jam_count pragma values, for testing purposes"));
+
+static cl::opt<unsigned> UnrollAndJamThreshold(
+    "unroll-and-jam-threshold", cl::init(60), cl::Hidden,
+    cl::desc("Threshold to use for inner loop when doing unroll and jam."));
+
+static cl::opt<unsigned> PragmaUnrollAndJamThreshold(
+    "pragma-unroll-and-jam-threshold", cl::init(1024), cl::Hidden,
+    cl::desc("Unrolled size limit for loops with an unroll_and_jam_count "
+             "pragma."));
+
+// Returns the loop hint metadata node with the given name, or nullptr.
+static MDNode *GetUnrollMetadataForLoop(const Loop *L, StringRef Name) {
+  if (MDNode *LoopID = L->getLoopID())
+    return GetUnrollMetadata(LoopID, Name);
+  return nullptr;
+}
+
+// Returns true if the loop has an unroll_and_jam(disable) pragma.
+static bool HasUnrollAndJamDisablePragma(const Loop *L) {
+  return GetUnrollMetadataForLoop(L, "llvm.loop.unroll_and_jam.disable");
+}
+
+// If the loop has an unroll_and_jam_count pragma, returns its (necessarily
+// positive) value. Otherwise returns 0.
+static unsigned UnrollAndJamCountPragmaValue(const Loop *L) {
+  MDNode *MD = GetUnrollMetadataForLoop(L, "llvm.loop.unroll_and_jam.count");
+  if (MD) {
+    assert(MD->getNumOperands() == 2 &&
+           "Unroll count hint metadata should have two operands.");
+    unsigned Count =
+        mdconst::extract<ConstantInt>(MD->getOperand(1))->getZExtValue();
+    assert(Count >= 1 && "Unroll count must be positive.");
+    return Count;
+  }
+  return 0;
+}
+
+// Returns the size of the outer loop unrolled Count times.
+static uint64_t getUnrolledLoopSize(
+    unsigned LoopSize, unsigned Count,
+    const TargetTransformInfo::UnrollingPreferences &UP) {
+  assert(LoopSize >= UP.BEInsns && "LoopSize should not be less than BEInsns!");
+  return (uint64_t)(LoopSize - UP.BEInsns) * Count + UP.BEInsns;
+}
+
+// Calculates the unroll and jam count and writes it to UP.Count. Returns true
+// if the count was set explicitly.
+static bool computeUnrollAndJamCount(
+    Loop *L, Loop *SubLoop, const TargetTransformInfo &TTI,
+    unsigned OuterTripCount, unsigned OuterTripMultiple,
+    unsigned OuterLoopSize, unsigned InnerLoopSize,
+    TargetTransformInfo::UnrollingPreferences &UP) {
+  // 1st priority is the count set by the "unroll-and-jam-count" option.
+  if (UnrollAndJamCount.getNumOccurrences() > 0) {
+    UP.Count = UnrollAndJamCount;
+    return true;
+  }
+
+  // 2nd priority is the count set by a pragma, within a larger size limit.
+  if (unsigned PragmaCount = UnrollAndJamCountPragmaValue(L)) {
+    if (getUnrolledLoopSize(OuterLoopSize, PragmaCount, UP) <
+        PragmaUnrollAndJamThreshold) {
+      UP.Count = PragmaCount;
+      return true;
+    }
+  }
+
+  // Otherwise pick the largest count, up to the target's default runtime
+  // unroll count, for which the unrolled outer loop stays within the target's
+  // partial unrolling threshold, the jammed inner loop stays small, and the
+  // values carried by the copies of the inner loop fit in the registers. The
+  // count should divide the trip count of the outer loop, or be a power of two
+  // if a remainder loop is allowed.
+  unsigned NumInnerPHIs = std::distance(SubLoop->getHeader()->phis().begin(),
+                                        SubLoop->getHeader()->phis().end());
+  unsigned NumRegs = TTI.getNumberOfRegisters(/*Vector=*/false);
+  bool AllowRemainder = OuterTripCount ? UP.AllowRemainder : UP.Runtime;
+  unsigned MaxCount = std::min(UP.MaxCount, UP.DefaultUnrollRuntimeCount);
+  if (OuterTripCount)
+    MaxCount = std::min(MaxCount, OuterTripCount);
+
+  UP.Count = 0;
+  for (unsigned Count = MaxCount; Count > 1; --Count) {
+    if (OuterTripMultiple % Count != 0 &&
+        (!AllowRemainder || !isPowerOf2_32(Count)))
+      continue;
+    if (getUnrolledLoopSize(OuterLoopSize, Count, UP) > UP.PartialThreshold ||
+        (uint64_t)InnerLoopSize * Count > UnrollAndJamThreshold ||
+        NumInnerPHIs * Count > NumRegs)
+      continue;
+    UP.Count = Count;
+    break;
+  }
+  DEBUG(dbgs() << "  unroll and jam count: " << UP.Count << "\n");
+  return false;
+}
+
+static LoopUnrollResult
+tryToUnrollAndJamLoop(Loop *L, DominatorTree &DT, LoopInfo *LI,
+                      ScalarEvolution &SE, const TargetTransformInfo &TTI,
+                      AssumptionCache &AC, DependenceInfo &DI,
+                      OptimizationRemarkEmitter &ORE, int OptLevel) {
+  // Only loop nests of depth two are unroll and jammed.
+  if (L->getSubLoops().size() != 1 || !L->getSubLoops()[0]->empty())
+    return LoopUnrollResult::Unmodified;
+  if (HasUnrollAndJamDisablePragma(L))
+    return LoopUnrollResult::Unmodified;
+  Loop *SubLoop = L->getSubLoops()[0];
+
+  DEBUG(dbgs() << "Loop Unroll and Jam: F["
+               << L->getHeader()->getParent()->getName() << "] Loop %"
+               << L->getHeader()->getName() << "\n");
+
+  TargetTransformInfo::UnrollingPreferences UP = gatherUnrollingPreferences(
+      L, SE, TTI, OptLevel, None, None, None, None, None, None);
+
+  unsigned NumInlineCandidates;
+  bool NotDuplicatable;
+  bool Convergent;
+  unsigned OuterLoopSize =
+      ApproximateLoopSize(L, NumInlineCandidates, NotDuplicatable, Convergent,
+                          TTI, &AC, UP.BEInsns);
+  if (NotDuplicatable || Convergent || NumInlineCandidates != 0) {
+    DEBUG(dbgs() << "  Not unrolling loop which contains calls or "
+                    "non-duplicatable instructions.\n");
+    return LoopUnrollResult::Unmodified;
+  }
+  unsigned InnerLoopSize =
+      ApproximateLoopSize(SubLoop, NumInlineCandidates, NotDuplicatable,
+                          Convergent, TTI, &AC, UP.BEInsns);
+  DEBUG(dbgs() << "  Outer loop size: " << OuterLoopSize
+               << ", inner loop size: " << InnerLoopSize << "\n");
+
+  unsigned TripCount = 0;
+  unsigned TripMultiple = 1;
+  if (BasicBlock *ExitingBlock = L->getExitingBlock()) {
+    TripCount = SE.getSmallConstantTripCount(L, ExitingBlock);
+    TripMultiple = SE.getSmallConstantTripMultiple(L, ExitingBlock);
+  }
+
+  bool IsExplicit =
+      computeUnrollAndJamCount(L, SubLoop, TTI, TripCount, TripMultiple,
+                               OuterLoopSize, InnerLoopSize, UP);
+  if (UP.Count < 2)
+    return LoopUnrollResult::Unmodified;
+
+  if (!isSafeToUnrollAndJam(L, SE, DT, DI)) {
+    if (IsExplicit)
+      ORE.emit([&]() {
+        return OptimizationRemarkMissed(DEBUG_TYPE, "UnsafeToUnrollAndJam",
+                                        L->getStartLoc(), L->getHeader())
+               << "unable to unroll and jam loop: the transformation is not "
+                  "legal for this loop nest";
+      });
+    return LoopUnrollResult::Unmodified;
+  }
+
+  return UnrollAndJamLoop(L, UP.Count, TripCount, TripMultiple,
+                          UP.UnrollRemainder, LI, &SE, &DT, &AC, &ORE);
+}
+
+namespace {
+
+class LoopUnrollAndJam : public LoopPass {
+public:
+  static char ID; // Pass ID, replacement for typeid
+
+  int OptLevel;
+
+  LoopUnrollAndJam(int OptLevel = 2) : LoopPass(ID), OptLevel(OptLevel) {
+    initializeLoopUnrollAndJamPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnLoop(Loop *L, LPPassManager &LPM) override {
+    if (skipLoop(L))
+      return false;
+
+    Function &F = *L->getHeader()->getParent();
+
+    auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    LoopInfo *LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    ScalarEvolution &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    const TargetTransformInfo &TTI =
+        getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+    auto &AC = getAnalysis<AssumptionCacheTracker>().getAssumptionCache(F);
+    auto &DI = getAnalysis<DependenceAnalysisWrapperPass>().getDI();
+    // For the old PM, we can't use OptimizationRemarkEmitter as an analysis
+    // pass, see LoopUnroll.
+    OptimizationRemarkEmitter ORE(&F);
+
+    LoopUnrollResult Result =
+        tryToUnrollAndJamLoop(L, DT, LI, SE, TTI, AC, DI, ORE, OptLevel);
+    return Result != LoopUnrollResult::Unmodified;
+  }
+
+  /// This transformation requires natural loop information & requires that
+  /// loop preheaders be inserted into the CFG...
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<AssumptionCacheTracker>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+    AU.addRequired<DependenceAnalysisWrapperPass>();
+    getLoopAnalysisUsage(AU);
+  }
+};
+
+} // end anonymous namespace
+
+char LoopUnrollAndJam::ID = 0;
+
+INITIALIZE_PASS_BEGIN(LoopUnrollAndJam, "loop-unroll-and-jam",
+                      "Unroll and Jam loops", false, false)
+INITIALIZE_PASS_DEPENDENCY(AssumptionCacheTracker)
+INITIALIZE_PASS_DEPENDENCY(LoopPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysisWrapperPass)
+INITIALIZE_PASS_END(LoopUnrollAndJam, "loop-unroll-and-jam",
+                    "Unroll and Jam loops", false, false)
+
+Pass *llvm::createLoopUnrollAndJamPass(int OptLevel) {
+  return new LoopUnrollAndJam(OptLevel);
+}
+
+PreservedAnalyses LoopUnrollAndJamPass::run(Loop &L, LoopAnalysisManager &AM,
+                                            LoopStandardAnalysisResults &AR,
+                                            LPMUpdater &) {
+  const auto &FAM =
+      AM.getResult<FunctionAnalysisManagerLoopProxy>(L, AR).getManager();
+  Function *F = L.getHeader()->getParent();
+
+  auto *ORE = FAM.getCachedResult<OptimizationRemarkEmitterAnalysis>(*F);
+  // FIXME: This should probably be optional rather than required.
+  if (!ORE)
+    report_fatal_error(
+        "LoopUnrollAndJamPass: OptimizationRemarkEmitterAnalysis not "
+        "cached at a higher level");
+
+  DependenceInfo DI(F, &AR.AA, &AR.SE, &AR.LI);
+  LoopUnrollResult Result = tryToUnrollAndJamLoop(
+      &L, AR.DT, &AR.LI, AR.SE, AR.TTI, AR.AC, DI, *ORE, OptLevel);
+  if (Result == LoopUnrollResult::Unmodified)
+    return PreservedAnalyses::all();
+
+  return getLoopPassPreservedAnalyses();
+}
@@ -19,6 +19,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/DomTreeUpdater.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/LoopIterator.h"
 #include "llvm/Analysis/LoopPass.h"
@@ -64,8 +65,7 @@ UnrollVerifyDomtree("unroll-verify-domtree", cl::Hidden,
 
 /// Convert the instruction operands from referencing the current values into
 /// those specified by VMap.
-static inline void remapInstruction(Instruction *I,
-                                    ValueToValueMapTy &VMap) {
+void llvm::remapInstruction(Instruction *I, ValueToValueMapTy &VMap) {
   for (unsigned op = 0, E = I->getNumOperands(); op != E; ++op) {
     Value *Op = I->getOperand(op);
 
@@ -103,11 +103,12 @@ static inline void remapInstruction(Instruction *I,
 /// ScalarEvolution by calling ScalarEvolution::forgetLoop because SE may have
 /// references to the eliminated BB.  The argument ForgottenLoops contains a set
 /// of loops that have already been forgotten to prevent redundant, expensive
-/// calls to ScalarEvolution::forgetLoop.  Returns the new combined block.
-static BasicBlock *
-foldBlockIntoPredecessor(BasicBlock *BB, LoopInfo *LI, ScalarEvolution *SE,
-                         SmallPtrSetImpl<Loop *> &ForgottenLoops,
-                         DominatorTree *DT) {
+/// calls to ScalarEvolution::forgetLoop.  If \p DTU is given, the edge changes
+/// are reported to it and BB is only erased once its updates are flushed.
+/// Returns the new combined block.
+BasicBlock *llvm::foldBlockIntoPredecessor(
+    BasicBlock *BB, LoopInfo *LI, ScalarEvolution *SE,
+    SmallPtrSetImpl<Loop *> &ForgottenLoops, DomTreeUpdater *DTU) {
   // Merge basic blocks into their predecessor if there is only one distinct
   // pred, and if there is only one distinct successor of the predecessor, and
   // if there are no PHI nodes.
@@ -126,6 +127,18 @@ foldBlockIntoPredecessor(BasicBlock *BB, LoopInfo *LI, ScalarEvolution *SE,
   // OnlyPred to OnlySucc.
   FoldSingleEntryPHINodes(BB);
 
+  // The successors of BB become the successors of OnlyPred.
+  SmallVector<DominatorTree::UpdateType, 8> Updates;
+  if (DTU) {
+    Updates.push_back({DominatorTree::Delete, OnlyPred, BB});
+    SmallPtrSet<BasicBlock *, 4> SeenSuccs;
+    for (BasicBlock *Succ : successors(BB))
+      if (SeenSuccs.insert(Succ).second) {
+        Updates.push_back({DominatorTree::Delete, BB, Succ});
+        Updates.push_back({DominatorTree::Insert, OnlyPred, Succ});
+      }
+  }
+
   // Delete the unconditional branch from the predecessor...
   OnlyPred->getInstList().pop_back();
 
@@ -139,17 +152,6 @@ foldBlockIntoPredecessor(BasicBlock *BB, LoopInfo *LI, ScalarEvolution *SE,
   // OldName will be valid until erased.
   StringRef OldName = BB->getName();
 
-  // Erase the old block and update dominator info.
-  if (DT)
-    if (DomTreeNode *DTN = DT->getNode(BB)) {
-      DomTreeNode *PredDTN = DT->getNode(OnlyPred);
-      SmallVector<DomTreeNode *, 8> Children(DTN->begin(), DTN->end());
-      for (auto *DI : Children)
-        DT->changeImmediateDominator(DI, PredDTN);
-
-      DT->eraseNode(BB);
-    }
-
   // ScalarEvolution holds references to loop exit blocks.
   if (SE) {
     if (Loop *L = LI->getLoopFor(BB)) {
@@ -163,7 +165,15 @@ foldBlockIntoPredecessor(BasicBlock *BB, LoopInfo *LI, ScalarEvolution *SE,
   if (!OldName.empty() && !OnlyPred->hasName())
     OnlyPred->setName(OldName);
 
-  BB->eraseFromParent();
+  // Erase the old block and update dominator info. The trees may refer to BB
+  // until the updates are flushed, so it keeps a terminator until then.
+  if (DTU) {
+    new UnreachableInst(BB->getContext(), BB);
+    DTU->applyUpdates(Updates);
+    DTU->deleteBB(BB);
+  } else {
+    BB->eraseFromParent();
+  }
 
   return OnlyPred;
 }
@@ -385,7 +395,6 @@ LoopUnrollResult llvm::UnrollLoop(
   bool CompletelyUnroll = Count == TripCount;
   SmallVector<BasicBlock *, 4> ExitBlocks;
   L->getExitBlocks(ExitBlocks);
-  std::vector<BasicBlock*> OriginalLoopBlocks = L->getBlocks();
 
   // Go through all exits of L and see if there are any phi-nodes there. We just
   // conservatively assume that they're inserted to preserve LCSSA form, which
@@ -551,6 +560,7 @@ LoopUnrollResult llvm::UnrollLoop(
   LoopBlocksDFS::RPOIterator BlockEnd = DFS.endRPO();
 
   std::vector<BasicBlock*> UnrolledLoopBlocks = L->getBlocks();
+  const size_t NumOrigUnrolledBlocks = UnrolledLoopBlocks.size();
 
   // Loop Unrolling might create new loops. While we do preserve LoopInfo, we
   // might break loop-simplified form for these loops (as they, e.g., would
@@ -630,22 +640,6 @@ LoopUnrollResult llvm::UnrollLoop(
 
       NewBlocks.push_back(New);
       UnrolledLoopBlocks.push_back(New);
-
-      // Update DomTree: since we just copy the loop body, and each copy has a
-      // dedicated entry block (copy of the header block), this header's copy
-      // dominates all copied blocks. That means, dominance relations in the
-      // copied body are the same as in the original body.
-      if (DT) {
-        if (*BB == Header)
-          DT->addNewBlock(New, Latches[It - 1]);
-        else {
-          auto BBDomNode = DT->getNode(*BB);
-          auto BBIDom = BBDomNode->getIDom();
-          BasicBlock *OriginalBBIDom = BBIDom->getBlock();
-          DT->addNewBlock(
-              New, cast<BasicBlock>(LastValueMap[cast<Value>(OriginalBBIDom)]));
-        }
-      }
     }
 
     // Remap all instructions in the most recent iteration
@@ -678,6 +672,12 @@ LoopUnrollResult llvm::UnrollLoop(
     }
   }
 
+  // The dominator trees learn about the unrolled iterations from the edges of
+  // the copies and from the rewired original latch, in one batch.
+  DomTreeUpdater DTU(DT, nullptr, DomTreeUpdater::UpdateStrategy::Lazy);
+  SmallPtrSet<BasicBlock *, 4> OrigLatchSuccs(succ_begin(LatchBlock),
+                                              succ_end(LatchBlock));
+
   // Now that all the basic blocks for the unrolled iterations are in place,
   // set up the branches to connect them.
   for (unsigned i = 0, e = Latches.size(); i != e; ++i) {
@@ -734,51 +734,29 @@ LoopUnrollResult llvm::UnrollLoop(
     }
   }
 
-  // Update dominators of blocks we might reach through exits.
-  // Immediate dominator of such block might change, because we add more
-  // routes which can lead to the exit: we can now reach it from the copied
-  // iterations too.
-  if (DT && Count > 1) {
-    for (auto *BB : OriginalLoopBlocks) {
-      auto *BBDomNode = DT->getNode(BB);
-      SmallVector<BasicBlock *, 16> ChildrenToUpdate;
-      for (auto *ChildDomNode : BBDomNode->getChildren()) {
-        auto *ChildBB = ChildDomNode->getBlock();
-        if (!L->contains(ChildBB))
-          ChildrenToUpdate.push_back(ChildBB);
-      }
-      BasicBlock *NewIDom;
-      if (BB == LatchBlock) {
-        // The latch is special because we emit unconditional branches in
-        // some cases where the original loop contained a conditional branch.
-        // Since the latch is always at the bottom of the loop, if the latch
-        // dominated an exit before unrolling, the new dominator of that exit
-        // must also be a latch.  Specifically, the dominator is the first
-        // latch which ends in a conditional branch, or the last latch if
-        // there is no such latch.
-        NewIDom = Latches.back();
-        for (BasicBlock *IterLatch : Latches) {
-          TerminatorInst *Term = IterLatch->getTerminator();
-          if (isa<BranchInst>(Term) && cast<BranchInst>(Term)->isConditional()) {
-            NewIDom = IterLatch;
-            break;
-          }
-        }
-      } else {
-        // The new idom of the block will be the nearest common dominator
-        // of all copies of the previous idom. This is equivalent to the
-        // nearest common dominator of the previous idom and the first latch,
-        // which dominates all copies of the previous idom.
-        NewIDom = DT->findNearestCommonDominator(BB, LatchBlock);
-      }
-      for (auto *ChildBB : ChildrenToUpdate)
-        DT->changeImmediateDominator(ChildBB, NewIDom);
+  if (DT) {
+    SmallVector<DominatorTree::UpdateType, 16> DTUpdates;
+    SmallPtrSet<BasicBlock *, 4> LatchSuccs(succ_begin(LatchBlock),
+                                            succ_end(LatchBlock));
+    for (BasicBlock *Succ : OrigLatchSuccs)
+      if (!LatchSuccs.count(Succ))
+        DTUpdates.push_back({DominatorTree::Delete, LatchBlock, Succ});
+    for (BasicBlock *Succ : LatchSuccs)
+      if (!OrigLatchSuccs.count(Succ))
+        DTUpdates.push_back({DominatorTree::Insert, LatchBlock, Succ});
+
+    // Every edge out of a copy is new, including those to the exit blocks,
+    // whose immediate dominators may move down to a later iteration.
+    for (BasicBlock *New :
+         makeArrayRef(UnrolledLoopBlocks).slice(NumOrigUnrolledBlocks)) {
+      SmallPtrSet<BasicBlock *, 4> SeenSuccs;
+      for (BasicBlock *Succ : successors(New))
+        if (SeenSuccs.insert(Succ).second)
+          DTUpdates.push_back({DominatorTree::Insert, New, Succ});
     }
+    DTU.applyUpdates(DTUpdates);
   }
 
-  if (DT && UnrollVerifyDomtree)
-    DT->verifyDomTree();
-
   // Merge adjacent basic blocks, if possible.
   SmallPtrSet<Loop *, 4> ForgottenLoops;
   for (BasicBlock *Latch : Latches) {
@@ -786,7 +764,7 @@ LoopUnrollResult llvm::UnrollLoop(
     if (Term->isUnconditional()) {
       BasicBlock *Dest = Term->getSuccessor(0);
       if (BasicBlock *Fold =
-              foldBlockIntoPredecessor(Dest, LI, SE, ForgottenLoops, DT)) {
+              foldBlockIntoPredecessor(Dest, LI, SE, ForgottenLoops, &DTU)) {
         // Dest has been folded into Fold. Update our worklists accordingly.
         std::replace(Latches.begin(), Latches.end(), Dest, Fold);
         UnrolledLoopBlocks.erase(std::remove(UnrolledLoopBlocks.begin(),
@@ -795,6 +773,10 @@ LoopUnrollResult llvm::UnrollLoop(
       }
     }
   }
+  DTU.flush();
+
+  if (DT && UnrollVerifyDomtree)
+    DT->verifyDomTree();
 
   // Simplify any new induction variables in the partially unrolled loop.
   if (SE && !CompletelyUnroll && Count > 1) {
@@ -0,0 +1,528 @@
+//===-- LoopUnrollAndJam.cpp - Loop unroll and jam utilities --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements loop unroll and jam as a routine, much like
+// LoopUnroll.cpp implements loop unroll.
+//
+// Unroll and jam unrolls an outer loop and fuses the copies of its inner loop
+// into a single inner loop, so that the values loaded by one copy of the
+// inner loop body can be reused by the others.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/DomTreeUpdater.h"
+#include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/UnrollLoop.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-unroll-and-jam"
+
+STATISTIC(NumUnrolledAndJammed, "Number of loops unroll and jammed");
+
+typedef SmallPtrSet<BasicBlock *, 4> BasicBlockSet;
+
+// Partition the blocks of an outer loop into the blocks of its subloop, the
+// blocks before the subloop (Fore) and the blocks after it (Aft). Returns
+// false if the fore blocks can be left other than through the subloop
+// preheader, or the aft blocks other than through the outer loop latch.
+static bool partitionOuterLoopBlocks(Loop *L, Loop *SubLoop,
+                                     BasicBlockSet &ForeBlocks,
+                                     BasicBlockSet &SubLoopBlocks,
+                                     BasicBlockSet &AftBlocks,
+                                     DominatorTree &DT) {
+  BasicBlock *SubLoopLatch = SubLoop->getLoopLatch();
+  SubLoopBlocks.insert(SubLoop->block_begin(), SubLoop->block_end());
+
+  for (BasicBlock *BB : L->blocks()) {
+    if (SubLoop->contains(BB))
+      continue;
+    if (DT.dominates(SubLoopLatch, BB))
+      AftBlocks.insert(BB);
+    else
+      ForeBlocks.insert(BB);
+  }
+
+  BasicBlock *SubLoopPreheader = SubLoop->getLoopPreheader();
+  for (BasicBlock *BB : ForeBlocks) {
+    if (BB == SubLoopPreheader)
+      continue;
+    for (BasicBlock *Succ : successors(BB))
+      if (!ForeBlocks.count(Succ))
+        return false;
+  }
+
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!AftBlocks.count(Latch))
+    return false;
+  for (BasicBlock *BB : AftBlocks) {
+    if (BB == Latch)
+      continue;
+    for (BasicBlock *Succ : successors(BB))
+      if (!AftBlocks.count(Succ))
+        return false;
+  }
+  return true;
+}
+
+// The fore blocks of every copy run before the subloop and aft blocks of the
+// previous copies, so the values the outer header PHIs take from the latch
+// must be computed before the subloop. Collects in ToMove the aft block
+// instructions computing them. Returns false if one of them cannot be moved
+// ahead of the subloop.
+static bool collectHeaderPhiOperands(Loop *L, Loop *SubLoop,
+                                     BasicBlockSet &AftBlocks,
+                                     SmallVectorImpl<Instruction *> &ToMove) {
+  SmallVector<Instruction *, 8> Worklist;
+  SmallPtrSet<Instruction *, 8> Visited;
+  for (PHINode &Phi : L->getHeader()->phis())
+    if (auto *I = dyn_cast<Instruction>(
+            Phi.getIncomingValueForBlock(L->getLoopLatch())))
+      Worklist.push_back(I);
+
+  while (!Worklist.empty()) {
+    Instruction *I = Worklist.pop_back_val();
+    if (!Visited.insert(I).second)
+      continue;
+    if (SubLoop->contains(I))
+      return false;
+    if (!AftBlocks.count(I->getParent()))
+      continue;
+    // A PHI in the aft blocks is fed by the subloop, and memory accesses
+    // cannot be reordered with it.
+    if (isa<PHINode>(I) || I->mayHaveSideEffects() ||
+        I->mayReadOrWriteMemory())
+      return false;
+    ToMove.push_back(I);
+    for (Value *Op : I->operands())
+      if (auto *OpI = dyn_cast<Instruction>(Op))
+        Worklist.push_back(OpI);
+  }
+  return true;
+}
+
+// Move the instructions in ToMove before InsertLoc, operands first.
+static void moveHeaderPhiOperandsToForeBlocks(ArrayRef<Instruction *> ToMove,
+                                              Instruction *InsertLoc) {
+  SmallPtrSet<Instruction *, 8> Pending(ToMove.begin(), ToMove.end());
+  while (!Pending.empty())
+    for (Instruction *I : ToMove) {
+      if (!Pending.count(I) || any_of(I->operands(), [&](Value *Op) {
+            auto *OpI = dyn_cast<Instruction>(Op);
+            return OpI && Pending.count(OpI);
+          }))
+        continue;
+      I->moveBefore(InsertLoc);
+      Pending.erase(I);
+    }
+}
+
+// Collect the loads and stores of Blocks. Returns false if one of the blocks
+// contains another kind of memory access or a volatile or atomic one.
+static bool getLoadsAndStores(BasicBlockSet &Blocks,
+                              SmallVectorImpl<Instruction *> &MemInstr) {
+  for (BasicBlock *BB : Blocks)
+    for (Instruction &I : *BB) {
+      if (auto *Ld = dyn_cast<LoadInst>(&I)) {
+        if (!Ld->isSimple())
+          return false;
+        MemInstr.push_back(&I);
+      } else if (auto *St = dyn_cast<StoreInst>(&I)) {
+        if (!St->isSimple())
+          return false;
+        MemInstr.push_back(&I);
+      } else if (I.mayHaveSideEffects() || I.mayReadOrWriteMemory()) {
+        return false;
+      }
+    }
+  return true;
+}
+
+// Check the dependences between the accesses of Earlier and those of Later,
+// which unroll and jam reorders. Accesses that are not in the subloop may only
+// depend on accesses of the same or earlier iterations of the outer loop. The
+// jammed subloop interleaves the inner iterations of several outer iterations,
+// so for two subloop accesses the dependences from a later outer iteration to
+// an earlier inner iteration are not allowed either.
+static bool checkDependencies(ArrayRef<Instruction *> Earlier,
+                              ArrayRef<Instruction *> Later,
+                              unsigned LoopDepth, bool InnerLoop,
+                              DependenceInfo &DI) {
+  for (Instruction *Src : Earlier)
+    for (Instruction *Dst : Later) {
+      if (isa<LoadInst>(Src) && isa<LoadInst>(Dst))
+        continue;
+      auto D = DI.depends(Src, Dst, /*PossiblyLoopIndependent=*/true);
+      if (!D)
+        continue;
+      if (D->isConfused() || D->getLevels() < LoopDepth + InnerLoop)
+        return false;
+      bool OuterGT = D->getDirection(LoopDepth) & Dependence::DVEntry::GT;
+      if (!InnerLoop && OuterGT)
+        return false;
+      if (InnerLoop && OuterGT &&
+          (D->getDirection(LoopDepth + 1) & Dependence::DVEntry::LT))
+        return false;
+    }
+  return true;
+}
+
+bool llvm::isSafeToUnrollAndJam(Loop *L, ScalarEvolution &SE,
+                                DominatorTree &DT, DependenceInfo &DI) {
+  // The supported loop nests look like this:
+  //
+  //       |
+  //   ForeFirst    <------\   }
+  //    Blocks             |   } ForeBlocks
+  //   ForeLast            |   }
+  //       |               |
+  //   SubLoopFirst  <\    |   }
+  //    Blocks        |    |   } SubLoopBlocks
+  //   SubLoopLast   -/    |   }
+  //       |               |
+  //   AftFirst            |   }
+  //    Blocks             |   } AftBlocks
+  //   AftLast     --------/   }
+  //       |
+  if (!L->isLoopSimplifyForm() || L->getSubLoops().size() != 1)
+    return false;
+  Loop *SubLoop = L->getSubLoops()[0];
+  if (!SubLoop->isLoopSimplifyForm() || !SubLoop->empty())
+    return false;
+
+  BasicBlock *Latch = L->getLoopLatch();
+  BasicBlock *SubLoopLatch = SubLoop->getLoopLatch();
+  if (L->getExitingBlock() != Latch || !L->getExitBlock() ||
+      SubLoop->getExitingBlock() != SubLoopLatch || !SubLoop->getExitBlock())
+    return false;
+  for (BasicBlock *BB : {Latch, SubLoopLatch}) {
+    auto *BI = dyn_cast<BranchInst>(BB->getTerminator());
+    if (!BI || BI->isUnconditional())
+      return false;
+  }
+
+  BasicBlockSet ForeBlocks, SubLoopBlocks, AftBlocks;
+  if (!partitionOuterLoopBlocks(L, SubLoop, ForeBlocks, SubLoopBlocks,
+                                AftBlocks, DT)) {
+    DEBUG(dbgs() << "Won't unroll-and-jam; unsupported loop structure\n");
+    return false;
+  }
+
+  // The jammed subloop runs as many iterations as each of its copies did.
+  const SCEV *SubLoopBECount = SE.getBackedgeTakenCount(SubLoop);
+  if (isa<SCEVCouldNotCompute>(SubLoopBECount) ||
+      !SE.isLoopInvariant(SubLoopBECount, L)) {
+    DEBUG(dbgs() << "Won't unroll-and-jam; subloop trip count varies\n");
+    return false;
+  }
+
+  LoopSafetyInfo LSI;
+  computeLoopSafetyInfo(&LSI, L);
+  if (LSI.MayThrow)
+    return false;
+
+  SmallVector<Instruction *, 8> ToMove;
+  if (!collectHeaderPhiOperands(L, SubLoop, AftBlocks, ToMove)) {
+    DEBUG(dbgs() << "Won't unroll-and-jam; outer loop values computed after "
+                    "the subloop\n");
+    return false;
+  }
+
+  SmallVector<Instruction *, 8> ForeMemInstr, SubLoopMemInstr, AftMemInstr;
+  if (!getLoadsAndStores(ForeBlocks, ForeMemInstr) ||
+      !getLoadsAndStores(SubLoopBlocks, SubLoopMemInstr) ||
+      !getLoadsAndStores(AftBlocks, AftMemInstr))
+    return false;
+
+  unsigned LoopDepth = L->getLoopDepth();
+  if (!checkDependencies(ForeMemInstr, SubLoopMemInstr, LoopDepth, false, DI) ||
+      !checkDependencies(ForeMemInstr, AftMemInstr, LoopDepth, false, DI) ||
+      !checkDependencies(SubLoopMemInstr, AftMemInstr, LoopDepth, false, DI) ||
+      !checkDependencies(SubLoopMemInstr, SubLoopMemInstr, LoopDepth, true,
+                         DI)) {
+    DEBUG(dbgs() << "Won't unroll-and-jam; unsafe dependence\n");
+    return false;
+  }
+  return true;
+}
+
+// Make the PHIs of BB take the values they received from OldPred from NewPred.
+static void updatePHIBlocks(BasicBlock *BB, BasicBlock *OldPred,
+                            BasicBlock *NewPred) {
+  for (PHINode &Phi : BB->phis()) {
+    int Idx = Phi.getBasicBlockIndex(OldPred);
+    if (Idx >= 0)
+      Phi.setIncomingBlock(Idx, NewPred);
+  }
+}
+
+// Move the PHIs of From to the start of To.
+static void movePHIs(BasicBlock *From, BasicBlock *To) {
+  Instruction *InsertPt = To->getFirstNonPHI();
+  while (auto *Phi = dyn_cast<PHINode>(&From->front()))
+    Phi->moveBefore(InsertPt);
+}
+
+// Replace the conditional branch ending BB by a branch to Succ.
+static void replaceWithUnconditionalBranch(BasicBlock *BB, BasicBlock *Succ) {
+  auto *Term = cast<BranchInst>(BB->getTerminator());
+  Value *Cond = Term->getCondition();
+  BranchInst::Create(Succ, Term);
+  Term->eraseFromParent();
+  RecursivelyDeleteTriviallyDeadInstructions(Cond);
+}
+
+/// Unroll and jam the given loop by Count. The loop must be in LCSSA form and
+/// have passed isSafeToUnrollAndJam. Unrolling is done as in UnrollLoop, with
+/// a remainder loop when the trip count is not known to be a multiple of
+/// Count. The copies of the outer loop are then stitched together so that the
+/// fore blocks of all copies run first, followed by a single subloop running
+/// the subloop bodies of all copies, followed by the aft blocks of all
+/// copies:
+///
+///   ForeBlocks      ForeBlocks.1 ...       ForeBlocks.N
+///   SubLoopBlocks   SubLoopBlocks.1 ...    SubLoopBlocks.N (back to the first)
+///   AftBlocks       AftBlocks.1 ...        AftBlocks.N (back to the header)
+///
+/// If UnrollRemainder is true, the remainder loop is itself unrolled.
+///
+/// This utility preserves LoopInfo, DominatorTree and the simplified and LCSSA
+/// forms of the loops, and notifies ScalarEvolution of the changed loops.
+LoopUnrollResult llvm::UnrollAndJamLoop(
+    Loop *L, unsigned Count, unsigned TripCount, unsigned TripMultiple,
+    bool UnrollRemainder, LoopInfo *LI, ScalarEvolution *SE,
+    DominatorTree *DT, AssumptionCache *AC, OptimizationRemarkEmitter *ORE) {
+  assert(DT && "DomTree is required");
+  assert(L->getSubLoops().size() == 1 && "Expected a single subloop");
+  assert(Count > 0 && TripMultiple > 0 && "Bad unroll-and-jam parameters");
+  assert((!TripCount || TripCount % TripMultiple == 0) &&
+         "Trip count must be a multiple of the trip multiple");
+  if (Count < 2)
+    return LoopUnrollResult::Unmodified;
+
+  Loop *SubLoop = L->getSubLoops()[0];
+  BasicBlock *Header = L->getHeader();
+
+  // Without a known multiple of Count, run the remaining iterations in an
+  // epilogue loop, which also makes the unrolled loop run a multiple of Count
+  // iterations.
+  bool NeedsRemainder = TripMultiple % Count != 0;
+  if (NeedsRemainder &&
+      !UnrollRuntimeLoopRemainder(L, Count, /*AllowExpensiveTripCount=*/false,
+                                  /*UseEpilogRemainder=*/true, UnrollRemainder,
+                                  LI, SE, DT, AC, /*PreserveLCSSA=*/true)) {
+    DEBUG(dbgs() << "Won't unroll-and-jam; remainder loop could not be "
+                    "generated\n");
+    return LoopUnrollResult::Unmodified;
+  }
+
+  DEBUG(dbgs() << "UNROLL AND JAMMING loop %" << Header->getName() << " by "
+               << Count << (NeedsRemainder ? " with remainder loop" : "")
+               << "\n");
+  ORE->emit([&]() {
+    OptimizationRemark Remark(DEBUG_TYPE, "UnrollAndJammed", L->getStartLoc(),
+                              Header);
+    Remark << "unroll and jammed loop by a factor of "
+           << ore::NV("UnrollCount", Count);
+    if (NeedsRemainder)
+      Remark << " with run-time trip count";
+    return Remark;
+  });
+
+  if (SE)
+    SE->forgetLoop(L);
+
+  BasicBlock *LatchBlock = L->getLoopLatch();
+  auto *LatchBI = cast<BranchInst>(LatchBlock->getTerminator());
+  bool ContinueOnTrue = L->contains(LatchBI->getSuccessor(0));
+  BasicBlock *LoopExit = LatchBI->getSuccessor(ContinueOnTrue);
+  auto *SubLoopLatchBI =
+      cast<BranchInst>(SubLoop->getLoopLatch()->getTerminator());
+  bool SubLoopContinueOnTrue = SubLoop->contains(SubLoopLatchBI->getSuccessor(0));
+
+  BasicBlockSet ForeBlocks, SubLoopBlocks, AftBlocks;
+  bool Partitioned = partitionOuterLoopBlocks(L, SubLoop, ForeBlocks,
+                                              SubLoopBlocks, AftBlocks, *DT);
+  (void)Partitioned;
+  assert(Partitioned && "Loop nest not checked by isSafeToUnrollAndJam");
+
+  SmallVector<Instruction *, 8> ToMove;
+  collectHeaderPhiOperands(L, SubLoop, AftBlocks, ToMove);
+  moveHeaderPhiOperandsToForeBlocks(
+      ToMove, SubLoop->getLoopPreheader()->getTerminator());
+
+  // The first and last blocks of the fore blocks, subloop and aft blocks of
+  // each copy, which are the blocks stitched together below.
+  std::vector<BasicBlock *> ForeBlocksFirst{Header};
+  std::vector<BasicBlock *> ForeBlocksLast{SubLoop->getLoopPreheader()};
+  std::vector<BasicBlock *> SubLoopBlocksFirst{SubLoop->getHeader()};
+  std::vector<BasicBlock *> SubLoopBlocksLast{SubLoop->getLoopLatch()};
+  std::vector<BasicBlock *> AftBlocksFirst{SubLoop->getExitBlock()};
+  std::vector<BasicBlock *> AftBlocksLast{LatchBlock};
+
+  std::vector<BasicBlock *> OrigBlocks(L->block_begin(), L->block_end());
+  SmallVector<PHINode *, 8> OrigPHINodes;
+  for (PHINode &PN : Header->phis())
+    OrigPHINodes.push_back(&PN);
+
+  // The blocks of all the copies of the subloop belong to the subloop.
+  NewLoopsMap NewLoops;
+  NewLoops[L] = L;
+  NewLoops[SubLoop] = SubLoop;
+
+  // Maps the values of the original loop to those of the latest copy.
+  ValueToValueMapTy LastValueMap;
+  for (unsigned It = 1; It != Count; ++It) {
+    SmallVector<BasicBlock *, 8> NewBlocks;
+    for (BasicBlock *BB : OrigBlocks) {
+      ValueToValueMapTy VMap;
+      BasicBlock *New = CloneBasicBlock(BB, VMap, "." + Twine(It));
+      Header->getParent()->getBasicBlockList().push_back(New);
+
+      // The header PHIs of a copy take the values of the previous copy.
+      if (BB == Header)
+        for (PHINode *OrigPHI : OrigPHINodes) {
+          auto *NewPHI = cast<PHINode>(VMap[OrigPHI]);
+          Value *InVal = NewPHI->getIncomingValueForBlock(LatchBlock);
+          if (auto *InValI = dyn_cast<Instruction>(InVal))
+            if (It > 1 && L->contains(InValI))
+              InVal = LastValueMap[InValI];
+          VMap[OrigPHI] = InVal;
+          New->getInstList().erase(NewPHI);
+        }
+
+      LastValueMap[BB] = New;
+      for (ValueToValueMapTy::iterator VI = VMap.begin(), VE = VMap.end();
+           VI != VE; ++VI)
+        LastValueMap[VI->first] = VI->second;
+
+      addClonedBlockToLoopInfo(BB, New, LI, NewLoops);
+
+      if (BB == ForeBlocksFirst[0])
+        ForeBlocksFirst.push_back(New);
+      if (BB == ForeBlocksLast[0])
+        ForeBlocksLast.push_back(New);
+      if (BB == SubLoopBlocksFirst[0])
+        SubLoopBlocksFirst.push_back(New);
+      if (BB == SubLoopBlocksLast[0])
+        SubLoopBlocksLast.push_back(New);
+      if (BB == AftBlocksFirst[0])
+        AftBlocksFirst.push_back(New);
+      if (BB == AftBlocksLast[0])
+        AftBlocksLast.push_back(New);
+
+      NewBlocks.push_back(New);
+    }
+
+    for (BasicBlock *NewBlock : NewBlocks)
+      for (Instruction &I : *NewBlock)
+        remapInstruction(&I, LastValueMap);
+  }
+
+  // The outer loop is now left, and its header reached back, from the last
+  // copy of the latch, with the values of the last copy.
+  auto RemapToLastCopy = [&](PHINode &PN) {
+    int Idx = PN.getBasicBlockIndex(LatchBlock);
+    Value *InVal = PN.getIncomingValue(Idx);
+    if (auto *InValI = dyn_cast<Instruction>(InVal))
+      if (L->contains(InValI))
+        InVal = LastValueMap[InValI];
+    PN.setIncomingValue(Idx, InVal);
+    PN.setIncomingBlock(Idx, AftBlocksLast.back());
+  };
+  for (PHINode *PN : OrigPHINodes)
+    RemapToLastCopy(*PN);
+  for (PHINode &PN : LoopExit->phis())
+    RemapToLastCopy(PN);
+
+  // The subloop is entered from the last copy of the fore blocks and left
+  // from the last copy of its latch, where the PHIs of all copies now live.
+  for (unsigned It = 0; It != Count; ++It) {
+    updatePHIBlocks(SubLoopBlocksFirst[It], ForeBlocksLast[It],
+                    ForeBlocksLast.back());
+    updatePHIBlocks(SubLoopBlocksFirst[It], SubLoopBlocksLast[It],
+                    SubLoopBlocksLast.back());
+    updatePHIBlocks(AftBlocksFirst[It], SubLoopBlocksLast[It],
+                    SubLoopBlocksLast.back());
+    if (It > 0) {
+      movePHIs(SubLoopBlocksFirst[It], SubLoopBlocksFirst[0]);
+      movePHIs(AftBlocksFirst[It], AftBlocksFirst[0]);
+    }
+  }
+
+  // Stitch the copies together.
+  for (unsigned It = 0; It != Count; ++It) {
+    bool IsLast = It + 1 == Count;
+    auto *ForeTerm = cast<BranchInst>(ForeBlocksLast[It]->getTerminator());
+    ForeTerm->setSuccessor(0, IsLast ? SubLoopBlocksFirst[0]
+                                     : ForeBlocksFirst[It + 1]);
+    if (!IsLast) {
+      replaceWithUnconditionalBranch(SubLoopBlocksLast[It],
+                                     SubLoopBlocksFirst[It + 1]);
+      replaceWithUnconditionalBranch(AftBlocksLast[It], AftBlocksFirst[It + 1]);
+      continue;
+    }
+    auto *SubTerm = cast<BranchInst>(SubLoopBlocksLast[It]->getTerminator());
+    SubTerm->setSuccessor(!SubLoopContinueOnTrue, SubLoopBlocksFirst[0]);
+    SubTerm->setSuccessor(SubLoopContinueOnTrue, AftBlocksFirst[0]);
+    auto *AftTerm = cast<BranchInst>(AftBlocksLast[It]->getTerminator());
+    AftTerm->setSuccessor(!ContinueOnTrue, ForeBlocksFirst[0]);
+    AftTerm->setSuccessor(ContinueOnTrue, LoopExit);
+  }
+
+  DT->recalculate(*Header->getParent());
+
+  // Merge the blocks that now follow each other.
+  SmallPtrSet<Loop *, 4> ForgottenLoops;
+  ForgottenLoops.insert(L);
+  ForgottenLoops.insert(SubLoop);
+  DomTreeUpdater DTU(DT, nullptr, DomTreeUpdater::UpdateStrategy::Lazy);
+  for (unsigned It = 1; It != Count; ++It)
+    for (BasicBlock *BB : {ForeBlocksFirst[It], SubLoopBlocksFirst[It],
+                           AftBlocksFirst[It]})
+      foldBlockIntoPredecessor(BB, LI, SE, ForgottenLoops, &DTU);
+  DTU.flush();
+
+  // Clean up the copies, whose header PHIs often became constants.
+  const DataLayout &DL = Header->getModule()->getDataLayout();
+  for (BasicBlock *BB : L->blocks())
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E;) {
+      Instruction *Inst = &*I++;
+      if (Value *V = SimplifyInstruction(Inst, {DL, nullptr, DT, AC}))
+        if (LI->replacementPreservesLCSSAForm(Inst, V))
+          Inst->replaceAllUsesWith(V);
+      if (isInstructionTriviallyDead(Inst))
+        BB->getInstList().erase(Inst);
+    }
+
+  assert(L->isLoopSimplifyForm() && SubLoop->isLoopSimplifyForm() &&
+         "Loops should be in simplified form after unroll-and-jam");
+  assert(L->isLCSSAForm(*DT) &&
+         "Loops should be in LCSSA form after unroll-and-jam");
+
+  ++NumUnrolledAndJammed;
+  return LoopUnrollResult::PartiallyUnrolled;
+}
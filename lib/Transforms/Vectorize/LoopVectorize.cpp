@@ -144,6 +144,7 @@ using namespace llvm;
 
 STATISTIC(LoopsVectorized, "Number of loops vectorized");
 STATISTIC(LoopsAnalyzed, "Number of loops analyzed for vectorization");
+STATISTIC(LoopsEpilogueVectorized, "Number of epilogue loops vectorized");
 
 static cl::opt<bool>
     EnableIfConversion("enable-if-conversion", cl::init(true), cl::Hidden,
@@ -157,6 +158,18 @@ static cl::opt<unsigned> TinyTripCountVectorThreshold(
              "value are vectorized only if no scalar iteration overheads "
              "are incurred."));
 
+static cl::opt<bool> EnableEpilogueVectorization(
+    "enable-epilogue-vectorization", cl::init(false), cl::Hidden,
+    cl::desc("Vectorize the scalar remainder of a vectorized loop with a "
+             "smaller vectorization factor."));
+
+/// The remainder of a vector loop processing fewer elements than this per
+/// iteration is left scalar.
+static cl::opt<unsigned> EpilogueVectorizationMinVF(
+    "epilogue-vectorization-minimum-VF", cl::init(16), cl::Hidden,
+    cl::desc("Only vectorize the epilogue of loops whose vectorization "
+             "factor times interleave count is at least this value."));
+
 static cl::opt<bool> MaximizeBandwidth(
     "vectorizer-maximize-bandwidth", cl::init(false), cl::Hidden,
     cl::desc("Maximize bandwidth when selecting vectorization factor which "
@@ -252,6 +265,13 @@ static cl::opt<unsigned> PragmaVectorizeSCEVCheckThreshold(
     cl::desc("The maximum number of SCEV checks allowed with a "
              "vectorize(enable) pragma"));
 
+/// Outer loops explicitly marked for vectorization are vectorized along this
+/// path, which builds their VPlan directly from the loop nest.
+static cl::opt<bool> EnableVPlanNativePath(
+    "enable-vplan-native-path", cl::init(false), cl::Hidden,
+    cl::desc("Enable VPlan-native vectorization path with support for outer "
+             "loop vectorization."));
+
 /// Create an analysis remark that explains why vectorization failed
 ///
 /// \p PassName is the name of the pass (e.g. can be AlwaysPrint).  \p
@@ -727,6 +747,10 @@ protected:
   /// Store instructions that were predicated.
   SmallVector<Instruction *, 4> PredicatedInstructions;
 
+  /// Phis of an outer loop nest widened into vector phis, whose incoming
+  /// values are added once all blocks of the vector loop are generated.
+  SmallVector<PHINode *, 8> OrigPHIsToFix;
+
   /// Trip count of the original loop.
   Value *TripCount = nullptr;
 
@@ -1173,7 +1197,13 @@ private:
 /// for example 'force', means a decision has been made. So, we need to be
 /// careful NOT to add them if the user hasn't specifically asked so.
 class LoopVectorizeHints {
-  enum HintKind { HK_WIDTH, HK_UNROLL, HK_FORCE, HK_ISVECTORIZED };
+  enum HintKind {
+    HK_WIDTH,
+    HK_UNROLL,
+    HK_FORCE,
+    HK_ISVECTORIZED,
+    HK_PREDICATE
+  };
 
   /// Hint - associates name and validation with the hint value.
   struct Hint {
@@ -1193,6 +1223,7 @@ class LoopVectorizeHints {
       case HK_FORCE:
         return (Val <= 1);
       case HK_ISVECTORIZED:
+      case HK_PREDICATE:
         return (Val==0 || Val==1);
       }
       return false;
@@ -1211,6 +1242,9 @@ class LoopVectorizeHints {
   /// Already Vectorized
   Hint IsVectorized;
 
+  /// Fold the tail of the loop into the vector body by masking
+  Hint Predicate;
+
   /// Return the loop metadata prefix.
   static StringRef Prefix() { return "llvm.loop."; }
 
@@ -1230,7 +1264,9 @@ public:
               HK_WIDTH),
         Interleave("interleave.count", DisableInterleaving, HK_UNROLL),
         Force("vectorize.enable", FK_Undefined, HK_FORCE),
-        IsVectorized("isvectorized", 0, HK_ISVECTORIZED), TheLoop(L), ORE(ORE) {
+        IsVectorized("isvectorized", 0, HK_ISVECTORIZED),
+        Predicate("vectorize.predicate.enable", FK_Undefined, HK_PREDICATE),
+        TheLoop(L), ORE(ORE) {
     // Populate values with existing loop metadata.
     getHintsFromMetadata();
 
@@ -1319,6 +1355,7 @@ public:
   unsigned getInterleave() const { return Interleave.Value; }
   unsigned getIsVectorized() const { return IsVectorized.Value; }
   enum ForceKind getForce() const { return (ForceKind)Force.Value; }
+  enum ForceKind getPredicate() const { return (ForceKind)Predicate.Value; }
 
   /// \brief If hints are provided that force vectorization, use the AlwaysPrint
   /// pass name to force the frontend to print the diagnostic.
@@ -1401,7 +1438,8 @@ private:
       return;
     unsigned Val = C->getZExtValue();
 
-    Hint *Hints[] = {&Width, &Interleave, &Force, &IsVectorized};
+    Hint *Hints[] = {&Width, &Interleave, &Force, &IsVectorized,
+                     &Predicate};
     for (auto H : Hints) {
       if (Name == H->Name) {
         if (H->validate(Val))
@@ -1570,6 +1608,15 @@ public:
   /// to be vectorized.
   bool blockNeedsPredication(BasicBlock *BB);
 
+  /// Returns true if the remainder iterations can run in the vector loop by
+  /// masking all of its memory operations, and if so switches the loop to
+  /// that mode.
+  bool prepareToFoldTailByMasking();
+
+  /// Returns true if the loop tail is folded into the vector body by masking,
+  /// so that no scalar remainder loop is needed.
+  bool foldTailByMasking() const { return FoldTailByMasking; }
+
   /// Check if this pointer is consecutive when vectorizing. This happens
   /// when the last index of the GEP is the induction variable, or that the
   /// pointer itself is an induction variable.
@@ -1580,6 +1627,11 @@ public:
   /// -1 - Address is consecutive, and decreasing.
   int isConsecutivePtr(Value *Ptr);
 
+  /// Returns the distance, in elements, between the addresses \p Ptr points
+  /// to in consecutive iterations of an outer loop, with its inner loops at
+  /// the same iteration. Returns None if the distance is not a constant.
+  Optional<int64_t> getOuterLoopStride(Value *Ptr);
+
   /// Returns true if the value V is uniform within the loop.
   bool isUniform(Value *V);
 
@@ -1612,7 +1664,7 @@ public:
 	  return LAI->getDepChecker().getMaxSafeRegisterWidth();
   }
 
-  bool hasStride(Value *V) { return LAI->hasStride(V); }
+  bool hasStride(Value *V) { return LAI && LAI->hasStride(V); }
 
   /// Returns true if the target machine supports masked store operation
   /// for the given \p DataType and kind of access to \p Ptr.
@@ -1686,6 +1738,21 @@ private:
   /// transformation.
   bool canVectorizeWithIfConvert();
 
+  /// Return true if this outer loop can be vectorized along the VPlan-native
+  /// path: its control flow must be uniform across its iterations, and its
+  /// header phis must be integer inductions. Memory dependences are not
+  /// checked, the explicit vectorization hint asserts their absence.
+  bool canVectorizeOuterLoop();
+
+  /// Return the difference between the values of \p S in consecutive
+  /// iterations of the outer loop, with its inner loops at the same iteration,
+  /// or null if it is unknown.
+  const SCEV *getOuterLoopStep(const SCEV *S);
+
+  /// Return true if \p V has the same value in consecutive iterations of the
+  /// outer loop, with its inner loops at the same iteration.
+  bool isUniformInOuterLoop(Value *V);
+
   /// Return true if all of the instructions in the block can be speculatively
   /// executed. \p SafePtrs is a list of addresses that are known to be legal
   /// and we know that we can read from them without segfault.
@@ -1794,6 +1861,10 @@ private:
   /// While vectorizing these instructions we have to generate a
   /// call to the appropriate masked intrinsic
   SmallPtrSet<const Instruction *, 8> MaskedOp;
+
+  /// All blocks of the loop, including the header, are predicated on the
+  /// induction variable being within the trip count.
+  bool FoldTailByMasking = false;
 };
 
 /// LoopVectorizationCostModel - estimates the expected speedups due to
@@ -1840,6 +1911,11 @@ public:
     collectInstsToScalarize(UserVF);
   }
 
+  /// Setup the decisions for vectorizing an outer loop by \p VF along the
+  /// VPlan-native path, where the memory accesses are the only instructions
+  /// that are not simply widened.
+  void setupOuterLoopDecisions(unsigned VF);
+
   /// \return The size (in bits) of the smallest and widest types in the code
   /// that needs to be vectorized. We ignore values that remain scalar such as
   /// 64 bit loop indices.
@@ -2248,6 +2324,10 @@ class LoopVectorizationPlanner {
   unsigned BestVF = 0;
   unsigned BestUF = 0;
 
+  /// Map from the basic blocks of an outer loop to the VPBasicBlocks modelling
+  /// them, when vectorizing along the VPlan-native path.
+  DenseMap<BasicBlock *, VPBasicBlock *> BB2VPBB;
+
 public:
   LoopVectorizationPlanner(Loop *L, LoopInfo *LI, const TargetLibraryInfo *TLI,
                            const TargetTransformInfo *TTI,
@@ -2255,9 +2335,14 @@ public:
                            LoopVectorizationCostModel &CM)
       : OrigLoop(L), LI(LI), TLI(TLI), TTI(TTI), Legal(Legal), CM(CM) {}
 
-  /// Plan how to best vectorize, return the best VF and its cost.
-  LoopVectorizationCostModel::VectorizationFactor plan(bool OptForSize,
-                                                       unsigned UserVF);
+  /// Plan how to best vectorize, return the best VF and its cost. If
+  /// \p MaxVFLimit is non-zero, no VF larger than it is considered.
+  LoopVectorizationCostModel::VectorizationFactor
+  plan(bool OptForSize, unsigned UserVF, unsigned MaxVFLimit = 0);
+
+  /// Plan how to vectorize an outer loop by \p VF along the VPlan-native path,
+  /// keeping the control flow of its inner loops.
+  void planInVPlanNativePath(unsigned VF);
 
   /// Finalize the best decision and dispose of all other VPlans.
   void setBestPlan(unsigned VF, unsigned UF);
@@ -2367,6 +2452,16 @@ private:
   /// exclusive, possibly decreasing \p Range.End.
   VPlanPtr buildVPlan(VFRange &Range,
                                     const SmallPtrSetImpl<Value *> &NeedDef);
+
+  /// Build a VPlan for vectorizing an outer loop by \p VF, with a
+  /// VPBasicBlock per basic block of the loop. Branches are kept, using the
+  /// first lane of their uniform conditions.
+  VPlanPtr buildVPlanForOuterLoop(unsigned VF);
+
+  /// Complete the vector code of an outer loop once all its blocks are
+  /// generated: add the incoming values of its widened phis and register
+  /// its inner loops in LoopInfo.
+  void fixOuterLoopNest(InnerLoopVectorizer &ILV, VPTransformState &State);
 };
 
 } // end namespace llvm
@@ -2443,14 +2538,72 @@ private:
 
 } // end anonymous namespace
 
-static void addAcyclicInnerLoop(Loop &L, SmallVectorImpl<Loop *> &V) {
+/// Returns true if every cycle in the body of \p L, excluding the loop itself,
+/// is formed by one of the loops nested in \p L, recursively.
+static bool isReducibleLoopNest(const Loop &L) {
+  for (const auto &SCC :
+       make_range(scc_iterator<Loop, LoopBodyTraits>::begin(L),
+                  scc_iterator<Loop, LoopBodyTraits>::end(L))) {
+    // Edges to the header of L are not part of the body, so a single block
+    // is a cycle only if it branches to itself and is not that header.
+    BasicBlock *BB = SCC.front().second;
+    if (SCC.size() == 1 &&
+        (BB == L.getHeader() || !is_contained(successors(BB), BB)))
+      continue;
+    if (none_of(L, [&](const Loop *InnerL) {
+          return InnerL->contains(BB) && InnerL->getNumBlocks() == SCC.size();
+        })) {
+      DEBUG(dbgs() << "LVL: Detected an irreducible cycle in the loop nest:\n");
+      DEBUG(L.dump());
+      return false;
+    }
+  }
+  return all_of(L, [](const Loop *InnerL) {
+    return isReducibleLoopNest(*InnerL);
+  });
+}
+
+/// Returns true if \p L is an outer loop explicitly marked for vectorization,
+/// which is required to vectorize it along the VPlan-native path. The legality
+/// of such loops is not analyzed for memory dependences.
+static bool isExplicitVecOuterLoop(Loop *L, OptimizationRemarkEmitter *ORE) {
+  assert(!L->empty() && "This is not an outer loop");
+  LoopVectorizeHints Hints(L, true /*DisableInterleaving*/, *ORE);
+
+  // Only outer loops with an explicit vectorization hint are supported.
+  // Unrolling is not supported.
+  if (Hints.getForce() != LoopVectorizeHints::FK_Enabled) {
+    DEBUG(dbgs() << "LV: Not vectorizing outer loop: No user vectorization "
+                    "hint.\n");
+    return false;
+  }
+
+  if (Hints.getInterleave() > 1) {
+    DEBUG(dbgs() << "LV: Not vectorizing outer loop: Interleave is not "
+                    "supported.\n");
+    return false;
+  }
+
+  return true;
+}
+
+static void collectSupportedLoops(Loop &L, OptimizationRemarkEmitter *ORE,
+                                  SmallVectorImpl<Loop *> &V) {
+  // Collect inner loops and outer loops without irreducible control flow. For
+  // now, only collect outer loops that have explicit vectorization hints.
   if (L.empty()) {
     if (!hasCyclesInLoopBody(L))
       V.push_back(&L);
     return;
   }
+  if (EnableVPlanNativePath && isReducibleLoopNest(L) &&
+      isExplicitVecOuterLoop(&L, ORE)) {
+    V.push_back(&L);
+    // Loops nested in a vectorized outer loop are left as they are.
+    return;
+  }
   for (Loop *InnerL : L)
-    addAcyclicInnerLoop(*InnerL, V);
+    collectSupportedLoops(*InnerL, ORE, V);
 }
 
 namespace {
@@ -2520,8 +2673,11 @@ struct LoopVectorize : public FunctionPass {
 
 Value *InnerLoopVectorizer::getBroadcastInstrs(Value *V) {
   // We need to place the broadcast of invariant variables outside the loop.
+  // The vector loop may span several basic blocks, e.g. the inner loops of a
+  // vectorized outer loop, all of which hold new instructions.
   Instruction *Instr = dyn_cast<Instruction>(V);
-  bool NewInstr = (Instr && Instr->getParent() == LoopVectorBody);
+  bool NewInstr =
+      (Instr && LI->getLoopFor(LoopVectorBody)->contains(Instr->getParent()));
   bool Invariant = OrigLoop->isLoopInvariant(V) && !NewInstr;
 
   // Place the code for broadcasting invariant variables in the new preheader.
@@ -2812,6 +2968,13 @@ void InnerLoopVectorizer::buildScalarSteps(Value *ScalarIV, Value *Step,
 }
 
 int LoopVectorizationLegality::isConsecutivePtr(Value *Ptr) {
+  if (!TheLoop->empty()) {
+    Optional<int64_t> Stride = getOuterLoopStride(Ptr);
+    if (Stride && (*Stride == 1 || *Stride == -1))
+      return *Stride;
+    return 0;
+  }
+
   const ValueToValueMap &Strides = getSymbolicStrides() ? *getSymbolicStrides() :
     ValueToValueMap();
 
@@ -2822,7 +2985,90 @@ int LoopVectorizationLegality::isConsecutivePtr(Value *Ptr) {
 }
 
 bool LoopVectorizationLegality::isUniform(Value *V) {
-  return LAI->isUniform(V);
+  // Outer loops are not analyzed by LoopAccessAnalysis.
+  return LAI && LAI->isUniform(V);
+}
+
+const SCEV *LoopVectorizationLegality::getOuterLoopStep(const SCEV *S) {
+  ScalarEvolution *SE = PSE.getSE();
+  if (SE->isLoopInvariant(S, TheLoop))
+    return SE->getZero(S->getType());
+
+  if (auto *AR = dyn_cast<SCEVAddRecExpr>(S)) {
+    if (!AR->isAffine())
+      return nullptr;
+    // Recurrences of inner loops advance in lockstep across the outer loop
+    // iterations, as long as their step does not depend on them.
+    const SCEV *Step = AR->getStepRecurrence(*SE);
+    if (!SE->isLoopInvariant(Step, TheLoop))
+      return nullptr;
+    if (AR->getLoop() == TheLoop)
+      return Step;
+    return getOuterLoopStep(AR->getStart());
+  }
+
+  if (auto *Add = dyn_cast<SCEVAddExpr>(S)) {
+    const SCEV *Step = SE->getZero(S->getType());
+    for (const SCEV *Op : Add->operands()) {
+      const SCEV *OpStep = getOuterLoopStep(Op);
+      if (!OpStep)
+        return nullptr;
+      Step = SE->getAddExpr(Step, OpStep);
+    }
+    return Step;
+  }
+
+  if (auto *Mul = dyn_cast<SCEVMulExpr>(S)) {
+    // Only a product with a single varying operand has a constant step.
+    const SCEV *Step = nullptr;
+    SmallVector<const SCEV *, 4> Factors;
+    for (const SCEV *Op : Mul->operands()) {
+      if (SE->isLoopInvariant(Op, TheLoop)) {
+        Factors.push_back(Op);
+        continue;
+      }
+      if (Step)
+        return nullptr;
+      Step = getOuterLoopStep(Op);
+      if (!Step)
+        return nullptr;
+    }
+    assert(Step && "Expected a varying operand.");
+    Factors.push_back(Step);
+    return SE->getMulExpr(Factors);
+  }
+
+  return nullptr;
+}
+
+bool LoopVectorizationLegality::isUniformInOuterLoop(Value *V) {
+  if (TheLoop->isLoopInvariant(V))
+    return true;
+  // Comparisons of uniform values are uniform.
+  if (auto *Cmp = dyn_cast<CmpInst>(V))
+    return isUniformInOuterLoop(Cmp->getOperand(0)) &&
+           isUniformInOuterLoop(Cmp->getOperand(1));
+  ScalarEvolution *SE = PSE.getSE();
+  if (!SE->isSCEVable(V->getType()))
+    return false;
+  const SCEV *Step = getOuterLoopStep(SE->getSCEV(V));
+  return Step && Step->isZero();
+}
+
+Optional<int64_t> LoopVectorizationLegality::getOuterLoopStride(Value *Ptr) {
+  ScalarEvolution *SE = PSE.getSE();
+  auto *Step =
+      dyn_cast_or_null<SCEVConstant>(getOuterLoopStep(SE->getSCEV(Ptr)));
+  if (!Step)
+    return None;
+
+  const DataLayout &DL = TheLoop->getHeader()->getModule()->getDataLayout();
+  Type *EltTy = cast<PointerType>(Ptr->getType())->getElementType();
+  int64_t Size = DL.getTypeAllocSize(EltTy);
+  int64_t Distance = Step->getAPInt().getSExtValue();
+  if (!Size || Distance % Size)
+    return None;
+  return Distance / Size;
 }
 
 Value *InnerLoopVectorizer::getOrCreateVectorValue(Value *V, unsigned Part) {
@@ -3384,6 +3630,21 @@ Value *InnerLoopVectorizer::getOrCreateVectorTripCount(Loop *L) {
   // is equal to the vectorization factor (number of SIMD elements) times the
   // unroll factor (number of SIMD instructions).
   Constant *Step = ConstantInt::get(TC->getType(), VF * UF);
+
+  // If the tail is to be folded by masking, round the number of iterations N
+  // up to a multiple of Step instead of rounding down. This is done by first
+  // adding Step-1 and then rounding down. Note that it's ok if this addition
+  // overflows: the vector induction variable will eventually wrap to zero
+  // given that it starts at zero and its Step is a power of two; the loop will
+  // then exit, with the last early-exit vector comparison also producing all-
+  // true.
+  if (Legal->foldTailByMasking()) {
+    assert(isPowerOf2_32(VF * UF) &&
+           "VF*UF must be a power of 2 when folding tail by masking");
+    TC = Builder.CreateAdd(TC, ConstantInt::get(TC->getType(), VF * UF - 1),
+                           "n.rnd.up");
+  }
+
   Value *R = Builder.CreateURem(TC, Step, "n.mod.vf");
 
   // If there is a non-reversed interleaved group that may speculatively access
@@ -3444,10 +3705,15 @@ void InnerLoopVectorizer::emitMinimumIterationCountCheck(Loop *L,
   // vector trip count is zero. This check also covers the case where adding one
   // to the backedge-taken count overflowed leading to an incorrect trip count
   // of zero. In this case we will also jump to the scalar loop.
+  // If the tail is folded by masking, the vector loop handles any trip count
+  // and the check is not needed.
   auto P = Legal->requiresScalarEpilogue() ? ICmpInst::ICMP_ULE
                                            : ICmpInst::ICMP_ULT;
-  Value *CheckMinIters = Builder.CreateICmp(
-      P, Count, ConstantInt::get(Count->getType(), VF * UF), "min.iters.check");
+  Value *CheckMinIters = Builder.getFalse();
+  if (!Legal->foldTailByMasking())
+    CheckMinIters = Builder.CreateICmp(
+        P, Count, ConstantInt::get(Count->getType(), VF * UF),
+        "min.iters.check");
 
   BasicBlock *NewBB = BB->splitBasicBlock(BB->getTerminator(), "vector.ph");
   // Update dominator tree immediately if the generated block is a
@@ -3492,6 +3758,11 @@ void InnerLoopVectorizer::emitSCEVChecks(Loop *L, BasicBlock *Bypass) {
 }
 
 void InnerLoopVectorizer::emitMemRuntimeChecks(Loop *L, BasicBlock *Bypass) {
+  // Outer loops are vectorized on the strength of an explicit hint, without
+  // memory dependence analysis.
+  if (!OrigLoop->empty())
+    return;
+
   BasicBlock *BB = L->getLoopPreheader();
 
   // Generate the code that checks in runtime if arrays overlap. We put the
@@ -3682,9 +3953,12 @@ BasicBlock *InnerLoopVectorizer::createVectorizedLoopSkeleton() {
   // Add a check in the middle block to see if we have completed
   // all of the iterations in the first vector loop.
   // If (N - N%VF) == N, then we *don't* need to run the remainder.
-  Value *CmpN =
-      CmpInst::Create(Instruction::ICmp, CmpInst::ICMP_EQ, Count,
-                      CountRoundDown, "cmp.n", MiddleBlock->getTerminator());
+  // If tail is to be folded, we know we don't need to run the remainder.
+  Value *CmpN = ConstantInt::getTrue(Count->getContext());
+  if (!Legal->foldTailByMasking())
+    CmpN = CmpInst::Create(Instruction::ICmp, CmpInst::ICMP_EQ, Count,
+                           CountRoundDown, "cmp.n",
+                           MiddleBlock->getTerminator());
   ReplaceInstWithInst(MiddleBlock->getTerminator(),
                       BranchInst::Create(ExitBlock, ScalarPH, CmpN));
 
@@ -4542,10 +4816,23 @@ void InnerLoopVectorizer::sinkScalarOperands(Instruction *PredInst) {
 
 void InnerLoopVectorizer::widenPHIInstruction(Instruction *PN, unsigned UF,
                                               unsigned VF) {
+  PHINode *P = cast<PHINode>(PN);
+  // Control flow inside an outer loop nest is uniform and kept as is, so its
+  // phis are simply widened. Their incoming values are added once all the
+  // blocks are generated.
+  if (!OrigLoop->empty()) {
+    assert(UF == 1 && "Outer loops are not interleaved.");
+    Type *VecTy = (VF == 1) ? PN->getType() : VectorType::get(PN->getType(), VF);
+    PHINode *VecPhi = Builder.CreatePHI(VecTy, P->getNumIncomingValues(),
+                                        "vec.phi");
+    VectorLoopValueMap.setVectorValue(P, 0, VecPhi);
+    OrigPHIsToFix.push_back(P);
+    return;
+  }
+
   assert(PN->getParent() == OrigLoop->getHeader() &&
          "Non-header phis should have been handled elsewhere");
 
-  PHINode *P = cast<PHINode>(PN);
   // In order to support recurrences we need to be able to vectorize Phi nodes.
   // Phi nodes have cycles, so we need to vectorize them in two stages. This is
   // stage #1: We create a new vector PHI node with no incoming edges. We'll use
@@ -4997,11 +5284,9 @@ bool LoopVectorizationLegality::canVectorize() {
       return false;
   }
 
-  // FIXME: The code is currently dead, since the loop gets sent to
-  // LoopVectorizationLegality is already an innermost loop.
-  //
-  // We can only vectorize innermost loops.
-  if (!TheLoop->empty()) {
+  // We can only vectorize innermost loops, unless the VPlan-native path is
+  // enabled.
+  if (!TheLoop->empty() && !EnableVPlanNativePath) {
     ORE->emit(createMissedAnalysis("NotInnermostLoop")
               << "loop is not the innermost loop");
     if (DoExtraAnalysis)
@@ -5046,6 +5331,15 @@ bool LoopVectorizationLegality::canVectorize() {
   DEBUG(dbgs() << "LV: Found a loop: " << TheLoop->getHeader()->getName()
                << '\n');
 
+  // Outer loops have their own checks, the ones below are for inner loops.
+  if (!TheLoop->empty()) {
+    if (!canVectorizeOuterLoop()) {
+      DEBUG(dbgs() << "LV: Can't vectorize the outer loop.\n");
+      Result = false;
+    }
+    return Result;
+  }
+
   // Check if we can if-convert non-single-bb loops.
   unsigned NumBlocks = TheLoop->getNumBlocks();
   if (NumBlocks != 1 && !canVectorizeWithIfConvert()) {
@@ -5112,6 +5406,147 @@ bool LoopVectorizationLegality::canVectorize() {
   return Result;
 }
 
+bool LoopVectorizationLegality::canVectorizeOuterLoop() {
+  assert(!TheLoop->empty() && "Not an outer loop.");
+  // Store the result and return it at the end instead of exiting early, in case
+  // allowExtraAnalysis is used to report multiple reasons for not vectorizing.
+  bool Result = true;
+  bool DoExtraAnalysis = ORE->allowExtraAnalysis(DEBUG_TYPE);
+
+  // The vector code branches on the first lane of each condition, so all
+  // branches must be uniform across the iterations of the outer loop. This
+  // also makes the trip counts of the inner loops uniform. The branch of the
+  // outer latch is replaced by the one of the vector loop.
+  for (BasicBlock *BB : TheLoop->blocks()) {
+    auto *Br = dyn_cast<BranchInst>(BB->getTerminator());
+    if (!Br || (Br->isConditional() && BB != TheLoop->getLoopLatch() &&
+                !isUniformInOuterLoop(Br->getCondition()))) {
+      ORE->emit(createMissedAnalysis("NonUniformBranch", BB->getTerminator())
+                << "outer loop contains control flow that varies across its "
+                   "iterations");
+      if (DoExtraAnalysis)
+        Result = false;
+      else
+        return false;
+    }
+  }
+
+  // The control flow of the inner loops is kept in the vector loop, so they
+  // need to be bottom-tested with a single exit as well.
+  SmallVector<Loop *, 4> InnerLoops(TheLoop->begin(), TheLoop->end());
+  while (!InnerLoops.empty()) {
+    Loop *L = InnerLoops.pop_back_val();
+    InnerLoops.append(L->begin(), L->end());
+    if (!L->getLoopPreheader() || !L->getLoopLatch() || !L->getExitBlock() ||
+        L->getExitingBlock() != L->getLoopLatch() ||
+        L->contains(TheLoop->getLoopLatch())) {
+      ORE->emit(createMissedAnalysis("CFGNotUnderstood")
+                << "loop control flow is not understood by vectorizer");
+      if (DoExtraAnalysis)
+        Result = false;
+      else
+        return false;
+    }
+  }
+
+  ScalarEvolution *SE = PSE.getSE();
+  if (isa<SCEVCouldNotCompute>(PSE.getBackedgeTakenCount())) {
+    ORE->emit(createMissedAnalysis("CantComputeNumberOfIterations")
+              << "could not determine number of loop iterations");
+    if (DoExtraAnalysis)
+      Result = false;
+    else
+      return false;
+  }
+
+  for (BasicBlock *BB : TheLoop->blocks()) {
+    for (Instruction &I : *BB) {
+      if (auto *Phi = dyn_cast<PHINode>(&I)) {
+        // Header phis must be integer inductions, which are widened like
+        // those of inner loops.
+        if (BB == TheLoop->getHeader()) {
+          InductionDescriptor ID;
+          if (InductionDescriptor::isInductionPHI(Phi, TheLoop, PSE, ID) &&
+              ID.getKind() == InductionDescriptor::IK_IntInduction) {
+            addInductionPhi(Phi, ID, AllowedExit);
+            continue;
+          }
+          ORE->emit(createMissedAnalysis("NonInductionPHI", Phi)
+                    << "outer loop header phi is not an integer induction");
+          if (DoExtraAnalysis)
+            Result = false;
+          else
+            return false;
+          continue;
+        }
+        // Other phis are widened into vector phis, which need a block of
+        // their own in the vector code.
+        BasicBlock *Pred = BB->getSinglePredecessor();
+        if (Pred && Pred->getSingleSuccessor()) {
+          ORE->emit(createMissedAnalysis("CFGNotUnderstood", Phi)
+                    << "loop control flow is not understood by vectorizer");
+          if (DoExtraAnalysis)
+            Result = false;
+          else
+            return false;
+        }
+        continue;
+      }
+
+      // Calls are widened into vector intrinsics.
+      if (auto *CI = dyn_cast<CallInst>(&I)) {
+        Intrinsic::ID ID = getVectorIntrinsicIDForCall(CI, TLI);
+        if (!isa<DbgInfoIntrinsic>(CI) &&
+            (!ID || (hasVectorInstrinsicScalarOpd(ID, 1) &&
+                     !SE->isLoopInvariant(SE->getSCEV(CI->getOperand(1)),
+                                          TheLoop)))) {
+          ORE->emit(createMissedAnalysis("CantVectorizeCall", CI)
+                    << "call instruction cannot be vectorized");
+          if (DoExtraAnalysis)
+            Result = false;
+          else
+            return false;
+        }
+        continue;
+      }
+
+      bool IsSupported = isa<BinaryOperator>(I) || isa<CmpInst>(I) ||
+                         isa<CastInst>(I) || isa<SelectInst>(I) ||
+                         isa<GetElementPtrInst>(I) || isa<BranchInst>(I);
+      if (auto *Ld = dyn_cast<LoadInst>(&I))
+        IsSupported = Ld->isSimple();
+      if (auto *St = dyn_cast<StoreInst>(&I))
+        IsSupported = St->isSimple() && VectorType::isValidElementType(
+                                            St->getValueOperand()->getType());
+      if (!IsSupported || (!I.getType()->isVoidTy() &&
+                           !VectorType::isValidElementType(I.getType()))) {
+        ORE->emit(createMissedAnalysis("CantVectorizeInstruction", &I)
+                  << "instruction cannot be vectorized");
+        if (DoExtraAnalysis)
+          Result = false;
+        else
+          return false;
+      }
+    }
+  }
+
+  // Values are not extracted from the vector loop.
+  for (BasicBlock *BB : TheLoop->blocks())
+    for (Instruction &I : *BB)
+      if (any_of(I.users(), [this](User *U) {
+            return !TheLoop->contains(cast<Instruction>(U));
+          })) {
+        ORE->emit(createMissedAnalysis("ValueUsedOutsideLoop", &I)
+                  << "value cannot be used outside the loop");
+        if (DoExtraAnalysis)
+          Result = false;
+        else
+          return false;
+      }
+
+  return Result;
+}
+
 static Type *convertPointerToIntegerType(const DataLayout &DL, Type *Ty) {
   if (Ty->isPointerTy())
     return DL.getIntPtrType(Ty);
@@ -5517,6 +5952,11 @@ void LoopVectorizationCostModel::collectLoopScalars(unsigned VF) {
     if (Induction.second.getKind() == InductionDescriptor::IK_PtrInduction)
       continue;
 
+    // If tail-folding is applied, the primary induction variable will be used
+    // to feed a vector compare.
+    if (Ind == Legal->getPrimaryInduction() && Legal->foldTailByMasking())
+      continue;
+
     // Determine if all users of the induction variable are scalar after
     // vectorization.
     auto ScalarInd = llvm::all_of(Ind->users(), [&](User *U) -> bool {
@@ -5591,6 +6031,33 @@ bool LoopVectorizationLegality::memoryInstructionCanBeWidened(Instruction *I,
   return true;
 }
 
+void LoopVectorizationCostModel::setupOuterLoopDecisions(unsigned VF) {
+  assert(!TheLoop->empty() && "Expected an outer loop.");
+  assert(VF >= 2 && "Expected VF >=2");
+
+  // Nothing is scalarized for its cost, only the loads that are uniform across
+  // the iterations of the outer loop remain scalar.
+  InstsToScalarize[VF];
+  auto &UniformInsts = Uniforms[VF];
+  auto &ScalarInsts = Scalars[VF];
+
+  for (BasicBlock *BB : TheLoop->blocks())
+    for (Instruction &I : *BB) {
+      Value *Ptr = getPointerOperand(&I);
+      if (!Ptr)
+        continue;
+      Optional<int64_t> Stride = Legal->getOuterLoopStride(Ptr);
+      if (isa<LoadInst>(I) && Stride && *Stride == 0) {
+        setWideningDecision(&I, VF, CM_Scalarize, 0);
+        UniformInsts.insert(&I);
+        ScalarInsts.insert(&I);
+      } else if (Stride && (*Stride == 1 || *Stride == -1))
+        setWideningDecision(&I, VF, CM_Widen, 0);
+      else
+        setWideningDecision(&I, VF, CM_GatherScatter, 0);
+    }
+}
+
 void LoopVectorizationCostModel::collectLoopUniforms(unsigned VF) {
   // We should not collect Uniforms more than once per VF. Right now,
   // this function is called from collectUniformsAndScalars(), which
@@ -5727,6 +6194,11 @@ void LoopVectorizationCostModel::collectLoopUniforms(unsigned VF) {
     auto *Ind = Induction.first;
     auto *IndUpdate = cast<Instruction>(Ind->getIncomingValueForBlock(Latch));
 
+    // If tail-folding is applied, the primary induction variable will be used
+    // to feed a vector compare.
+    if (Ind == Legal->getPrimaryInduction() && Legal->foldTailByMasking())
+      continue;
+
     // Determine if all users of the induction variable are uniform after
     // vectorization.
     auto UniformInd = llvm::all_of(Ind->users(), [&](User *U) -> bool {
@@ -5798,7 +6270,77 @@ bool LoopVectorizationLegality::isFirstOrderRecurrence(const PHINode *Phi) {
 }
 
 bool LoopVectorizationLegality::blockNeedsPredication(BasicBlock *BB) {
-  return LoopAccessInfo::blockNeedsPredication(BB, TheLoop, DT);
+  return FoldTailByMasking ||
+         LoopAccessInfo::blockNeedsPredication(BB, TheLoop, DT);
+}
+
+bool LoopVectorizationLegality::prepareToFoldTailByMasking() {
+  DEBUG(dbgs() << "LV: checking if tail can be folded by masking.\n");
+
+  // The mask compares the primary induction variable with the backedge-taken
+  // count.
+  if (!PrimaryInduction || PrimaryInduction->getType() != WidestIndTy) {
+    DEBUG(dbgs() << "LV: No primary induction, cannot fold tail by "
+                    "masking.\n");
+    return false;
+  }
+
+  // The masked-off lanes of the last iteration would contribute to the final
+  // value of a reduction or recurrence, so loops with them are not folded.
+  if (!Reductions.empty() || !FirstOrderRecurrences.empty()) {
+    ORE->emit(createMissedAnalysis("ReductionFoldTail")
+              << "loop with reductions or recurrences cannot fold its tail "
+                 "by masking");
+    DEBUG(dbgs() << "LV: Loop has reductions, cannot fold tail by "
+                    "masking.\n");
+    return false;
+  }
+
+  // A value used after the loop would have to be extracted from the last
+  // active lane rather than the last lane, so every user of the values that
+  // leave the loop must be inside it.
+  for (auto *AE : AllowedExit) {
+    for (User *U : AE->users()) {
+      Instruction *UI = cast<Instruction>(U);
+      if (TheLoop->contains(UI))
+        continue;
+      ORE->emit(createMissedAnalysis("LiveOutFoldTail", UI)
+                << "value used outside the loop prevents folding its tail "
+                   "by masking");
+      DEBUG(dbgs() << "LV: Cannot fold tail by masking, loop has an "
+                      "outside user for : " << *UI << '\n');
+      return false;
+    }
+  }
+
+  // Interleaved accesses would need masked interleaved loads and stores.
+  for (BasicBlock *BB : TheLoop->blocks())
+    for (Instruction &I : *BB)
+      if (isAccessInterleaved(&I)) {
+        DEBUG(dbgs() << "LV: Cannot fold tail by masking interleaved "
+                        "accesses.\n");
+        return false;
+      }
+
+  // Check and mark all blocks for predication, including those that
+  // ordinarily do not need predication such as the header block. The list of
+  // pointers that we can safely read and write to remains empty.
+  SmallPtrSet<const Instruction *, 8> SavedMaskedOp(MaskedOp.begin(),
+                                                    MaskedOp.end());
+  unsigned SavedNumPredStores = NumPredStores;
+  SmallPtrSet<Value *, 8> SafePointers;
+  for (BasicBlock *BB : TheLoop->blocks()) {
+    if (!blockCanBePredicated(BB, SafePointers)) {
+      MaskedOp = std::move(SavedMaskedOp);
+      NumPredStores = SavedNumPredStores;
+      DEBUG(dbgs() << "LV: Cannot fold tail by masking as required.\n");
+      return false;
+    }
+  }
+
+  DEBUG(dbgs() << "LV: can fold tail by masking.\n");
+  FoldTailByMasking = true;
+  return true;
 }
 
 bool LoopVectorizationLegality::blockCanBePredicated(
@@ -6180,8 +6722,18 @@ Optional<unsigned> LoopVectorizationCostModel::computeMaxVF(bool OptForSize) {
   }
 
   unsigned TC = PSE.getSE()->getSmallConstantTripCount(TheLoop);
-  if (!OptForSize) // Remaining checks deal with scalar loop when OptForSize.
-    return computeFeasibleMaxVF(OptForSize, TC);
+  if (!OptForSize) { // Remaining checks deal with scalar loop when OptForSize.
+    unsigned MaxVF = computeFeasibleMaxVF(OptForSize, TC);
+
+    // Fold the tail into the vector loop if a loop hint asks for it and the
+    // trip count is not known to be a multiple of the vectorization factor.
+    if (Hints->getPredicate() == LoopVectorizeHints::FK_Enabled &&
+        MaxVF > 1 && (TC == 0 || TC % MaxVF != 0) &&
+        !Legal->prepareToFoldTailByMasking())
+      DEBUG(dbgs() << "LV: Cannot fold tail by masking, a scalar remainder "
+                      "loop is used.\n");
+    return MaxVF;
+  }
 
   if (Legal->getRuntimePointerChecking()->Need) {
     ORE->emit(createMissedAnalysis("CantVersionLoopWithOptForSize")
@@ -6196,6 +6748,16 @@ Optional<unsigned> LoopVectorizationCostModel::computeMaxVF(bool OptForSize) {
   // If we optimize the program for size, avoid creating the tail loop.
   DEBUG(dbgs() << "LV: Found trip count: " << TC << '\n');
 
+  unsigned MaxVF = computeFeasibleMaxVF(OptForSize, TC);
+
+  // If we don't know the precise trip count, or if the trip count that we
+  // found modulo the vectorization factor is not zero, try to fold the tail
+  // by masking. The widest feasible VF is kept even if a smaller one would
+  // divide the trip count and need no mask.
+  if (MaxVF > 1 && (TC < 2 || TC % MaxVF != 0) &&
+      Legal->prepareToFoldTailByMasking())
+    return MaxVF;
+
   // If we don't know the precise trip count, don't try to vectorize.
   if (TC < 2) {
     ORE->emit(
@@ -6205,8 +6767,6 @@ Optional<unsigned> LoopVectorizationCostModel::computeMaxVF(bool OptForSize) {
     return None;
   }
 
-  unsigned MaxVF = computeFeasibleMaxVF(OptForSize, TC);
-
   if (TC % MaxVF != 0) {
     // If the trip count that we found modulo the vectorization factor is not
     // zero then we require a tail.
@@ -7496,7 +8056,8 @@ void LoopVectorizationCostModel::collectValuesToIgnore() {
 }
 
 LoopVectorizationCostModel::VectorizationFactor
-LoopVectorizationPlanner::plan(bool OptForSize, unsigned UserVF) {
+LoopVectorizationPlanner::plan(bool OptForSize, unsigned UserVF,
+                               unsigned MaxVFLimit) {
   // Width 1 means no vectorize, cost 0 means uncomputed cost.
   const LoopVectorizationCostModel::VectorizationFactor NoVectorization = {1U,
                                                                            0U};
@@ -7517,6 +8078,8 @@ LoopVectorizationPlanner::plan(bool OptForSize, unsigned UserVF) {
 
   unsigned MaxVF = MaybeMaxVF.getValue();
   assert(MaxVF != 0 && "MaxVF is zero.");
+  if (MaxVFLimit)
+    MaxVF = std::min(MaxVF, MaxVFLimit);
 
   for (unsigned VF = 1; VF <= MaxVF; VF *= 2) {
     // Collect Uniform and Scalar instructions after vectorization with VF.
@@ -7559,6 +8122,7 @@ void LoopVectorizationPlanner::executePlan(InnerLoopVectorizer &ILV,
                          DT,     ILV.Builder, ILV.VectorLoopValueMap,
                          &ILV,   CallbackILV};
   State.CFG.PrevBB = ILV.createVectorizedLoopSkeleton();
+  State.TripCount = ILV.getOrCreateTripCount(nullptr);
 
   //===------------------------------------------------===//
   //
@@ -7571,6 +8135,8 @@ void LoopVectorizationPlanner::executePlan(InnerLoopVectorizer &ILV,
   // 2. Copy and widen instructions from the old loop into the new loop.
   assert(VPlans.size() == 1 && "Not a single VPlan to execute.");
   VPlans.front()->execute(&State);
+  if (!OrigLoop->empty())
+    fixOuterLoopNest(ILV, State);
 
   // 3. Fix the vectorized code: take care of header phi's, live-outs,
   //    predication, updating analyses.
@@ -8075,6 +8641,11 @@ void LoopVectorizationPlanner::buildVPlans(unsigned MinVF, unsigned MaxVF) {
       NeedDef.insert(Branch->getCondition());
   }
 
+  // If the tail is to be folded by masking, the primary induction variable
+  // needs to be represented in VPlan for it to model early-exit masking.
+  if (Legal->foldTailByMasking())
+    NeedDef.insert(Legal->getPrimaryInduction());
+
   for (unsigned VF = MinVF; VF < MaxVF + 1;) {
     VFRange SubRange = {VF, MaxVF + 1};
     VPlans.push_back(buildVPlan(SubRange, NeedDef));
@@ -8127,9 +8698,17 @@ VPValue *LoopVectorizationPlanner::createBlockInMask(BasicBlock *BB,
   // load/store/gather/scatter. Initialize BlockMask to no-mask.
   VPValue *BlockMask = nullptr;
 
-  // Loop incoming mask is all-one.
-  if (OrigLoop->getHeader() == BB)
+  if (OrigLoop->getHeader() == BB) {
+    if (!Legal->foldTailByMasking())
+      return BlockMaskCache[BB] = BlockMask; // Loop incoming mask is all-one.
+
+    // Introduce the early-exit compare IV <= BTC to form header block mask.
+    // This is used instead of IV < TC because TC may wrap, unlike BTC.
+    VPValue *IV = Plan->getVPValue(Legal->getPrimaryInduction());
+    VPValue *BTC = Plan->getOrCreateBackedgeTakenCount();
+    BlockMask = Builder.createICmpULE(IV, BTC);
     return BlockMaskCache[BB] = BlockMask;
+  }
 
   // This is the block mask. We OR all incoming edges.
   for (auto *Predecessor : predecessors(BB)) {
@@ -8593,6 +9172,136 @@ LoopVectorizationPlanner::buildVPlan(VFRange &Range,
   return Plan;
 }
 
+void LoopVectorizationPlanner::planInVPlanNativePath(unsigned VF) {
+  assert(!OrigLoop->empty() && "Expected an outer loop.");
+  CM.setupOuterLoopDecisions(VF);
+  VPlans.push_back(buildVPlanForOuterLoop(VF));
+  DEBUG(printPlans(dbgs()));
+}
+
+LoopVectorizationPlanner::VPlanPtr
+LoopVectorizationPlanner::buildVPlanForOuterLoop(unsigned VF) {
+  SmallPtrSet<Instruction *, 4> DeadInstructions;
+  collectTriviallyDeadInstructions(DeadInstructions);
+
+  // Create the VPBasicBlocks in a topological order, enclosed in a single
+  // region from the header to the latch of the outer loop.
+  LoopBlocksDFS DFS(OrigLoop);
+  DFS.perform(LI);
+  BB2VPBB.clear();
+  for (BasicBlock *BB : make_range(DFS.beginRPO(), DFS.endRPO()))
+    BB2VPBB[BB] = new VPBasicBlock(BB->getName());
+  auto *TopRegion =
+      new VPRegionBlock(BB2VPBB[OrigLoop->getHeader()],
+                        BB2VPBB[OrigLoop->getLoopLatch()], "outer.loop");
+  auto Plan = llvm::make_unique<VPlan>(TopRegion);
+
+  for (BasicBlock *BB : make_range(DFS.beginRPO(), DFS.endRPO())) {
+    VPBasicBlock *VPBB = BB2VPBB[BB];
+    VPBB->setParent(TopRegion);
+
+    // Model the edges inside the loop, except for the backedge of the outer
+    // loop which is replaced by the one of the vector loop.
+    SmallVector<VPBlockBase *, 2> Succs;
+    for (BasicBlock *Succ : successors(BB))
+      if (Succ != OrigLoop->getHeader() && OrigLoop->contains(Succ))
+        Succs.push_back(BB2VPBB[Succ]);
+    if (Succs.size() == 1)
+      VPBB->setOneSuccessor(Succs[0]);
+    else if (Succs.size() == 2)
+      VPBB->setTwoSuccessors(
+          Succs[0], Succs[1],
+          Plan->getOrAddVPValue(
+              cast<BranchInst>(BB->getTerminator())->getCondition()));
+
+    for (Instruction &I : *BB) {
+      Instruction *Instr = &I;
+      if (isa<BranchInst>(Instr) || isa<DbgInfoIntrinsic>(Instr) ||
+          DeadInstructions.count(Instr))
+        continue;
+
+      // The phis of the outer loop header are its inductions. The other phis
+      // merge values along the uniform control flow, which is kept.
+      if (auto *Phi = dyn_cast<PHINode>(Instr)) {
+        if (BB == OrigLoop->getHeader())
+          VPBB->appendRecipe(new VPWidenIntOrFpInductionRecipe(Phi));
+        else
+          VPBB->appendRecipe(new VPWidenPHIRecipe(Phi));
+        continue;
+      }
+
+      if (isa<LoadInst>(Instr) || isa<StoreInst>(Instr)) {
+        if (CM.getWideningDecision(Instr, VF) ==
+            LoopVectorizationCostModel::CM_Scalarize)
+          VPBB->appendRecipe(new VPReplicateRecipe(Instr, true /*IsUniform*/));
+        else
+          VPBB->appendRecipe(
+              new VPWidenMemoryInstructionRecipe(*Instr, nullptr /*Mask*/));
+        continue;
+      }
+
+      if (!VPBB->empty()) {
+        auto *LastWidenRecipe = dyn_cast<VPWidenRecipe>(&VPBB->back());
+        if (LastWidenRecipe && LastWidenRecipe->appendInstruction(Instr))
+          continue;
+      }
+      VPBB->appendRecipe(new VPWidenRecipe(Instr));
+    }
+  }
+
+  Plan->addVF(VF);
+  Plan->setName("Outer loop VPlan for VF={" + Twine(VF) + "},UF=1");
+  return Plan;
+}
+
+void LoopVectorizationPlanner::fixOuterLoopNest(InnerLoopVectorizer &ILV,
+                                                VPTransformState &State) {
+  // Add the incoming values of the widened phis, from the generated copies of
+  // their incoming blocks.
+  for (PHINode *OrigPhi : ILV.OrigPHIsToFix) {
+    auto *VecPhi = cast<PHINode>(ILV.getOrCreateVectorValue(OrigPhi, 0));
+    for (unsigned I = 0, E = OrigPhi->getNumIncomingValues(); I != E; ++I) {
+      BasicBlock *NewPred =
+          State.CFG.VPBB2IRBB[BB2VPBB[OrigPhi->getIncomingBlock(I)]];
+      assert(NewPred && "Phi predecessor not generated.");
+      ILV.Builder.SetInsertPoint(NewPred->getTerminator());
+      VecPhi->addIncoming(
+          ILV.getOrCreateVectorValue(OrigPhi->getIncomingValue(I), 0), NewPred);
+    }
+  }
+
+  // Register the copies of the inner loops, whose blocks were all added to
+  // the vector loop. Consecutive VPBasicBlocks may share a basic block, but
+  // only within the same loop.
+  Loop *VectorLoop = LI->getLoopFor(State.CFG.VPBB2IRBB[BB2VPBB[
+      OrigLoop->getHeader()]]);
+  DenseMap<Loop *, Loop *> OrigToNewLoop;
+  OrigToNewLoop[OrigLoop] = VectorLoop;
+  SmallVector<Loop *, 8> InnerLoops;
+  SmallVector<Loop *, 8> Worklist(OrigLoop->rbegin(), OrigLoop->rend());
+  while (!Worklist.empty()) {
+    Loop *OrigL = Worklist.pop_back_val();
+    Loop *NewL = LI->AllocateLoop();
+    OrigToNewLoop[OrigL->getParentLoop()]->addChildLoop(NewL);
+    OrigToNewLoop[OrigL] = NewL;
+    InnerLoops.push_back(OrigL);
+    Worklist.append(OrigL->rbegin(), OrigL->rend());
+  }
+  for (Loop *OrigL : InnerLoops) {
+    Loop *NewL = OrigToNewLoop[OrigL];
+    SmallPtrSet<BasicBlock *, 8> Added;
+    // The header comes first in the blocks of a loop.
+    for (BasicBlock *BB : OrigL->blocks()) {
+      BasicBlock *NewBB = State.CFG.VPBB2IRBB[BB2VPBB[BB]];
+      if (!Added.insert(NewBB).second)
+        continue;
+      NewL->addBlockEntry(NewBB);
+      if (LI->getLoopFor(BB) == OrigL)
+        LI->changeLoopFor(NewBB, NewL);
+    }
+  }
+}
+
 void VPInterleaveRecipe::print(raw_ostream &O, const Twine &Indent) const {
   O << " +\n"
     << Indent << "\"INTERLEAVE-GROUP with factor " << IG->getFactor() << " at ";
@@ -8687,8 +9396,80 @@ void VPPredInstPHIRecipe::execute(VPTransformState &State) {
   }
 }
 
+/// Return the largest vectorization factor worth considering for the scalar
+/// remainder of a loop vectorized with \p VF and interleaved \p IC times, or
+/// 0 if the remainder is too short to be vectorized.
+static unsigned getMaxEpilogueVF(unsigned VF, unsigned IC,
+                                 unsigned ConstTripCount,
+                                 bool RequiresScalarEpilogue) {
+  unsigned MainStep = VF * IC;
+  if (MainStep < EpilogueVectorizationMinVF)
+    return 0;
+
+  // The remainder runs fewer than MainStep iterations (at most MainStep if a
+  // scalar epilogue is required), so an epilogue VF of at least half of it is
+  // used for about half of the remainder iterations.
+  unsigned MaxVF = MainStep / 2;
+  if (ConstTripCount) {
+    unsigned Remainder = ConstTripCount % MainStep;
+    if (Remainder == 0 && RequiresScalarEpilogue)
+      Remainder = MainStep;
+    MaxVF = std::min(MaxVF, (unsigned)PowerOf2Floor(Remainder));
+  }
+  return MaxVF > 1 ? MaxVF : 0;
+}
+
+/// Vectorize the outer loop \p L along the VPlan-native path, by the width of
+/// its hint or else by the number of its widest elements that fit a vector
+/// register. The loop is not interleaved.
+static bool processLoopInVPlanNativePath(
+    Loop *L, PredicatedScalarEvolution &PSE, LoopInfo *LI, DominatorTree *DT,
+    LoopVectorizationLegality *LVL, TargetTransformInfo *TTI,
+    TargetLibraryInfo *TLI, DemandedBits *DB, AssumptionCache *AC,
+    OptimizationRemarkEmitter *ORE, LoopVectorizeHints &Hints) {
+  assert(EnableVPlanNativePath && "VPlan-native path is disabled.");
+  Function *F = L->getHeader()->getParent();
+
+  LoopVectorizationCostModel CM(L, PSE, LI, LVL, *TTI, TLI, DB, AC, ORE, F,
+                                &Hints);
+  CM.collectValuesToIgnore();
+
+  unsigned VF = Hints.getWidth();
+  if (!VF) {
+    unsigned WidestType = CM.getSmallestAndWidestTypes().second;
+    VF = PowerOf2Floor(TTI->getRegisterBitWidth(true) / WidestType);
+  }
+  if (VF < 2) {
+    DEBUG(dbgs() << "LV: Not vectorizing outer loop: No vector registers.\n");
+    emitMissedWarning(F, L, Hints, ORE);
+    return false;
+  }
+
+  LoopVectorizationPlanner LVP(L, LI, TLI, TTI, LVL, CM);
+  LVP.planInVPlanNativePath(VF);
+  LVP.setBestPlan(VF, 1);
+
+  InnerLoopVectorizer LB(L, PSE, LI, DT, TLI, TTI, AC, ORE, VF, 1, LVL, &CM);
+  LVP.executePlan(LB, DT);
+  ++LoopsVectorized;
+
+  ORE->emit([&]() {
+    return OptimizationRemark(LV_NAME, "Vectorized", L->getStartLoc(),
+                              L->getHeader())
+           << "vectorized outer loop (vectorization width: "
+           << ore::NV("VectorizationFactor", VF) << ")";
+  });
+
+  // Mark the loop as already vectorized to avoid vectorizing again.
+  Hints.setAlreadyVectorized();
+
+  DEBUG(verifyFunction(*F));
+  return true;
+}
+
 bool LoopVectorizePass::processLoop(Loop *L) {
-  assert(L->empty() && "Only process inner loops.");
+  assert((L->empty() || EnableVPlanNativePath) &&
+         "VPlan-native path is disabled.");
 
 #ifndef NDEBUG
   const std::string DebugLocStr = getDebugLocString(L);
@@ -8799,6 +9580,12 @@ bool LoopVectorizePass::processLoop(Loop *L) {
     return false;
   }
 
+  // Outer loops explicitly marked for vectorization keep their inner loops,
+  // and are planned without the cost model.
+  if (!L->empty())
+    return processLoopInVPlanNativePath(L, PSE, LI, DT, &LVL, TTI, TLI, DB, AC,
+                                        ORE, Hints);
+
   // Use the cost model.
   LoopVectorizationCostModel CM(L, PSE, LI, &LVL, *TTI, TLI, DB, AC, ORE, F,
                                 &Hints);
@@ -8830,6 +9617,18 @@ bool LoopVectorizePass::processLoop(Loop *L) {
     return false;
   }
 
+  if (VF.Width == 1 && LVL.foldTailByMasking()) {
+    // Interleaving alone cannot mask the tail iterations.
+    DEBUG(dbgs() << "LV: Not vectorizing: the tail cannot be folded without "
+                    "vectorizing.\n");
+    ORE->emit(createMissedAnalysis(Hints.vectorizeAnalysisPassName(),
+                                   "VectorizationNotBeneficial", L)
+              << "the cost-model indicates that vectorization is not "
+                 "beneficial");
+    emitMissedWarning(F, L, Hints, ORE);
+    return false;
+  }
+
   if (VF.Width == 1) {
     DEBUG(dbgs() << "LV: Vectorization is possible but not beneficial.\n");
     VecDiagMsg = std::make_pair(
@@ -8864,6 +9663,15 @@ bool LoopVectorizePass::processLoop(Loop *L) {
   // Override IC if user provided an interleave count.
   IC = UserIC > 0 ? UserIC : IC;
 
+  // Folding the tail rounds the trip count up to a multiple of VF * IC, which
+  // must be a power of two. The user interleave count is not checked.
+  if (LVL.foldTailByMasking() && !isPowerOf2_32(IC)) {
+    DEBUG(dbgs() << "LV: Interleave count " << IC
+                 << " is not a power of two, using "
+                 << PowerOf2Floor(IC) << " to fold the tail.\n");
+    IC = PowerOf2Floor(IC);
+  }
+
   // Emit diagnostic messages, if any.
   const char *VAPassName = Hints.vectorizeAnalysisPassName();
   if (!VectorizeLoop && !InterleaveLoop) {
@@ -8919,6 +9727,11 @@ bool LoopVectorizePass::processLoop(Loop *L) {
              << NV("InterleaveCount", IC) << ")";
     });
   } else {
+    // The remainder of a loop with a constant trip count is known before the
+    // loop is rewritten.
+    unsigned ConstTripCount = SE->getSmallConstantTripCount(L);
+    bool RequiresScalarEpilogue = LVL.requiresScalarEpilogue();
+
     // If we decided that it is *legal* to vectorize the loop, then do it.
     InnerLoopVectorizer LB(L, PSE, LI, DT, TLI, TTI, AC, ORE, VF.Width, IC,
                            &LVL, &CM);
@@ -8939,6 +9752,17 @@ bool LoopVectorizePass::processLoop(Loop *L) {
              << NV("VectorizationFactor", VF.Width)
              << ", interleaved count: " << NV("InterleaveCount", IC) << ")";
     });
+
+    // The original loop now runs the scalar remainder. Runtime checks are
+    // not repeated for it, so loops that needed them keep a scalar
+    // remainder.
+    if (EnableEpilogueVectorization && !OptForSize &&
+        !LVL.foldTailByMasking() && !LB.areSafetyChecksAdded()) {
+      unsigned MaxEpilogueVF = getMaxEpilogueVF(
+          VF.Width, IC, ConstTripCount, RequiresScalarEpilogue);
+      if (MaxEpilogueVF)
+        vectorizeEpilogueLoop(L, MaxEpilogueVF);
+    }
   }
 
   // Mark the loop as already vectorized to avoid vectorizing again.
@@ -8948,6 +9772,65 @@ bool LoopVectorizePass::processLoop(Loop *L) {
   return true;
 }
 
+bool LoopVectorizePass::vectorizeEpilogueLoop(Loop *L, unsigned MaxVF) {
+  DEBUG(dbgs() << "LV: Trying to vectorize the epilogue with VF <= " << MaxVF
+               << ".\n");
+
+  // The vector loop skeleton gave the remainder loop an exit block shared
+  // with the middle block, put it back into the form the legality checks
+  // expect.
+  simplifyLoop(L, DT, LI, SE, AC, false /* PreserveLCSSA */);
+  formLCSSARecursively(*L, *DT, LI, SE);
+
+  Function *F = L->getHeader()->getParent();
+  LoopVectorizeHints Hints(L, true, *ORE);
+  PredicatedScalarEvolution PSE(*SE, *L);
+  LoopVectorizationRequirements Requirements(*ORE);
+  LoopVectorizationLegality LVL(L, PSE, DT, TLI, AA, F, TTI, GetLAA, LI, ORE,
+                                &Requirements, &Hints);
+  if (!LVL.canVectorize()) {
+    DEBUG(dbgs() << "LV: Not vectorizing the epilogue: cannot prove "
+                    "legality.\n");
+    return false;
+  }
+  if (LVL.getRuntimePointerChecking()->Need ||
+      !PSE.getUnionPredicate().isAlwaysTrue()) {
+    DEBUG(dbgs() << "LV: Not vectorizing the epilogue: it needs runtime "
+                    "checks.\n");
+    return false;
+  }
+
+  LoopVectorizationCostModel CM(L, PSE, LI, &LVL, *TTI, TLI, DB, AC, ORE, F,
+                                &Hints);
+  CM.collectValuesToIgnore();
+  LoopVectorizationPlanner LVP(L, LI, TLI, TTI, &LVL, CM);
+
+  // The epilogue is entered at most once per execution of the loop, so it is
+  // not interleaved.
+  LoopVectorizationCostModel::VectorizationFactor VF =
+      LVP.plan(false /* OptForSize */, 0 /* UserVF */, MaxVF);
+  if (VF.Width == 1) {
+    DEBUG(dbgs() << "LV: Vectorizing the epilogue is not beneficial.\n");
+    return false;
+  }
+
+  LVP.setBestPlan(VF.Width, 1);
+  InnerLoopVectorizer LB(L, PSE, LI, DT, TLI, TTI, AC, ORE, VF.Width, 1, &LVL,
+                         &CM);
+  LVP.executePlan(LB, DT);
+  ++LoopsEpilogueVectorized;
+
+  using namespace ore;
+
+  ORE->emit([&]() {
+    return OptimizationRemark(LV_NAME, "EpilogueVectorized", L->getStartLoc(),
+                              L->getHeader())
+           << "vectorized epilogue loop (vectorization width: "
+           << NV("VectorizationFactor", VF.Width) << ")";
+  });
+  return true;
+}
+
 bool LoopVectorizePass::runImpl(
     Function &F, ScalarEvolution &SE_, LoopInfo &LI_, TargetTransformInfo &TTI_,
     DominatorTree &DT_, BlockFrequencyInfo &BFI_, TargetLibraryInfo *TLI_,
@@ -8992,7 +9875,7 @@ bool LoopVectorizePass::runImpl(
   SmallVector<Loop *, 8> Worklist;
 
   for (Loop *L : *LI)
-    addAcyclicInnerLoop(*L, Worklist);
+    collectSupportedLoops(*L, ORE, Worklist);
 
   LoopsAnalyzed += Worklist.size();
 
@@ -1327,7 +1327,11 @@ void BoUpSLP::buildTree(ArrayRef<Value *> Roots,
   UserIgnoreList = UserIgnoreLst;
   if (!allSameType(Roots))
     return;
-  buildTree_rec(Roots, 0, -1);
+  {
+    // Building the tree and its schedule does not change the IR.
+    BatchAAScope BatchAA(*AA);
+    buildTree_rec(Roots, 0, -1);
+  }
 
   // Collect the values that we need to extract from the tree.
   for (TreeEntry &EIdx : VectorizableTree) {
@@ -3777,18 +3781,22 @@ void BoUpSLP::scheduleBlock(BlockScheduling *BS) {
   // initial instructions.
   int Idx = 0;
   int NumToSchedule = 0;
-  for (auto *I = BS->ScheduleStart; I != BS->ScheduleEnd;
-       I = I->getNextNode()) {
-    BS->doForAllOpcodes(I, [this, &Idx, &NumToSchedule, BS](ScheduleData *SD) {
-      assert(SD->isPartOfBundle() ==
-                 (getTreeEntry(SD->Inst) != nullptr) &&
-             "scheduler and vectorizer bundle mismatch");
-      SD->FirstInBundle->SchedulingPriority = Idx++;
-      if (SD->isSchedulingEntity()) {
-        BS->calculateDependencies(SD, false, this);
-        NumToSchedule++;
-      }
-    });
+  {
+    BatchAAScope BatchAA(*AA);
+    for (auto *I = BS->ScheduleStart; I != BS->ScheduleEnd;
+         I = I->getNextNode()) {
+      BS->doForAllOpcodes(I, [this, &Idx, &NumToSchedule,
+                              BS](ScheduleData *SD) {
+        assert(SD->isPartOfBundle() ==
+                   (getTreeEntry(SD->Inst) != nullptr) &&
+               "scheduler and vectorizer bundle mismatch");
+        SD->FirstInBundle->SchedulingPriority = Idx++;
+        if (SD->isSchedulingEntity()) {
+          BS->calculateDependencies(SD, false, this);
+          NumToSchedule++;
+        }
+      });
+    }
   }
   BS->initialFillReadyList(ReadyInsts);
 
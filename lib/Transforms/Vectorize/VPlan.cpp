@@ -122,8 +122,14 @@ VPBasicBlock::createEmptyBasicBlock(VPTransformState::CFGState &CFG) {
   for (VPBlockBase *PredVPBlock : getHierarchicalPredecessors()) {
     VPBasicBlock *PredVPBB = PredVPBlock->getExitBasicBlock();
     auto &PredVPSuccessors = PredVPBB->getSuccessors();
-    BasicBlock *PredBB = CFG.VPBB2IRBB[PredVPBB];
-    assert(PredBB && "Predecessor basic-block not found building successor.");
+    BasicBlock *PredBB = CFG.VPBB2IRBB.lookup(PredVPBB);
+    // A predecessor along a backedge of an outer loop nest is generated
+    // later, and hooks itself up to NewBB when it creates its branch.
+    if (!PredBB) {
+      assert(PredVPBB->getCondBit() &&
+             "Predecessor basic-block not found building successor.");
+      continue;
+    }
     auto *PredBBTerminator = PredBB->getTerminator();
     DEBUG(dbgs() << "LV: draw edge from" << PredBB->getName() << '\n');
     if (isa<UnreachableInst>(PredBBTerminator)) {
@@ -184,6 +190,25 @@ void VPBasicBlock::execute(VPTransformState *State) {
   for (VPRecipeBase &Recipe : Recipes)
     Recipe.execute(*State);
 
+  // 3. Branch on the condition bit, if any. It is uniform across the lanes,
+  // so the first lane decides for all of them. Successors that were already
+  // generated are the headers of enclosing loops and are hooked up now, the
+  // others hook themselves up when they get generated.
+  if (VPValue *CBV = getCondBit()) {
+    Value *IRCBV = State->VPValue2Value[CBV];
+    assert(IRCBV && "Condition bit not found in the original loop.");
+    Value *NewCond = State->Callback.getOrCreateVectorValues(IRCBV, 0);
+    if (NewCond->getType()->isVectorTy())
+      NewCond = State->Builder.CreateExtractElement(
+          NewCond, State->Builder.getInt32(0));
+    auto *CondBr = BranchInst::Create(NewBB, nullptr, NewCond);
+    for (unsigned Idx = 0; Idx < 2; ++Idx) {
+      VPBasicBlock *SuccVPBB = getSuccessors()[Idx]->getEntryBasicBlock();
+      CondBr->setSuccessor(Idx, State->CFG.VPBB2IRBB.lookup(SuccVPBB));
+    }
+    ReplaceInstWithInst(NewBB->getTerminator(), CondBr);
+  }
+
   DEBUG(dbgs() << "LV: filled BB:" << *NewBB);
 }
 
@@ -239,6 +264,13 @@ void VPInstruction::generateInstruction(VPTransformState &State,
     State.set(this, V, Part);
     break;
   }
+  case VPInstruction::ICmpULE: {
+    Value *IV = State.get(getOperand(0), Part);
+    Value *TC = State.get(getOperand(1), Part);
+    Value *V = Builder.CreateICmpULE(IV, TC);
+    State.set(this, V, Part);
+    break;
+  }
   default:
     llvm_unreachable("Unsupported opcode for instruction");
   }
@@ -264,6 +296,9 @@ void VPInstruction::print(raw_ostream &O) const {
   case VPInstruction::Not:
     O << "not";
     break;
+  case VPInstruction::ICmpULE:
+    O << "icmp ule";
+    break;
   default:
     O << Instruction::getOpcodeName(getOpcode());
   }
@@ -278,6 +313,15 @@ void VPInstruction::print(raw_ostream &O) const {
 /// LoopVectorBody basic-block was created for this. Introduce additional
 /// basic-blocks as needed, and fill them all.
 void VPlan::execute(VPTransformState *State) {
+  // -1. Check if the backedge taken count is needed, and if so build it.
+  if (BackedgeTakenCount && BackedgeTakenCount->getNumUsers()) {
+    Value *TC = State->TripCount;
+    IRBuilder<> Builder(State->CFG.PrevBB->getTerminator());
+    auto *TCMO = Builder.CreateSub(TC, ConstantInt::get(TC->getType(), 1),
+                                   "trip.count.minus.1");
+    Value2VPValue[TCMO] = BackedgeTakenCount;
+  }
+
   // 0. Set the reverse mapping from VPValues to Values for code generation.
   for (auto &Entry : Value2VPValue)
     State->VPValue2Value[Entry.second] = Entry.first;
@@ -331,35 +375,21 @@ void VPlan::updateDominatorTree(DominatorTree *DT, BasicBlock *LoopPreHeaderBB,
   BasicBlock *LoopHeaderBB = LoopPreHeaderBB->getSingleSuccessor();
   assert(LoopHeaderBB && "Loop preheader does not have a single successor.");
   DT->addNewBlock(LoopHeaderBB, LoopPreHeaderBB);
-  // The vector body may be more than a single basic-block by this point.
-  // Update the dominator tree information inside the vector body by propagating
-  // it from header to latch, expecting only triangular control-flow, if any.
-  BasicBlock *PostDomSucc = nullptr;
-  for (auto *BB = LoopHeaderBB; BB != LoopLatchBB; BB = PostDomSucc) {
-    // Get the list of successors of this block.
-    std::vector<BasicBlock *> Succs(succ_begin(BB), succ_end(BB));
-    assert(Succs.size() <= 2 &&
-           "Basic block in vector loop has more than 2 successors.");
-    PostDomSucc = Succs[0];
-    if (Succs.size() == 1) {
-      assert(PostDomSucc->getSinglePredecessor() &&
-             "PostDom successor has more than one predecessor.");
-      DT->addNewBlock(PostDomSucc, BB);
-      continue;
-    }
-    BasicBlock *InterimSucc = Succs[1];
-    if (PostDomSucc->getSingleSuccessor() == InterimSucc) {
-      PostDomSucc = Succs[1];
-      InterimSucc = Succs[0];
+  // The vector body may be more than a single basic-block by this point, laid
+  // out between header and latch in reverse post-order. The immediate
+  // dominator of each block is the nearest common dominator of its
+  // predecessors, ignoring those along backedges of nested loops, which are
+  // not in the tree yet.
+  for (auto *BB = LoopHeaderBB->getNextNode(); BB != LoopLatchBB->getNextNode();
+       BB = BB->getNextNode()) {
+    BasicBlock *IDom = nullptr;
+    for (BasicBlock *Pred : predecessors(BB)) {
+      if (!DT->getNode(Pred))
+        continue;
+      IDom = IDom ? DT->findNearestCommonDominator(IDom, Pred) : Pred;
     }
-    assert(InterimSucc->getSingleSuccessor() == PostDomSucc &&
-           "One successor of a basic block does not lead to the other.");
-    assert(InterimSucc->getSinglePredecessor() &&
-           "Interim successor has more than one predecessor.");
-    assert(std::distance(pred_begin(PostDomSucc), pred_end(PostDomSucc)) == 2 &&
-           "PostDom successor has more than two predecessors.");
-    DT->addNewBlock(InterimSucc, BB);
-    DT->addNewBlock(PostDomSucc, BB);
+    assert(IDom && "Basic block in vector loop has no dominating predecessor.");
+    DT->addNewBlock(BB, IDom);
   }
 }
 
@@ -297,6 +297,9 @@ struct VPTransformState {
   /// Values of the output IR.
   VectorizerValueMap &ValueMap;
 
+  /// Hold the trip count of the scalar loop.
+  Value *TripCount = nullptr;
+
   /// Hold a reference to a mapping between VPValues in VPlan and original
   /// Values they correspond to.
   VPValue2ValueTy VPValue2Value;
@@ -326,6 +329,10 @@ private:
   /// List of successor blocks.
   SmallVector<VPBlockBase *, 1> Successors;
 
+  /// Successor selector, null for zero or single successor blocks. Only set
+  /// for blocks modelling uniform branches of an outer loop.
+  VPValue *CondBit = nullptr;
+
   /// Add \p Successor as the last successor to this block.
   void appendSuccessor(VPBlockBase *Successor) {
     assert(Successor && "Cannot add nullptr successor!");
@@ -466,9 +473,11 @@ public:
 
   /// Sets two given VPBlockBases \p IfTrue and \p IfFalse to be the two
   /// successors. The parent of this Block is copied to be the parent of both
-  /// \p IfTrue and \p IfFalse.
-  void setTwoSuccessors(VPBlockBase *IfTrue, VPBlockBase *IfFalse) {
+  /// \p IfTrue and \p IfFalse. If given, \p Condition selects between them.
+  void setTwoSuccessors(VPBlockBase *IfTrue, VPBlockBase *IfFalse,
+                        VPValue *Condition = nullptr) {
     assert(Successors.empty() && "Setting two successors when others exist.");
+    CondBit = Condition;
     appendSuccessor(IfTrue);
     appendSuccessor(IfFalse);
     IfTrue->appendPredecessor(this);
@@ -477,6 +486,10 @@ public:
     IfFalse->Parent = Parent;
   }
 
+  /// \return the condition selecting between the two successors of this
+  /// block, or null if it has none.
+  VPValue *getCondBit() const { return CondBit; }
+
   void disconnectSuccessor(VPBlockBase *Successor) {
     assert(Successor && "Successor to disconnect is null.");
     removeSuccessor(Successor);
@@ -547,7 +560,7 @@ public:
 class VPInstruction : public VPUser, public VPRecipeBase {
 public:
   /// VPlan opcodes, extending LLVM IR with idiomatics instructions.
-  enum { Not = Instruction::OtherOpsEnd + 1 };
+  enum { Not = Instruction::OtherOpsEnd + 1, ICmpULE };
 
 private:
   typedef unsigned char OpcodeTy;
@@ -741,6 +754,10 @@ private:
   /// VPlan.
   Value2VPValueTy Value2VPValue;
 
+  /// Represents the backedge taken count of the original loop, for folding
+  /// the tail.
+  VPValue *BackedgeTakenCount = nullptr;
+
 public:
   VPlan(VPBlockBase *Entry = nullptr) : Entry(Entry) {}
 
@@ -748,7 +765,10 @@ public:
     if (Entry)
       VPBlockBase::deleteCFG(Entry);
     for (auto &MapEntry : Value2VPValue)
-      delete MapEntry.second;
+      if (MapEntry.second != BackedgeTakenCount)
+        delete MapEntry.second;
+    if (BackedgeTakenCount)
+      delete BackedgeTakenCount;
   }
 
   /// Generate the IR code for this VPlan.
@@ -759,6 +779,13 @@ public:
 
   VPBlockBase *setEntry(VPBlockBase *Block) { return Entry = Block; }
 
+  /// The backedge taken count of the original loop.
+  VPValue *getOrCreateBackedgeTakenCount() {
+    if (!BackedgeTakenCount)
+      BackedgeTakenCount = new VPValue();
+    return BackedgeTakenCount;
+  }
+
   void addVF(unsigned VF) { VFs.insert(VF); }
 
   bool hasVF(unsigned VF) { return VFs.count(VF); }
@@ -779,6 +806,13 @@ public:
     return Value2VPValue[V];
   }
 
+  VPValue *getOrAddVPValue(Value *V) {
+    assert(V && "Trying to get or add the VPValue of a null Value");
+    if (!Value2VPValue.count(V))
+      addVPValue(V);
+    return getVPValue(V);
+  }
+
 private:
   /// Add to the given dominator tree the header block and every new basic block
   /// that was created between it and the latch block, inclusive.
@@ -0,0 +1,68 @@
+; RUN: opt < %s -disable-output -basicaa -print-memoryssa 2>&1 | FileCheck %s
+; RUN: opt < %s -disable-output -basicaa -memoryssa -stats 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; MemorySSA optimizes its uses in a batch of alias queries. Check that the
+; decomposed GEPs, underlying objects and capture results reused across the
+; queries of the batch give the same answers.
+
+declare void @escape(i32*)
+
+; CHECK-LABEL: define i32 @f(
+define i32 @f(i32* noalias %p, i64 %i, i1 %c) {
+entry:
+  %local = alloca [4 x i32]
+  %l0 = getelementptr inbounds [4 x i32], [4 x i32]* %local, i64 0, i64 0
+  %l1 = getelementptr inbounds [4 x i32], [4 x i32]* %local, i64 0, i64 1
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  %pi = getelementptr inbounds i32, i32* %p, i64 %i
+  %pi1 = getelementptr inbounds i32, i32* %pi, i64 1
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 0, i32* %l0
+  store i32 0, i32* %l0
+; CHECK: 2 = MemoryDef(1)
+; CHECK-NEXT: store i32 1, i32* %l1
+  store i32 1, i32* %l1
+; CHECK: 3 = MemoryDef(2)
+; CHECK-NEXT: store i32 2, i32* %pi
+  store i32 2, i32* %pi
+; CHECK: 4 = MemoryDef(3)
+; CHECK-NEXT: store i32 3, i32* %p1
+  store i32 3, i32* %p1
+; CHECK: MemoryUse(1)
+; CHECK-NEXT: %a = load i32, i32* %l0
+  %a = load i32, i32* %l0
+; CHECK: MemoryUse(4)
+; CHECK-NEXT: %b = load i32, i32* %pi1
+  %b = load i32, i32* %pi1
+; CHECK: MemoryUse(4)
+; CHECK-NEXT: %d = load i32, i32* %pi
+  %d = load i32, i32* %pi
+  br i1 %c, label %then, label %exit
+
+then:
+; CHECK: 5 = MemoryDef(4)
+; CHECK-NEXT: call void @escape(i32* %l1)
+  call void @escape(i32* %l1)
+  br label %exit
+
+exit:
+; CHECK: 6 = MemoryPhi({entry,4},{then,5})
+; CHECK: MemoryUse(6)
+; CHECK-NEXT: %e = load i32, i32* %l0
+  %e = load i32, i32* %l0
+; CHECK: MemoryUse(4)
+; CHECK-NEXT: %g = load i32, i32* %pi
+  %g = load i32, i32* %pi
+  %s1 = add i32 %a, %b
+  %s2 = add i32 %d, %e
+  %s3 = add i32 %s1, %s2
+  %s4 = add i32 %s3, %g
+  ret i32 %s4
+}
+
+; STATS-DAG: basicaa - Number of decomposed GEPs reused in a batch
+; STATS-DAG: basicaa - Number of GEPs decomposed in a batch
+; STATS-DAG: basicaa - Number of underlying objects reused in a batch
+; STATS-DAG: basicaa - Number of underlying objects found in a batch
@@ -0,0 +1,100 @@
+; RUN: opt < %s -passes='print<loop-cache-cost>' -disable-output 2>&1 \
+; RUN:   | FileCheck %s
+
+; Check the estimated cache cost of each loop of a matrix multiplication as
+; the innermost loop:
+;
+;   for (i = 0; i < 64; i++)
+;     for (j = 0; j < 64; j++)
+;       for (k = 0; k < 64; k++)
+;         C[i][j] += A[i][k] * B[k][j];
+;
+; With k innermost B is walked down a column; with i innermost both A and C
+; are. The best innermost loop is j, where C and B are walked along a row and
+; A is invariant.
+
+; CHECK: Loop cache cost in function 'matmul':
+; CHECK-NEXT: i:
+; CHECK-NEXT: i: cost = 528384
+; CHECK-NEXT: k: cost = 282624
+; CHECK-NEXT: j: cost = 36864
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @matmul([64 x i32]* %A, [64 x i32]* %B, [64 x i32]* %C) {
+entry:
+  br label %i
+
+i:
+  %iv.i = phi i64 [ 0, %entry ], [ %iv.i.next, %i.latch ]
+  br label %j
+
+j:
+  %iv.j = phi i64 [ 0, %i ], [ %iv.j.next, %j.latch ]
+  br label %k
+
+k:
+  %iv.k = phi i64 [ 0, %j ], [ %iv.k.next, %k ]
+  %a = getelementptr inbounds [64 x i32], [64 x i32]* %A, i64 %iv.i, i64 %iv.k
+  %b = getelementptr inbounds [64 x i32], [64 x i32]* %B, i64 %iv.k, i64 %iv.j
+  %c = getelementptr inbounds [64 x i32], [64 x i32]* %C, i64 %iv.i, i64 %iv.j
+  %va = load i32, i32* %a
+  %vb = load i32, i32* %b
+  %vc = load i32, i32* %c
+  %mul = mul nsw i32 %va, %vb
+  %add = add nsw i32 %vc, %mul
+  store i32 %add, i32* %c
+  %iv.k.next = add nuw nsw i64 %iv.k, 1
+  %cond.k = icmp eq i64 %iv.k.next, 64
+  br i1 %cond.k, label %j.latch, label %k
+
+j.latch:
+  %iv.j.next = add nuw nsw i64 %iv.j, 1
+  %cond.j = icmp eq i64 %iv.j.next, 64
+  br i1 %cond.j, label %i.latch, label %j
+
+i.latch:
+  %iv.i.next = add nuw nsw i64 %iv.i, 1
+  %cond.i = icmp eq i64 %iv.i.next, 64
+  br i1 %cond.i, label %exit, label %i
+
+exit:
+  ret void
+}
+
+; A loop with two subloops is not a perfect nest.
+; CHECK: Loop cache cost in function 'not_perfect':
+; CHECK-NEXT: outer:
+; CHECK-NEXT: Not a perfect loop nest with memory references
+
+define void @not_perfect(i32* %A) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  br label %first
+
+first:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %first ]
+  store i32 0, i32* %A
+  %j.next = add nuw nsw i64 %j, 1
+  %c1 = icmp eq i64 %j.next, 8
+  br i1 %c1, label %second, label %first
+
+second:
+  %k = phi i64 [ 0, %first ], [ %k.next, %second ]
+  store i32 1, i32* %A
+  %k.next = add nuw nsw i64 %k, 1
+  %c2 = icmp eq i64 %k.next, 8
+  br i1 %c2, label %latch, label %second
+
+latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %c3 = icmp eq i64 %i.next, 8
+  br i1 %c3, label %exit, label %outer
+
+exit:
+  ret void
+}
@@ -0,0 +1,20 @@
+; RUN: opt -S -basicaa -early-cse-memssa < %s | FileCheck %s
+; RUN: opt -S -basicaa -early-cse-memssa -memssa-walker-budget=0 < %s \
+; RUN:   | FileCheck %s --check-prefix=BUDGET
+;
+; Check that once the walker has used up its budget, every def it reaches is
+; treated as a clobber, which keeps the store of the loaded value alive.
+
+; CHECK-LABEL: @f(
+; CHECK: store i32 0, i32* %b
+; CHECK-NOT: store
+; CHECK: ret void
+; BUDGET-LABEL: @f(
+; BUDGET: store i32 0, i32* %b
+; BUDGET-NEXT: store i32 %v, i32* %a
+define void @f(i32* noalias %a, i32* noalias %b) {
+  %v = load i32, i32* %a
+  store i32 0, i32* %b
+  store i32 %v, i32* %a
+  ret void
+}
@@ -0,0 +1,34 @@
+; RUN: opt < %s -analyze -scalar-evolution 2>&1 | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-work=3 \
+; RUN:   -pass-remarks-analysis=scalar-evolution 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=BUDGET
+
+; Check that once the per-function work budget is used up, expressions are
+; left unknown and a remark names the loop.
+
+; CHECK-NOT: remark
+; CHECK: %i.next = add nuw nsw i32 %i, 1
+; CHECK-NEXT: -->  {1,+,1}<nuw><nsw><%loop>
+; CHECK: Loop %loop: backedge-taken count is 99
+
+; BUDGET: remark: <unknown>:0:0: work budget exhausted while analyzing loop loop; later queries return conservative results
+; BUDGET: %gep = getelementptr inbounds i32, i32* %p, i32 %i
+; BUDGET-NEXT: -->  %gep U: full-set S: full-set
+; BUDGET: %i.next = add nuw nsw i32 %i, 1
+; BUDGET-NEXT: -->  %i.next U: full-set S: full-set
+
+define void @f(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %gep = getelementptr inbounds i32, i32* %p, i32 %i
+  store i32 %i, i32* %gep
+  %i.next = add nuw nsw i32 %i, 1
+  %c = icmp slt i32 %i.next, 100
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
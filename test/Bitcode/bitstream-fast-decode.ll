@@ -0,0 +1,27 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -benchmark-decode=2 | FileCheck %s
+; RUN: llvm-as < %s | llvm-dis | FileCheck %s --check-prefix=DIS
+
+; Check the decode benchmark of llvm-bcanalyzer, and that values spanning
+; many VBR chunks, char6 and fixed-width arrays survive a round trip.
+
+; CHECK: Decoded {{[0-9]+}} records in {{[0-9]+}} bytes
+; CHECK-NEXT: Best of 2 runs:
+
+; DIS: @a_char6_name.0123456789 = global i64 -9223372036854775807
+@a_char6_name.0123456789 = global i64 -9223372036854775807
+
+; DIS: @"not char6!" = global [5 x i32] [i32 1, i32 4096, i32 2147483647, i32 -1, i32 0]
+@"not char6!" = global [5 x i32] [i32 1, i32 4096, i32 2147483647, i32 -1, i32 0]
+
+; DIS: @str = constant [12 x i8] c"hello world\00"
+@str = constant [12 x i8] c"hello world\00"
+
+; DIS-LABEL: define i64 @wide(i64 %x)
+; DIS-NEXT: %a = add i64 %x, 81985529216486895
+; DIS-NEXT: %b = mul i64 %a, -6148914691236517205
+; DIS-NEXT: ret i64 %b
+define i64 @wide(i64 %x) {
+  %a = add i64 %x, 81985529216486895
+  %b = mul i64 %a, -6148914691236517205
+  ret i64 %b
+}
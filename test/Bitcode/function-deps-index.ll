@@ -0,0 +1,59 @@
+; RUN: llvm-as -bitcode-function-deps < %s | llvm-bcanalyzer -dump \
+; RUN:   | FileCheck %s --check-prefix=BC
+; RUN: llvm-as -bitcode-function-deps < %s > %t.bc
+; RUN: llvm-extract -func=a -recursive %t.bc -S | FileCheck %s
+
+; Check the function dependency index in the module-level VST, and that
+; llvm-extract follows it.
+
+; BC: <VALUE_SYMTAB
+; BC: <FNENTRY
+; a calls b and c, and references @g and @pers.
+; BC: <FNDEPS {{.*}}op0=4 op1=2 op2=5 op3=6 op4=0 op5=7/>
+; b calls @ext and references @str.
+; BC-NEXT: <FNDEPS {{.*}}op0=5 op1=1 op2=3 op3=2/>
+; BC-NEXT: <FNDEPS {{.*}}op0=6 op1=0/>
+; BC-NEXT: <FNDEPS {{.*}}op0=7 op1=0/>
+; BC-NEXT: <FNDEPS {{.*}}op0=8 op1=0 op2=1/>
+
+; CHECK: define void @a()
+; CHECK: define void @b()
+; CHECK: define void @c()
+; CHECK: declare i32 @pers(...)
+; CHECK-NOT: define
+
+@g = global i32 0
+@fp = global void ()* @c
+@str = private constant [3 x i8] c"hi\00"
+
+declare void @ext()
+
+define void @a() personality i32 (...)* @pers {
+  call void @b()
+  invoke void @c() to label %ok unwind label %lp
+ok:
+  store i32 1, i32* @g
+  ret void
+lp:
+  %x = landingpad { i8*, i32 } cleanup
+  ret void
+}
+
+define void @b() {
+  call void @ext()
+  %p = getelementptr [3 x i8], [3 x i8]* @str, i64 0, i64 0
+  ret void
+}
+
+define void @c() {
+  ret void
+}
+
+define i32 @pers(...) {
+  ret i32 0
+}
+
+define void @unused() {
+  %v = load void ()*, void ()** @fp
+  ret void
+}
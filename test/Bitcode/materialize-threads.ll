@@ -0,0 +1,77 @@
+; RUN: llvm-as < %s | llvm-dis -bitcode-materialize-threads=2 \
+; RUN:   -bitcode-materialize-readahead=2 | FileCheck %s
+; RUN: llvm-as < %s | llvm-dis > %t.serial.ll
+; RUN: llvm-as < %s | llvm-dis -bitcode-materialize-threads=3 > %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+
+; Check that function blocks decoded ahead of materialization on worker threads
+; produce the same module, including function-local constants, metadata,
+; blockaddress forward references and value names.
+
+@table = constant [2 x i8*] [i8* blockaddress(@jumps, %a), i8* blockaddress(@jumps, %b)]
+
+; CHECK-LABEL: define i32 @first(i32 %x)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: %sum = add nsw i32 %x, 42
+; CHECK-NEXT: %r = call i32 @second(i32 %sum), !dbg
+define i32 @first(i32 %x) !dbg !4 {
+entry:
+  %sum = add nsw i32 %x, 42
+  %r = call i32 @second(i32 %sum), !dbg !7
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @second(i32 %y)
+; CHECK: loop:
+; CHECK-NEXT: %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+; CHECK: store volatile float 1.500000e+00, float* @g, !tbaa
+define i32 @second(i32 %y) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  store volatile float 1.5, float* @g, !tbaa !8
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %y
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %i.next
+}
+
+; CHECK-LABEL: define void @jumps(i8* %target)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: indirectbr i8* %target, [label %a, label %b]
+define void @jumps(i8* %target) {
+entry:
+  indirectbr i8* %target, [label %a, label %b]
+a:
+  ret void
+b:
+  ret void
+}
+
+; CHECK-LABEL: define <2 x i64> @third()
+; CHECK-NEXT: ret <2 x i64> <i64 7, i64 -1>
+define <2 x i64> @third() {
+  ret <2 x i64> <i64 7, i64 -1>
+}
+
+@g = global float 0.0
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "first", scope: !1, file: !1, line: 1, type: !5, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: false, unit: !0, variables: !2)
+!5 = !DISubroutineType(types: !6)
+!6 = !{null}
+!7 = !DILocation(line: 2, column: 3, scope: !4)
+!8 = !{!9, !9, i64 0}
+!9 = !{!"float", !10, i64 0}
+!10 = !{!"omnipotent char", !11, i64 0}
+!11 = !{!"Simple C/C++ TBAA"}
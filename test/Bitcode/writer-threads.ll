@@ -0,0 +1,84 @@
+; RUN: llvm-as < %s > %t.serial.bc
+; RUN: llvm-as -bitcode-writer-threads=3 < %s > %t.parallel.bc
+; RUN: cmp %t.serial.bc %t.parallel.bc
+; RUN: llvm-dis < %t.parallel.bc | FileCheck %s
+
+; Check that function blocks written on worker threads are spliced into the
+; module in order, byte for byte identical to writing them serially, and that
+; the function offsets in the value symbol table still point at them.
+
+@table = constant [2 x i8*] [i8* blockaddress(@jumps, %a), i8* blockaddress(@jumps, %b)]
+@g = global float 0.0
+
+; CHECK-LABEL: define i32 @first(i32 %x)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: %sum = add nsw i32 %x, 42
+; CHECK-NEXT: %r = call i32 @second(i32 %sum), !dbg
+define i32 @first(i32 %x) !dbg !4 {
+entry:
+  %sum = add nsw i32 %x, 42
+  %r = call i32 @second(i32 %sum), !dbg !7
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @second(i32 %y)
+; CHECK: %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+; CHECK: store volatile float 1.500000e+00, float* @g, !tbaa
+define i32 @second(i32 %y) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  store volatile float 1.5, float* @g, !tbaa !8
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %y
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %i.next
+}
+
+declare void @external()
+
+; CHECK-LABEL: define void @jumps(i8* %target)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: indirectbr i8* %target, [label %a, label %b]
+define void @jumps(i8* %target) {
+entry:
+  indirectbr i8* %target, [label %a, label %b]
+a:
+  call void @external()
+  ret void
+b:
+  ret void
+}
+
+; CHECK-LABEL: define <2 x i64> @fourth()
+; CHECK-NEXT: ret <2 x i64> <i64 7, i64 -1>
+define <2 x i64> @fourth() {
+  ret <2 x i64> <i64 7, i64 -1>
+}
+
+; CHECK-LABEL: define i8* @fifth()
+; CHECK-NEXT: ret i8* getelementptr inbounds ([12 x i8], [12 x i8]* @str, i64 0, i64 1)
+@str = constant [12 x i8] c"hello world\00"
+define i8* @fifth() {
+  ret i8* getelementptr inbounds ([12 x i8], [12 x i8]* @str, i64 0, i64 1)
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "first", scope: !1, file: !1, line: 1, type: !5, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: false, unit: !0, variables: !2)
+!5 = !DISubroutineType(types: !6)
+!6 = !{null}
+!7 = !DILocation(line: 2, column: 3, scope: !4)
+!8 = !{!9, !9, i64 0}
+!9 = !{!"float", !10, i64 0}
+!10 = !{!"omnipotent char", !11, i64 0}
+!11 = !{!"Simple C/C++ TBAA"}
@@ -0,0 +1,144 @@
+; Check that allocas whose lifetimes do not overlap share a field of the
+; coroutine frame, and that the fields are ordered by decreasing alignment.
+; RUN: opt < %s -coro-split -S | FileCheck %s
+; RUN: opt < %s -coro-split -coro-reuse-frame-slots=false -S \
+; RUN:     | FileCheck %s --check-prefix=NOREUSE
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+%struct.big = type { i64, i64 }
+
+define i8* @f(i1 %n) "coroutine.presplit"="1" {
+entry:
+  %x = alloca i32
+  %y = alloca %struct.big
+  %z = alloca i64
+  %w = alloca i32
+  %id = call token @llvm.coro.id(i32 0, i8* null, i8* null, i8* null)
+  %size = call i32 @llvm.coro.size.i32()
+  %alloc = call i8* @malloc(i32 %size)
+  %hdl = call i8* @llvm.coro.begin(token %id, i8* %alloc)
+  %c = call i8 @get()
+  %x.i8 = bitcast i32* %x to i8*
+  call void @llvm.lifetime.start.p0i8(i64 4, i8* %x.i8)
+  call void @use(i8* %x.i8)
+  %w.i8 = bitcast i32* %w to i8*
+  call void @llvm.lifetime.start.p0i8(i64 4, i8* %w.i8)
+  call void @use(i8* %w.i8)
+  %sp1 = call i8 @llvm.coro.suspend(token none, i1 false)
+  switch i8 %sp1, label %suspend [i8 0, label %resume1
+                                  i8 1, label %cleanup1]
+resume1:
+  call void @use(i8* %x.i8)
+  call void @llvm.lifetime.end.p0i8(i64 4, i8* %x.i8)
+  %y.i8 = bitcast %struct.big* %y to i8*
+  call void @llvm.lifetime.start.p0i8(i64 16, i8* %y.i8)
+  call void @use(i8* %y.i8)
+  %z.i8 = bitcast i64* %z to i8*
+  call void @use(i8* %z.i8)
+  %sp2 = call i8 @llvm.coro.suspend(token none, i1 false)
+  switch i8 %sp2, label %suspend [i8 0, label %resume2
+                                  i8 1, label %cleanup2]
+resume2:
+  call void @use(i8* %y.i8)
+  call void @llvm.lifetime.end.p0i8(i64 16, i8* %y.i8)
+  call void @use(i8* %z.i8)
+  call void @use(i8* %w.i8)
+  call void @llvm.lifetime.end.p0i8(i64 4, i8* %w.i8)
+  call void @print(i8 %c)
+  br label %cleanup
+
+cleanup1:
+  call void @llvm.lifetime.end.p0i8(i64 4, i8* %x.i8)
+  call void @llvm.lifetime.end.p0i8(i64 4, i8* %w.i8)
+  br label %cleanup
+
+cleanup2:
+  call void @llvm.lifetime.end.p0i8(i64 16, i8* %y.i8)
+  call void @llvm.lifetime.end.p0i8(i64 4, i8* %w.i8)
+  br label %cleanup
+
+cleanup:
+  %mem = call i8* @llvm.coro.free(token %id, i8* %hdl)
+  call void @free(i8* %mem)
+  br label %suspend
+suspend:
+  call i1 @llvm.coro.end(i8* %hdl, i1 0)
+  ret i8* %hdl
+}
+
+; %x and %y share the field of %y, the largest of them. %w overlaps both, and
+; %z has no lifetime markers, so they get their own fields. The i8 spill of %c
+; comes last.
+; CHECK: %f.Frame = type { void (%f.Frame*)*, void (%f.Frame*)*, i1, i1, i64, %struct.big, i32, i8 }
+; NOREUSE: %f.Frame = type { void (%f.Frame*)*, void (%f.Frame*)*, i1, i1, %struct.big, i64, i32, i32, i8 }
+
+; The second lifetime of %x starts at a marker on one of its fields, so its
+; lifetime is not known and it does not share the field of %y.
+; CHECK: %g.Frame = type { void (%g.Frame*)*, void (%g.Frame*)*, i1, i1, %struct.big, { i32, i32 } }
+
+; CHECK-LABEL: @f.resume(
+; CHECK-DAG: %x.reload.addr = getelementptr inbounds %f.Frame, %f.Frame* %FramePtr, i32 0, i32 5
+; CHECK-DAG: %y.reload.addr = getelementptr inbounds %f.Frame, %f.Frame* %FramePtr, i32 0, i32 5
+; CHECK: ret void
+
+define i8* @g() "coroutine.presplit"="1" {
+entry:
+  %x = alloca { i32, i32 }
+  %y = alloca %struct.big
+  %id = call token @llvm.coro.id(i32 0, i8* null, i8* null, i8* null)
+  %size = call i32 @llvm.coro.size.i32()
+  %alloc = call i8* @malloc(i32 %size)
+  %hdl = call i8* @llvm.coro.begin(token %id, i8* %alloc)
+  %x.i8 = bitcast { i32, i32 }* %x to i8*
+  call void @llvm.lifetime.start.p0i8(i64 8, i8* %x.i8)
+  call void @use(i8* %x.i8)
+  %sp1 = call i8 @llvm.coro.suspend(token none, i1 false)
+  switch i8 %sp1, label %suspend [i8 0, label %resume1
+                                  i8 1, label %cleanup]
+resume1:
+  call void @use(i8* %x.i8)
+  call void @llvm.lifetime.end.p0i8(i64 8, i8* %x.i8)
+  %y.i8 = bitcast %struct.big* %y to i8*
+  call void @llvm.lifetime.start.p0i8(i64 16, i8* %y.i8)
+  call void @use(i8* %y.i8)
+  %x.f1 = getelementptr { i32, i32 }, { i32, i32 }* %x, i32 0, i32 1
+  %x.f1.i8 = bitcast i32* %x.f1 to i8*
+  call void @llvm.lifetime.start.p0i8(i64 4, i8* %x.f1.i8)
+  call void @use(i8* %x.f1.i8)
+  %sp2 = call i8 @llvm.coro.suspend(token none, i1 false)
+  switch i8 %sp2, label %suspend [i8 0, label %resume2
+                                  i8 1, label %cleanup]
+resume2:
+  call void @use(i8* %y.i8)
+  call void @use(i8* %x.f1.i8)
+  br label %cleanup
+
+cleanup:
+  %mem = call i8* @llvm.coro.free(token %id, i8* %hdl)
+  call void @free(i8* %mem)
+  br label %suspend
+suspend:
+  call i1 @llvm.coro.end(i8* %hdl, i1 0)
+  ret i8* %hdl
+}
+
+declare i8* @llvm.coro.free(token, i8*)
+declare i32 @llvm.coro.size.i32()
+declare i8  @llvm.coro.suspend(token, i1)
+declare void @llvm.coro.resume(i8*)
+declare void @llvm.coro.destroy(i8*)
+
+declare token @llvm.coro.id(i32, i8*, i8*, i8*)
+declare i1 @llvm.coro.alloc(token)
+declare i8* @llvm.coro.begin(token, i8*)
+declare i1 @llvm.coro.end(i8*, i1)
+
+declare void @llvm.lifetime.start.p0i8(i64, i8* nocapture)
+declare void @llvm.lifetime.end.p0i8(i64, i8* nocapture)
+
+declare noalias i8* @malloc(i32)
+declare i8 @get()
+declare void @use(i8*)
+declare void @print(i8)
+declare void @free(i8*)
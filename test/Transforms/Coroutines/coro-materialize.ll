@@ -1,5 +1,7 @@
 ; Verifies that we materialize instruction across suspend points
 ; RUN: opt < %s -coro-split -S | FileCheck %s
+; RUN: opt < %s -coro-split -coro-materialize-by-size=false -S \
+; RUN:     | FileCheck %s --check-prefix=NOSIZE
 
 define i8* @f(i32 %n) "coroutine.presplit"="1" {
 entry:
@@ -34,8 +36,37 @@ suspend:
 
 ; See that we only spilled one value
 ; CHECK: %f.Frame = type { void (%f.Frame*)*, void (%f.Frame*)*, i1, i1, i32 }
+; CHECK: %g.Frame = type { void (%g.Frame*)*, void (%g.Frame*)*, i1, i1, i32 }
 ; CHECK-LABEL: @f(
 
+; Recreating the truncation on resume would spill the wider i64 instead, so
+; the truncation is spilled unless the frame size is ignored.
+; NOSIZE: %g.Frame = type { void (%g.Frame*)*, void (%g.Frame*)*, i1, i1, i64 }
+
+define i8* @g(i64 %n) "coroutine.presplit"="1" {
+entry:
+  %id = call token @llvm.coro.id(i32 0, i8* null, i8* null, i8* null)
+  %size = call i32 @llvm.coro.size.i32()
+  %alloc = call i8* @malloc(i32 %size)
+  %hdl = call i8* @llvm.coro.begin(token %id, i8* %alloc)
+
+  %trunc = trunc i64 %n to i32
+  %sp1 = call i8 @llvm.coro.suspend(token none, i1 false)
+  switch i8 %sp1, label %suspend [i8 0, label %resume
+                                  i8 1, label %cleanup]
+resume:
+  call void @print(i32 %trunc)
+  br label %cleanup
+
+cleanup:
+  %mem = call i8* @llvm.coro.free(token %id, i8* %hdl)
+  call void @free(i8* %mem)
+  br label %suspend
+suspend:
+  call i1 @llvm.coro.end(i8* %hdl, i1 0)
+  ret i8* %hdl
+}
+
 declare i8* @llvm.coro.free(token, i8*)
 declare i32 @llvm.coro.size.i32()
 declare i8  @llvm.coro.suspend(token, i1)
@@ -0,0 +1,61 @@
+; RUN: opt < %s -correlated-propagation -S | FileCheck %s
+; RUN: opt < %s -correlated-propagation -lvi-max-processed-per-value=1 \
+; RUN:   -pass-remarks-analysis=lazy-value-info -S 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=WORK
+; RUN: opt < %s -correlated-propagation -lvi-max-stack-depth=1 \
+; RUN:   -pass-remarks-analysis=lazy-value-info -S 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=DEPTH
+; RUN: opt < %s -correlated-propagation -lvi-max-cached-blocks=1 \
+; RUN:   -pass-remarks-analysis=lazy-value-info -S 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=EVICT
+
+; Check that queries running into the work and depth limits of LazyValueInfo
+; are given up on, and that evicting blocks from the cache only costs
+; recomputation.
+
+; CHECK-LABEL: @f(
+; CHECK: ret i1 true
+; WORK: remark: <unknown>:0:0: gave up on the value of x in then after reaching the work limit
+; WORK-LABEL: @f(
+; WORK: ret i1 %r
+; DEPTH: remark: <unknown>:0:0: gave up on the value of x in then after reaching the depth limit
+; DEPTH-LABEL: @f(
+; DEPTH: ret i1 %r
+define i1 @f(i32 %x) {
+entry:
+  %c = icmp ult i32 %x, 10
+  br i1 %c, label %then, label %exit
+
+then:
+  br label %next
+
+next:
+  %r = icmp ult i32 %x, 20
+  ret i1 %r
+
+exit:
+  ret i1 false
+}
+
+; CHECK-LABEL: @g(
+; CHECK: %s = and i1 true, true
+; EVICT: remark: <unknown>:0:0: evicted 2 blocks from the cache
+; EVICT-LABEL: @g(
+; EVICT: %s = and i1 true, true
+define i1 @g(i32 %x) {
+entry:
+  %c = icmp ult i32 %x, 10
+  br i1 %c, label %then, label %exit
+
+then:
+  %q = icmp ult i32 %x, 15
+  br label %next
+
+next:
+  %r = icmp ult i32 %x, 20
+  %s = and i1 %q, %r
+  ret i1 %s
+
+exit:
+  ret i1 false
+}
@@ -0,0 +1,334 @@
+; RUN: opt < %s -basicaa -dse-memssa -S | FileCheck %s
+; RUN: opt < %s -aa-pipeline=basic-aa -passes=dse-memssa -S | FileCheck %s
+; RUN: opt < %s -basicaa -dse-memssa -dse-memoryssa-scanlimit=1 -S \
+; RUN:   | FileCheck %s --check-prefix=LIMIT
+
+; Check dead store elimination on top of MemorySSA, which removes stores across
+; basic blocks.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+declare void @llvm.memset.p0i8.i64(i8* nocapture, i8, i64, i32, i1) nounwind
+declare void @may_throw()
+declare void @use(i32*)
+
+; The store in the entry block is overwritten on both paths.
+define void @diamond(i32* %p, i1 %c) {
+; CHECK-LABEL: @diamond(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: br i1 %c
+; CHECK: store i32 2, i32* %p
+entry:
+  store i32 1, i32* %p
+  br i1 %c, label %then, label %else
+
+then:
+  br label %exit
+
+else:
+  br label %exit
+
+exit:
+  store i32 2, i32* %p
+  ret void
+}
+
+; The store is read on one path, so it has to stay.
+define i32 @diamond_read(i32* %p, i1 %c) {
+; CHECK-LABEL: @diamond_read(
+; CHECK: store i32 1, i32* %p
+; CHECK: store i32 2, i32* %p
+entry:
+  store i32 1, i32* %p
+  br i1 %c, label %then, label %exit
+
+then:
+  %v = load i32, i32* %p
+  br label %exit
+
+exit:
+  %r = phi i32 [ %v, %then ], [ 0, %entry ]
+  store i32 2, i32* %p
+  ret i32 %r
+}
+
+; The store in the entry block is overwritten on both arms of the diamond.
+define void @diamond_both_arms(i32* %p, i1 %c) {
+; CHECK-LABEL: @diamond_both_arms(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: br i1 %c
+; CHECK: then:
+; CHECK-NEXT: store i32 2, i32* %p
+; CHECK: else:
+; CHECK-NEXT: store i32 3, i32* %p
+entry:
+  store i32 1, i32* %p
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 2, i32* %p
+  br label %exit
+
+else:
+  store i32 3, i32* %p
+  br label %exit
+
+exit:
+  ret void
+}
+
+; One arm reads the store before overwriting it.
+define i32 @diamond_both_arms_read(i32* %p, i1 %c) {
+; CHECK-LABEL: @diamond_both_arms_read(
+; CHECK: store i32 1, i32* %p
+; CHECK: store i32 2, i32* %p
+; CHECK: store i32 3, i32* %p
+entry:
+  store i32 1, i32* %p
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 2, i32* %p
+  br label %exit
+
+else:
+  %v = load i32, i32* %p
+  store i32 3, i32* %p
+  br label %exit
+
+exit:
+  %r = phi i32 [ 0, %then ], [ %v, %else ]
+  ret i32 %r
+}
+
+; One arm only overwrites a part of the store.
+define void @diamond_both_arms_partial(i32* %p, i1 %c) {
+; CHECK-LABEL: @diamond_both_arms_partial(
+; CHECK: store i32 1, i32* %p
+; CHECK: store i32 2, i32* %p
+; CHECK: store i8 3, i8* %p.i8
+entry:
+  store i32 1, i32* %p
+  %p.i8 = bitcast i32* %p to i8*
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 2, i32* %p
+  br label %exit
+
+else:
+  store i8 3, i8* %p.i8
+  br label %exit
+
+exit:
+  ret void
+}
+
+; The later store does not post-dominate the earlier one.
+define void @not_postdominated(i32* %p, i1 %c) {
+; CHECK-LABEL: @not_postdominated(
+; CHECK: store i32 1, i32* %p
+; CHECK: store i32 2, i32* %p
+entry:
+  store i32 1, i32* %p
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 2, i32* %p
+  br label %exit
+
+exit:
+  ret void
+}
+
+; A call that may throw lies between the stores and %p is visible to the
+; caller.
+define void @throw_between(i32* %p, i1 %c) {
+; CHECK-LABEL: @throw_between(
+; CHECK: store i32 1, i32* %p
+; CHECK: store i32 2, i32* %p
+entry:
+  store i32 1, i32* %p
+  br i1 %c, label %then, label %exit
+
+then:
+  call void @may_throw() readnone
+  br label %exit
+
+exit:
+  store i32 2, i32* %p
+  ret void
+}
+
+; Stores between the killing and the dead store to other memory are skipped.
+define void @skip_unrelated(i32* noalias %p, i32* noalias %q, i1 %c) {
+; CHECK-LABEL: @skip_unrelated(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: store i32 5, i32* %q
+; CHECK-NEXT: br i1 %c
+; CHECK: store i32 2, i32* %p
+; LIMIT-LABEL: @skip_unrelated(
+; LIMIT-NEXT: entry:
+; LIMIT-NEXT: store i32 1, i32* %p
+entry:
+  store i32 1, i32* %p
+  store i32 5, i32* %q
+  br i1 %c, label %then, label %exit
+
+then:
+  br label %exit
+
+exit:
+  store i32 2, i32* %p
+  ret void
+}
+
+; The end of the memset is overwritten in another block and gets trimmed.
+define void @partial(i8* %p, i1 %c) {
+; CHECK-LABEL: @partial(
+; CHECK: call void @llvm.memset.p0i8.i64(i8* %p, i8 0, i64 16, i32 16, i1 false)
+entry:
+  call void @llvm.memset.p0i8.i64(i8* %p, i8 0, i64 32, i32 16, i1 false)
+  br i1 %c, label %then, label %exit
+
+then:
+  br label %exit
+
+exit:
+  %p16 = getelementptr inbounds i8, i8* %p, i64 16
+  %p16.i64 = bitcast i8* %p16 to i64*
+  store i64 1, i64* %p16.i64
+  %p24 = getelementptr inbounds i8, i8* %p, i64 24
+  %p24.i64 = bitcast i8* %p24 to i64*
+  store i64 2, i64* %p24.i64
+  ret void
+}
+
+; Stores to a local that is never read again are dead at the function exit.
+define void @dead_at_exit(i1 %c) {
+; CHECK-LABEL: @dead_at_exit(
+; CHECK-NOT: store
+; CHECK: ret void
+entry:
+  %a = alloca i32
+  store i32 1, i32* %a
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 2, i32* %a
+  br label %exit
+
+exit:
+  ret void
+}
+
+; The local escapes into a call that may read it.
+define void @escaped_at_exit(i1 %c) {
+; CHECK-LABEL: @escaped_at_exit(
+; CHECK: store i32 1, i32* %a
+; CHECK: call void @use(i32* %a)
+entry:
+  %a = alloca i32
+  store i32 1, i32* %a
+  br i1 %c, label %then, label %exit
+
+then:
+  call void @use(i32* %a)
+  br label %exit
+
+exit:
+  ret void
+}
+
+; Stores in a loop are read by the next iteration.
+define i32 @loop(i32 %n) {
+; CHECK-LABEL: @loop(
+; CHECK: loop:
+; CHECK: store i32 %i, i32* %a
+entry:
+  %a = alloca i32
+  store i32 0, i32* %a
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load i32, i32* %a
+  store i32 %i, i32* %a
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %v
+}
+
+; Storing back a value just loaded from the same address is a no-op, unless
+; the address may have changed in between.
+define void @noop(i32* %p, i32* %q, i1 %c) {
+; CHECK-LABEL: @noop(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: %v = load i32, i32* %p
+; CHECK-NEXT: br i1 %c
+; CHECK: store i32 0, i32* %q
+; CHECK: store i32 %v, i32* %p
+entry:
+  %v = load i32, i32* %p
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 %v, i32* %p
+  store i32 0, i32* %q
+  br label %exit
+
+exit:
+  store i32 %v, i32* %p
+  ret void
+}
+
+; Release fences order the stores.
+define void @fence(i32* %p) {
+; CHECK-LABEL: @fence(
+; CHECK: store i32 1, i32* %p
+; CHECK: store i32 2, i32* %p
+  store i32 1, i32* %p
+  fence release
+  store i32 2, i32* %p
+  ret void
+}
+
+; A narrower constant store in a later block is merged into the wider one.
+define void @merge_across_blocks(i32* %p) {
+; CHECK-LABEL: @merge_across_blocks(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: store i32 305419785, i32* %p
+; CHECK-NEXT: %b = bitcast i32* %p to i8*
+; CHECK-NEXT: br label %next
+; CHECK: next:
+; CHECK-NEXT: ret void
+entry:
+  store i32 305419896, i32* %p
+  %b = bitcast i32* %p to i8*
+  br label %next
+
+next:
+  store i8 9, i8* %b
+  ret void
+}
+
+; The narrower store also runs on paths that skip the wider one, so it stays.
+define void @merge_not_dominating(i32* %p, i1 %c) {
+; CHECK-LABEL: @merge_not_dominating(
+; CHECK: store i32 305419896, i32* %p
+; CHECK: store i8 9, i8* %b
+entry:
+  %b = bitcast i32* %p to i8*
+  br i1 %c, label %then, label %join
+
+then:
+  store i32 305419896, i32* %p
+  br label %join
+
+join:
+  store i8 9, i8* %b
+  ret void
+}
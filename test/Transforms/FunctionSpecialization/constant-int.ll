@@ -0,0 +1,105 @@
+; RUN: opt -function-specialization -S < %s | FileCheck %s
+; RUN: opt -passes=function-specialization -S < %s | FileCheck %s
+
+; The mode is used three times in the loop, so the constant mode is worth a
+; clone, in which these instructions can be folded.
+; CHECK-LABEL: define void @caller(
+; CHECK: call void @kernel.specialized.1(i32* %p, i32 %n, i32 1)
+define internal void @kernel(i32* %p, i32 %n, i32 %mode) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %addr = getelementptr i32, i32* %p, i32 %i
+  %v = load i32, i32* %addr
+  %is.add = icmp eq i32 %mode, 0
+  %add = add i32 %v, %mode
+  %mul = mul i32 %v, %mode
+  %r = select i1 %is.add, i32 %add, i32 %mul
+  store i32 %r, i32* %addr
+  %i.next = add nuw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @caller(i32* %p, i32 %n) {
+  call void @kernel(i32* %p, i32 %n, i32 1)
+  ret void
+}
+
+; Functions that are too large are left alone.
+; CHECK-LABEL: define void @caller_big(
+; CHECK: call void @kernel_big(i32* %p, i32 %n, i32 1)
+define internal void @kernel_big(i32* %p, i32 %n, i32 %mode) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %addr = getelementptr i32, i32* %p, i32 %i
+  %v = load i32, i32* %addr
+  %is.add = icmp eq i32 %mode, 0
+  %v1 = mul i32 %v, %v
+  %v2 = mul i32 %v1, %v
+  %v3 = mul i32 %v2, %v
+  %v4 = mul i32 %v3, %v
+  %v5 = mul i32 %v4, %v
+  %v6 = mul i32 %v5, %v
+  %v7 = mul i32 %v6, %v
+  %v8 = mul i32 %v7, %v
+  %v9 = mul i32 %v8, %v
+  %r = select i1 %is.add, i32 %v9, i32 %v
+  store i32 %r, i32* %addr
+  %i.next = add nuw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @caller_big(i32* %p, i32 %n) {
+  call void @kernel_big(i32* %p, i32 %n, i32 1)
+  ret void
+}
+
+; The linker may replace a weak definition, so its body cannot be
+; specialized.
+; CHECK-LABEL: define void @caller_weak(
+; CHECK: call void @kernel_weak(i32* %p, i32 %n, i32 1)
+define weak void @kernel_weak(i32* %p, i32 %n, i32 %mode) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %addr = getelementptr i32, i32* %p, i32 %i
+  %v = load i32, i32* %addr
+  %is.add = icmp eq i32 %mode, 0
+  %add = add i32 %v, %mode
+  %mul = mul i32 %v, %mode
+  %r = select i1 %is.add, i32 %add, i32 %mul
+  store i32 %r, i32* %addr
+  %i.next = add nuw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @caller_weak(i32* %p, i32 %n) {
+  call void @kernel_weak(i32* %p, i32 %n, i32 1)
+  ret void
+}
+
+; The clones are appended to the module.
+; CHECK: define internal void @kernel.specialized.1(
+; CHECK: %is.add = icmp eq i32 1, 0
+; CHECK: %add = add i32 %v, 1
+; CHECK: %mul = mul i32 %v, 1
+; CHECK-NOT: @kernel_weak.specialized
@@ -0,0 +1,68 @@
+; RUN: opt -function-specialization -S < %s | FileCheck %s
+; RUN: opt -passes=function-specialization -S < %s | FileCheck %s
+; RUN: opt -function-specialization -func-specialization-max-clones=1 -S < %s | FileCheck %s --check-prefix=ONE
+
+; @apply calls its comparator argument in a loop. Each comparator gets its own
+; clone, in which the indirect call is a direct one. The original function
+; loses all its callers and is erased.
+
+; CHECK-LABEL: define i32 @sort_less(
+; CHECK: call void @apply.specialized.{{[12]}}(i32* %p, i32 %n, i1 (i32, i32)* @less)
+; CHECK-LABEL: define i32 @sort_greater(
+; CHECK: call void @apply.specialized.{{[12]}}(i32* %p, i32 %n, i1 (i32, i32)* @greater)
+; CHECK-NOT: define internal void @apply(
+; CHECK: define internal void @apply.specialized.1(
+; CHECK: call i1 @{{less|greater}}(i32
+; CHECK: define internal void @apply.specialized.2(
+; CHECK: call i1 @{{less|greater}}(i32
+
+; With a single clone allowed, one call site keeps calling the original.
+; ONE: define internal void @apply(
+; ONE: define internal void @apply.specialized.1(
+
+define internal void @apply(i32* %p, i32 %n, i1 (i32, i32)* %cmp) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %i.next = add nuw i32 %i, 1
+  %a.addr = getelementptr i32, i32* %p, i32 %i
+  %b.addr = getelementptr i32, i32* %p, i32 %i.next
+  %a = load i32, i32* %a.addr
+  %b = load i32, i32* %b.addr
+  %swap = call i1 %cmp(i32 %a, i32 %b)
+  br i1 %swap, label %do.swap, label %latch
+
+do.swap:
+  store i32 %b, i32* %a.addr
+  store i32 %a, i32* %b.addr
+  br label %latch
+
+latch:
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define i1 @less(i32 %a, i32 %b) {
+  %r = icmp slt i32 %a, %b
+  ret i1 %r
+}
+
+define i1 @greater(i32 %a, i32 %b) {
+  %r = icmp sgt i32 %a, %b
+  ret i1 %r
+}
+
+define i32 @sort_less(i32* %p, i32 %n) {
+  call void @apply(i32* %p, i32 %n, i1 (i32, i32)* @less)
+  ret i32 0
+}
+
+define i32 @sort_greater(i32* %p, i32 %n) {
+  call void @apply(i32* %p, i32 %n, i1 (i32, i32)* @greater)
+  ret i32 0
+}
@@ -0,0 +1,81 @@
+; RUN: opt -function-specialization -S < %s | FileCheck %s
+; RUN: opt -passes=function-specialization -S < %s | FileCheck %s
+
+; Only the hot call site is specialized; the cold one keeps calling the
+; original function. The entry counts are split between the two.
+
+; CHECK: define internal void @apply({{.*}}) !prof ![[REST:[0-9]+]]
+; CHECK-LABEL: define i32 @hot_caller(
+; CHECK: call void @apply.specialized.1(i32* %p, i32 %n, i1 (i32, i32)* @less)
+; CHECK-LABEL: define i32 @cold_caller(
+; CHECK: call void @apply(i32* %p, i32 %n, i1 (i32, i32)* @greater)
+; CHECK: define internal void @apply.specialized.1({{.*}}) !prof ![[HOT:[0-9]+]]
+; CHECK: call i1 @less(i32
+; CHECK-DAG: ![[REST]] = !{!"function_entry_count", i64 1}
+; CHECK-DAG: ![[HOT]] = !{!"function_entry_count", i64 1000}
+
+define internal void @apply(i32* %p, i32 %n, i1 (i32, i32)* %cmp) !prof !20 {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %i.next = add nuw i32 %i, 1
+  %a.addr = getelementptr i32, i32* %p, i32 %i
+  %b.addr = getelementptr i32, i32* %p, i32 %i.next
+  %a = load i32, i32* %a.addr
+  %b = load i32, i32* %b.addr
+  %swap = call i1 %cmp(i32 %a, i32 %b)
+  br i1 %swap, label %do.swap, label %latch
+
+do.swap:
+  store i32 %b, i32* %a.addr
+  store i32 %a, i32* %b.addr
+  br label %latch
+
+latch:
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define i1 @less(i32 %a, i32 %b) {
+  %r = icmp slt i32 %a, %b
+  ret i1 %r
+}
+
+define i1 @greater(i32 %a, i32 %b) {
+  %r = icmp sgt i32 %a, %b
+  ret i1 %r
+}
+
+define i32 @hot_caller(i32* %p, i32 %n) !prof !15 {
+  call void @apply(i32* %p, i32 %n, i1 (i32, i32)* @less)
+  ret i32 0
+}
+
+define i32 @cold_caller(i32* %p, i32 %n) !prof !16 {
+  call void @apply(i32* %p, i32 %n, i1 (i32, i32)* @greater)
+  ret i32 0
+}
+
+!llvm.module.flags = !{!1}
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 10000}
+!5 = !{!"MaxCount", i64 1000}
+!6 = !{!"MaxInternalCount", i64 1}
+!7 = !{!"MaxFunctionCount", i64 1000}
+!8 = !{!"NumCounts", i64 3}
+!9 = !{!"NumFunctions", i64 3}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 100, i32 1}
+!13 = !{i32 999000, i64 100, i32 1}
+!14 = !{i32 999999, i64 1, i32 2}
+!15 = !{!"function_entry_count", i64 1000}
+!16 = !{!"function_entry_count", i64 1}
+!20 = !{!"function_entry_count", i64 1001}
@@ -0,0 +1,79 @@
+; RUN: opt -hotcoldsplit -S < %s | FileCheck %s
+; RUN: opt -passes=hotcoldsplit -S < %s | FileCheck %s
+
+; The profile says the slow path is cold, although nothing in it does.
+; CHECK-LABEL: define i32 @profiled(
+; CHECK: codeRepl:
+; CHECK: call void @profiled_slow(
+define i32 @profiled(i32 %x, i32 %y) !prof !15 {
+entry:
+  %cmp = icmp slt i32 %x, %y
+  br i1 %cmp, label %fast, label %slow, !prof !17
+
+slow:
+  %a = mul i32 %x, %y
+  %b = xor i32 %a, %x
+  %c = sub i32 %b, %y
+  %c1 = mul i32 %c, %c
+  %c2 = udiv i32 %c1, %x
+  %c3 = urem i32 %c2, %y
+  %d = shl i32 %c3, 3
+  br label %exit
+
+fast:
+  %e = add i32 %x, %y
+  br label %exit
+
+exit:
+  %r = phi i32 [ %d, %slow ], [ %e, %fast ]
+  ret i32 %r
+}
+
+; Without a profile, the same code is left alone.
+; CHECK-LABEL: define i32 @not_profiled(
+; CHECK-NOT: codeRepl
+; CHECK: ret i32
+define i32 @not_profiled(i32 %x, i32 %y) {
+entry:
+  %cmp = icmp slt i32 %x, %y
+  br i1 %cmp, label %fast, label %slow
+
+slow:
+  %a = mul i32 %x, %y
+  %b = xor i32 %a, %x
+  %c = sub i32 %b, %y
+  %c1 = mul i32 %c, %c
+  %c2 = udiv i32 %c1, %x
+  %c3 = urem i32 %c2, %y
+  %d = shl i32 %c3, 3
+  br label %exit
+
+fast:
+  %e = add i32 %x, %y
+  br label %exit
+
+exit:
+  %r = phi i32 [ %d, %slow ], [ %e, %fast ]
+  ret i32 %r
+}
+
+; CHECK: define internal void @profiled_slow({{.*}}) #[[COLD:[0-9]+]]
+; CHECK: attributes #[[COLD]] = { cold minsize }
+
+!llvm.module.flags = !{!1}
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 10000}
+!5 = !{!"MaxCount", i64 1000}
+!6 = !{!"MaxInternalCount", i64 1}
+!7 = !{!"MaxFunctionCount", i64 1000}
+!8 = !{!"NumCounts", i64 3}
+!9 = !{!"NumFunctions", i64 3}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 100, i32 1}
+!13 = !{i32 999000, i64 100, i32 1}
+!14 = !{i32 999999, i64 1, i32 2}
+!15 = !{!"function_entry_count", i64 1000}
+!17 = !{!"branch_weights", i32 1000000, i32 1}
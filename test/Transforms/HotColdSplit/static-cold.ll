@@ -0,0 +1,99 @@
+; RUN: opt -hotcoldsplit -S < %s | FileCheck %s
+; RUN: opt -passes=hotcoldsplit -S < %s | FileCheck %s
+
+; The error path ends in a noreturn call and is outlined into a cold function.
+; CHECK-LABEL: define i32 @error_path(
+; CHECK: entry:
+; CHECK-NEXT: %cmp = icmp
+; CHECK-NEXT: br i1 %cmp, label %ok, label %codeRepl
+; CHECK: ok:
+; CHECK-NEXT: %add = add i32 %x, %y
+; CHECK: codeRepl:
+; CHECK-NEXT: call void @error_path_fail(i32 %x, i32 %y) #[[NORETURN:[0-9]+]]
+; CHECK-NEXT: unreachable
+define i32 @error_path(i32 %x, i32 %y) {
+entry:
+  %cmp = icmp slt i32 %x, %y
+  br i1 %cmp, label %ok, label %fail
+
+ok:
+  %add = add i32 %x, %y
+  ret i32 %add
+
+fail:
+  %a = mul i32 %x, %y
+  %b = xor i32 %a, %x
+  %c = sub i32 %b, %y
+  %d = shl i32 %c, 3
+  call void @report(i32 %d)
+  br label %abort
+
+abort:
+  call void @abort()
+  unreachable
+}
+
+; The call to a cold function makes its block cold, and so the branch to it.
+; CHECK-LABEL: define void @cold_call(
+; CHECK: call void @cold_call_if.then(i32 %x) #[[NOINLINE:[0-9]+]]
+define void @cold_call(i32 %x, i1 %c) {
+entry:
+  br i1 %c, label %if.then, label %exit
+
+if.then:
+  %a = mul i32 %x, %x
+  %b = add i32 %a, 7
+  %d = udiv i32 %b, 3
+  call void @log(i32 %d)
+  br label %exit
+
+exit:
+  ret void
+}
+
+; An unreachable block alone is not worth a call.
+; CHECK-LABEL: define void @too_small(
+; CHECK: trap:
+; CHECK-NEXT: call void @abort()
+; CHECK-NEXT: unreachable
+define void @too_small(i1 %c) {
+entry:
+  br i1 %c, label %trap, label %exit
+
+trap:
+  call void @abort()
+  unreachable
+
+exit:
+  ret void
+}
+
+; Functions that are already cold are left alone.
+; CHECK-LABEL: define void @already_cold(
+; CHECK-NOT: codeRepl
+define void @already_cold(i32 %x, i1 %c) cold {
+entry:
+  br i1 %c, label %if.then, label %exit
+
+if.then:
+  %a = mul i32 %x, %x
+  %b = add i32 %a, 7
+  %d = udiv i32 %b, 3
+  call void @log(i32 %d)
+  br label %exit
+
+exit:
+  ret void
+}
+
+; CHECK: define internal void @error_path_fail(i32 %x, i32 %y) #[[COLD_NORETURN:[0-9]+]] !section_prefix ![[UNLIKELY:[0-9]+]]
+; CHECK: define internal void @cold_call_if.then(i32 %x) #[[COLD:[0-9]+]] !section_prefix ![[UNLIKELY]]
+; CHECK-DAG: attributes #[[COLD_NORETURN]] = { cold minsize noreturn }
+; CHECK-DAG: attributes #[[COLD]] = { cold minsize }
+; CHECK-DAG: attributes #[[NORETURN]] = { noinline noreturn }
+; CHECK-DAG: attributes #[[NOINLINE]] = { noinline }
+; CHECK: ![[UNLIKELY]] = !{!"function_section_prefix", !".unlikely"}
+
+declare void @report(i32)
+declare void @log(i32) cold
+declare void @abort() noreturn
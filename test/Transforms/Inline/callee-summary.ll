@@ -0,0 +1,146 @@
+; RUN: opt < %s -inline -S | FileCheck %s
+; RUN: opt < %s -inline -inline-cost-callee-summaries=false -S | FileCheck %s
+; RUN: opt < %s -passes='cgscc(inline)' -S | FileCheck %s
+; RUN: opt < %s -inline -stats -disable-output 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; Check that the cost of a callee body is computed once for the call sites
+; that pass it nothing to simplify, and that reusing it does not change the
+; inlining decisions.
+
+; STATS: 2 inline-cost - Number of callee summaries computed
+; STATS: 7 inline-cost - Number of call sites analyzed with a cached callee summary
+
+define i32 @small(i32* %p, i32 %n) {
+  %v = load i32, i32* %p
+  %r = add i32 %v, %n
+  ret i32 %r
+}
+
+define i32 @big(i32* %p, i32 %n) {
+  %v0 = load i32, i32* %p
+  %v1 = mul i32 %v0, %n
+  %v2 = mul i32 %v1, %n
+  %v3 = mul i32 %v2, %n
+  %v4 = mul i32 %v3, %n
+  %v5 = mul i32 %v4, %n
+  %v6 = mul i32 %v5, %n
+  %v7 = mul i32 %v6, %n
+  %v8 = mul i32 %v7, %n
+  %v9 = mul i32 %v8, %n
+  %v10 = mul i32 %v9, %n
+  %v11 = mul i32 %v10, %n
+  %v12 = mul i32 %v11, %n
+  %v13 = mul i32 %v12, %n
+  %v14 = mul i32 %v13, %n
+  %v15 = mul i32 %v14, %n
+  %v16 = mul i32 %v15, %n
+  %v17 = mul i32 %v16, %n
+  %v18 = mul i32 %v17, %n
+  %v19 = mul i32 %v18, %n
+  %v20 = mul i32 %v19, %n
+  %v21 = mul i32 %v20, %n
+  %v22 = mul i32 %v21, %n
+  %v23 = mul i32 %v22, %n
+  %v24 = mul i32 %v23, %n
+  %v25 = mul i32 %v24, %n
+  %v26 = mul i32 %v25, %n
+  %v27 = mul i32 %v26, %n
+  %v28 = mul i32 %v27, %n
+  %v29 = mul i32 %v28, %n
+  %v30 = mul i32 %v29, %n
+  %v31 = mul i32 %v30, %n
+  %v32 = mul i32 %v31, %n
+  %v33 = mul i32 %v32, %n
+  %v34 = mul i32 %v33, %n
+  %v35 = mul i32 %v34, %n
+  %v36 = mul i32 %v35, %n
+  %v37 = mul i32 %v36, %n
+  %v38 = mul i32 %v37, %n
+  %v39 = mul i32 %v38, %n
+  %v40 = mul i32 %v39, %n
+  %v41 = mul i32 %v40, %n
+  %v42 = mul i32 %v41, %n
+  %v43 = mul i32 %v42, %n
+  %v44 = mul i32 %v43, %n
+  %v45 = mul i32 %v44, %n
+  %v46 = mul i32 %v45, %n
+  %v47 = mul i32 %v46, %n
+  %v48 = mul i32 %v47, %n
+  %v49 = mul i32 %v48, %n
+  %v50 = mul i32 %v49, %n
+  %v51 = mul i32 %v50, %n
+  %v52 = mul i32 %v51, %n
+  %v53 = mul i32 %v52, %n
+  %v54 = mul i32 %v53, %n
+  %v55 = mul i32 %v54, %n
+  %v56 = mul i32 %v55, %n
+  %v57 = mul i32 %v56, %n
+  %v58 = mul i32 %v57, %n
+  %v59 = mul i32 %v58, %n
+  %v60 = mul i32 %v59, %n
+  %v61 = mul i32 %v60, %n
+  %v62 = mul i32 %v61, %n
+  %v63 = mul i32 %v62, %n
+  %v64 = mul i32 %v63, %n
+  %v65 = mul i32 %v64, %n
+  %v66 = mul i32 %v65, %n
+  %v67 = mul i32 %v66, %n
+  %v68 = mul i32 %v67, %n
+  %v69 = mul i32 %v68, %n
+  %v70 = mul i32 %v69, %n
+  %v71 = mul i32 %v70, %n
+  %v72 = mul i32 %v71, %n
+  %v73 = mul i32 %v72, %n
+  %v74 = mul i32 %v73, %n
+  %v75 = mul i32 %v74, %n
+  %v76 = mul i32 %v75, %n
+  %v77 = mul i32 %v76, %n
+  %v78 = mul i32 %v77, %n
+  %v79 = mul i32 %v78, %n
+  %v80 = mul i32 %v79, %n
+  %v81 = mul i32 %v80, %n
+  %v82 = mul i32 %v81, %n
+  %v83 = mul i32 %v82, %n
+  %v84 = mul i32 %v83, %n
+  %v85 = mul i32 %v84, %n
+  %v86 = mul i32 %v85, %n
+  %v87 = mul i32 %v86, %n
+  %v88 = mul i32 %v87, %n
+  %v89 = mul i32 %v88, %n
+  ret i32 %v89
+}
+
+; CHECK-LABEL: @caller1(
+; CHECK-NOT: call i32 @small
+; CHECK: call i32 @big(
+; CHECK-NOT: call i32 @small
+; CHECK: ret i32
+define i32 @caller1(i32* %p, i32 %n) {
+  %a = call i32 @small(i32* %p, i32 %n)
+  %b = call i32 @big(i32* %p, i32 %a)
+  ret i32 %b
+}
+
+; CHECK-LABEL: @caller2(
+; CHECK-NOT: call i32 @small
+; CHECK: call i32 @big(
+; CHECK-NOT: call i32 @small
+; CHECK: ret i32
+define i32 @caller2(i32* %p, i32 %n) {
+  %a = call i32 @small(i32* %p, i32 %n)
+  %b = call i32 @big(i32* %p, i32 %a)
+  ret i32 %b
+}
+
+; CHECK-LABEL: @caller3(
+; CHECK-NOT: call i32 @small
+; CHECK: call i32 @big(
+; CHECK-NOT: call i32 @small
+; CHECK: ret i32
+define i32 @caller3(i32* %p, i32 %n) {
+  %a = call i32 @small(i32* %p, i32 %n)
+  %b = call i32 @big(i32* %p, i32 %a)
+  ret i32 %b
+}
@@ -0,0 +1,145 @@
+; RUN: opt < %s -S -module-inline -module-inliner-growth-percent=100 \
+; RUN:     -pass-remarks=module-inline -pass-remarks-missed=module-inline 2>&1 \
+; RUN:     | FileCheck %s
+; RUN: opt < %s -S -passes=module-inline -module-inliner-growth-percent=100 \
+; RUN:     -pass-remarks=module-inline -pass-remarks-missed=module-inline 2>&1 \
+; RUN:     | FileCheck %s
+; RUN: opt < %s -S -module-inline -module-inliner-growth-percent=30 \
+; RUN:     -pass-remarks=module-inline -pass-remarks-missed=module-inline 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=BUDGET
+; RUN: opt < %s -S -passes=module-inline -module-inliner-growth-percent=30 \
+; RUN:     -pass-remarks=module-inline -pass-remarks-missed=module-inline 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=BUDGET
+
+; The call sites are visited from the hottest to the coldest, whatever the
+; order of their callers in the module.
+
+; CHECK: remark: <unknown>:0:0: work inlined into hot
+; CHECK: remark: <unknown>:0:0: work inlined into warm
+; CHECK: remark: <unknown>:0:0: work inlined into cold
+
+; With a tight growth budget, only the hottest call site is inlined.
+
+; BUDGET: remark: <unknown>:0:0: work inlined into hot
+; BUDGET: remark: <unknown>:0:0: work not inlined into warm because the growth budget of the module is spent
+; BUDGET: remark: <unknown>:0:0: work not inlined into cold because the growth budget of the module is spent
+
+@g = global i32 0
+
+define internal i32 @work(i32 %x) {
+entry:
+  %a = mul i32 %x, %x
+  %b = add i32 %a, 7
+  %c = xor i32 %b, %x
+  %d = mul i32 %c, 13
+  %e = sub i32 %d, %a
+  %f = shl i32 %e, 3
+  %v = load volatile i32, i32* @g
+  %r = add i32 %f, %v
+  ret i32 %r
+}
+
+; CHECK-NOT: define internal
+; CHECK-LABEL: define i32 @cold(
+; CHECK-NOT: call
+; CHECK: ret i32
+; BUDGET-LABEL: define i32 @cold(
+; BUDGET: call i32 @work(
+define i32 @cold(i32 %x) !prof !20 {
+entry:
+  %r = call i32 @work(i32 %x)
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @warm(
+; CHECK-NOT: call
+; CHECK: ret i32
+; BUDGET-LABEL: define i32 @warm(
+; BUDGET: call i32 @work(
+define i32 @warm(i32 %x) !prof !21 {
+entry:
+  %r = call i32 @work(i32 %x)
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @hot(
+; CHECK-NOT: call
+; CHECK: ret i32
+; BUDGET-LABEL: define i32 @hot(
+; BUDGET-NOT: call
+; BUDGET: ret i32
+define i32 @hot(i32 %x) !prof !22 {
+entry:
+  %r = call i32 @work(i32 %x)
+  ret i32 %r
+}
+
+; The call site of @inner exposed by inlining @outer is inlined in turn, and
+; both local callees are deleted once they have no uses left. So is @work once
+; all of its call sites are inlined.
+
+; CHECK-LABEL: define i32 @chain(
+; CHECK-NOT: call
+; CHECK: store volatile i32 1, i32* @g
+; CHECK: store volatile i32 2, i32* @g
+; CHECK: ret i32
+define i32 @chain(i32 %x) !prof !21 {
+entry:
+  %r = call i32 @outer(i32 %x)
+  ret i32 %r
+}
+
+define internal i32 @outer(i32 %x) {
+entry:
+  store volatile i32 1, i32* @g
+  %r = call i32 @inner(i32 %x)
+  ret i32 %r
+}
+
+define internal i32 @inner(i32 %x) {
+entry:
+  store volatile i32 2, i32* @g
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+; A recursive call site is never inlined.
+
+; CHECK-LABEL: define i32 @recursive(
+; CHECK: call i32 @recursive(
+; CHECK-NOT: define internal
+define i32 @recursive(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %exit, label %rec
+
+rec:
+  %y = sub i32 %x, 1
+  %r = call i32 @recursive(i32 %y)
+  br label %exit
+
+exit:
+  %p = phi i32 [ 0, %entry ], [ %r, %rec ]
+  ret i32 %p
+}
+
+!llvm.module.flags = !{!1}
+
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 10000}
+!5 = !{!"MaxCount", i64 1000}
+!6 = !{!"MaxInternalCount", i64 1}
+!7 = !{!"MaxFunctionCount", i64 1000}
+!8 = !{!"NumCounts", i64 3}
+!9 = !{!"NumFunctions", i64 3}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 1000, i32 1}
+!13 = !{i32 999000, i64 1000, i32 1}
+!14 = !{i32 999999, i64 1, i32 2}
+
+!20 = !{!"function_entry_count", i64 1}
+!21 = !{!"function_entry_count", i64 100}
+!22 = !{!"function_entry_count", i64 1000}
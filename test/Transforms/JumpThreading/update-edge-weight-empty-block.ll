@@ -0,0 +1,39 @@
+; RUN: opt -S -jump-threading %s | FileCheck %s
+
+; %a is almost empty, but it cannot be folded into %merge because the phi in
+; %merge takes different values from %a and from their common predecessor. It
+; keeps its frequency, so threading %a through %merge moves 75% of the flow of
+; %merge off the edge to %t: the edge weights of %merge go from 80/20 to 20/80.
+
+; CHECK-LABEL: @foo(
+; CHECK: merge:
+; CHECK: br i1 %cmp, label %t, label %f, !prof ![[PROF:[0-9]+]]
+; CHECK: ![[PROF]] = !{!"branch_weights", i32 42{{[0-9]+}}, i32 17{{[0-9]+}}}
+
+define void @foo(i32 %x, i1 %c) !prof !0 {
+entry:
+  br i1 %c, label %a, label %merge, !prof !1
+
+a:
+  br label %merge
+
+merge:
+  %p = phi i32 [ 1, %a ], [ %x, %entry ]
+  %cmp = icmp eq i32 %p, 1
+  br i1 %cmp, label %t, label %f, !prof !2
+
+t:
+  call void @c()
+  ret void
+
+f:
+  call void @d()
+  ret void
+}
+
+declare void @c()
+declare void @d()
+
+!0 = !{!"function_entry_count", i64 1000}
+!1 = !{!"branch_weights", i32 3, i32 1}
+!2 = !{!"branch_weights", i32 4, i32 1}
@@ -0,0 +1,61 @@
+; RUN: opt -S -loop-fusion -pass-remarks=loop-fusion < %s 2>&1 | FileCheck %s
+; RUN: opt -S -aa-pipeline=basic-aa -passes=loop-fusion < %s | FileCheck %s --check-prefix=IR
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; for (i = 0; i < 100; i++) A[i] = B[i] + 1;
+; for (i = 0; i < 100; i++) C[i] = A[i] * 2;
+;
+; The second loop only reads the element of A written by the same iteration of
+; the first one, so the loops can be fused.
+
+; CHECK: remark: <unknown>:0:0: loop fused with the next loop
+
+; IR-LABEL: @same_index(
+; IR: entry:
+; IR-NEXT: br label %loop0
+; IR: loop0:
+; IR-NEXT: %i0 = phi i64 [ 0, %entry ], [ %i0.next, %loop1 ]
+; IR-NEXT: %i1 = phi i64 [ 0, %entry ], [ %i1.next, %loop1 ]
+; IR: store i32 %add
+; IR-NEXT: %i0.next = add nuw nsw i64 %i0, 1
+; IR-NEXT: br label %loop1
+; IR: loop1:
+; IR: store i32 %mul
+; IR: %cmp1 = icmp
+; IR-NEXT: br i1 %cmp1, label %loop0, label %exit
+; IR-NOT: between:
+; IR: exit:
+; IR-NEXT: ret void
+define void @same_index(i32* noalias %A, i32* noalias %B, i32* noalias %C) {
+entry:
+  br label %loop0
+
+loop0:
+  %i0 = phi i64 [ 0, %entry ], [ %i0.next, %loop0 ]
+  %b.addr = getelementptr inbounds i32, i32* %B, i64 %i0
+  %b = load i32, i32* %b.addr
+  %add = add nsw i32 %b, 1
+  %a.addr0 = getelementptr inbounds i32, i32* %A, i64 %i0
+  store i32 %add, i32* %a.addr0
+  %i0.next = add nuw nsw i64 %i0, 1
+  %cmp0 = icmp ne i64 %i0.next, 100
+  br i1 %cmp0, label %loop0, label %between
+
+between:
+  br label %loop1
+
+loop1:
+  %i1 = phi i64 [ 0, %between ], [ %i1.next, %loop1 ]
+  %a.addr1 = getelementptr inbounds i32, i32* %A, i64 %i1
+  %a = load i32, i32* %a.addr1
+  %mul = mul nsw i32 %a, 2
+  %c.addr = getelementptr inbounds i32, i32* %C, i64 %i1
+  store i32 %mul, i32* %c.addr
+  %i1.next = add nuw nsw i64 %i1, 1
+  %cmp1 = icmp ne i64 %i1.next, 100
+  br i1 %cmp1, label %loop1, label %exit
+
+exit:
+  ret void
+}
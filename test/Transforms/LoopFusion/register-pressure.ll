@@ -0,0 +1,47 @@
+; RUN: opt -S -loop-fusion -pass-remarks-missed=loop-fusion < %s 2>&1 \
+; RUN:     | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Each loop uses five loop invariant values and fits in the eight registers of
+; the default target, but the fused loop would not.
+
+; CHECK: remark: <unknown>:0:0: loop not fused with the next loop: fused loop would need more registers than available
+
+; CHECK-LABEL: @pressure(
+; CHECK: br i1 %cmp0, label %loop0, label %between
+; CHECK: br i1 %cmp1, label %loop1, label %exit
+define void @pressure(i32* noalias %A, i32* noalias %B, i32 %x0, i32 %x1, i32 %x2, i32 %x3, i32 %x4, i32 %y0, i32 %y1, i32 %y2, i32 %y3, i32 %y4) {
+entry:
+  br label %loop0
+
+loop0:
+  %i0 = phi i64 [ 0, %entry ], [ %i0.next, %loop0 ]
+  %va.0 = add i32 %x0, %x1
+  %va.1 = mul i32 %va.0, %x2
+  %va.2 = mul i32 %va.1, %x3
+  %va.3 = mul i32 %va.2, %x4
+  %a.addr = getelementptr inbounds i32, i32* %A, i64 %i0
+  store i32 %va.3, i32* %a.addr
+  %i0.next = add nuw nsw i64 %i0, 1
+  %cmp0 = icmp ne i64 %i0.next, 100
+  br i1 %cmp0, label %loop0, label %between
+
+between:
+  br label %loop1
+
+loop1:
+  %i1 = phi i64 [ 0, %between ], [ %i1.next, %loop1 ]
+  %vb.0 = add i32 %y0, %y1
+  %vb.1 = mul i32 %vb.0, %y2
+  %vb.2 = mul i32 %vb.1, %y3
+  %vb.3 = mul i32 %vb.2, %y4
+  %b.addr = getelementptr inbounds i32, i32* %B, i64 %i1
+  store i32 %vb.3, i32* %b.addr
+  %i1.next = add nuw nsw i64 %i1, 1
+  %cmp1 = icmp ne i64 %i1.next, 100
+  br i1 %cmp1, label %loop1, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,146 @@
+; RUN: opt -S -loop-fusion -pass-remarks-missed=loop-fusion < %s 2>&1 \
+; RUN:     | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; for (i = 0; i < 100; i++) A[i] = B[i] + 1;
+; for (i = 0; i < 100; i++) C[i] = A[i + 1] * 2;
+;
+; Iteration i of the second loop reads the element written by iteration i + 1
+; of the first one, which fusion would run too late.
+
+; CHECK: remark: <unknown>:0:0: loop not fused with the next loop: fusion would violate a dependence
+; CHECK: remark: <unknown>:0:0: loop not fused with the next loop: loops have different trip counts
+; CHECK: remark: <unknown>:0:0: loop not fused with the next loop: loop contains calls or instructions with side effects
+; CHECK: remark: <unknown>:0:0: loop not fused with the next loop: code between the loops
+
+; CHECK-LABEL: @forward_read(
+; CHECK: br i1 %cmp0, label %loop0, label %between
+; CHECK: br i1 %cmp1, label %loop1, label %exit
+define void @forward_read(i32* noalias %A, i32* noalias %B, i32* noalias %C) {
+entry:
+  br label %loop0
+
+loop0:
+  %i0 = phi i64 [ 0, %entry ], [ %i0.next, %loop0 ]
+  %b.addr = getelementptr inbounds i32, i32* %B, i64 %i0
+  %b = load i32, i32* %b.addr
+  %add = add nsw i32 %b, 1
+  %a.addr0 = getelementptr inbounds i32, i32* %A, i64 %i0
+  store i32 %add, i32* %a.addr0
+  %i0.next = add nuw nsw i64 %i0, 1
+  %cmp0 = icmp ne i64 %i0.next, 100
+  br i1 %cmp0, label %loop0, label %between
+
+between:
+  br label %loop1
+
+loop1:
+  %i1 = phi i64 [ 0, %between ], [ %i1.next, %loop1 ]
+  %i1.next = add nuw nsw i64 %i1, 1
+  %a.addr1 = getelementptr inbounds i32, i32* %A, i64 %i1.next
+  %a = load i32, i32* %a.addr1
+  %mul = mul nsw i32 %a, 2
+  %c.addr = getelementptr inbounds i32, i32* %C, i64 %i1
+  store i32 %mul, i32* %c.addr
+  %cmp1 = icmp ne i64 %i1.next, 100
+  br i1 %cmp1, label %loop1, label %exit
+
+exit:
+  ret void
+}
+
+; for (i = 0; i < 100; i++) A[i] = 0;
+; for (i = 0; i < 50; i++) B[i] = 0;
+
+; CHECK-LABEL: @different_trip_count(
+; CHECK: br i1 %cmp0, label %loop0, label %between
+; CHECK: br i1 %cmp1, label %loop1, label %exit
+define void @different_trip_count(i32* noalias %A, i32* noalias %B) {
+entry:
+  br label %loop0
+
+loop0:
+  %i0 = phi i64 [ 0, %entry ], [ %i0.next, %loop0 ]
+  %a.addr = getelementptr inbounds i32, i32* %A, i64 %i0
+  store i32 0, i32* %a.addr
+  %i0.next = add nuw nsw i64 %i0, 1
+  %cmp0 = icmp ne i64 %i0.next, 100
+  br i1 %cmp0, label %loop0, label %between
+
+between:
+  br label %loop1
+
+loop1:
+  %i1 = phi i64 [ 0, %between ], [ %i1.next, %loop1 ]
+  %b.addr = getelementptr inbounds i32, i32* %B, i64 %i1
+  store i32 0, i32* %b.addr
+  %i1.next = add nuw nsw i64 %i1, 1
+  %cmp1 = icmp ne i64 %i1.next, 50
+  br i1 %cmp1, label %loop1, label %exit
+
+exit:
+  ret void
+}
+
+declare void @f()
+
+; CHECK-LABEL: @call_in_loop(
+; CHECK: br i1 %cmp0, label %loop0, label %between
+; CHECK: br i1 %cmp1, label %loop1, label %exit
+define void @call_in_loop(i32* noalias %A) {
+entry:
+  br label %loop0
+
+loop0:
+  %i0 = phi i64 [ 0, %entry ], [ %i0.next, %loop0 ]
+  call void @f()
+  %i0.next = add nuw nsw i64 %i0, 1
+  %cmp0 = icmp ne i64 %i0.next, 100
+  br i1 %cmp0, label %loop0, label %between
+
+between:
+  br label %loop1
+
+loop1:
+  %i1 = phi i64 [ 0, %between ], [ %i1.next, %loop1 ]
+  %a.addr = getelementptr inbounds i32, i32* %A, i64 %i1
+  store i32 0, i32* %a.addr
+  %i1.next = add nuw nsw i64 %i1, 1
+  %cmp1 = icmp ne i64 %i1.next, 100
+  br i1 %cmp1, label %loop1, label %exit
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: @code_between(
+; CHECK: br i1 %cmp0, label %loop0, label %between
+; CHECK: br i1 %cmp1, label %loop1, label %exit
+define void @code_between(i32* noalias %A, i32* noalias %B) {
+entry:
+  br label %loop0
+
+loop0:
+  %i0 = phi i64 [ 0, %entry ], [ %i0.next, %loop0 ]
+  %a.addr = getelementptr inbounds i32, i32* %A, i64 %i0
+  store i32 0, i32* %a.addr
+  %i0.next = add nuw nsw i64 %i0, 1
+  %cmp0 = icmp ne i64 %i0.next, 100
+  br i1 %cmp0, label %loop0, label %between
+
+between:
+  store i32 1, i32* %B
+  br label %loop1
+
+loop1:
+  %i1 = phi i64 [ 0, %between ], [ %i1.next, %loop1 ]
+  %b.addr = getelementptr inbounds i32, i32* %B, i64 %i1
+  store i32 0, i32* %b.addr
+  %i1.next = add nuw nsw i64 %i1, 1
+  %cmp1 = icmp ne i64 %i1.next, 100
+  br i1 %cmp1, label %loop1, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,57 @@
+; RUN: opt < %s -basicaa -loop-interchange -pass-remarks=loop-interchange \
+; RUN:   -pass-remarks-missed=loop-interchange -disable-output 2>&1 \
+; RUN:   | FileCheck %s
+; RUN: opt < %s -basicaa -loop-interchange -pass-remarks=loop-interchange \
+; RUN:   -pass-remarks-missed=loop-interchange -disable-output \
+; RUN:   -loop-interchange-use-cache-cost=false 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=NOCC
+
+; One access is in a good and one in a bad induction order, so the induction
+; order heuristic does not interchange the loops. The cache cost model sees
+; that the access in the good order is to the larger elements, so it is
+; better to walk the other access along its rows.
+;
+;   int A[100][100];
+;   double B[100][100];
+;   for (i = 0; i < 100; i++)
+;     for (j = 0; j < 100; j++)
+;       A[j][i] += B[i][j];
+
+; CHECK: remark: <unknown>:0:0: Loop interchanged with enclosing loop.
+; NOCC: remark: <unknown>:0:0: Interchanging loops is too costly (cost=0, threshold=0) and it does not improve parallelism.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@A = common global [100 x [100 x i32]] zeroinitializer
+@B = common global [100 x [100 x double]] zeroinitializer
+
+define void @mixed_element_sizes() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %pb = getelementptr inbounds [100 x [100 x double]], [100 x [100 x double]]* @B, i64 0, i64 %i, i64 %j
+  %b = load double, double* %pb
+  %conv = fptosi double %b to i32
+  %pa = getelementptr inbounds [100 x [100 x i32]], [100 x [100 x i32]]* @A, i64 0, i64 %j, i64 %i
+  %a = load i32, i32* %pa
+  %add = add nsw i32 %a, %conv
+  store i32 %add, i32* %pa
+  %j.next = add nuw nsw i64 %j, 1
+  %cj = icmp eq i64 %j.next, 100
+  br i1 %cj, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %ci = icmp eq i64 %i.next, 100
+  br i1 %ci, label %exit, label %outer.header
+
+exit:
+  ret void
+}
@@ -0,0 +1,40 @@
+; RUN: opt < %s -loop-unroll -unroll-count=2 -unroll-verify-domtree -verify-dom-info -S | FileCheck %s
+; RUN: opt < %s -loop-unroll -unroll-count=2 -dom-tree-updater-recalculate-ratio=0 -unroll-verify-domtree -verify-dom-info -S | FileCheck %s
+
+; REQUIRES: asserts
+; The dominator tree is updated from the edges of the unrolled iterations and
+; of the folded blocks, both incrementally and by recalculation. The exit is
+; now dominated by the second latch, and the early exit is reached from both
+; copies of the header.
+
+define void @test(i32* %p, i1 %c) {
+; CHECK-LABEL: @test(
+; CHECK:       header:
+; CHECK:         br i1 %c, label %early, label %latch
+; CHECK:       latch:
+; CHECK:         br i1 %c, label %early, label %latch.1
+; CHECK:       latch.1:
+; CHECK:         br i1 %{{.*}}, label %header, label %exit
+entry:
+  br label %header
+
+header:
+  %iv = phi i32 [ 0, %entry ], [ %iv.next, %latch ]
+  br i1 %c, label %early, label %latch
+
+latch:
+  %gep = getelementptr i32, i32* %p, i32 %iv
+  store i32 %iv, i32* %gep
+  %iv.next = add nuw nsw i32 %iv, 1
+  %cmp = icmp ult i32 %iv.next, 4
+  br i1 %cmp, label %header, label %exit
+
+early:
+  br label %join
+
+exit:
+  br label %join
+
+join:
+  ret void
+}
@@ -0,0 +1,69 @@
+; RUN: opt -loop-unroll-and-jam -S < %s | FileCheck %s
+; RUN: opt -aa-pipeline=basic-aa -passes='require<opt-remark-emit>,loop(unroll-and-jam)' -S < %s \
+; RUN:     | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = global [16 x [16 x i32]] zeroinitializer
+@C = global [16 x i32] zeroinitializer
+
+; for (i = 0; i < 16; i++) {
+;   sum = 0;
+;   for (j = 0; j < 16; j++)
+;     sum += A[i][j];
+;   C[i] = sum;
+; }
+;
+; Each copy of the inner loop carries two values, so four copies fit in the
+; eight registers of the default target.
+
+; CHECK-LABEL: @row_sums(
+; CHECK: for.outer:
+; CHECK-NEXT: %i = phi i64 [ 0, %entry ], [ %add8.3, %for.latch ]
+; CHECK: for.inner:
+; CHECK-NEXT: %j = phi i64 [ 0, %for.outer ], [ %inc, %for.inner ]
+; CHECK-NEXT: %sum = phi i32 [ 0, %for.outer ], [ %add, %for.inner ]
+; CHECK-NEXT: %j.1 = phi i64 [ 0, %for.outer ], [ %inc.1, %for.inner ]
+; CHECK-NEXT: %sum.1 = phi i32 [ 0, %for.outer ], [ %add.1, %for.inner ]
+; CHECK-NEXT: %j.2 = phi i64 [ 0, %for.outer ], [ %inc.2, %for.inner ]
+; CHECK-NEXT: %sum.2 = phi i32 [ 0, %for.outer ], [ %add.2, %for.inner ]
+; CHECK-NEXT: %j.3 = phi i64 [ 0, %for.outer ], [ %inc.3, %for.inner ]
+; CHECK-NEXT: %sum.3 = phi i32 [ 0, %for.outer ], [ %add.3, %for.inner ]
+; CHECK: %exitcond.3 = icmp eq i64 %inc.3, 16
+; CHECK-NEXT: br i1 %exitcond.3, label %for.latch, label %for.inner
+; CHECK: for.latch:
+; CHECK: store i32 %add.lcssa, i32* %arrayidx6
+; CHECK: store i32 %add.lcssa.1, i32* %arrayidx6.1
+; CHECK: store i32 %add.lcssa.2, i32* %arrayidx6.2
+; CHECK: store i32 %add.lcssa.3, i32* %arrayidx6.3
+; CHECK: %exitcond9.3 = icmp eq i64 %add8.3, 16
+; CHECK-NEXT: br i1 %exitcond9.3, label %exit, label %for.outer
+define void @row_sums() {
+entry:
+  br label %for.outer
+
+for.outer:
+  %i = phi i64 [ 0, %entry ], [ %add8, %for.latch ]
+  br label %for.inner
+
+for.inner:
+  %j = phi i64 [ 0, %for.outer ], [ %inc, %for.inner ]
+  %sum = phi i32 [ 0, %for.outer ], [ %add, %for.inner ]
+  %arrayidx = getelementptr inbounds [16 x [16 x i32]], [16 x [16 x i32]]* @A, i64 0, i64 %i, i64 %j
+  %0 = load i32, i32* %arrayidx
+  %add = add i32 %0, %sum
+  %inc = add nuw nsw i64 %j, 1
+  %exitcond = icmp eq i64 %inc, 16
+  br i1 %exitcond, label %for.latch, label %for.inner
+
+for.latch:
+  %add.lcssa = phi i32 [ %add, %for.inner ]
+  %arrayidx6 = getelementptr inbounds [16 x i32], [16 x i32]* @C, i64 0, i64 %i
+  store i32 %add.lcssa, i32* %arrayidx6
+  %add8 = add nuw nsw i64 %i, 1
+  %exitcond9 = icmp eq i64 %add8, 16
+  br i1 %exitcond9, label %exit, label %for.outer
+
+exit:
+  ret void
+}
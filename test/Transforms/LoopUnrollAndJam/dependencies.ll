@@ -0,0 +1,88 @@
+; RUN: opt -loop-unroll-and-jam -unroll-and-jam-count=2 \
+; RUN:     -pass-remarks-missed=loop-unroll-and-jam -S < %s 2>&1 | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = global [17 x [17 x i32]] zeroinitializer
+
+; for (i = 1; i < 17; i++)
+;   for (j = 0; j < 16; j++)
+;     A[i][j] = A[i - 1][j + 1] + 1;
+;
+; Iteration (i, j) reads the element written by iteration (i - 1, j + 1). The
+; jammed inner loop would run iteration (i, j) before iteration (i - 1, j + 1).
+
+; CHECK: remark: <unknown>:0:0: unable to unroll and jam loop: the transformation is not legal for this loop nest
+; CHECK-LABEL: @backward_inner(
+; CHECK-NOT: .1 =
+; CHECK: ret void
+define void @backward_inner() {
+entry:
+  br label %for.outer
+
+for.outer:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %for.latch ]
+  %i.prev = add nsw i64 %i, -1
+  br label %for.inner
+
+for.inner:
+  %j = phi i64 [ 0, %for.outer ], [ %j.next, %for.inner ]
+  %j.next = add nuw nsw i64 %j, 1
+  %src = getelementptr inbounds [17 x [17 x i32]], [17 x [17 x i32]]* @A, i64 0, i64 %i.prev, i64 %j.next
+  %v = load i32, i32* %src
+  %add = add nsw i32 %v, 1
+  %dst = getelementptr inbounds [17 x [17 x i32]], [17 x [17 x i32]]* @A, i64 0, i64 %i, i64 %j
+  store i32 %add, i32* %dst
+  %inner.cond = icmp eq i64 %j.next, 16
+  br i1 %inner.cond, label %for.latch, label %for.inner
+
+for.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.cond = icmp eq i64 %i.next, 17
+  br i1 %outer.cond, label %exit, label %for.outer
+
+exit:
+  ret void
+}
+
+; for (i = 1; i < 17; i++)
+;   for (j = 0; j < 16; j++)
+;     A[i][j + 1] = A[i - 1][j] + 1;
+;
+; Here the element read was written by an earlier iteration of both loops, so
+; the loop nest is unroll and jammed.
+
+; CHECK-LABEL: @forward_inner(
+; CHECK: for.inner:
+; CHECK: %j.1 = phi
+; CHECK: store i32 %add, i32* %dst
+; CHECK: store i32 %add.1, i32* %dst.1
+; CHECK: ret void
+define void @forward_inner() {
+entry:
+  br label %for.outer
+
+for.outer:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %for.latch ]
+  %i.prev = add nsw i64 %i, -1
+  br label %for.inner
+
+for.inner:
+  %j = phi i64 [ 0, %for.outer ], [ %j.next, %for.inner ]
+  %j.next = add nuw nsw i64 %j, 1
+  %src = getelementptr inbounds [17 x [17 x i32]], [17 x [17 x i32]]* @A, i64 0, i64 %i.prev, i64 %j
+  %v = load i32, i32* %src
+  %add = add nsw i32 %v, 1
+  %dst = getelementptr inbounds [17 x [17 x i32]], [17 x [17 x i32]]* @A, i64 0, i64 %i, i64 %j.next
+  store i32 %add, i32* %dst
+  %inner.cond = icmp eq i64 %j.next, 16
+  br i1 %inner.cond, label %for.latch, label %for.inner
+
+for.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.cond = icmp eq i64 %i.next, 17
+  br i1 %outer.cond, label %exit, label %for.outer
+
+exit:
+  ret void
+}
@@ -0,0 +1,64 @@
+; RUN: opt -loop-unroll-and-jam -unroll-and-jam-count=4 -S < %s | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; for (i = 0; i < n; i++)
+;   for (j = 0; j < m; j++)
+;     C[i] += A[j] * B[i];
+;
+; The outer trip count is only known at run time, so the last n % 4
+; iterations run in a remainder loop.
+
+; CHECK-LABEL: @runtime_trip_count(
+; CHECK: %xtraiter = and i32 %n, 3
+; CHECK: %unroll_iter = sub i32 %n, %xtraiter
+; CHECK: for.outer:
+; CHECK: %niter = phi i32 [ %unroll_iter, %for.outer.preheader.new ], [ %niter.nsub.3, %for.latch ]
+; CHECK: for.inner:
+; CHECK: %j.3 = phi i32
+; CHECK: br i1 %exitcond.3, label %for.latch, label %for.inner
+; CHECK: for.latch:
+; CHECK: %niter.ncmp.3 = icmp eq i32 %niter.nsub.3, 0
+; CHECK: for.outer.epil:
+; CHECK: for.inner.epil:
+define void @runtime_trip_count(i32* noalias %A, i32* noalias %B, i32* noalias %C, i32 %n, i32 %m) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  %cmp.inner = icmp sgt i32 %m, 0
+  %guard = and i1 %cmp, %cmp.inner
+  br i1 %guard, label %for.outer.preheader, label %exit
+
+for.outer.preheader:
+  br label %for.outer
+
+for.outer:
+  %i = phi i32 [ %inc.outer, %for.latch ], [ 0, %for.outer.preheader ]
+  %arrayidx.B = getelementptr inbounds i32, i32* %B, i32 %i
+  %b = load i32, i32* %arrayidx.B
+  br label %for.inner
+
+for.inner:
+  %j = phi i32 [ 0, %for.outer ], [ %inc, %for.inner ]
+  %sum = phi i32 [ 0, %for.outer ], [ %add, %for.inner ]
+  %arrayidx.A = getelementptr inbounds i32, i32* %A, i32 %j
+  %a = load i32, i32* %arrayidx.A
+  %mul = mul nsw i32 %a, %b
+  %add = add nsw i32 %mul, %sum
+  %inc = add nuw nsw i32 %j, 1
+  %exitcond = icmp eq i32 %inc, %m
+  br i1 %exitcond, label %for.latch, label %for.inner
+
+for.latch:
+  %add.lcssa = phi i32 [ %add, %for.inner ]
+  %arrayidx.C = getelementptr inbounds i32, i32* %C, i32 %i
+  store i32 %add.lcssa, i32* %arrayidx.C
+  %inc.outer = add nuw nsw i32 %i, 1
+  %exitcond.outer = icmp eq i32 %inc.outer, %n
+  br i1 %exitcond.outer, label %exit.loopexit, label %for.outer
+
+exit.loopexit:
+  br label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,113 @@
+; RUN: opt < %s -loop-vectorize -enable-epilogue-vectorization -pass-remarks=loop-vectorize -S 2>%t | FileCheck %s
+; RUN: FileCheck %s --check-prefix=REMARK < %t
+; RUN: opt < %s -loop-vectorize -pass-remarks=loop-vectorize -S 2>&1 | FileCheck %s --check-prefix=DISABLED
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The scalar remainder of the interleaved vector loop is vectorized again
+; without interleaving.
+
+; REMARK: remark: <unknown>:0:0: vectorized loop (vectorization width: 16, interleaved count: 4)
+; REMARK-NEXT: remark: <unknown>:0:0: vectorized epilogue loop (vectorization width: 16)
+; DISABLED: remark: <unknown>:0:0: vectorized loop (vectorization width: 16, interleaved count: {{[0-9]+}})
+; DISABLED-NOT: vectorized epilogue loop
+
+; CHECK-LABEL: @add_unknown_tc(
+; CHECK: vector.body:
+; CHECK: load <16 x i32>
+; CHECK: add nsw <16 x i32>
+; CHECK: vector.body{{[0-9]+}}:
+; CHECK: load <16 x i32>
+; CHECK: add nsw <16 x i32>
+; CHECK: %index.next{{[0-9]+}} = add i64 %index{{[0-9]+}}, 16
+; CHECK: for.body:
+; CHECK: ret void
+define void @add_unknown_tc(i32* noalias nocapture %a, i32* noalias nocapture readonly %b, i64 %n) #0 {
+entry:
+  %cmp6 = icmp sgt i64 %n, 0
+  br i1 %cmp6, label %for.body, label %for.end
+
+for.body:
+  %i = phi i64 [ %i.next, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i32, i32* %b, i64 %i
+  %0 = load i32, i32* %arrayidx, align 4
+  %arrayidx2 = getelementptr inbounds i32, i32* %a, i64 %i
+  %1 = load i32, i32* %arrayidx2, align 4
+  %add = add nsw i32 %1, %0
+  store i32 %add, i32* %arrayidx2, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; With a constant trip count the epilogue factor is bounded by the number of
+; remaining iterations.
+
+; REMARK: remark: <unknown>:0:0: vectorized loop (vectorization width: 16, interleaved count: 4)
+; REMARK-NEXT: remark: <unknown>:0:0: vectorized epilogue loop (vectorization width: 4)
+
+; CHECK-LABEL: @add_const_tc(
+; CHECK: load <16 x i32>
+; CHECK: load <4 x i32>
+; CHECK-NOT: load <8 x i32>
+; CHECK: ret void
+define void @add_const_tc(i32* noalias nocapture %a, i32* noalias nocapture readonly %b) #0 {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ %i.next, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i32, i32* %b, i64 %i
+  %0 = load i32, i32* %arrayidx, align 4
+  %arrayidx2 = getelementptr inbounds i32, i32* %a, i64 %i
+  %1 = load i32, i32* %arrayidx2, align 4
+  %add = add nsw i32 %1, %0
+  store i32 %add, i32* %arrayidx2, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1029
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; A main loop processing few elements per iteration keeps a scalar epilogue.
+
+; DISABLED: remark: <unknown>:0:0: vectorized loop (vectorization width: 2, interleaved count: 1)
+; REMARK: remark: <unknown>:0:0: vectorized loop (vectorization width: 2, interleaved count: 1)
+; REMARK-NOT: vectorized epilogue loop
+
+; CHECK-LABEL: @add_small_vf(
+; CHECK: vector.body:
+; CHECK-NOT: vector.body{{[0-9]+}}:
+; CHECK: ret void
+define void @add_small_vf(i32* noalias nocapture %a, i32* noalias nocapture readonly %b, i64 %n) #0 {
+entry:
+  %cmp6 = icmp sgt i64 %n, 0
+  br i1 %cmp6, label %for.body, label %for.end
+
+for.body:
+  %i = phi i64 [ %i.next, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i32, i32* %b, i64 %i
+  %0 = load i32, i32* %arrayidx, align 4
+  %arrayidx2 = getelementptr inbounds i32, i32* %a, i64 %i
+  %1 = load i32, i32* %arrayidx2, align 4
+  %add = add nsw i32 %1, %0
+  store i32 %add, i32* %arrayidx2, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body, !llvm.loop !0
+
+for.end:
+  ret void
+}
+
+attributes #0 = { "target-cpu"="skylake-avx512" "target-features"="+avx512f,+avx512vl,+avx2" }
+
+!0 = distinct !{!0, !1, !2}
+!1 = !{!"llvm.loop.vectorize.width", i32 2}
+!2 = !{!"llvm.loop.interleave.count", i32 1}
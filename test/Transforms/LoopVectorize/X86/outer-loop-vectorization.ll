@@ -0,0 +1,169 @@
+; RUN: opt < %s -loop-vectorize -enable-vplan-native-path -verify-loop-info -verify-dom-info -pass-remarks=loop-vectorize -pass-remarks-analysis=loop-vectorize -S 2>%t | FileCheck %s
+; RUN: FileCheck %s --check-prefix=REMARK < %t
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@A = global [1024 x i32] zeroinitializer, align 16
+@B = global [1024 x [1024 x i32]] zeroinitializer, align 16
+@N = global [1024 x i64] zeroinitializer, align 16
+
+; Outer loops explicitly marked for vectorization are vectorized along the
+; VPlan-native path, keeping their inner loops.
+
+; REMARK: remark: <unknown>:0:0: vectorized outer loop (vectorization width: 4)
+; REMARK: remark: <unknown>:0:0: vectorized outer loop (vectorization width: 8)
+; REMARK: remark: <unknown>:0:0: loop not vectorized: outer loop contains control flow that varies across its iterations
+
+; void sum_columns(long m) {
+;   #pragma clang loop vectorize(enable) vectorize_width(4)
+;   for (long i = 0; i < 1024; i++) {
+;     int sum = 0;
+;     for (long j = 0; j < m; j++)
+;       sum += B[j][i];
+;     A[i] = sum;
+;   }
+; }
+
+; CHECK-LABEL: @sum_columns(
+; CHECK: vector.body:
+; CHECK-NEXT: %index = phi i64 [ 0, %vector.ph ], [ %index.next, %[[OUTER_LATCH:.*]] ]
+; CHECK-NEXT: %vec.ind = phi <4 x i64> [ <i64 0, i64 1, i64 2, i64 3>, %vector.ph ], [ %vec.ind.next, %[[OUTER_LATCH]] ]
+; CHECK: br label %[[INNER:.*]]
+; CHECK: [[INNER]]:
+; CHECK-NEXT: %[[J:.*]] = phi <4 x i64> [ zeroinitializer, %vector.body ], [ %[[J_NEXT:.*]], %[[INNER]] ]
+; CHECK-NEXT: %[[SUM:.*]] = phi <4 x i32> [ zeroinitializer, %vector.body ], [ %[[SUM_NEXT:.*]], %[[INNER]] ]
+; CHECK: %[[B:.*]] = load <4 x i32>
+; CHECK: %[[SUM_NEXT]] = add nsw <4 x i32> %[[SUM]], %[[B]]
+; CHECK: %[[J_NEXT]] = add nuw nsw <4 x i64> %[[J]], <i64 1, i64 1, i64 1, i64 1>
+; CHECK: %[[CMP:.*]] = icmp eq <4 x i64> %[[J_NEXT]]
+; CHECK: %[[COND:.*]] = extractelement <4 x i1> %[[CMP]], i32 0
+; CHECK: br i1 %[[COND]], label %[[OUTER_LATCH]], label %[[INNER]]
+; CHECK: [[OUTER_LATCH]]:
+; CHECK-NEXT: %[[LCSSA:.*]] = phi <4 x i32> [ %[[SUM_NEXT]], %[[INNER]] ]
+; CHECK: store <4 x i32> %[[LCSSA]]
+; CHECK: %index.next = add i64 %index, 4
+; CHECK: br i1 {{.*}}, label %middle.block, label %vector.body
+
+define void @sum_columns(i64 %m) {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %sum = phi i32 [ 0, %outer.header ], [ %sum.next, %inner ]
+  %gep.b = getelementptr inbounds [1024 x [1024 x i32]], [1024 x [1024 x i32]]* @B, i64 0, i64 %j, i64 %i
+  %b = load i32, i32* %gep.b, align 4
+  %sum.next = add nsw i32 %sum, %b
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.cond = icmp eq i64 %j.next, %m
+  br i1 %inner.cond, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi i32 [ %sum.next, %inner ]
+  %gep.a = getelementptr inbounds [1024 x i32], [1024 x i32]* @A, i64 0, i64 %i
+  store i32 %sum.lcssa, i32* %gep.a, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.cond = icmp eq i64 %i.next, 1024
+  br i1 %outer.cond, label %exit, label %outer.header, !llvm.loop !0
+
+exit:
+  ret void
+}
+
+; Without a width hint, the vectorization factor fits the widest elements in
+; a vector register. Loads that are uniform across the outer loop iterations
+; are not widened, and the others are gathered.
+
+; void transpose_add(long m) {
+;   #pragma clang loop vectorize(enable)
+;   for (long i = 0; i < 1024; i++)
+;     for (long j = 0; j < m; j++)
+;       B[j][i] += A[j] + B[i][j];
+; }
+
+; CHECK-LABEL: @transpose_add(
+; CHECK: vector.body:
+; CHECK: [[INNER2:.*]]:
+; CHECK: %[[UNIFORM:.*]] = load i32, i32*
+; CHECK: call <8 x i32> @llvm.masked.gather.v8i32.v8p0i32(
+; CHECK: load <8 x i32>
+; CHECK: store <8 x i32>
+; CHECK: br i1 %{{.*}}, label %{{.*}}, label %[[INNER2]]
+
+define void @transpose_add(i64 %m) #0 {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %gep.a = getelementptr inbounds [1024 x i32], [1024 x i32]* @A, i64 0, i64 %j
+  %a = load i32, i32* %gep.a, align 4
+  %gep.bt = getelementptr inbounds [1024 x [1024 x i32]], [1024 x [1024 x i32]]* @B, i64 0, i64 %i, i64 %j
+  %bt = load i32, i32* %gep.bt, align 4
+  %gep.b = getelementptr inbounds [1024 x [1024 x i32]], [1024 x [1024 x i32]]* @B, i64 0, i64 %j, i64 %i
+  %b = load i32, i32* %gep.b, align 4
+  %add = add nsw i32 %a, %bt
+  %add2 = add nsw i32 %add, %b
+  store i32 %add2, i32* %gep.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.cond = icmp eq i64 %j.next, %m
+  br i1 %inner.cond, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.cond = icmp eq i64 %i.next, 1024
+  br i1 %outer.cond, label %exit, label %outer.header, !llvm.loop !3
+
+exit:
+  ret void
+}
+
+; The trip count of the inner loop varies across the outer loop iterations.
+
+; CHECK-LABEL: @varying_inner_tc(
+; CHECK-NOT: <4 x i32>
+; CHECK: ret void
+
+define void @varying_inner_tc() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %gep.n = getelementptr inbounds [1024 x i64], [1024 x i64]* @N, i64 0, i64 %i
+  %n = load i64, i64* %gep.n, align 8
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %gep.b = getelementptr inbounds [1024 x [1024 x i32]], [1024 x [1024 x i32]]* @B, i64 0, i64 %j, i64 %i
+  store i32 0, i32* %gep.b, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.cond = icmp eq i64 %j.next, %n
+  br i1 %inner.cond, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.cond = icmp eq i64 %i.next, 1024
+  br i1 %outer.cond, label %exit, label %outer.header, !llvm.loop !4
+
+exit:
+  ret void
+}
+
+attributes #0 = { "target-cpu"="core-avx2" "target-features"="+avx2" }
+
+!0 = distinct !{!0, !1, !2}
+!1 = !{!"llvm.loop.vectorize.enable", i1 true}
+!2 = !{!"llvm.loop.vectorize.width", i32 4}
+!3 = distinct !{!3, !1}
+!4 = distinct !{!4, !1, !2}
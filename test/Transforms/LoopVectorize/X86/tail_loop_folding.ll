@@ -0,0 +1,153 @@
+; RUN: opt < %s -loop-vectorize -force-vector-width=8 -force-vector-interleave=1 -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -force-vector-width=8 -force-vector-interleave=3 -S \
+; RUN:   | FileCheck %s --check-prefix=IC3
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; With the predicate hint, the tail iterations run in the vector loop under a
+; mask comparing the induction variable with the backedge-taken count, and the
+; scalar remainder is never entered.
+
+; CHECK-LABEL: @tail_folding_enabled(
+; CHECK: vector.body:
+; CHECK: %[[IND:.*]] = phi <8 x i64>
+; CHECK: %[[MASK:.*]] = icmp ule <8 x i64> %[[IND]], <i64 429, i64 429, i64 429, i64 429, i64 429, i64 429, i64 429, i64 429>
+; CHECK: call <8 x i32> @llvm.masked.load.v8i32.p0v8i32({{.*}}, <8 x i1> %[[MASK]], <8 x i32> undef)
+; CHECK: call <8 x i32> @llvm.masked.load.v8i32.p0v8i32({{.*}}, <8 x i1> %[[MASK]], <8 x i32> undef)
+; CHECK: call void @llvm.masked.store.v8i32.p0v8i32({{.*}}, <8 x i1> %[[MASK]])
+; CHECK: %index.next = add i64 %index, 8
+; CHECK: icmp eq i64 %index.next, 432
+; CHECK: middle.block:
+; CHECK-NEXT: br i1 true, label %for.cond.cleanup, label %scalar.ph
+
+; An interleave count that is not a power of two is rounded down to a power of
+; two (here 2) when the tail is folded.
+
+; IC3-LABEL: @tail_folding_enabled(
+; IC3: vector.body:
+; IC3: %index.next = add i64 %index, 16
+; IC3: icmp eq i64 %index.next, 432
+
+define void @tail_folding_enabled(i32* noalias nocapture %A, i32* noalias nocapture readonly %B, i32* noalias nocapture readonly %C) #0 {
+entry:
+  br label %for.body
+
+for.cond.cleanup:
+  ret void
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %B, i64 %indvars.iv
+  %0 = load i32, i32* %arrayidx, align 4
+  %arrayidx2 = getelementptr inbounds i32, i32* %C, i64 %indvars.iv
+  %1 = load i32, i32* %arrayidx2, align 4
+  %add = add nsw i32 %1, %0
+  %arrayidx4 = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  store i32 %add, i32* %arrayidx4, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 430
+  br i1 %exitcond, label %for.cond.cleanup, label %for.body, !llvm.loop !6
+}
+
+; Without the hint, the remainder iterations run in the scalar loop.
+
+; CHECK-LABEL: @tail_folding_disabled(
+; CHECK: vector.body:
+; CHECK-NOT: @llvm.masked.load
+; CHECK-NOT: @llvm.masked.store
+; CHECK: middle.block:
+; CHECK: %cmp.n = icmp eq i64 430, 424
+
+define void @tail_folding_disabled(i32* noalias nocapture %A, i32* noalias nocapture readonly %B, i32* noalias nocapture readonly %C) #0 {
+entry:
+  br label %for.body
+
+for.cond.cleanup:
+  ret void
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %B, i64 %indvars.iv
+  %0 = load i32, i32* %arrayidx, align 4
+  %arrayidx2 = getelementptr inbounds i32, i32* %C, i64 %indvars.iv
+  %1 = load i32, i32* %arrayidx2, align 4
+  %add = add nsw i32 %1, %0
+  %arrayidx4 = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  store i32 %add, i32* %arrayidx4, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 430
+  br i1 %exitcond, label %for.cond.cleanup, label %for.body, !llvm.loop !10
+}
+
+; When optimizing for size, a loop with an unknown trip count is vectorized
+; by folding its tail rather than not at all.
+
+; CHECK-LABEL: @tail_folding_optsize(
+; CHECK: %n.rnd.up = add i64 %n, 7
+; CHECK: vector.body:
+; CHECK: @llvm.masked.load.v8i32.p0v8i32(
+; CHECK: @llvm.masked.store.v8i32.p0v8i32(
+; CHECK: middle.block:
+; CHECK-NEXT: br i1 true
+
+define void @tail_folding_optsize(i32* noalias nocapture %A, i32* noalias nocapture readonly %B, i64 %n) #1 {
+entry:
+  %cmp6 = icmp sgt i64 %n, 0
+  br i1 %cmp6, label %for.body, label %for.cond.cleanup
+
+for.cond.cleanup:
+  ret void
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %B, i64 %indvars.iv
+  %0 = load i32, i32* %arrayidx, align 4
+  %add = add nsw i32 %0, 1
+  %arrayidx2 = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  store i32 %add, i32* %arrayidx2, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, %n
+  br i1 %exitcond, label %for.cond.cleanup, label %for.body
+}
+
+; Reductions are not supported when folding the tail, so the hint is ignored
+; and a scalar remainder loop is kept.
+
+; CHECK-LABEL: @reduction_i32(
+; CHECK: vector.body:
+; CHECK-NOT: @llvm.masked.load
+; CHECK: middle.block:
+; CHECK: %cmp.n = icmp eq i64
+
+define i32 @reduction_i32(i32* nocapture readonly %A, i32* nocapture readonly %B, i64 %n) #0 {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ %indvars.iv.next, %for.body ], [ 0, %entry ]
+  %sum.0 = phi i32 [ %sum.1, %for.body ], [ 0, %entry ]
+  %arrayidxA = getelementptr inbounds i32, i32* %A, i64 %indvars.iv
+  %0 = load i32, i32* %arrayidxA, align 4
+  %arrayidxB = getelementptr inbounds i32, i32* %B, i64 %indvars.iv
+  %1 = load i32, i32* %arrayidxB, align 4
+  %add = add nsw i32 %1, %0
+  %sum.1 = add nuw nsw i32 %add, %sum.0
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, %n
+  br i1 %exitcond, label %for.cond.cleanup, label %for.body, !llvm.loop !6
+
+for.cond.cleanup:
+  ret i32 %sum.1
+}
+
+attributes #0 = { "target-cpu"="core-avx2" "target-features"="+avx,+avx2" }
+attributes #1 = { optsize "target-cpu"="core-avx2" "target-features"="+avx,+avx2" }
+
+!6 = distinct !{!6, !7, !8}
+!7 = !{!"llvm.loop.vectorize.predicate.enable", i1 true}
+!8 = !{!"llvm.loop.vectorize.enable", i1 true}
+
+!10 = distinct !{!10, !11, !12}
+!11 = !{!"llvm.loop.vectorize.predicate.enable", i1 false}
+!12 = !{!"llvm.loop.vectorize.enable", i1 true}
@@ -7,7 +7,7 @@
 ; No more loops in the module
 ; CHECK-NOT: LV: Loop hints: force=
 ; CHECK: 3 loop-vectorize               - Number of loops analyzed for vectorization
-; CHECK: 2 loop-vectorize               - Number of loops vectorized
+; CHECK: 3 loop-vectorize               - Number of loops vectorized
 
 target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
 target triple = "x86_64-apple-macosx10.8.0"
@@ -48,9 +48,10 @@ for.end:
 !2 = !{!"llvm.loop.vectorize.enable", i1 true}
 
 ;
-; This loop will not be vectorized as the trip count is below the threshold.
+; This loop will be vectorized as the trip count is below the threshold but
+; the scalar iterations are folded into the vector loop by masking.
 ;
-define void @not_vectorized(float* noalias nocapture %A, float* noalias nocapture readonly %B) {
+define void @vectorized_with_masking(float* noalias nocapture %A, float* noalias nocapture readonly %B) {
 entry:
   br label %for.body
 
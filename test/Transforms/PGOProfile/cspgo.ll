@@ -0,0 +1,56 @@
+; Context sensitive PGO: the IR is instrumented a second time, after inlining,
+; and the resulting records are told apart by a flag bit in the function hash.
+; RUN: opt < %s -passes=cspgo-instr-gen -S | FileCheck %s --check-prefix=GEN
+
+; Context sensitive instrumentation goes with a regular profile use, not with
+; regular instrumentation, in one compile or across an LTO link.
+; RUN: not opt < %s -passes=pgo-instr-gen,cspgo-instr-gen -S 2>&1 | FileCheck %s --check-prefix=BOTH
+; RUN: not opt < %s -O2 -profile-generate -cs-profile-generate -S 2>&1 | FileCheck %s --check-prefix=BOTH
+; BOTH: Context sensitive instrumentation cannot be added to a module with IR level instrumentation
+
+; RUN: llvm-profdata merge %S/Inputs/cspgo.proftext -o %t.profdata
+; RUN: opt < %s -passes=pgo-instr-use,cspgo-instr-use -pgo-test-profile-file=%t.profdata -S | FileCheck %s --check-prefix=USE
+
+; A profile without context sensitive records leaves the IR untouched.
+; RUN: llvm-profdata merge %S/Inputs/branch1.proftext -o %t.nocs.profdata
+; RUN: opt < %s -passes=cspgo-instr-use -pgo-test-profile-file=%t.nocs.profdata -S | FileCheck %s --check-prefix=NOCS
+; RUN: opt < %s -passes=pgo-instr-use,cspgo-instr-use -pgo-test-profile-file=%t.nocs.profdata -S | FileCheck %s --check-prefix=REGULAR
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The raw profile version has both the IR and the context sensitive flags set.
+; GEN: @__llvm_profile_raw_version = constant i64 216172782113783812, comdat
+
+define i32 @test_br_1(i32 %i) {
+; USE-LABEL: @test_br_1
+; USE-SAME: !prof ![[FUNC_ENTRY_COUNT:[0-9]+]]
+; NOCS-LABEL: @test_br_1
+; NOCS-NOT: !prof
+entry:
+  %cmp = icmp sgt i32 %i, 0
+  br i1 %cmp, label %if.then, label %if.end
+; USE: br i1 %cmp, label %if.then, label %if.end
+; USE-SAME: !prof ![[BW_ENTRY:[0-9]+]]
+; REGULAR: br i1 %cmp, label %if.then, label %if.end
+; REGULAR-SAME: !prof ![[BW_REGULAR:[0-9]+]]
+
+if.then:
+; GEN: if.then:
+; GEN: call void @llvm.instrprof.increment(i8* getelementptr inbounds ([9 x i8], [9 x i8]* @__profn_test_br_1, i32 0, i32 0), i64 1152921530178146050, i32 2, i32 1)
+  %add = add nsw i32 %i, 2
+  br label %if.end
+
+if.end:
+; GEN: if.end:
+; GEN: call void @llvm.instrprof.increment(i8* getelementptr inbounds ([9 x i8], [9 x i8]* @__profn_test_br_1, i32 0, i32 0), i64 1152921530178146050, i32 2, i32 0)
+  %retv = phi i32 [ %add, %if.then ], [ %i, %entry ]
+  ret i32 %retv
+}
+
+; The context sensitive records override the counts of the regular ones, but
+; the module keeps the regular profile summary.
+; USE-DAG: {{![0-9]+}} = !{!"MaxFunctionCount", i64 3}
+; USE-DAG: ![[FUNC_ENTRY_COUNT]] = !{!"function_entry_count", i64 10}
+; USE-DAG: ![[BW_ENTRY]] = !{!"branch_weights", i32 1, i32 9}
+; REGULAR-DAG: ![[BW_REGULAR]] = !{!"branch_weights", i32 2, i32 1}
@@ -1,6 +1,9 @@
 ; RUN: llvm-extract -func=a --recursive %s -S | FileCheck --check-prefix=CHECK-AB %s
 ; RUN: llvm-extract -func=a --recursive --delete %s -S | FileCheck --check-prefix=CHECK-CD %s
 ; RUN: llvm-extract -func=d --recursive %s -S | FileCheck --check-prefix=CHECK-CD %s
+; RUN: llvm-as -bitcode-function-deps %s -o %t.bc
+; RUN: llvm-extract -func=a --recursive %t.bc -S | FileCheck --check-prefix=CHECK-AB %s
+; RUN: llvm-extract -func=d --recursive %t.bc -S | FileCheck --check-prefix=CHECK-CD %s
 
 ; CHECK-AB: define void @a
 ; CHECK-AB: define void @b
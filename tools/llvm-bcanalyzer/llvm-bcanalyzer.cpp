@@ -39,6 +39,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cctype>
@@ -75,6 +76,11 @@ static cl::opt<std::string> CheckHash(
     "check-hash",
     cl::desc("Check module hash using the argument as a string table"));
 
+static cl::opt<unsigned> BenchmarkDecode(
+    "benchmark-decode", cl::init(0), cl::value_desc("N"),
+    cl::desc("Decode every record of the input N times and print the decode "
+             "throughput instead of analyzing it"));
+
 namespace {
 
 /// CurStreamTypeType - A type for CurStreamType
@@ -296,6 +302,7 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     STRINGIFY_CODE(VST_CODE, BBENTRY)
     STRINGIFY_CODE(VST_CODE, FNENTRY)
     STRINGIFY_CODE(VST_CODE, COMBINED_ENTRY)
+    STRINGIFY_CODE(VST_CODE, FNDEPS)
     }
   case bitc::MODULE_STRTAB_BLOCK_ID:
     switch (CodeID) {
@@ -964,6 +971,82 @@ static int AnalyzeBitcode() {
   return 0;
 }
 
+/// Decode every record of the block whose ID was just read, and of its nested
+/// blocks, the way a bitcode reader does, without interpreting them.
+static bool decodeBlock(BitstreamCursor &Stream, BitstreamBlockInfo &BlockInfo,
+                        unsigned BlockID, uint64_t &NumRecords) {
+  if (BlockID == bitc::BLOCKINFO_BLOCK_ID) {
+    Optional<BitstreamBlockInfo> NewBlockInfo = Stream.ReadBlockInfoBlock();
+    if (!NewBlockInfo)
+      return ReportError("Malformed BlockInfoBlock");
+    BlockInfo = std::move(*NewBlockInfo);
+    return false;
+  }
+
+  if (Stream.EnterSubBlock(BlockID))
+    return ReportError("Malformed block record");
+
+  SmallVector<uint64_t, 64> Record;
+  while (true) {
+    BitstreamEntry Entry = Stream.advance();
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return ReportError("malformed bitcode file");
+    case BitstreamEntry::EndBlock:
+      return false;
+    case BitstreamEntry::SubBlock:
+      if (decodeBlock(Stream, BlockInfo, Entry.ID, NumRecords))
+        return true;
+      continue;
+    case BitstreamEntry::Record:
+      break;
+    }
+
+    Record.clear();
+    StringRef Blob;
+    Stream.readRecord(Entry.ID, Record, &Blob);
+    ++NumRecords;
+  }
+}
+
+/// Time \p Runs full decodes of the input and print the record decoding
+/// throughput of the BitstreamCursor.
+static int benchmarkDecode(unsigned Runs) {
+  std::unique_ptr<MemoryBuffer> StreamBuffer;
+  BitstreamCursor Stream;
+  CurStreamTypeType CurStreamType;
+  if (openBitcodeFile(InputFilename, StreamBuffer, Stream, CurStreamType))
+    return true;
+
+  uint64_t StartBit = Stream.GetCurrentBitNo();
+  uint64_t NumBytes = Stream.getBitcodeBytes().size();
+  uint64_t NumRecords = 0;
+  double Min = 0;
+  for (unsigned Run = 0; Run != Runs; ++Run) {
+    BitstreamBlockInfo BlockInfo;
+    Stream.setBlockInfo(&BlockInfo);
+    Stream.JumpToBit(StartBit);
+    NumRecords = 0;
+
+    TimeRecord Start = TimeRecord::getCurrentTime(/*Start=*/true);
+    while (!Stream.AtEndOfStream()) {
+      if (Stream.ReadCode() != bitc::ENTER_SUBBLOCK)
+        return ReportError("Invalid record at top-level");
+      if (decodeBlock(Stream, BlockInfo, Stream.ReadSubBlockID(), NumRecords))
+        return true;
+    }
+    TimeRecord End = TimeRecord::getCurrentTime(/*Start=*/false);
+
+    double Elapsed = End.getWallTime() - Start.getWallTime();
+    Min = Run ? std::min(Min, Elapsed) : Elapsed;
+  }
+
+  outs() << "Decoded " << NumRecords << " records in " << NumBytes
+         << " bytes\n";
+  outs() << format("Best of %u runs: %.4fs, %.1f MB/s, %.1f Mrecords/s\n",
+                   Runs, Min, NumBytes / Min / 1e6, NumRecords / Min / 1e6);
+  return 0;
+}
 
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
@@ -972,5 +1055,7 @@ int main(int argc, char **argv) {
   llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
   cl::ParseCommandLineOptions(argc, argv, "llvm-bcanalyzer file analyzer\n");
 
+  if (BenchmarkDecode)
+    return benchmarkDecode(BenchmarkDecode);
   return AnalyzeBitcode();
 }
@@ -28,12 +28,15 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include <algorithm>
 #include <system_error>
 using namespace llvm;
 
@@ -69,6 +72,11 @@ static cl::opt<bool>
                         cl::desc("Load module without materializing metadata, "
                                  "then materialize only the metadata"));
 
+static cl::opt<unsigned> BenchmarkLoad(
+    "benchmark-load", cl::init(0), cl::Hidden, cl::value_desc("N"),
+    cl::desc("Load the input N times and print the wall time of each load "
+             "instead of disassembling it"));
+
 namespace {
 
 static void printDebugLoc(const DebugLoc &DL, formatted_raw_ostream &OS) {
@@ -161,6 +169,25 @@ static std::unique_ptr<Module> openInputFile(LLVMContext &Context) {
   return M;
 }
 
+/// Time \p Runs loads of the input, each into a fresh context, and print the
+/// wall time of every run. Together with -bitcode-materialize-threads this
+/// measures the parse time of large modules.
+static void benchmarkLoad(unsigned Runs) {
+  double Total = 0, Min = 0;
+  for (unsigned Run = 0; Run != Runs; ++Run) {
+    LLVMContext Context;
+    TimeRecord Start = TimeRecord::getCurrentTime(/*Start=*/true);
+    std::unique_ptr<Module> M = openInputFile(Context);
+    TimeRecord End = TimeRecord::getCurrentTime(/*Start=*/false);
+    double Elapsed = End.getWallTime() - Start.getWallTime();
+    Total += Elapsed;
+    Min = Run ? std::min(Min, Elapsed) : Elapsed;
+    errs() << "run " << Run << ": " << format("%.4f", Elapsed) << "s\n";
+  }
+  errs() << "min: " << format("%.4f", Min) << "s, mean: "
+         << format("%.4f", Total / Runs) << "s\n";
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal(argv[0]);
@@ -174,6 +201,11 @@ int main(int argc, char **argv) {
       llvm::make_unique<LLVMDisDiagnosticHandler>(argv[0]));
   cl::ParseCommandLineOptions(argc, argv, "llvm .bc -> .ll disassembler\n");
 
+  if (BenchmarkLoad) {
+    benchmarkLoad(BenchmarkLoad);
+    return 0;
+  }
+
   std::unique_ptr<Module> M = openInputFile(Context);
 
   // Just use stdout.  We won't actually print anything on it.
@@ -14,6 +14,7 @@
 
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriterPass.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IRPrintingPasses.h"
@@ -231,33 +232,10 @@ int main(int argc, char **argv) {
   // Use *argv instead of argv[0] to work around a wrong GCC warning.
   ExitOnError ExitOnErr(std::string(*argv) + ": error reading input: ");
 
-  if (Recursive) {
-    std::vector<llvm::Function *> Workqueue;
-    for (GlobalValue *GV : GVs) {
-      if (auto *F = dyn_cast<Function>(GV)) {
-        Workqueue.push_back(F);
-      }
-    }
-    while (!Workqueue.empty()) {
-      Function *F = &*Workqueue.back();
-      Workqueue.pop_back();
-      ExitOnErr(F->materialize());
-      for (auto &BB : *F) {
-        for (auto &I : BB) {
-          auto *CI = dyn_cast<CallInst>(&I);
-          if (!CI)
-            continue;
-          Function *CF = CI->getCalledFunction();
-          if (!CF)
-            continue;
-          if (CF->isDeclaration() || GVs.count(CF))
-            continue;
-          GVs.insert(CF);
-          Workqueue.push_back(CF);
-        }
-      }
-    }
-  }
+  // Add the called functions. If the input was written with a function
+  // dependency index, this reads no function bodies but the extracted ones.
+  if (Recursive)
+    ExitOnErr(materializeWithDependencies(GVs, /*CallsOnly=*/true));
 
   auto Materialize = [&](GlobalValue &GV) { ExitOnErr(GV.materialize()); };
 
@@ -15,6 +15,7 @@
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/DataTypes.h"
@@ -90,5 +91,35 @@ TEST_F(BlockFrequencyInfoTest, Basic) {
   EXPECT_EQ(BFI.getBlockFreq(BB3).getFrequency(), BB3Freq);
 }
 
+TEST_F(BlockFrequencyInfoTest, IncrementalUpdate) {
+  auto M = makeLLVMModule();
+  Function *F = M->getFunction("f");
+
+  BlockFrequencyInfo BFI = buildBFI(*F);
+  BasicBlock &BB0 = F->getEntryBlock();
+  BasicBlock *BB1 = BB0.getTerminator()->getSuccessor(0);
+  BasicBlock *BB3 = BB1->getSingleSuccessor();
+  uint64_t BB1Freq = BFI.getBlockFreq(BB1).getFrequency();
+
+  // Split the edge from bb0 to bb1.
+  BasicBlock *NewBB = BasicBlock::Create(C, "split", F, BB1);
+  BranchInst::Create(BB1, NewBB);
+  BB0.getTerminator()->setSuccessor(0, NewBB);
+  BFI.setBlockFreqForSplitEdge(NewBB, &BB0, BPI->getEdgeProbability(&BB0, 0u));
+  EXPECT_NEAR(BFI.getBlockFreq(NewBB).getFrequency(), BB1Freq, 1);
+
+  // Merge bb1 into the new block.
+  uint64_t NewBBFreq = BFI.getBlockFreq(NewBB).getFrequency();
+  BB1->getTerminator()->eraseFromParent();
+  NewBB->getTerminator()->eraseFromParent();
+  BranchInst::Create(BB3, NewBB);
+  cast<PHINode>(BB3->begin())->setIncomingBlock(0, NewBB);
+  BFI.eraseBlock(BB1);
+  BB1->eraseFromParent();
+  EXPECT_EQ(BFI.getBlockFreq(NewBB).getFrequency(), NewBBFreq);
+  EXPECT_EQ(BFI.getBlockFreq(BB3).getFrequency(),
+            BFI.getBlockFreq(&BB0).getFrequency());
+}
+
 } // end anonymous namespace
 } // end namespace llvm
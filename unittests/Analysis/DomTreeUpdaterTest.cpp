@@ -0,0 +1,142 @@
+//===- DomTreeUpdaterTest.cpp - DomTreeUpdater unit tests -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/DomTreeUpdater.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+static std::unique_ptr<Module> makeLLVMModule(LLVMContext &Context,
+                                              StringRef ModuleStr) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(ModuleStr, Err, Context);
+  assert(M && "Bad assembly?");
+  return M;
+}
+
+static const char *DiamondModule = "define void @f(i1 %c) {\n"
+                                   "entry:\n"
+                                   "  br i1 %c, label %left, label %right\n"
+                                   "left:\n"
+                                   "  br label %exit\n"
+                                   "right:\n"
+                                   "  br label %exit\n"
+                                   "exit:\n"
+                                   "  ret void\n"
+                                   "}\n";
+
+static BasicBlock *getBlock(Function &F, StringRef Name) {
+  for (BasicBlock &BB : F)
+    if (BB.getName() == Name)
+      return &BB;
+  return nullptr;
+}
+
+TEST(DomTreeUpdater, LazyEdgeDeletion) {
+  LLVMContext Context;
+  auto M = makeLLVMModule(Context, DiamondModule);
+  Function &F = *M->getFunction("f");
+  DominatorTree DT(F);
+  PostDominatorTree PDT;
+  PDT.recalculate(F);
+  DomTreeUpdater DTU(&DT, &PDT, DomTreeUpdater::UpdateStrategy::Lazy);
+
+  BasicBlock *Entry = getBlock(F, "entry");
+  BasicBlock *Left = getBlock(F, "left");
+  BasicBlock *Right = getBlock(F, "right");
+  BasicBlock *Exit = getBlock(F, "exit");
+
+  // Replace the conditional branch by a branch to the left side only.
+  Entry->getTerminator()->eraseFromParent();
+  BranchInst::Create(Left, Entry);
+  DTU.deleteEdge(Entry, Right);
+  EXPECT_TRUE(DTU.hasPendingDomTreeUpdates());
+  EXPECT_TRUE(DTU.hasPendingPostDomTreeUpdates());
+
+  // Asking for one tree only brings that tree up to date.
+  EXPECT_TRUE(DTU.getDomTree().verify());
+  EXPECT_FALSE(DTU.hasPendingDomTreeUpdates());
+  EXPECT_TRUE(DTU.hasPendingPostDomTreeUpdates());
+  EXPECT_TRUE(DT.dominates(Left, Exit));
+
+  // The unreachable block can now go; it is erased once both trees are done.
+  DTU.deleteBB(Right);
+  EXPECT_TRUE(DTU.isBBPendingDeletion(Right));
+  EXPECT_EQ(F.size(), 4u);
+  DTU.flush();
+  EXPECT_FALSE(DTU.hasPendingUpdates());
+  EXPECT_FALSE(DTU.hasPendingDeletedBB());
+  EXPECT_EQ(F.size(), 3u);
+  EXPECT_TRUE(DT.verify());
+  EXPECT_TRUE(PDT.verify());
+  EXPECT_TRUE(PDT.dominates(Left, Entry));
+}
+
+TEST(DomTreeUpdater, EagerEdgeInsertion) {
+  LLVMContext Context;
+  auto M = makeLLVMModule(Context, DiamondModule);
+  Function &F = *M->getFunction("f");
+  DominatorTree DT(F);
+  PostDominatorTree PDT;
+  PDT.recalculate(F);
+  DomTreeUpdater DTU(&DT, &PDT, DomTreeUpdater::UpdateStrategy::Eager);
+
+  BasicBlock *Left = getBlock(F, "left");
+  BasicBlock *Right = getBlock(F, "right");
+  BasicBlock *Exit = getBlock(F, "exit");
+
+  // Let the left side also branch to the right one.
+  Left->getTerminator()->eraseFromParent();
+  BranchInst::Create(Right, Exit, UndefValue::get(Type::getInt1Ty(Context)),
+                     Left);
+  DTU.insertEdge(Left, Right);
+  EXPECT_FALSE(DTU.hasPendingUpdates());
+  EXPECT_TRUE(DT.verify());
+  EXPECT_TRUE(PDT.verify());
+  EXPECT_FALSE(DT.dominates(Right, Exit));
+}
+
+TEST(DomTreeUpdater, LazyBatchRecalculation) {
+  LLVMContext Context;
+  auto M = makeLLVMModule(Context, DiamondModule);
+  Function &F = *M->getFunction("f");
+  DominatorTree DT(F);
+  PostDominatorTree PDT;
+  PDT.recalculate(F);
+
+  BasicBlock *Entry = getBlock(F, "entry");
+  BasicBlock *Left = getBlock(F, "left");
+  BasicBlock *Right = getBlock(F, "right");
+  BasicBlock *Exit = getBlock(F, "exit");
+  {
+    DomTreeUpdater DTU(&DT, &PDT, DomTreeUpdater::UpdateStrategy::Lazy);
+
+    // Branch straight to the exit, making both sides dead.
+    Entry->getTerminator()->eraseFromParent();
+    BranchInst::Create(Exit, Entry);
+    DTU.applyUpdates({{DominatorTree::Insert, Entry, Exit},
+                      {DominatorTree::Delete, Entry, Left},
+                      {DominatorTree::Delete, Entry, Right}});
+    DTU.deleteBB(Left);
+    DTU.deleteBB(Right);
+    // The updater flushes on destruction.
+  }
+  EXPECT_EQ(F.size(), 2u);
+  EXPECT_TRUE(DT.verify());
+  EXPECT_TRUE(PDT.verify());
+  EXPECT_EQ(DT.getNode(Exit)->getIDom()->getBlock(), Entry);
+}
@@ -791,6 +791,53 @@ TEST_F(MemorySSATest, WalkerInvariantLoadOpt) {
   EXPECT_EQ(LoadClobber, MSSA.getLiveOnEntryDef());
 }
 
+// Test that queries with an explicit location see changes to MemorySSA made
+// after an earlier query for the same access and location.
+TEST_F(MemorySSATest, WalkerLocationCache) {
+  F = Function::Create(FunctionType::get(B.getVoidTy(), {}, false),
+                       GlobalValue::ExternalLinkage, "F", &M);
+  B.SetInsertPoint(BasicBlock::Create(C, "", F));
+  Type *Int8 = Type::getInt8Ty(C);
+  Constant *One = ConstantInt::get(Int8, 1);
+  Value *AllocA = B.CreateAlloca(Int8, One, "a");
+  Value *AllocB = B.CreateAlloca(Int8, One, "b");
+
+  Instruction *SA = B.CreateStore(One, AllocA);
+  // A long chain of stores the walker has to step over.
+  for (unsigned I = 0; I < 64; ++I)
+    B.CreateStore(One, AllocB);
+  Instruction *LastSB = B.CreateStore(One, AllocB);
+  Instruction *Load = B.CreateLoad(AllocB);
+
+  setupAnalyses();
+  MemorySSA &MSSA = *Analyses->MSSA;
+  MemorySSAWalker *Walker = Analyses->Walker;
+  MemorySSAUpdater Updater(&MSSA);
+
+  MemoryLocation LocA(AllocA, 1);
+  MemoryAccess *LoadMA = MSSA.getMemoryAccess(Load);
+  EXPECT_EQ(Walker->getClobberingMemoryAccess(LoadMA, LocA),
+            MSSA.getMemoryAccess(SA));
+  // Asking again gives the same answer.
+  EXPECT_EQ(Walker->getClobberingMemoryAccess(LoadMA, LocA),
+            MSSA.getMemoryAccess(SA));
+
+  // Store to A again right before the load; the cached answer is stale now.
+  B.SetInsertPoint(Load);
+  Instruction *NewSA = B.CreateStore(One, AllocA);
+  MemoryAccess *NewSAMA = Updater.createMemoryAccessAfter(
+      NewSA, MSSA.getMemoryAccess(LastSB), MSSA.getMemoryAccess(LastSB));
+  Updater.insertDef(cast<MemoryDef>(NewSAMA), /*RenameUses=*/true);
+  EXPECT_EQ(cast<MemoryUse>(LoadMA)->getDefiningAccess(), NewSAMA);
+  EXPECT_EQ(Walker->getClobberingMemoryAccess(LoadMA, LocA), NewSAMA);
+
+  // Removing the new store brings back the old answer.
+  Updater.removeMemoryAccess(NewSAMA);
+  NewSA->eraseFromParent();
+  EXPECT_EQ(Walker->getClobberingMemoryAccess(LoadMA, LocA),
+            MSSA.getMemoryAccess(SA));
+}
+
 // Test loads get reoptimized properly by the walker.
 TEST_F(MemorySSATest, WalkerReopt) {
   F = Function::Create(FunctionType::get(B.getVoidTy(), {}, false),
@@ -174,7 +174,7 @@ TEST_F(InstrProfTest, get_profile_summary) {
     ASSERT_EQ(288230376151711744U, NinetyFivePerc->MinCount);
     ASSERT_EQ(72057594037927936U, NinetyNinePerc->MinCount);
   };
-  ProfileSummary &PS = Reader->getSummary();
+  ProfileSummary &PS = Reader->getSummary(false);
   VerifySummary(PS);
 
   // Test that conversion of summary to and from Metadata works.
@@ -801,7 +801,31 @@ TEST_P(MaybeSparseInstrProfTest, get_max_function_count) {
   auto Profile = Writer.writeBuffer();
   readProfile(std::move(Profile));
 
-  ASSERT_EQ(1ULL << 63, Reader->getMaximumFunctionCount());
+  ASSERT_EQ(1ULL << 63, Reader->getMaximumFunctionCount(false));
+}
+
+TEST_P(MaybeSparseInstrProfTest, get_cs_max_function_count) {
+  uint64_t CSHash = 0x1234;
+  NamedInstrProfRecord::setCSFlagInHash(CSHash);
+  Writer.addRecord({"foo", 0x1234, {1000, 2}}, Err);
+  Writer.addRecord({"foo", CSHash, {50, 2}}, Err);
+  Writer.addRecord({"bar", CSHash, {70}}, Err);
+  ASSERT_THAT_ERROR(Writer.setIsIRLevelProfile(true, false), Succeeded());
+  ASSERT_THAT_ERROR(Writer.setIsIRLevelProfile(true, true), Succeeded());
+  ASSERT_THAT_ERROR(Writer.setIsIRLevelProfile(false, false), Failed());
+  auto Profile = Writer.writeBuffer();
+  readProfile(std::move(Profile));
+
+  ASSERT_TRUE(Reader->isIRLevelProfile());
+  ASSERT_TRUE(Reader->hasCSIRLevelProfile());
+  ASSERT_EQ(1000U, Reader->getMaximumFunctionCount(false));
+  ASSERT_EQ(70U, Reader->getMaximumFunctionCount(true));
+  ASSERT_EQ(1U, Reader->getSummary(false).getNumFunctions());
+  ASSERT_EQ(2U, Reader->getSummary(true).getNumFunctions());
+
+  Expected<InstrProfRecord> R = Reader->getInstrProfRecord("foo", CSHash);
+  EXPECT_THAT_ERROR(R.takeError(), Succeeded());
+  ASSERT_EQ(50U, R->Counts[0]);
 }
 
 TEST_P(MaybeSparseInstrProfTest, get_weighted_function_counts) {
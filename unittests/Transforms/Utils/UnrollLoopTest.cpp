@@ -0,0 +1,130 @@
+//===- UnrollLoopTest.cpp - Unit tests for UnrollLoop ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/UnrollLoop.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/DomTreeUpdater.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+static std::unique_ptr<Module> parseIR(LLVMContext &C, const char *IR) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> Mod = parseAssemblyString(IR, Err, C);
+  if (!Mod)
+    Err.print("UnrollLoopTests", errs());
+  return Mod;
+}
+
+static BasicBlock *getBlock(Function &F, StringRef Name) {
+  for (BasicBlock &BB : F)
+    if (BB.getName() == Name)
+      return &BB;
+  return nullptr;
+}
+
+TEST(UnrollLoop, FoldBlockIntoPredecessorUpdatesDomTrees) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = parseIR(C, R"(
+    define void @f(i1 %c, i1 %d) {
+    entry:
+      br i1 %c, label %a, label %exit
+    a:
+      br label %b
+    b:
+      br i1 %d, label %left, label %exit
+    left:
+      br label %exit
+    exit:
+      ret void
+    }
+  )");
+  Function &F = *M->getFunction("f");
+  DominatorTree DT(F);
+  PostDominatorTree PDT;
+  PDT.recalculate(F);
+  LoopInfo LI(DT);
+  DomTreeUpdater DTU(&DT, &PDT, DomTreeUpdater::UpdateStrategy::Lazy);
+
+  BasicBlock *A = getBlock(F, "a");
+  BasicBlock *B = getBlock(F, "b");
+  BasicBlock *Left = getBlock(F, "left");
+  BasicBlock *Exit = getBlock(F, "exit");
+
+  SmallPtrSet<Loop *, 4> ForgottenLoops;
+  EXPECT_EQ(foldBlockIntoPredecessor(B, &LI, nullptr, ForgottenLoops, &DTU), A);
+
+  // %b stays around, emptied, until the trees have seen its edges go away.
+  EXPECT_TRUE(DTU.isBBPendingDeletion(B));
+  DTU.flush();
+  EXPECT_EQ(F.size(), 4u);
+
+  EXPECT_TRUE(DT.verify());
+  EXPECT_TRUE(PDT.verify());
+  EXPECT_EQ(DT.getNode(Left)->getIDom()->getBlock(), A);
+  EXPECT_EQ(PDT.getNode(A)->getIDom()->getBlock(), Exit);
+}
+
+TEST(UnrollLoop, PartialUnrollUpdatesDomTree) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = parseIR(C, R"(
+    define void @f(i1 %c) {
+    entry:
+      br label %header
+    header:
+      %iv = phi i32 [ 0, %entry ], [ %iv.next, %latch ]
+      br i1 %c, label %early, label %latch
+    latch:
+      %iv.next = add nuw nsw i32 %iv, 1
+      %cmp = icmp ult i32 %iv.next, 4
+      br i1 %cmp, label %header, label %exit
+    early:
+      br label %join
+    exit:
+      br label %join
+    join:
+      ret void
+    }
+  )");
+  Function &F = *M->getFunction("f");
+  DominatorTree DT(F);
+  LoopInfo LI(DT);
+  AssumptionCache AC(F);
+  TargetLibraryInfoImpl TLII;
+  TargetLibraryInfo TLI(TLII);
+  ScalarEvolution SE(F, TLI, AC, DT, LI);
+
+  Loop *L = *LI.begin();
+  EXPECT_EQ(UnrollLoop(L, 2, 4, false, false, false, false, false, 4, 0, false,
+                       &LI, &SE, &DT, &AC, nullptr, true),
+            LoopUnrollResult::PartiallyUnrolled);
+
+  // The exit is now reached from the second copy of the latch only, while the
+  // early exit and the join are reached from both copies of the header.
+  EXPECT_TRUE(DT.verify());
+  DominatorTree Fresh(F);
+  EXPECT_FALSE(DT.compare(Fresh));
+  BasicBlock *Header = getBlock(F, "header");
+  BasicBlock *LastLatch = getBlock(F, "latch.1");
+  ASSERT_NE(LastLatch, nullptr);
+  EXPECT_EQ(getBlock(F, "exit")->getSinglePredecessor(), LastLatch);
+  EXPECT_EQ(DT.getNode(getBlock(F, "exit"))->getIDom()->getBlock(), LastLatch);
+  EXPECT_EQ(DT.getNode(getBlock(F, "early"))->getIDom()->getBlock(), Header);
+  EXPECT_EQ(DT.getNode(getBlock(F, "join"))->getIDom()->getBlock(), Header);
+}